@@ -9,11 +9,12 @@ uniform sampler2D waterTexture;
 uniform sampler2D boxTexture;
 uniform float time;
 uniform vec3 viewPos;
-uniform bool isBox;
+
+// SURFACE_BOAT or water, as in 7.4.camera.vs
 
 void main()
 {
-    if (isBox) {
+#ifdef SURFACE_BOAT
         // Box rendering - textured box with brown tint
         vec4 boxColor = texture(boxTexture, TexCoord);
         
@@ -34,7 +35,7 @@ void main()
         
         vec3 finalColor = tintedColor * 0.9f + diffuse; // x + specular
         FragColor = vec4(finalColor, 1.0f);
-    } else {
+#else
         // Water rendering - animated texture coordinates for flowing water effect
         vec2 animatedTexCoord = TexCoord + vec2(time * 0.1f, time * 0.05f);
         
@@ -63,5 +64,5 @@ void main()
         float alpha = 0.9f + 0.1f * sin(time * 2.0f + FragPos.x * 3.0f + FragPos.z * 2.0f);
         
         FragColor = vec4(finalColor, alpha);
-    }
+#endif
 }
\ No newline at end of file
@@ -10,13 +10,15 @@ uniform mat4 model;
 uniform mat4 view;
 uniform mat4 projection;
 uniform float time;
-uniform bool isBox;
+
+// built as two permutations (common/shader_permutations.h): SURFACE_BOAT for the
+// boat, otherwise the water
 
 void main()
 {
     vec3 pos = aPos;
     
-    if (isBox) {
+#ifdef SURFACE_BOAT
         // Boat rendering - calculate proper normals for lighting
         // For a boat hull, we'll use a simple approach
         vec3 worldPos = vec3(model * vec4(pos, 1.0f));
@@ -31,7 +33,7 @@ void main()
             float side = sign(pos.x);
             Normal = normalize(vec3(side, 0.3f, 0.0f));
         }
-    } else {
+#else
         // Water rendering - apply wave animation
         // Add subtle high-frequency waves in the shader
         float wave = 0.05f * sin(pos.x * 8.0f + time * 3.0f) * cos(pos.z * 6.0f + time * 2.5f);
@@ -41,7 +43,7 @@ void main()
         float dx = 0.05f * 8.0f * cos(pos.x * 8.0f + time * 3.0f) * cos(pos.z * 6.0f + time * 2.5f);
         float dz = -0.05f * 6.0f * sin(pos.x * 8.0f + time * 3.0f) * sin(pos.z * 6.0f + time * 2.5f);
         Normal = normalize(vec3(-dx, 1.0f, -dz));
-    }
+#endif
     
     FragPos = vec3(model * vec4(pos, 1.0f));
     gl_Position = projection * view * model * vec4(pos, 1.0f);
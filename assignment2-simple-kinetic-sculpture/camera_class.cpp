@@ -10,14 +10,29 @@
 #include <learnopengl/shader_m.h>
 #include <learnopengl/camera.h>
 
+#include "../common/headless.h"
+#include "../common/frame_profiler.h"
+#include "../common/bench.h"
+#include "../common/texture_manager.h"
+#include "../common/shader_permutations.h"
+#include "../common/frame_pipeline.h"
+
 #include <iostream>
 #include <vector>
 #include <cmath>
+#include <cstring>
 
 void framebuffer_size_callback(GLFWwindow* window, int width, int height);
 void mouse_callback(GLFWwindow* window, double xpos, double ypos);
 void scroll_callback(GLFWwindow* window, double xoffset, double yoffset);
 void processInput(GLFWwindow *window);
+uint32_t sampleInputKeys(GLFWwindow *window);
+void applyCameraInput(const InputFrame& input, float dt);
+float waveHeight(float x, float z, float time);
+void buildWaveGrid(int gridSize, std::vector<float>& vertices, std::vector<unsigned int>& indices);
+void updateWaveGrid(std::vector<float>& vertices, int gridSize, float time);
+int runHeadless(const HeadlessOptions& options);
+int runBenchmarks(const BenchOptions& options);
 
 // settings
 const unsigned int SCR_WIDTH = 800;
@@ -33,8 +48,41 @@ bool firstMouse = true;
 float deltaTime = 0.0f;	// time between current frame and last frame
 float lastFrame = 0.0f;
 
-int main()
+// wave grid resolution (vertices per side)
+const int GRID_SIZE = 64;
+
+// input gathered from callbacks during the frame, applied once per frame
+InputFrame pendingInput;
+
+// --pipelined: the worker builds the next frame's wave grid while this frame draws.
+// --pipeline-stress: uncapped frame rate, alternating sequential and pipelined phases that
+// report their frame rate and update/render overlap
+bool usePipeline = false;
+bool pipelineStress = false;
+
+// one frame of the water: the displaced grid and the time it was built for
+struct WaveSnapshot
 {
+    std::vector<float> vertices;
+    float time = 0.0f;
+};
+
+int main(int argc, char** argv)
+{
+    HeadlessOptions options = ParseHeadlessOptions(argc, argv);
+    BenchOptions benchOptions = ParseBenchOptions(argc, argv);
+    if (benchOptions.enabled)
+        return runBenchmarks(benchOptions);
+    if (options.enabled)
+        return runHeadless(options);
+    for (int i = 1; i < argc; ++i)
+    {
+        if (std::strcmp(argv[i], "--pipelined") == 0)
+            usePipeline = true;
+        else if (std::strcmp(argv[i], "--pipeline-stress") == 0)
+            usePipeline = pipelineStress = true;
+    }
+
     // glfw: initialize and configure
     // ------------------------------
     glfwInit();
@@ -56,6 +104,8 @@ int main()
         return -1;
     }
     glfwMakeContextCurrent(window);
+    if (pipelineStress)
+        glfwSwapInterval(0);
     glfwSetFramebufferSizeCallback(window, framebuffer_size_callback);
     glfwSetCursorPosCallback(window, mouse_callback);
     glfwSetScrollCallback(window, scroll_callback);
@@ -79,57 +129,25 @@ int main()
 
     // build and compile our shader zprogram
     // ------------------------------------
-    Shader ourShader("7.4.camera.vs", "7.4.camera.fs");
+    ShaderCache shaders;
+    shaders.ParseOptions(argc, argv);
+    // water and boat are separate builds of 7.4.camera.*, selected by permutation key per draw
+    ShaderPermutations surfaceShaders(shaders, "7.4.camera.vs", "7.4.camera.fs");
+    ShaderPermutation waterSurface;
+    waterSurface.surface = SurfaceVariant::Water;
+    ShaderPermutation boatSurface;
+    boatSurface.surface = SurfaceVariant::Boat;
+    const ShaderPermutation surfaces[] = { waterSurface, boatSurface };
+    for (const ShaderPermutation& surface : surfaces)
+        surfaceShaders.Get(surface);
     ////////////////////////////
     // wave model (plane with subdivided grid)
     ////////////////////////////
 
-    // Wave animation parameters
-    const int GRID_SIZE = 64;
-    const int VERTEX_COUNT = GRID_SIZE * GRID_SIZE;
-    const int TRIANGLE_COUNT = (GRID_SIZE - 1) * (GRID_SIZE - 1) * 6;
-    
-    // Generate subdivided plane vertices
+    // Generate subdivided plane vertices and triangle indices
     std::vector<float> vertices;
     std::vector<unsigned int> indices;
-    
-    // Generate vertices
-    for (int i = 0; i < GRID_SIZE; i++) {
-        for (int j = 0; j < GRID_SIZE; j++) {
-            float x = ((float)j / (GRID_SIZE - 1)) * 2.0f - 1.0f; // -1 to 1
-            float z = ((float)i / (GRID_SIZE - 1)) * 2.0f - 1.0f;
-            float y = 0.0f;
-            
-            // Position
-            vertices.push_back(x);
-            vertices.push_back(y);
-            vertices.push_back(z);
-            
-            // Texture coordinates
-            vertices.push_back((float)j / (GRID_SIZE - 1)); // 0 to 1
-            vertices.push_back((float)i / (GRID_SIZE - 1));
-        }
-    }
-    
-    // Generate edge for triangles
-    for (int i = 0; i < GRID_SIZE - 1; i++) {
-        for (int j = 0; j < GRID_SIZE - 1; j++) {
-            int topLeft = i * GRID_SIZE + j;
-            int topRight = topLeft + 1;
-            int bottomLeft = (i + 1) * GRID_SIZE + j;
-            int bottomRight = bottomLeft + 1;
-            
-            // First triangle
-            indices.push_back(topLeft);
-            indices.push_back(bottomLeft);
-            indices.push_back(topRight);
-            
-            // Second triangle
-            indices.push_back(topRight);
-            indices.push_back(bottomLeft);
-            indices.push_back(bottomRight);
-        }
-    }
+    buildWaveGrid(GRID_SIZE, vertices, indices);
 
     unsigned int VBO, VAO, EBO;
     glGenVertexArrays(1, &VAO);
@@ -154,29 +172,15 @@ int main()
 
     // load and create water texture 
     // -----------------------------
-    unsigned int waterTexture;
-    glGenTextures(1, &waterTexture);
-    glBindTexture(GL_TEXTURE_2D, waterTexture);
-    // set the texture wrapping parameters
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_REPEAT);
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_REPEAT);
-    // set texture filtering parameters
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
-    // load image, create texture and generate mipmaps
-    int width, height, nrChannels;
-    stbi_set_flip_vertically_on_load(true); // tell stb_image.h to flip loaded texture's on the y-axis.
-    unsigned char *data = stbi_load(FileSystem::getPath("resources/textures/wave.jpg").c_str(), &width, &height, &nrChannels, 0);
-    if (data)
-    {
-        glTexImage2D(GL_TEXTURE_2D, 0, GL_RGB, width, height, 0, GL_RGB, GL_UNSIGNED_BYTE, data);
-        glGenerateMipmap(GL_TEXTURE_2D);
-    }
-    else
-    {
+    // both textures tile with GL_REPEAT, flipped on the y-axis, without mipmaps
+    TextureManager textures;
+    textures.ParseOptions(argc, argv);
+    TextureOptions textureOptions;
+    textureOptions.mipmaps = false;
+    textureOptions.flipVertically = true;
+    unsigned int waterTexture = textures.Load(FileSystem::getPath("resources/textures/wave.jpg"), textureOptions);
+    if (!waterTexture)
         std::cout << "Failed to load water texture" << std::endl;
-    }
-    stbi_image_free(data);
 
     ////////////////////////////
     // Boat Model
@@ -264,31 +268,8 @@ int main()
     glEnableVertexAttribArray(1);
     
     // Load box texture
-    unsigned int boxTexture;
-    glGenTextures(1, &boxTexture);
-    glBindTexture(GL_TEXTURE_2D, boxTexture);
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_REPEAT);
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_REPEAT);
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
-    
-    // Load block.png texture for the box
-    int boxWidth, boxHeight, boxNrChannels;
-    unsigned char *boxData = stbi_load(FileSystem::getPath("resources/textures/container2.png").c_str(), &boxWidth, &boxHeight, &boxNrChannels, 0);
-    if (boxData)
-    {
-        GLenum format;
-        if (boxNrChannels == 1)
-            format = GL_RED;
-        else if (boxNrChannels == 3)
-            format = GL_RGB;
-        else if (boxNrChannels == 4)
-            format = GL_RGBA;
-            
-        glTexImage2D(GL_TEXTURE_2D, 0, format, boxWidth, boxHeight, 0, format, GL_UNSIGNED_BYTE, boxData);
-        glGenerateMipmap(GL_TEXTURE_2D);
-    }
-    else
+    unsigned int boxTexture = textures.Load(FileSystem::getPath("resources/textures/container2.png"), textureOptions);
+    if (!boxTexture)
     {
         std::cout << "Failed to load block texture" << std::endl;
         // Fallback to brown solid color if texture fails to load
@@ -298,17 +279,51 @@ int main()
             230, 230, 230, 255, 
             230, 230, 230, 255,
         };
-        glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA, 2, 2, 0, GL_RGBA, GL_UNSIGNED_BYTE, brownData);
+        boxTexture = textures.Create("box fallback", brownData, 2, 2, 4, textureOptions);
     }
-    stbi_image_free(boxData);
  
 
     // tell opengl for each sampler to which texture unit it belongs to (only has to be done once)
     // -------------------------------------------------------------------------------------------
-    ourShader.use();
-    ourShader.setInt("waterTexture", 0);
-    ourShader.setInt("boxTexture", 0);
+    for (const ShaderPermutation& surface : surfaces)
+    {
+        ShaderProgram& surfaceShader = surfaceShaders.Get(surface);
+        surfaceShader.use();
+        surfaceShader.setInt("waterTexture", 0);
+        surfaceShader.setInt("boxTexture", 0);
+    }
 
+    InputRecording recording;
+    uint64_t frameIndex = 0;
+
+    // per-stage CPU scopes and GPU passes
+    // -----------------------------------
+    FrameProfiler profiler;
+    profiler.ParseOptions(argc, argv);
+    const int inputScope = profiler.RegisterScope("input");
+    const int waveScope = profiler.RegisterScope("wave update");
+    const int uniformScope = profiler.RegisterScope("uniform upload");
+    const int drawScope = profiler.RegisterScope("draw submission");
+    const int waterPass = profiler.RegisterGpuPass("water");
+    const int boatPass = profiler.RegisterGpuPass("boat");
+
+    shaders.StartHotReload(window);
+
+    // --pipelined: the worker builds its grid from its own copy of the vertices, for the
+    // time handed over before BeginUpdate; the render thread draws the front snapshot
+    FramePipeline<WaveSnapshot> pipeline;
+    float stageTime = 0.0f;
+    const FramePipeline<WaveSnapshot>::UpdateStage updateStage = [&](WaveSnapshot& next) {
+        if (next.vertices.empty())
+            next.vertices = vertices;
+        next.time = stageTime;
+        updateWaveGrid(next.vertices, GRID_SIZE, next.time);
+    };
+    bool pipelined = usePipeline;
+    if (pipelined)
+        pipeline.Start(updateStage);
+    PipelineStress stress;
+    stress.Begin(glfwGetTime());
 
     // render loop
     // -----------
@@ -319,110 +334,166 @@ int main()
         float currentFrame = static_cast<float>(glfwGetTime());
         deltaTime = currentFrame - lastFrame;
         lastFrame = currentFrame;
+        profiler.BeginFrame();
+        shaders.Poll();
 
         // input
         // -----
-        processInput(window);
-
-        // render
-        glClearColor(0.1f, 0.2f, 0.4f, 1.0f);
-        glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT); 
+        {
+            ProfileScope scope(profiler, inputScope);
+            processInput(window);
+            pendingInput.keys = sampleInputKeys(window);
+            if (!options.recordPath.empty())
+                recording.Push(frameIndex, pendingInput);
+            applyCameraInput(pendingInput, deltaTime);
+            pendingInput = InputFrame();
+            ++frameIndex;
+        }
 
         // get time parameter for animate
         float time = static_cast<float>(glfwGetTime());
-        
+
         ////////////////////////////
-        // wave animation
+        // wave animation: this frame's, or pipelined, the grid the worker built during the last frame
         ////////////////////////////
-        for (int i = 0; i < GRID_SIZE; i++) {
-            for (int j = 0; j < GRID_SIZE; j++) {
-                int vertexIndex = (i * GRID_SIZE + j) * 5; // 5 floats per vertex (x,y,z,u,v)
-                
-                float x = vertices[vertexIndex];
-                float z = vertices[vertexIndex + 2];
-                
-                // Water Movement!!!!
-                float wave1 = 0.1f * sin(x * 2.0f + time * 1.5f) * cos(z * 1.5f + time * 1.2f);
-                float wave2 = 0.2f * cos(x * 3.0f + time * 2.0f) * sin(z * 2.0f + time * 1.8f);
-                float wave3 = 0.15f * sin(x * 4.0f + time * 2.5f) * cos(z * 3.0f + time * 2.2f);
-                float wave4 = 0.1f * sin(x * 5.0f + time * 3.0f) * sin(z * 4.0f + time * 2.8f);
-                
-                // Combine waves
-                float y = wave1 + wave2 + wave3 + wave4;
-                vertices[vertexIndex + 1] = y; // Update Y position
-            }
+        const std::vector<float>* waveVertices = &vertices;
+        if (pipelined)
+        {
+            stageTime = time;
+            pipeline.BeginUpdate();
+            pipeline.BeginRender();
+            waveVertices = &pipeline.Front().vertices;
+            time = pipeline.Front().time;
+        }
+        else
+        {
+            ProfileScope scope(profiler, waveScope);
+            updateWaveGrid(vertices, GRID_SIZE, time);
         }
-        
-        // Update vertex buffer with new positions
-        glBindBuffer(GL_ARRAY_BUFFER, VBO);
-        glBufferSubData(GL_ARRAY_BUFFER, 0, vertices.size() * sizeof(float), vertices.data());
-
-        // bind texture
-        glActiveTexture(GL_TEXTURE0);
-        glBindTexture(GL_TEXTURE_2D, waterTexture);
-
-        // activate shader
-        ourShader.use();
 
+        // render
+        glClearColor(0.1f, 0.2f, 0.4f, 1.0f);
+        glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT); 
+        
         // pass projection matrix to shader (note that in this case it could change every frame)
         glm::mat4 projection = glm::perspective(glm::radians(camera.Zoom), (float)SCR_WIDTH / (float)SCR_HEIGHT, 0.1f, 100.0f);
-        ourShader.setMat4("projection", projection);
 
         // camera/view transformation
         glm::mat4 view = camera.GetViewMatrix();
-        ourShader.setMat4("view", view);
 
-        // pass time uniform for additional shader effects
-        ourShader.setFloat("time", time);
-        ourShader.setVec3("viewPos", camera.Position);
+        {
+            ProfileScope scope(profiler, uniformScope);
 
-        // render the animated plane
-        glBindVertexArray(VAO);
-        glm::mat4 model = glm::mat4(1.0f);
-        model = glm::scale(model, glm::vec3(5.0f, 1.0f, 5.0f)); // Scale up the plane
-        ourShader.setMat4("model", model);
-        ourShader.setBool("isBox", false); // This is water, not box
+            // Update vertex buffer with new positions
+            glBindBuffer(GL_ARRAY_BUFFER, VBO);
+            glBufferSubData(GL_ARRAY_BUFFER, 0, waveVertices->size() * sizeof(float), waveVertices->data());
 
-        glDrawElements(GL_TRIANGLES, indices.size(), GL_UNSIGNED_INT, 0);
+            // per-frame uniforms, for each surface's program
+            for (const ShaderPermutation& surface : surfaces)
+            {
+                ShaderProgram& surfaceShader = surfaceShaders.Get(surface);
+                surfaceShader.use();
+                surfaceShader.setMat4("projection", projection);
+                surfaceShader.setMat4("view", view);
 
-        ////////////////////////////
-        // Box rendering with floating animation
-        ////////////////////////////
-        
-        // Bind box texture
-        glActiveTexture(GL_TEXTURE0);
-        glBindTexture(GL_TEXTURE_2D, boxTexture);
-        
-        // Bind box VAO
-        glBindVertexArray(boxVAO);
-        
-        // Calculate floating height at center of grid by matching the water wave equations at (x=0, z=0)
-        float x = 0.0f;
-        float z = 0.0f;
-        float wave1 = 0.1f * sin(x * 2.0f + time * 1.5f) * cos(z * 1.5f + time * 1.2f);
-        float wave2 = 0.2f * cos(x * 3.0f + time * 2.0f) * sin(z * 2.0f + time * 1.8f);
-        float wave3 = 0.15f * sin(x * 4.0f + time * 2.5f) * cos(z * 3.0f + time * 2.2f);
-        float wave4 = 0.1f * sin(x * 5.0f + time * 3.0f) * sin(z * 4.0f + time * 2.8f);
-        float floatHeight = 0.175 + (wave1 + wave2 + wave3 + wave4)*0.7f;
-        
-        // Position box at center of wave plane with floating animation
-        glm::mat4 boxModel = glm::mat4(1.0f);
-        boxModel = glm::translate(boxModel, glm::vec3(0.0f, floatHeight, 0.0f)); 
-        boxModel = glm::rotate(boxModel, glm::radians(45.0f), glm::vec3(0.0f, 1.0f, 0.0f));
-        boxModel = glm::scale(boxModel, glm::vec3(0.5f, 0.5f, 0.5f)); 
-        
-        ourShader.setMat4("model", boxModel);
-        ourShader.setBool("isBox", true); // bool that check if object was a box (for shader jing)
-        
-        // Draw the boat (now has 25 triangles = 75 indices)
-        glDrawElements(GL_TRIANGLES, 75, GL_UNSIGNED_INT, 0);
+                // pass time uniform for additional shader effects
+                surfaceShader.setFloat("time", time);
+                surfaceShader.setVec3("viewPos", camera.Position);
+            }
+        }
+
+        {
+            ProfileScope drawTimer(profiler, drawScope);
+
+            // render the animated plane
+            {
+                ProfileGpuPass gpuTimer(profiler, waterPass);
+
+                // bind texture
+                glActiveTexture(GL_TEXTURE0);
+                glBindTexture(GL_TEXTURE_2D, waterTexture);
+                textures.Use(waterTexture);
+
+                glBindVertexArray(VAO);
+                glm::mat4 model = glm::mat4(1.0f);
+                model = glm::scale(model, glm::vec3(5.0f, 1.0f, 5.0f)); // Scale up the plane
+                ShaderProgram& waterShader = surfaceShaders.Get(waterSurface);
+                waterShader.use();
+                waterShader.setMat4("model", model);
+
+                glDrawElements(GL_TRIANGLES, indices.size(), GL_UNSIGNED_INT, 0);
+            }
+
+            ////////////////////////////
+            // Box rendering with floating animation
+            ////////////////////////////
+            {
+                ProfileGpuPass gpuTimer(profiler, boatPass);
+
+                // Bind box texture
+                glActiveTexture(GL_TEXTURE0);
+                glBindTexture(GL_TEXTURE_2D, boxTexture);
+                textures.Use(boxTexture);
+            
+                // Bind box VAO
+                glBindVertexArray(boxVAO);
+            
+                // Calculate floating height at center of grid by matching the water wave equations at (x=0, z=0)
+                float floatHeight = 0.175f + waveHeight(0.0f, 0.0f, time) * 0.7f;
+            
+                // Position box at center of wave plane with floating animation
+                glm::mat4 boxModel = glm::mat4(1.0f);
+                boxModel = glm::translate(boxModel, glm::vec3(0.0f, floatHeight, 0.0f)); 
+                boxModel = glm::rotate(boxModel, glm::radians(45.0f), glm::vec3(0.0f, 1.0f, 0.0f));
+                boxModel = glm::scale(boxModel, glm::vec3(0.5f, 0.5f, 0.5f)); 
+            
+                ShaderProgram& boatShader = surfaceShaders.Get(boatSurface);
+                boatShader.use();
+                boatShader.setMat4("model", boxModel);
+            
+                // Draw the boat (now has 25 triangles = 75 indices)
+                glDrawElements(GL_TRIANGLES, 75, GL_UNSIGNED_INT, 0);
+            }
+        }
 
         // glfw: swap buffers and poll IO events (keys pressed/released, mouse moved etc.)
         // -------------------------------------------------------------------------------
         glfwSwapBuffers(window);
+        if (pipelined)
+        {
+            pipeline.EndRender();
+            ProfileScope scope(profiler, waveScope);
+            pipeline.FinishUpdate();
+        }
         glfwPollEvents();
+        textures.EndFrame();
+        profiler.EndFrame();
+
+        // --pipeline-stress: report the phase that just ended and switch modes
+        if (pipelineStress && stress.EndFrame(glfwGetTime(), pipelined, pipeline.Overlap()))
+        {
+            if (pipelined)
+            {
+                pipeline.Stop();
+                pipeline.ResetOverlap();
+            }
+            else
+                pipeline.Start(updateStage);
+            pipelined = !pipelined;
+        }
+    }
+
+    if (pipeline.Running())
+    {
+        pipeline.Stop();
+        if (pipeline.Overlap().frames > 0)
+            pipeline.Overlap().Print("pipeline/overlap");
     }
 
+    profiler.PrintSummary();
+    profiler.WriteTrace();
+    profiler.ReleaseGpu();
+
     // optional: de-allocate all resources once they've outlived their purpose:
     // ------------------------------------------------------------------------
     glDeleteVertexArrays(1, &VAO);
@@ -431,6 +502,13 @@ int main()
     glDeleteVertexArrays(1, &boxVAO);
     glDeleteBuffers(1, &boxVBO);
     glDeleteBuffers(1, &boxEBO);
+    textures.PrintReport();
+    textures.ReleaseAll();
+    shaders.PrintReport();
+    shaders.Release();
+
+    if (!options.recordPath.empty())
+        recording.Save(options.recordPath);
 
     // glfw: terminate, clearing all previously allocated GLFW resources.
     // ------------------------------------------------------------------
@@ -444,19 +522,204 @@ void processInput(GLFWwindow *window)
 {
     if (glfwGetKey(window, GLFW_KEY_ESCAPE) == GLFW_PRESS)
         glfwSetWindowShouldClose(window, true);
+}
 
+// pack the movement keys for this frame
+// -------------------------------------
+uint32_t sampleInputKeys(GLFWwindow *window)
+{
+    uint32_t keys = 0;
     if (glfwGetKey(window, GLFW_KEY_W) == GLFW_PRESS)
-        camera.ProcessKeyboard(FORWARD, deltaTime);
+        keys |= INPUT_KEY_W;
     if (glfwGetKey(window, GLFW_KEY_S) == GLFW_PRESS)
-        camera.ProcessKeyboard(BACKWARD, deltaTime);
+        keys |= INPUT_KEY_S;
     if (glfwGetKey(window, GLFW_KEY_A) == GLFW_PRESS)
-        camera.ProcessKeyboard(LEFT, deltaTime);
+        keys |= INPUT_KEY_A;
     if (glfwGetKey(window, GLFW_KEY_D) == GLFW_PRESS)
-        camera.ProcessKeyboard(RIGHT, deltaTime);
+        keys |= INPUT_KEY_D;
+    return keys;
+}
+
+// move the fly camera from one frame of input (live or recorded)
+// ---------------------------------------------------------------
+void applyCameraInput(const InputFrame& input, float dt)
+{
+    if (input.keys & INPUT_KEY_W)
+        camera.ProcessKeyboard(FORWARD, dt);
+    if (input.keys & INPUT_KEY_S)
+        camera.ProcessKeyboard(BACKWARD, dt);
+    if (input.keys & INPUT_KEY_A)
+        camera.ProcessKeyboard(LEFT, dt);
+    if (input.keys & INPUT_KEY_D)
+        camera.ProcessKeyboard(RIGHT, dt);
     //if (glfwGetKey(window, GLFW_KEY_SPACE) == GLFW_PRESS)
     //    camera.ProcessKeyboard(UP, deltaTime);
     //if (glfwGetKey(window, GLFW_KEY_LEFT_CONTROL) == GLFW_PRESS)
     //    camera.ProcessKeyboard(DOWN, deltaTime);
+    if (input.mouseDx != 0.0f || input.mouseDy != 0.0f)
+        camera.ProcessMouseMovement(input.mouseDx, input.mouseDy);
+}
+
+// Water Movement!!!! sum of four travelling waves, shared by the grid and the floating boat
+// -----------------------------------------------------------------------------------------
+float waveHeight(float x, float z, float time)
+{
+    float wave1 = 0.1f * sin(x * 2.0f + time * 1.5f) * cos(z * 1.5f + time * 1.2f);
+    float wave2 = 0.2f * cos(x * 3.0f + time * 2.0f) * sin(z * 2.0f + time * 1.8f);
+    float wave3 = 0.15f * sin(x * 4.0f + time * 2.5f) * cos(z * 3.0f + time * 2.2f);
+    float wave4 = 0.1f * sin(x * 5.0f + time * 3.0f) * sin(z * 4.0f + time * 2.8f);
+    return wave1 + wave2 + wave3 + wave4;
+}
+
+// subdivided plane from -1 to 1 on x/z: 5 floats per vertex (x,y,z,u,v) and two triangles per cell
+// ------------------------------------------------------------------------------------------------
+void buildWaveGrid(int gridSize, std::vector<float>& vertices, std::vector<unsigned int>& indices)
+{
+    vertices.clear();
+    indices.clear();
+    vertices.reserve(gridSize * gridSize * 5);
+    indices.reserve((gridSize - 1) * (gridSize - 1) * 6);
+
+    // Generate vertices
+    for (int i = 0; i < gridSize; i++) {
+        for (int j = 0; j < gridSize; j++) {
+            float x = ((float)j / (gridSize - 1)) * 2.0f - 1.0f; // -1 to 1
+            float z = ((float)i / (gridSize - 1)) * 2.0f - 1.0f;
+            float y = 0.0f;
+            
+            // Position
+            vertices.push_back(x);
+            vertices.push_back(y);
+            vertices.push_back(z);
+            
+            // Texture coordinates
+            vertices.push_back((float)j / (gridSize - 1)); // 0 to 1
+            vertices.push_back((float)i / (gridSize - 1));
+        }
+    }
+    
+    // Generate edge for triangles
+    for (int i = 0; i < gridSize - 1; i++) {
+        for (int j = 0; j < gridSize - 1; j++) {
+            int topLeft = i * gridSize + j;
+            int topRight = topLeft + 1;
+            int bottomLeft = (i + 1) * gridSize + j;
+            int bottomRight = bottomLeft + 1;
+            
+            // First triangle
+            indices.push_back(topLeft);
+            indices.push_back(bottomLeft);
+            indices.push_back(topRight);
+            
+            // Second triangle
+            indices.push_back(topRight);
+            indices.push_back(bottomLeft);
+            indices.push_back(bottomRight);
+        }
+    }
+}
+
+// recompute the height of every grid vertex for the given time
+// -------------------------------------------------------------
+void updateWaveGrid(std::vector<float>& vertices, int gridSize, float time)
+{
+    for (int i = 0; i < gridSize; i++) {
+        for (int j = 0; j < gridSize; j++) {
+            int vertexIndex = (i * gridSize + j) * 5; // 5 floats per vertex (x,y,z,u,v)
+            
+            float x = vertices[vertexIndex];
+            float z = vertices[vertexIndex + 2];
+            vertices[vertexIndex + 1] = waveHeight(x, z, time); // Update Y position
+        }
+    }
+}
+
+// run the CPU side of the demo (camera input, wave grid, boat float height) without a window
+// ------------------------------------------------------------------------------------------
+int runHeadless(const HeadlessOptions& options)
+{
+    InputRecording recording;
+    if (!options.inputPath.empty() && !recording.Load(options.inputPath))
+        return -1;
+
+    std::vector<float> vertices;
+    std::vector<unsigned int> indices;
+    buildWaveGrid(GRID_SIZE, vertices, indices);
+
+    TimingStats frameStats("frame");
+    TimingStats waveStats("wave grid");
+    frameStats.Reserve(options.frames);
+    waveStats.Reserve(options.frames);
+
+    float floatHeight = 0.0f;
+    for (uint64_t frame = 0; frame < options.frames; ++frame)
+    {
+        ScopedTimer frameTimer(frameStats);
+        float time = frame * options.dt;
+
+        applyCameraInput(recording.At(frame), options.dt);
+        {
+            ScopedTimer waveTimer(waveStats);
+            updateWaveGrid(vertices, GRID_SIZE, time);
+        }
+        floatHeight = 0.175f + waveHeight(0.0f, 0.0f, time) * 0.7f;
+    }
+
+    frameStats.Print();
+    waveStats.Print();
+    std::cout << "camera " << camera.Position.x << " " << camera.Position.y << " " << camera.Position.z
+              << "  boat height " << floatHeight << std::endl;
+    return 0;
+}
+
+// CPU hot paths: wave height generation for several grid sizes and texture decode
+// --------------------------------------------------------------------------------
+int runBenchmarks(const BenchOptions& options)
+{
+    BenchmarkRunner runner(options);
+
+    const int gridSizes[] = { 32, 64, 128, 256 };
+    for (int gridSize : gridSizes)
+    {
+        std::vector<float> vertices;
+        std::vector<unsigned int> indices;
+        buildWaveGrid(gridSize, vertices, indices);
+        float time = 0.0f;
+        runner.Run("wave_grid/" + std::to_string(gridSize), [&]() {
+            updateWaveGrid(vertices, gridSize, time);
+            time += 1.0f / 60.0f;
+            DoNotOptimize(vertices[1]);
+        });
+    }
+
+    // packing a permutation key (common/shader_permutations.h)
+    const int benchInfluences[] = { 0, 1, 2, 4 };
+    ShaderPermutation benchSurface;
+    benchSurface.surface = SurfaceVariant::Boat;
+    int benchStep = 0;
+    runner.Run("shader_permutations/key", [&]() {
+        benchSurface.boneInfluences = benchInfluences[benchStep++ & 3];
+        DoNotOptimize(PermutationKey(benchSurface));
+    });
+
+    const char* textures[] = { "resources/textures/wave.jpg", "resources/textures/container2.png" };
+    for (const char* texture : textures)
+    {
+        std::string path = FileSystem::getPath(texture);
+        int width, height, nrChannels;
+        if (!stbi_info(path.c_str(), &width, &height, &nrChannels))
+        {
+            std::cout << "Skipping texture_decode, failed to open " << path << std::endl;
+            continue;
+        }
+        runner.Run(std::string("texture_decode/") + texture, [&]() {
+            unsigned char *data = stbi_load(path.c_str(), &width, &height, &nrChannels, 0);
+            DoNotOptimize(data);
+            stbi_image_free(data);
+        });
+    }
+
+    return runner.Finish();
 }
 
 // glfw: whenever the window size changed (by OS or user resize) this callback function executes
@@ -489,7 +752,8 @@ void mouse_callback(GLFWwindow* window, double xposIn, double yposIn)
     lastX = xpos;
     lastY = ypos;
 
-    camera.ProcessMouseMovement(xoffset, yoffset);
+    pendingInput.mouseDx += xoffset;
+    pendingInput.mouseDy += yoffset;
 }
 
 // glfw: whenever the mouse scroll wheel scrolls, this callback is called
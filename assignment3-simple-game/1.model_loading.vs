@@ -1,9 +1,16 @@
 #version 330 core
-layout (location = 0) in vec3 aPos;
-layout (location = 1) in vec3 aNormal;
-layout (location = 2) in vec2 aTexCoords;
+layout (location = 0) in vec3 aPos;        // packed meshes: 0-1 in the mesh box, the model matrix maps it back
+layout (location = 1) in vec3 aNormal;     // packed meshes: octahedral in xy (unused here)
+layout (location = 2) in vec2 aTexCoords;  // packed meshes: half floats
+layout (location = 7) in float aMaterial;   // array layer, batched models only (common/model_batch.h)
 
 out vec2 TexCoords;
+flat out int Material;
+out vec3 WorldPos;
+out float ViewDepth;
+
+// the depth prepass and the GL_EQUAL shading pass must produce the same depth
+invariant gl_Position;
 
 uniform mat4 model;
 uniform mat4 view;
@@ -12,5 +19,10 @@ uniform mat4 projection;
 void main()
 {
     TexCoords = vec2(aTexCoords.x,aTexCoords.y);    
-    gl_Position = projection * view * model * vec4(aPos, 1.0);
+    Material = int(aMaterial + 0.5);
+    vec4 worldPos = model * vec4(aPos, 1.0);
+    WorldPos = worldPos.xyz;
+    vec4 viewPos = view * worldPos;
+    ViewDepth = -viewPos.z;
+    gl_Position = projection * viewPos;
 }
\ No newline at end of file
@@ -0,0 +1,322 @@
+#ifndef FLIGHT_SIM_H
+#define FLIGHT_SIM_H
+
+#include <glm/glm.hpp>
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cmath>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+// control bits sampled on the render thread, consumed once per simulation tick
+enum FlightInputBits : uint8_t
+{
+    FLIGHT_PITCH_UP   = 1 << 0,
+    FLIGHT_PITCH_DOWN = 1 << 1,
+    FLIGHT_ROLL_LEFT  = 1 << 2,
+    FLIGHT_ROLL_RIGHT = 1 << 3,
+    FLIGHT_SPEED_UP   = 1 << 4,
+    FLIGHT_SPEED_DOWN = 1 << 5
+};
+
+struct FlightState
+{
+    glm::vec3 position = glm::vec3(100.0f, 26.0f, 0.0f);
+    float pitch = 0.0f;  // rotation around X axis (nose up/down)
+    float yaw = 0.0f;    // rotation around Y axis (left/right)
+    float roll = 0.0f;   // rotation around Z axis (banking)
+    float speed = 5.0f;  // units per second
+};
+
+// advance the flight model by one fixed step. The result only depends on the
+// previous state, the input bits and dt, so a recorded input stream replays bit-exact
+// ------------------------------------------------------------------------------------
+inline void StepFlight(FlightState& state, uint8_t input, float dt)
+{
+    const float rotationSpeed = 10.0f; // degrees per second
+    const float acceleration = 10.0f;  // units per second^2 for speed control
+    const float turnRate = 0.5f;       // degrees per second per degree of roll
+
+    if (input & FLIGHT_PITCH_UP)
+        state.pitch += rotationSpeed * dt;
+    if (input & FLIGHT_PITCH_DOWN)
+        state.pitch -= rotationSpeed * dt;
+    if (input & FLIGHT_ROLL_RIGHT)
+        state.roll += rotationSpeed * dt;
+    if (input & FLIGHT_ROLL_LEFT)
+        state.roll -= rotationSpeed * dt;
+    if (input & FLIGHT_SPEED_UP)
+        state.speed += acceleration * dt;
+    if (input & FLIGHT_SPEED_DOWN)
+        state.speed -= acceleration * dt;
+
+    state.pitch = std::clamp(state.pitch, -89.0f, 89.0f);
+    state.roll = std::clamp(state.roll, -45.0f, 45.0f);
+    state.speed = std::clamp(state.speed, 1.0f, 50.0f);
+
+    // banking causes turning
+    state.yaw -= state.roll * turnRate * dt;
+    while (state.yaw < 0.0f) state.yaw += 360.0f;
+    while (state.yaw >= 360.0f) state.yaw -= 360.0f;
+
+    float yawRad = glm::radians(state.yaw);
+    float pitchRad = glm::radians(state.pitch);
+    glm::vec3 forward(
+        std::sin(yawRad) * std::cos(pitchRad),
+        -std::sin(pitchRad),  // Negative because pitch up should move up
+        std::cos(yawRad) * std::cos(pitchRad)
+    );
+    forward = glm::normalize(forward);
+    state.position += forward * state.speed * dt;
+}
+
+// blend two consecutive ticks for rendering; yaw takes the short way around 0/360
+inline FlightState InterpolateFlight(const FlightState& a, const FlightState& b, float alpha)
+{
+    FlightState result;
+    result.position = glm::mix(a.position, b.position, alpha);
+    result.pitch = glm::mix(a.pitch, b.pitch, alpha);
+    result.roll = glm::mix(a.roll, b.roll, alpha);
+    result.speed = glm::mix(a.speed, b.speed, alpha);
+
+    float yawDelta = b.yaw - a.yaw;
+    if (yawDelta > 180.0f) yawDelta -= 360.0f;
+    if (yawDelta < -180.0f) yawDelta += 360.0f;
+    result.yaw = a.yaw + yawDelta * alpha;
+    if (result.yaw < 0.0f) result.yaw += 360.0f;
+    if (result.yaw >= 360.0f) result.yaw -= 360.0f;
+    return result;
+}
+
+// FNV-1a over the raw bits of the state, used to compare a replay against a recording
+inline uint64_t HashFlightState(const FlightState& state)
+{
+    float values[7] = { state.position.x, state.position.y, state.position.z, state.pitch, state.yaw, state.roll, state.speed };
+    unsigned char bytes[sizeof(values)];
+    std::memcpy(bytes, values, sizeof(values));
+
+    uint64_t hash = 1469598103934665603ull;
+    for (unsigned char byte : bytes)
+    {
+        hash ^= byte;
+        hash *= 1099511628211ull;
+    }
+    return hash;
+}
+
+// input stream keyed by simulation tick; only changes are stored
+// ---------------------------------------------------------------
+class FlightInputLog
+{
+public:
+    struct Event
+    {
+        uint64_t tick;
+        uint8_t input;
+    };
+
+    void Push(uint64_t tick, uint8_t input)
+    {
+        if (!events.empty() && events.back().input == input)
+            return;
+        events.push_back({ tick, input });
+    }
+
+    // input active at the given tick; ticks must be queried in increasing order
+    uint8_t At(uint64_t tick)
+    {
+        while (cursor + 1 < events.size() && events[cursor + 1].tick <= tick)
+            ++cursor;
+        if (events.empty() || events[cursor].tick > tick)
+            return 0;
+        return events[cursor].input;
+    }
+
+    void Rewind() { cursor = 0; }
+
+    bool Save(const std::string& path) const
+    {
+        std::ofstream file(path);
+        if (!file)
+        {
+            std::cout << "Failed to write input log: " << path << std::endl;
+            return false;
+        }
+        file << "# tick input\n";
+        for (const Event& e : events)
+            file << e.tick << " " << static_cast<unsigned int>(e.input) << "\n";
+        return true;
+    }
+
+    bool Load(const std::string& path)
+    {
+        std::ifstream file(path);
+        if (!file)
+        {
+            std::cout << "Failed to read input log: " << path << std::endl;
+            return false;
+        }
+        events.clear();
+        cursor = 0;
+        std::string line;
+        while (std::getline(file, line))
+        {
+            if (line.empty() || line[0] == '#')
+                continue;
+            unsigned long long tick = 0;
+            unsigned int input = 0;
+            if (std::sscanf(line.c_str(), "%llu %u", &tick, &input) == 2)
+                events.push_back({ tick, static_cast<uint8_t>(input) });
+        }
+        return true;
+    }
+
+private:
+    std::vector<Event> events;
+    size_t cursor = 0;
+};
+
+// fixed-timestep flight simulation running on its own thread. The render thread
+// publishes input with SetInput() and reads an interpolated state with GetRenderState()
+// -------------------------------------------------------------------------------------
+class FlightSimulation
+{
+public:
+    FlightSimulation(const FlightState& initial, double tickRate)
+        : tickRate(tickRate), dt(static_cast<float>(1.0 / tickRate)), previous(initial), current(initial)
+    {
+    }
+
+    ~FlightSimulation()
+    {
+        Stop();
+    }
+
+    // record every tick's input into log, or drive the simulation from it instead of live input
+    void Record(FlightInputLog* log) { recordLog = log; }
+    void Replay(FlightInputLog* log) { replayLog = log; }
+
+    void Start()
+    {
+        if (running)
+            return;
+        running = true;
+        worker = std::thread(&FlightSimulation::Run, this);
+    }
+
+    void Stop()
+    {
+        running = false;
+        if (worker.joinable())
+            worker.join();
+    }
+
+    // advance synchronously on the calling thread, for headless runs
+    void StepTicks(uint64_t count)
+    {
+        for (uint64_t i = 0; i < count; ++i)
+            Tick();
+    }
+
+    void SetInput(uint8_t input) { liveInput.store(input, std::memory_order_relaxed); }
+
+    FlightState GetState()
+    {
+        std::lock_guard<std::mutex> lock(stateMutex);
+        return current;
+    }
+
+    // state between the last two ticks, based on how far wall time is into the next tick
+    FlightState GetRenderState()
+    {
+        FlightState a, b;
+        Clock::time_point tickTime;
+        {
+            std::lock_guard<std::mutex> lock(stateMutex);
+            a = previous;
+            b = current;
+            tickTime = lastTickTime;
+        }
+        double elapsed = std::chrono::duration<double>(Clock::now() - tickTime).count();
+        float alpha = static_cast<float>(std::clamp(elapsed * tickRate, 0.0, 1.0));
+        return InterpolateFlight(a, b, alpha);
+    }
+
+    uint64_t GetTick() const { return tick.load(); }
+    double GetTickRate() const { return tickRate; }
+
+private:
+    using Clock = std::chrono::steady_clock;
+
+    void Tick()
+    {
+        uint64_t t = tick.load();
+        uint8_t input = replayLog ? replayLog->At(t) : liveInput.load(std::memory_order_relaxed);
+        if (recordLog)
+            recordLog->Push(t, input);
+
+        FlightState next = current;
+        StepFlight(next, input, dt);
+        {
+            std::lock_guard<std::mutex> lock(stateMutex);
+            previous = current;
+            current = next;
+            lastTickTime = Clock::now();
+        }
+        tick.store(t + 1);
+    }
+
+    void Run()
+    {
+        const Clock::duration tickDuration = std::chrono::duration_cast<Clock::duration>(std::chrono::duration<double>(1.0 / tickRate));
+        const int maxCatchUpTicks = 8; // don't spiral if the machine can't keep up
+
+        Clock::time_point last = Clock::now();
+        Clock::duration accumulator = Clock::duration::zero();
+        while (running)
+        {
+            Clock::time_point now = Clock::now();
+            accumulator += now - last;
+            last = now;
+
+            int steps = 0;
+            while (accumulator >= tickDuration && steps < maxCatchUpTicks)
+            {
+                Tick();
+                accumulator -= tickDuration;
+                ++steps;
+            }
+            if (steps == maxCatchUpTicks)
+                accumulator = Clock::duration::zero();
+
+            std::this_thread::sleep_until(now + (tickDuration - accumulator));
+        }
+    }
+
+    double tickRate;
+    float dt;
+
+    std::mutex stateMutex;
+    FlightState previous;
+    FlightState current;
+    Clock::time_point lastTickTime = Clock::now();
+
+    std::atomic<uint8_t> liveInput{ 0 };
+    std::atomic<uint64_t> tick{ 0 };
+    std::atomic<bool> running{ false };
+    std::thread worker;
+
+    FlightInputLog* recordLog = nullptr;
+    FlightInputLog* replayLog = nullptr;
+};
+
+#endif
@@ -11,7 +11,24 @@
 #include <learnopengl/model.h>
 #include <stb_image.h>
 
+#include "flight_sim.h"
+#include "../common/headless.h"
+#include "../common/frame_profiler.h"
+#include "../common/bench.h"
+#include "../common/render_queue.h"
+#include "../common/cascaded_shadows.h"
+#include "../common/occlusion_culling.h"
+#include "../common/texture_manager.h"
+#include "../common/model_batch.h"
+#include "../common/vertex_quantization.h"
+#include "../common/shader_cache.h"
+#include "../common/shader_permutations.h"
+#include "../common/command_buffer.h"
+#define ALLOCATION_TRACKER_IMPLEMENTATION
+#include "../common/frame_arena.h"
+
 #include <iostream>
+#include <cstring>
 #include <cmath>
 #include <vector>
 #include <random>
@@ -20,10 +37,68 @@ void framebuffer_size_callback(GLFWwindow* window, int width, int height);
 void mouse_callback(GLFWwindow* window, double xpos, double ypos);
 void scroll_callback(GLFWwindow* window, double xoffset, double yoffset);
 void processInput(GLFWwindow *window);
+uint32_t sampleInputKeys(GLFWwindow *window);
+uint8_t flightInputFromKeys(uint32_t keys);
+int runHeadless(const HeadlessOptions& options);
+int validateAssets();
+int runBenchmarks(const BenchOptions& options);
+void queueModel(RenderQueue& queue, Model& model, unsigned int program, int modelLocation, const glm::mat4& modelMatrix, float depth01,
+                const BatchArena* arena = nullptr, const std::vector<int>* arenaMeshes = nullptr,
+                const QuantizedModel<Model>* quantized = nullptr);
+void queueBatchedModel(RenderQueue& queue, const BatchedModel& batch, unsigned int program, int modelLocation, const glm::mat4& modelMatrix, float depth01);
+void updateChaseCamera(const FlightState& plane);
+void modelBoundingSphere(const Model& model, glm::vec3& centre, float& radius);
+void modelBoundingBox(const Model& model, glm::vec3& low, glm::vec3& high);
+void worldBoundingBox(const glm::vec3& low, const glm::vec3& high, const glm::mat4& matrix, glm::vec3& worldLow, glm::vec3& worldHigh);
 
 // settings
 const unsigned int SCR_WIDTH = 1920;
 const unsigned int SCR_HEIGHT = 1080;
+const float FAR_PLANE = 1000.0f;
+
+// shadows: sun direction, cascades over the first SHADOW_DISTANCE units of the chase camera
+const glm::vec3 SUN_DIRECTION = glm::normalize(glm::vec3(-0.4f, -1.0f, -0.3f));
+const int SHADOW_MAP_SIZE = 2048;
+const int SHADOW_CASCADES = 4;
+const float SHADOW_DISTANCE = 400.0f;
+const float SHADOW_CASTER_REACH = 600.0f;  // how far towards the sun casters outside a cascade still count
+bool shadowsEnabled = true;
+
+// overdraw: --depth-prepass lays down depth first and shades with GL_EQUAL, --front-to-back
+// sorts opaque draws nearest first, --overdraw shows shaded fragments per pixel
+bool depthPrepass = false;
+bool frontToBack = false;
+bool overdrawView = false;
+
+// --occlusion-culling: islands hidden last frame are only drawn if their box passes a query
+bool occlusionCulling = false;
+
+// --model-batching: each model is one draw from merged buffers and an array texture
+bool modelBatching = false;
+
+// --geometry-arena: all model geometry in one vertex and index buffer, one VAO for every draw
+bool geometryArena = false;
+
+// --quantized-vertices: per-mesh draws read 28-byte packed vertices (common/vertex_quantization.h).
+// Batched and arena draws keep their own layout, so main rejects it with either of those flags
+bool quantizedVertices = false;
+
+// --validate-assets (headless): load the models offscreen, check texture sharing and read a
+// defragmented geometry arena back (see validateAssets)
+bool validateModelAssets = false;
+
+// --record-threads <n>: shadow cascades and the scene are culled, sorted and recorded into
+// command buffers by n workers, and replayed here (common/command_buffer.h). 0 records nothing
+int recordThreads = 0;
+
+// --headless with --record-threads: a field of proxy islands, culled per cascade and for the
+// view, is recorded and replayed into the null backend every frame (see runHeadless)
+const int PROXY_ISLANDS = 1024;
+const int PROXY_MESHES = 8;
+const float PROXY_RADIUS = 60.0f;
+
+// frames after the first ALLOCATION_WARMUP_FRAMES of a headless run must not touch the heap
+const uint64_t ALLOCATION_WARMUP_FRAMES = 10;
 
 // camera
 Camera camera(glm::vec3(0.0f, 0.0f, 3.0f));
@@ -31,61 +106,77 @@ float lastX = SCR_WIDTH / 2.0f;
 float lastY = SCR_HEIGHT / 2.0f;
 bool firstMouse = true;
 
-// plane state
-glm::vec3 planePosition(100.0f, 26.0f, 0.0f);
-float planePitch = 0.0f;  // rotation around X axis (nose up/down)
-float planeYaw = 0.0f;    // rotation around Y axis (left/right)
-float planeRoll = 0.0f;   // rotation around Z axis (banking)
-float planeSpeed = 5.0f;  // units per second
+// flight simulation (fixed timestep, runs on its own thread)
+double simTickRate = 240.0; // ticks per second, override with --sim-hz
 
 // islands
 std::vector<glm::vec3> islandPositions;
 
+// a model drawn this frame with its world-space bounding sphere (shadow culling) and box (occlusion tests)
+struct SceneCaster
+{
+    Model* model = nullptr;
+    glm::mat4 matrix = glm::mat4(1.0f);
+    glm::vec3 centre = glm::vec3(0.0f);
+    float radius = 0.0f;
+    glm::vec3 boxMin = glm::vec3(0.0f);
+    glm::vec3 boxMax = glm::vec3(0.0f);
+    const BatchedModel* batch = nullptr;   // set with --model-batching
+    const std::vector<int>* arenaMeshes = nullptr;  // per-mesh arena handles with --geometry-arena
+    const QuantizedModel<Model>* quantized = nullptr;  // packed mesh VAOs with --quantized-vertices
+};
+
 // timing
 float deltaTime = 0.0f;
 float lastFrame = 0.0f;
 
-// utility function for loading a 2D texture from file
-// ---------------------------------------------------
-unsigned int loadTexture(char const * path)
+int main(int argc, char** argv)
 {
-    unsigned int textureID;
-    glGenTextures(1, &textureID);
-
-    int width, height, nrComponents;
-    unsigned char *data = stbi_load(path, &width, &height, &nrComponents, 0);
-    if (data)
+    // command line: --sim-hz <rate>, --record <file>, --replay <file>, plus the headless options
+    // ------------------------------------------------------------------------------------------
+    HeadlessOptions options = ParseHeadlessOptions(argc, argv);
+    std::string recordPath;
+    std::string replayPath;
+    for (int i = 1; i < argc; ++i)
     {
-        GLenum format;
-        if (nrComponents == 1)
-            format = GL_RED;
-        else if (nrComponents == 3)
-            format = GL_RGB;
-        else if (nrComponents == 4)
-            format = GL_RGBA;
-
-        glBindTexture(GL_TEXTURE_2D, textureID);
-        glTexImage2D(GL_TEXTURE_2D, 0, format, width, height, 0, format, GL_UNSIGNED_BYTE, data);
-        glGenerateMipmap(GL_TEXTURE_2D);
-
-        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_REPEAT);
-        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_REPEAT);
-        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_LINEAR);
-        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
-
-        stbi_image_free(data);
+        if (std::strcmp(argv[i], "--sim-hz") == 0 && i + 1 < argc)
+            simTickRate = std::max(1.0, std::atof(argv[++i]));
+        else if (std::strcmp(argv[i], "--record") == 0 && i + 1 < argc)
+            recordPath = argv[++i];
+        else if (std::strcmp(argv[i], "--replay") == 0 && i + 1 < argc)
+            replayPath = argv[++i];
+        else if (std::strcmp(argv[i], "--no-shadows") == 0)
+            shadowsEnabled = false;
+        else if (std::strcmp(argv[i], "--depth-prepass") == 0)
+            depthPrepass = true;
+        else if (std::strcmp(argv[i], "--front-to-back") == 0)
+            frontToBack = true;
+        else if (std::strcmp(argv[i], "--overdraw") == 0)
+            overdrawView = true;
+        else if (std::strcmp(argv[i], "--occlusion-culling") == 0)
+            occlusionCulling = true;
+        else if (std::strcmp(argv[i], "--model-batching") == 0)
+            modelBatching = true;
+        else if (std::strcmp(argv[i], "--geometry-arena") == 0)
+            geometryArena = true;
+        else if (std::strcmp(argv[i], "--quantized-vertices") == 0)
+            quantizedVertices = true;
+        else if (std::strcmp(argv[i], "--validate-assets") == 0)
+            validateModelAssets = true;
+        else if (std::strcmp(argv[i], "--record-threads") == 0 && i + 1 < argc)
+            recordThreads = std::max(0, std::atoi(argv[++i]));
     }
-    else
+    if (quantizedVertices && (modelBatching || geometryArena))
     {
-        std::cout << "Texture failed to load at path: " << path << std::endl;
-        stbi_image_free(data);
+        std::cout << "--quantized-vertices can't be combined with --model-batching or --geometry-arena" << std::endl;
+        return -1;
     }
+    BenchOptions benchOptions = ParseBenchOptions(argc, argv);
+    if (benchOptions.enabled)
+        return runBenchmarks(benchOptions);
+    if (options.enabled)
+        return runHeadless(options);
 
-    return textureID;
-}
-
-int main()
-{
     // glfw: initialize and configure
     // ------------------------------
     glfwInit();
@@ -131,7 +222,15 @@ int main()
 
     // build and compile shaders
     // -------------------------
-    Shader ourShader("1.model_loading.vs", "1.model_loading.fs");
+    ShaderCache shaders;
+    shaders.ParseOptions(argc, argv);
+    ShaderPermutations modelShaders(shaders, "1.model_loading.vs", "1.model_loading.fs");
+    ShaderPermutation arrayMaterials;
+    arrayMaterials.materialArray = true;
+    ShaderProgram& ourShader = modelShaders.Get(ShaderPermutation());
+    ShaderProgram& depthShader = shaders.Load("1.model_loading.vs", "shadow_depth.fs");
+    ShaderProgram& overdrawShader = shaders.Load("1.model_loading.vs", "overdraw.fs");
+    ShaderProgram& batchedShader = modelShaders.Get(arrayMaterials);
     
 
     // load models
@@ -139,6 +238,13 @@ int main()
     Model ourModel(FileSystem::getPath("resources/objects/plane/plane.dae"));
     //stbi_set_flip_vertically_on_load(true);
     Model islandModel(FileSystem::getPath("resources/objects/island4/Untitled.dae"));
+    glm::vec3 planeCentre, islandCentre;
+    float planeRadius, islandRadius;
+    modelBoundingSphere(ourModel, planeCentre, planeRadius);
+    modelBoundingSphere(islandModel, islandCentre, islandRadius);
+    glm::vec3 planeLow, planeHigh, islandLow, islandHigh;
+    modelBoundingBox(ourModel, planeLow, planeHigh);
+    modelBoundingBox(islandModel, islandLow, islandHigh);
     
     // Randomly place extra islands (2 or 3) in the world
     islandPositions.clear();
@@ -156,9 +262,48 @@ int main()
         islandPositions.emplace_back(horizontalDist(gen), heightDist(gen), horizontalDist(gen));
     }
     
-    // load and create texture for ground
-    // ----------------------------------
-    unsigned int groundTexture = loadTexture(FileSystem::getPath("resources/textures/wave.png").c_str());
+    // textures: the models' own, deduplicated, and the ocean's; --texture-budget caps them
+    // -----------------------------------------------------------------------------------
+    TextureManager textures;
+    textures.ParseOptions(argc, argv);
+    textures.Adopt(ourModel);
+    textures.Adopt(islandModel);
+    unsigned int groundTexture = textures.Load(FileSystem::getPath("resources/textures/wave.png"));
+
+    // --geometry-arena: one buffer pair sized for both models; meshes (or batched models) are ranges of it
+    BatchArena arena;
+    std::vector<int> planeMeshes, islandMeshes;
+    if (geometryArena)
+    {
+        uint32_t vertexCount = 0, indexCount = 0;
+        CountModelGeometry(ourModel, vertexCount, indexCount);
+        CountModelGeometry(islandModel, vertexCount, indexCount);
+        arena.Init(vertexCount, indexCount, SetupBatchVertexAttributes);
+        if (!modelBatching)
+        {
+            planeMeshes = AddModelToArena(ourModel, arena);
+            islandMeshes = AddModelToArena(islandModel, arena);
+        }
+    }
+
+    // --model-batching: each model's meshes merged into one buffer pair, its textures into one array
+    BatchedModel planeBatch, islandBatch;
+    if (modelBatching)
+    {
+        planeBatch = BuildBatchedModel(ourModel, textures, TextureOptions(), geometryArena ? &arena : nullptr);
+        islandBatch = BuildBatchedModel(islandModel, textures, TextureOptions(), geometryArena ? &arena : nullptr);
+    }
+
+    // --quantized-vertices: packed copies of both models; nothing else reads the float mesh
+    // buffers, so they are dropped
+    QuantizedModel<Model> planeQuantized, islandQuantized;
+    if (quantizedVertices)
+    {
+        planeQuantized.Init(ourModel, true);
+        islandQuantized.Init(islandModel, true);
+        PrintQuantizationReport("plane.dae", planeQuantized.Error(), sizeof(Vertex));
+        PrintQuantizationReport("Untitled.dae", islandQuantized.Error(), sizeof(Vertex));
+    }
     
     // Create static ground plane
     // --------------------------
@@ -196,6 +341,156 @@ int main()
     // draw in wireframe
     //glPolygonMode(GL_FRONT_AND_BACK, GL_LINE);
 
+    // start the flight simulation; it ticks independently of the render loop and vsync
+    // ---------------------------------------------------------------------------------
+    FlightInputLog inputLog;
+    FlightSimulation flightSim(FlightState(), simTickRate);
+    if (!replayPath.empty() && inputLog.Load(replayPath))
+        flightSim.Replay(&inputLog);
+    else if (!recordPath.empty())
+        flightSim.Record(&inputLog);
+    flightSim.Start();
+
+    // per-stage CPU scopes and GPU passes
+    // -----------------------------------
+    FrameProfiler profiler;
+    profiler.ParseOptions(argc, argv);
+    const int inputScope = profiler.RegisterScope("input");
+    const int simulationScope = profiler.RegisterScope("simulation");
+    const int islandScope = profiler.RegisterScope("island loop");
+    const int cullingScope = profiler.RegisterScope("culling");
+    const int queueScope = profiler.RegisterScope("queue building");
+    const int drawScope = profiler.RegisterScope("draw submission");
+    const int prepassPass = profiler.RegisterGpuPass("depth prepass");
+    const int scenePass = profiler.RegisterGpuPass("scene");
+    const int shadedFragmentCounter = profiler.RegisterFragmentCounter("fragments shaded");
+    const int drawCounter = profiler.RegisterCounter("draws");
+    const int vaoBindCounter = profiler.RegisterCounter("vao binds");
+    const int naiveStateCounter = profiler.RegisterCounter("state changes unsorted");
+    const int sortedStateCounter = profiler.RegisterCounter("state changes sorted");
+    const int occlusionPass = profiler.RegisterGpuPass("occlusion tests");
+    const int islandsDrawnCounter = profiler.RegisterCounter("islands drawn");
+    const int islandsCulledCounter = profiler.RegisterCounter("islands culled");
+    const int textureMemoryCounter = profiler.RegisterCounter("texture MB resident");
+    const int allocationCounter = profiler.RegisterCounter("heap allocations");  // any thread, the flight sim's too
+    AllocationScope frameAllocations;
+    int cascadePasses[MAX_SHADOW_CASCADES];
+    int cascadeCasterCounters[MAX_SHADOW_CASCADES];
+    for (int i = 0; i < SHADOW_CASCADES; ++i)
+    {
+        cascadePasses[i] = profiler.RegisterGpuPass("shadow cascade " + std::to_string(i));
+        cascadeCasterCounters[i] = profiler.RegisterCounter("casters in cascade " + std::to_string(i));
+    }
+
+    CascadedShadowMap shadowMap;
+    if (shadowsEnabled && !shadowMap.Init(SHADOW_MAP_SIZE, SHADOW_CASCADES))
+        shadowsEnabled = false;
+    ShadowCascade cascades[MAX_SHADOW_CASCADES];
+    RenderQueue shadowQueue;
+    std::vector<SceneCaster> casters;
+    int depthModelLocation = glGetUniformLocation(depthShader.ID, "model");
+
+    // draws are collected into a queue, sorted by state and submitted once per frame
+    // -------------------------------------------------------------------------------
+    RenderQueue renderQueue;
+    renderQueue.SetDrawOrder(frontToBack ? DrawOrder::FrontToBack : DrawOrder::State);
+    ourShader.use();
+    ourShader.setInt("texture_diffuse1", 0);
+    int modelLocation = glGetUniformLocation(ourShader.ID, "model");
+    batchedShader.use();
+    batchedShader.setInt("materialTextures", 0);
+    int batchedModelLocation = glGetUniformLocation(batchedShader.ID, "model");
+
+    // shaded or depth-only packets for a caster: one per mesh, or one for a batched model
+    auto queueCaster = [&](RenderQueue& queue, const SceneCaster& caster, bool shaded, float depth01) {
+        if (caster.batch)
+            queueBatchedModel(queue, *caster.batch, shaded ? batchedShader.ID : depthShader.ID, shaded ? batchedModelLocation : depthModelLocation, caster.matrix, depth01);
+        else
+            queueModel(queue, *caster.model, shaded ? ourShader.ID : depthShader.ID, shaded ? modelLocation : depthModelLocation, caster.matrix, depth01,
+                       caster.arenaMeshes ? &arena : nullptr, caster.arenaMeshes, caster.quantized);
+    };
+    int overdrawModelLocation = glGetUniformLocation(overdrawShader.ID, "model");
+
+    // islands are occlusion-tested by index; the plane is always drawn
+    // -----------------------------------------------------------------
+    OcclusionQueries occlusion;
+    if (occlusionCulling)
+        occlusion.Init(static_cast<int>(islandPositions.size()));
+    std::vector<char> drawnEarly(islandPositions.size(), 1);
+    RenderQueue lateQueue;
+
+    // culling runs first and leaves the casters of each cascade here, by index
+    int cascadeCount = 0;
+    std::vector<int> cascadeCasters[MAX_SHADOW_CASCADES];
+
+    // casters inside one cascade, depth-only; returns how many
+    auto queueCascade = [&](RenderQueue& queue, int cascade) {
+        queue.Clear();
+        for (int caster : cascadeCasters[cascade])
+            queueCaster(queue, casters[caster], false, 0.0f);
+        return static_cast<int>(cascadeCasters[cascade].size());
+    };
+
+    // the ground and every island to draw before the occlusion tests; returns the island count.
+    // Depth is the distance to the nearest point of the bounding sphere. With occlusion
+    // culling only islands visible last frame go in; the rest wait for their box test
+    auto queueScene = [&](RenderQueue& queue) {
+        queue.Clear();
+
+        // Ground stays at fixed position (identity matrix)
+        DrawPacket groundPacket;
+        groundPacket.program = ourShader.ID;
+        groundPacket.vao = groundVAO;
+        groundPacket.textures[0] = groundTexture;
+        groundPacket.textureCount = 1;
+        groundPacket.modelLocation = modelLocation;
+        groundPacket.indexed = false;
+        groundPacket.count = 6;
+        groundPacket.key = PackDrawKey(groundPacket, 0, 1.0f);  // the ocean is behind everything else
+        queue.Push(groundPacket);
+
+        int drawn = 0;
+        for (size_t i = 0; i < casters.size(); ++i)
+        {
+            const SceneCaster& caster = casters[i];
+            if (i < drawnEarly.size())
+            {
+                if (!drawnEarly[i])
+                    continue;
+                ++drawn;
+            }
+            float nearest = std::max(0.0f, glm::length(caster.centre - camera.Position) - caster.radius);
+            queueCaster(queue, caster, true, nearest / FAR_PLANE);
+        }
+        return drawn;
+    };
+
+    // jobs 0..cascadeCount-1 record the cascades, job cascadeCount the scene. Workers only
+    // read the frame's casters and cascades, which this thread doesn't touch until it waits
+    const bool threadedRecording = recordThreads > 0;
+    CommandRecorder recorder(recordThreads);
+    GLCommandBackend glCommands;
+    RenderQueue cascadeQueues[MAX_SHADOW_CASCADES];
+    int cascadeDrawn[MAX_SHADOW_CASCADES] = {};
+    int sceneIslandsDrawn = 0;
+    int depthProjectionLocation = glGetUniformLocation(depthShader.ID, "projection");
+    const CommandRecorder::RecordJob recordPasses = [&](int job, CommandBuffer& buffer) {
+        if (job < cascadeCount)
+        {
+            buffer.UseProgram(depthShader.ID);
+            buffer.UniformMatrix4(depthProjectionLocation, 1, glm::value_ptr(cascades[job].viewProjection));
+            cascadeDrawn[job] = queueCascade(cascadeQueues[job], job);
+            cascadeQueues[job].Record(buffer);
+            return;
+        }
+        sceneIslandsDrawn = queueScene(renderQueue);
+        if (!overdrawView)
+            renderQueue.Record(buffer);
+    };
+    if (threadedRecording)
+        std::cout << "Recording draws on " << recordThreads << " worker threads" << std::endl;
+    shaders.StartHotReload(window);
+
     // render loop
     // -----------
     while (!glfwWindowShouldClose(window))
@@ -206,137 +501,296 @@ int main()
         deltaTime = currentFrame - lastFrame;
         lastFrame = currentFrame;
 
+        profiler.BeginFrame();
+        frameAllocations.Begin();
+
+        // shaders edited on disk (--hot-reload); a relinked program may move its uniforms
+        if (shaders.Poll() > 0)
+        {
+            modelLocation = glGetUniformLocation(ourShader.ID, "model");
+            batchedModelLocation = glGetUniformLocation(batchedShader.ID, "model");
+            depthModelLocation = glGetUniformLocation(depthShader.ID, "model");
+            overdrawModelLocation = glGetUniformLocation(overdrawShader.ID, "model");
+            depthProjectionLocation = glGetUniformLocation(depthShader.ID, "projection");
+        }
+
         // input
         // -----
-        processInput(window);
-        
-        // Update yaw based on roll (banking causes turning)
-        // -------------------------------------------------
-        float turnRate = 0.5f; // degrees per second per degree of roll
-        planeYaw -= planeRoll * turnRate * deltaTime;
-        
-        // Normalize yaw to 0-360 degrees
-        while (planeYaw < 0.0f) planeYaw += 360.0f;
-        while (planeYaw >= 360.0f) planeYaw -= 360.0f;
-        
-        // Update plane position based on orientation
-        // ------------------------------------------
-        float yawRad = glm::radians(planeYaw);
-        float pitchRad = glm::radians(planePitch);
-        
-        // Calculate forward direction based on yaw and pitch
-        // Forward direction in the plane's local space
-        glm::vec3 forward(
-            std::sin(yawRad) * std::cos(pitchRad),
-            -std::sin(pitchRad),  // Negative because pitch up should move up
-            std::cos(yawRad) * std::cos(pitchRad)
-        );
-        forward = glm::normalize(forward);
-        
-        // Move plane forward
-        planePosition += forward * planeSpeed * deltaTime;
-
-        // Update third-person camera
-        // ---------------------------
-        // Camera follows behind and above the plane
-        float cameraDistance = 8.0f;
-        float cameraHeight = 3.0f;
-        
-        // Calculate camera position behind the plane
-        glm::vec3 cameraOffset(
-            -std::sin(yawRad) * cameraDistance,
-            cameraHeight,
-            -std::cos(yawRad) * cameraDistance
-        );
-        
-        glm::vec3 cameraPos = planePosition + cameraOffset;
-        
-        // Look at the plane
-        glm::vec3 cameraTarget = planePosition;
-        camera.Position = cameraPos;
-        camera.Front = glm::normalize(cameraTarget - cameraPos);
-        camera.Up = glm::vec3(0.0f, 1.0f, 0.0f);
+        {
+            ProfileScope scope(profiler, inputScope);
+            processInput(window);
+            flightSim.SetInput(flightInputFromKeys(sampleInputKeys(window)));
+        }
 
-        // render
-        // ------
-        glClearColor(0.5f, 0.7f, 0.9f, 1.0f); // Sky blue
-        glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+        // Plane state interpolated between the last two simulation ticks
+        // --------------------------------------------------------------
+        FlightState plane;
+        {
+            ProfileScope scope(profiler, simulationScope);
+            plane = flightSim.GetRenderState();
+            updateChaseCamera(plane);
+        }
 
         // view/projection transformations
-        glm::mat4 projection = glm::perspective(glm::radians(camera.Zoom), (float)SCR_WIDTH / (float)SCR_HEIGHT, 0.1f, 1000.0f);
+        glm::mat4 projection = glm::perspective(glm::radians(camera.Zoom), (float)SCR_WIDTH / (float)SCR_HEIGHT, 0.1f, FAR_PLANE);
         glm::mat4 view = camera.GetViewMatrix();
-        
-        // Render static ground plane
-        // --------------------------
-        ourShader.use();
-        ourShader.setMat4("projection", projection);
-        ourShader.setMat4("view", view);
-        
-        // Ground stays at fixed position (identity matrix)
-        glm::mat4 groundModel = glm::mat4(1.0f);
-        ourShader.setMat4("model", groundModel);
-        
-        // bind texture
-        glActiveTexture(GL_TEXTURE0);
-        glBindTexture(GL_TEXTURE_2D, groundTexture);
-        ourShader.setInt("texture_diffuse1", 0);
-        
-        glBindVertexArray(groundVAO);
-        glDrawArrays(GL_TRIANGLES, 0, 6);
-        glBindVertexArray(0);
-        
-        // Unbind wave texture so island model doesn't use it
-        glActiveTexture(GL_TEXTURE0);
-        glBindTexture(GL_TEXTURE_2D, 0);
-
-        // Render island model
-        // -------------------
-        ourShader.use();
-        ourShader.setMat4("projection", projection);
-        ourShader.setMat4("view", view);
-        
-        // Island transforms: draw the main island and the randomly placed ones
-        for (const auto& islandPos : islandPositions)
+
+        // Island transforms: the main island and the randomly placed ones, then the plane
+        casters.clear();
         {
-            glm::mat4 islandModelMatrix = glm::mat4(1.0f);
-            islandModelMatrix = glm::translate(islandModelMatrix, islandPos);
-            islandModelMatrix = glm::rotate(islandModelMatrix, glm::radians(90.0f), glm::vec3(-1.0f, 0.0f, 0.0f));
-            islandModelMatrix = glm::scale(islandModelMatrix, glm::vec3(500.0f, 500.0f, 500.0f));
-            ourShader.setMat4("model", islandModelMatrix);
-            islandModel.Draw(ourShader);
+            ProfileScope islandTimer(profiler, islandScope);
+            for (const auto& islandPos : islandPositions)
+            {
+                glm::mat4 islandModelMatrix = glm::mat4(1.0f);
+                islandModelMatrix = glm::translate(islandModelMatrix, islandPos);
+                islandModelMatrix = glm::rotate(islandModelMatrix, glm::radians(90.0f), glm::vec3(-1.0f, 0.0f, 0.0f));
+                islandModelMatrix = glm::scale(islandModelMatrix, glm::vec3(500.0f, 500.0f, 500.0f));
+                SceneCaster island = { &islandModel, islandModelMatrix, glm::vec3(islandModelMatrix * glm::vec4(islandCentre, 1.0f)), islandRadius * 500.0f };
+                worldBoundingBox(islandLow, islandHigh, islandModelMatrix, island.boxMin, island.boxMax);
+                island.batch = modelBatching ? &islandBatch : nullptr;
+                island.arenaMeshes = geometryArena && !modelBatching ? &islandMeshes : nullptr;
+                island.quantized = quantizedVertices ? &islandQuantized : nullptr;
+                casters.push_back(island);
+            }
         }
 
-        // Render plane model
-        // ------------------
-        ourShader.use();
-        ourShader.setMat4("projection", projection);
-        ourShader.setMat4("view", view);
-        
         // Build transformation matrix for plane
         glm::mat4 model = glm::mat4(1.0f);
-        model = glm::translate(model, planePosition);
+        model = glm::translate(model, plane.position);
         
         // Apply rotations: yaw, pitch, roll (in that order)
-        model = glm::rotate(model, glm::radians(planeYaw), glm::vec3(0.0f, 1.0f, 0.0f));
-        model = glm::rotate(model, glm::radians(planePitch), glm::vec3(1.0f, 0.0f, 0.0f));
-        model = glm::rotate(model, glm::radians(planeRoll), glm::vec3(0.0f, 0.0f, 1.0f));
+        model = glm::rotate(model, glm::radians(plane.yaw), glm::vec3(0.0f, 1.0f, 0.0f));
+        model = glm::rotate(model, glm::radians(plane.pitch), glm::vec3(1.0f, 0.0f, 0.0f));
+        model = glm::rotate(model, glm::radians(plane.roll), glm::vec3(0.0f, 0.0f, 1.0f));
         
         model = glm::scale(model, glm::vec3(0.01f, 0.01f, 0.01f));
-        ourShader.setMat4("model", model);
-        ourModel.Draw(ourShader);
+        SceneCaster planeCaster = { &ourModel, model, glm::vec3(model * glm::vec4(planeCentre, 1.0f)), planeRadius * 0.01f };
+        worldBoundingBox(planeLow, planeHigh, model, planeCaster.boxMin, planeCaster.boxMax);
+        planeCaster.batch = modelBatching ? &planeBatch : nullptr;
+        planeCaster.arenaMeshes = geometryArena && !modelBatching ? &planeMeshes : nullptr;
+        planeCaster.quantized = quantizedVertices ? &planeQuantized : nullptr;
+        casters.push_back(planeCaster);
+
+        // Shadow cascades fitted to the chase camera; each only draws the casters inside it.
+        // Last frame's occlusion results decide which islands the scene queue gets
+        // ---------------------------------------------------------------------------------
+        {
+            ProfileScope cullTimer(profiler, cullingScope);
+            cascadeCount = 0;
+            if (shadowsEnabled)
+                cascadeCount = FitCascades(view, glm::radians(camera.Zoom), (float)SCR_WIDTH / (float)SCR_HEIGHT, 0.1f, SHADOW_DISTANCE,
+                                           SUN_DIRECTION, SHADOW_CASCADES, shadowMap.Size(), SHADOW_CASTER_REACH, cascades);
+            for (int i = 0; i < cascadeCount; ++i)
+            {
+                cascadeCasters[i].clear();
+                for (size_t c = 0; c < casters.size(); ++c)
+                    if (SphereInCascade(cascades[i], casters[c].centre, casters[c].radius))
+                        cascadeCasters[i].push_back(static_cast<int>(c));
+            }
 
+            if (occlusionCulling)
+                occlusion.CollectResults();
+            for (size_t i = 0; i < drawnEarly.size(); ++i)
+                drawnEarly[i] = !occlusionCulling || occlusion.Visible(static_cast<int>(i));
+        }
+        // with threaded recording the queues are built on the workers, outside any scope
+        if (threadedRecording)
+            recorder.Dispatch(cascadeCount + 1, recordPasses);
+
+        if (shadowsEnabled)
+        {
+            depthShader.use();
+            depthShader.setMat4("view", glm::mat4(1.0f));
+            for (int i = 0; i < cascadeCount; ++i)
+            {
+                ProfileGpuPass gpuTimer(profiler, cascadePasses[i]);
+                shadowMap.BeginCascade(i);
+                if (threadedRecording)
+                {
+                    recorder.Wait(i);
+                    ReplayCommands(recorder.Buffer(i), glCommands);
+                }
+                else
+                {
+                    depthShader.setMat4("projection", cascades[i].viewProjection);
+                    {
+                        ProfileScope queueTimer(profiler, queueScope);
+                        cascadeDrawn[i] = queueCascade(shadowQueue, i);
+                    }
+                    shadowQueue.Submit();
+                }
+                shadowMap.EndCascade();
+                profiler.SetCounter(cascadeCasterCounters[i], cascadeDrawn[i]);
+            }
+        }
+
+        // render
+        // ------
+        if (overdrawView)
+            glClearColor(0.0f, 0.0f, 0.0f, 1.0f);
+        else
+            glClearColor(0.5f, 0.7f, 0.9f, 1.0f); // Sky blue
+        glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+
+        // per-frame uniforms are program state, so they are set once for all packets
+        ShaderProgram* sceneShaders[] = { &ourShader, &batchedShader };
+        for (ShaderProgram* sceneShader : sceneShaders)
+        {
+            sceneShader->use();
+            sceneShader->setMat4("projection", projection);
+            sceneShader->setMat4("view", view);
+            if (shadowsEnabled)
+                shadowMap.Bind(*sceneShader, cascades, cascadeCount);
+            else
+                sceneShader->setInt("cascadeCount", 0);
+        }
+
+        // Collect draw packets, or wait for the worker that did
+        // -----------------------------------------------------
+        int islandsDrawn = 0;
+        if (threadedRecording)
+        {
+            recorder.Wait(cascadeCount);
+            islandsDrawn = sceneIslandsDrawn;
+        }
+        else
+        {
+            ProfileScope queueTimer(profiler, queueScope);
+            islandsDrawn = queueScene(renderQueue);
+        }
+        profiler.SetCounter(islandsDrawnCounter, islandsDrawn);
+        profiler.SetCounter(islandsCulledCounter, static_cast<double>(islandPositions.size() - islandsDrawn));
+
+        // textures drawn this frame stay resident longest under a budget
+        textures.Use(groundTexture);
+        if (modelBatching)
+        {
+            textures.Use(planeBatch.materials);
+            textures.Use(islandBatch.materials);
+        }
+        else
+        {
+            textures.UseModel(ourModel);
+            if (islandsDrawn > 0)
+                textures.UseModel(islandModel);
+        }
+
+        // the main pass and late islands draw the same way: shaded, or counted in the overdraw view
+        auto submitScene = [&](RenderQueue& queue) {
+            if (overdrawView)
+            {
+                // additive, so brightness is the number of fragments shaded per pixel
+                glEnable(GL_BLEND);
+                glBlendFunc(GL_ONE, GL_ONE);
+                overdrawShader.use();
+                overdrawShader.setMat4("projection", projection);
+                overdrawShader.setMat4("view", view);
+                queue.SubmitWithProgram(overdrawShader.ID, overdrawModelLocation);
+                glDisable(GL_BLEND);
+            }
+            else
+            {
+                queue.Submit();
+            }
+        };
+
+        // Depth prepass: the same draws with a depth-only program, then shading with
+        // GL_EQUAL so each pixel runs the full fragment shader once
+        // --------------------------------------------------------------------------
+        if (depthPrepass)
+        {
+            ProfileGpuPass gpuTimer(profiler, prepassPass);
+            depthShader.use();
+            depthShader.setMat4("projection", projection);
+            depthShader.setMat4("view", view);
+            glColorMask(GL_FALSE, GL_FALSE, GL_FALSE, GL_FALSE);
+            renderQueue.SubmitWithProgram(depthShader.ID, depthModelLocation);
+            glColorMask(GL_TRUE, GL_TRUE, GL_TRUE, GL_TRUE);
+            glDepthFunc(GL_EQUAL);
+            glDepthMask(GL_FALSE);
+        }
+
+        // Sort and submit; the occlusion query counts fragments that reach the fragment shader
+        // -------------------------------------------------------------------------------------
+        {
+            ProfileScope drawTimer(profiler, drawScope);
+            ProfileGpuPass gpuTimer(profiler, scenePass);
+            ProfileGpuPass fragmentCount(profiler, shadedFragmentCounter);
+            if (threadedRecording && !overdrawView)
+                ReplayCommands(recorder.Buffer(cascadeCount), glCommands);
+            else
+                submitScene(renderQueue);
+        }
+        glDepthFunc(GL_LESS);
+        glDepthMask(GL_TRUE);
+
+        // Occlusion: every island's box is tested against the depth just drawn (read back
+        // next frame), and islands hidden last frame draw only if their test passes now
+        // --------------------------------------------------------------------------------
+        if (occlusionCulling)
+        {
+            ProfileGpuPass gpuTimer(profiler, occlusionPass);
+            depthShader.use();
+            depthShader.setMat4("projection", projection);
+            depthShader.setMat4("view", view);
+            occlusion.BeginTests();
+            for (size_t i = 0; i < drawnEarly.size(); ++i)
+                occlusion.TestBox(static_cast<int>(i), casters[i].boxMin, casters[i].boxMax, camera.Position, depthModelLocation);
+            occlusion.EndTests();
+
+            for (size_t i = 0; i < drawnEarly.size(); ++i)
+            {
+                if (drawnEarly[i])
+                    continue;
+                lateQueue.Clear();
+                queueCaster(lateQueue, casters[i], true, 0.0f);
+                occlusion.BeginConditional(static_cast<int>(i));
+                submitScene(lateQueue);
+                occlusion.EndConditional(static_cast<int>(i));
+            }
+        }
+        profiler.SetCounter(drawCounter, renderQueue.SubmittedStats().draws);
+        profiler.SetCounter(vaoBindCounter, renderQueue.SubmittedStats().vaoBinds);
+        profiler.SetCounter(naiveStateCounter, renderQueue.NaiveStats().Total());
+        profiler.SetCounter(sortedStateCounter, renderQueue.SubmittedStats().Total());
 
         // glfw: swap buffers and poll IO events (keys pressed/released, mouse moved etc.)
         // -------------------------------------------------------------------------------
         glfwSwapBuffers(window);
         glfwPollEvents();
+        textures.EndFrame();
+        profiler.SetCounter(textureMemoryCounter, textures.ResidentBytes() / (1024.0 * 1024.0));
+        profiler.SetCounter(allocationCounter, static_cast<double>(frameAllocations.End()));
+        profiler.EndFrame();
     }
 
+    profiler.PrintSummary();
+    profiler.WriteTrace();
+    profiler.ReleaseGpu();
+    shadowMap.Release();
+    occlusion.Release();
+
+    flightSim.Stop();
+    if (!recordPath.empty() && replayPath.empty())
+        inputLog.Save(recordPath);
+    std::cout << "Simulated " << flightSim.GetTick() << " ticks, state hash " << std::hex << HashFlightState(flightSim.GetState()) << std::dec << std::endl;
+
     // optional: de-allocate all resources once they've outlived their purpose:
     // ------------------------------------------------------------------------
     glDeleteVertexArrays(1, &groundVAO);
     glDeleteBuffers(1, &groundVBO);
-    glDeleteTextures(1, &groundTexture);
+    if (modelBatching)
+    {
+        ReleaseBatchedModel(planeBatch, textures);
+        ReleaseBatchedModel(islandBatch, textures);
+    }
+    arena.Release();
+    planeQuantized.Release();
+    islandQuantized.Release();
+    textures.PrintReport();
+    textures.ReleaseAll();
+    shaders.PrintReport();
+    shaders.Release();
 
     // glfw: terminate, clearing all previously allocated GLFW resources.
     // ------------------------------------------------------------------
@@ -350,42 +804,590 @@ void processInput(GLFWwindow *window)
 {
     if (glfwGetKey(window, GLFW_KEY_ESCAPE) == GLFW_PRESS)
         glfwSetWindowShouldClose(window, true);
+}
 
-    // Plane rotation controls
-    float rotationSpeed = 10.0f; // degrees per second
-    float acceleration = 10.0f;  // units per second^2 for speed control
-    
-    // W/S: Pitch (nose up/down)
-    if (glfwGetKey(window, GLFW_KEY_W) == GLFW_PRESS)
-        planePitch += rotationSpeed * deltaTime;
-    if (glfwGetKey(window, GLFW_KEY_S) == GLFW_PRESS)
-        planePitch -= rotationSpeed * deltaTime;
-    
-    // A/D: Roll (banking left/right)
-    if (glfwGetKey(window, GLFW_KEY_D) == GLFW_PRESS)
-        planeRoll += rotationSpeed * deltaTime;
-    if (glfwGetKey(window, GLFW_KEY_A) == GLFW_PRESS)
-        planeRoll -= rotationSpeed * deltaTime;
+// one packet per mesh, with the mesh's first diffuse texture on unit 0
+// --------------------------------------------------------------------
+void queueModel(RenderQueue& queue, Model& model, unsigned int program, int modelLocation, const glm::mat4& modelMatrix, float depth01,
+                const BatchArena* arena, const std::vector<int>* arenaMeshes, const QuantizedModel<Model>* quantized)
+{
+    for (size_t m = 0; m < model.meshes.size(); ++m)
+    {
+        Mesh& mesh = model.meshes[m];
+        DrawPacket packet;
+        packet.program = program;
+        packet.vao = mesh.VAO;
+        // meshes in the arena draw their range of the shared buffers
+        int handle = arena && m < arenaMeshes->size() ? (*arenaMeshes)[m] : -1;
+        if (handle >= 0)
+        {
+            const BatchArena::Range& range = arena->Get(handle);
+            packet.vao = arena->Vao();
+            packet.first = static_cast<int>(range.firstIndex);
+            packet.baseVertex = static_cast<int>(range.baseVertex);
+        }
+        // the shader samples only texture_diffuse1, on unit 0, so the mesh's other maps aren't
+        // bound and the sort key groups meshes by the texture actually drawn
+        packet.textureCount = 1;
+        packet.textures[0] = 0; // untextured meshes sample texture 0
+        for (const Texture& texture : mesh.textures)
+            if (texture.type == "texture_diffuse")
+            {
+                packet.textures[0] = texture.id;
+                break;
+            }
+        packet.modelLocation = modelLocation;
+        packet.model = modelMatrix;
+        // packed positions are relative to the mesh box; packets have no decode uniforms, so the box goes in the model matrix
+        if (quantized)
+        {
+            packet.vao = quantized->Vao(static_cast<int>(m));
+            packet.model = modelMatrix * quantized->MeshMatrix(static_cast<int>(m));
+        }
+        packet.count = static_cast<int>(mesh.indices.size());
+        packet.key = PackDrawKey(packet, 0, depth01);
+        queue.Push(packet);
+    }
+}
+
+// the whole model as one packet: merged buffers, every material in one array texture on unit 0
+// -------------------------------------------------------------------------------------------
+void queueBatchedModel(RenderQueue& queue, const BatchedModel& batch, unsigned int program, int modelLocation, const glm::mat4& modelMatrix, float depth01)
+{
+    DrawPacket packet;
+    packet.program = program;
+    packet.vao = batch.vao;
+    packet.textures[0] = batch.materials;
+    packet.textureCount = 1;
+    packet.textureTarget = GL_TEXTURE_2D_ARRAY;
+    packet.modelLocation = modelLocation;
+    packet.model = modelMatrix;
+    packet.count = batch.indexCount;
+    if (batch.arena)
+    {
+        const BatchArena::Range& range = batch.arena->Get(batch.arenaHandle);
+        packet.first = static_cast<int>(range.firstIndex);
+        packet.baseVertex = static_cast<int>(range.baseVertex);
+    }
+    packet.key = PackDrawKey(packet, 0, depth01);
+    queue.Push(packet);
+}
+
+// third-person chase camera: behind and above the plane, looking at it
+// ---------------------------------------------------------------------
+void updateChaseCamera(const FlightState& plane)
+{
+    float yawRad = glm::radians(plane.yaw);
+
+    // Camera follows behind and above the plane
+    float cameraDistance = 8.0f;
+    float cameraHeight = 3.0f;
     
-    // Clamp pitch to reasonable limits
-    if (planePitch > 89.0f) planePitch = 89.0f;
-    if (planePitch < -89.0f) planePitch = -89.0f;
+    // Calculate camera position behind the plane
+    glm::vec3 cameraOffset(
+        -std::sin(yawRad) * cameraDistance,
+        cameraHeight,
+        -std::cos(yawRad) * cameraDistance
+    );
     
-    // Normalize yaw to 0-360 degrees
-    while (planeYaw < 0.0f) planeYaw += 360.0f;
-    while (planeYaw >= 360.0f) planeYaw -= 360.0f;
+    glm::vec3 cameraPos = plane.position + cameraOffset;
     
-    // Clamp roll to reasonable limits
-    if (planeRoll > 45.0f) planeRoll = 45.0f;
-    if (planeRoll < -45.0f) planeRoll = -45.0f;
+    // Look at the plane
+    glm::vec3 cameraTarget = plane.position;
+    camera.Position = cameraPos;
+    camera.Front = glm::normalize(cameraTarget - cameraPos);
+    camera.Up = glm::vec3(0.0f, 1.0f, 0.0f);
+}
 
-    // Z / X: adjust speed (forward velocity)
+// model-space sphere around every vertex: box centre, farthest vertex
+// --------------------------------------------------------------------
+void modelBoundingSphere(const Model& model, glm::vec3& centre, float& radius)
+{
+    glm::vec3 low, high;
+    modelBoundingBox(model, low, high);
+    centre = (low + high) * 0.5f;
+    radius = 0.0f;
+    for (const Mesh& mesh : model.meshes)
+        for (const Vertex& v : mesh.vertices)
+            radius = std::max(radius, glm::length(v.Position - centre));
+}
+
+// model-space box around every vertex
+// -----------------------------------
+void modelBoundingBox(const Model& model, glm::vec3& low, glm::vec3& high)
+{
+    low = glm::vec3(1.0e30f);
+    high = glm::vec3(-1.0e30f);
+    for (const Mesh& mesh : model.meshes)
+        for (const Vertex& v : mesh.vertices)
+        {
+            low = glm::min(low, v.Position);
+            high = glm::max(high, v.Position);
+        }
+}
+
+// world-space box around a transformed model-space box
+// -----------------------------------------------------
+void worldBoundingBox(const glm::vec3& low, const glm::vec3& high, const glm::mat4& matrix, glm::vec3& worldLow, glm::vec3& worldHigh)
+{
+    worldLow = glm::vec3(1.0e30f);
+    worldHigh = glm::vec3(-1.0e30f);
+    for (int i = 0; i < 8; ++i)
+    {
+        glm::vec3 corner((i & 1) ? high.x : low.x, (i & 2) ? high.y : low.y, (i & 4) ? high.z : low.z);
+        glm::vec3 world = glm::vec3(matrix * glm::vec4(corner, 1.0f));
+        worldLow = glm::min(worldLow, world);
+        worldHigh = glm::max(worldHigh, world);
+    }
+}
+
+// pack the flight control keys for this frame
+// --------------------------------------------
+uint32_t sampleInputKeys(GLFWwindow *window)
+{
+    uint32_t keys = 0;
+    if (glfwGetKey(window, GLFW_KEY_W) == GLFW_PRESS)
+        keys |= INPUT_KEY_W;
+    if (glfwGetKey(window, GLFW_KEY_S) == GLFW_PRESS)
+        keys |= INPUT_KEY_S;
+    if (glfwGetKey(window, GLFW_KEY_A) == GLFW_PRESS)
+        keys |= INPUT_KEY_A;
+    if (glfwGetKey(window, GLFW_KEY_D) == GLFW_PRESS)
+        keys |= INPUT_KEY_D;
     if (glfwGetKey(window, GLFW_KEY_Z) == GLFW_PRESS)
-        planeSpeed += acceleration * deltaTime;
+        keys |= INPUT_KEY_Z;
     if (glfwGetKey(window, GLFW_KEY_X) == GLFW_PRESS)
-        planeSpeed -= acceleration * deltaTime;
-    if (planeSpeed < 1.0f) planeSpeed = 1.0f;
-    if (planeSpeed > 50.0f) planeSpeed = 50.0f;
+        keys |= INPUT_KEY_X;
+    return keys;
+}
+
+// map keys to flight controls; the simulation thread picks them up on its next tick
+// ----------------------------------------------------------------------------------
+uint8_t flightInputFromKeys(uint32_t keys)
+{
+    uint8_t input = 0;
+
+    // W/S: Pitch (nose up/down)
+    if (keys & INPUT_KEY_W)
+        input |= FLIGHT_PITCH_UP;
+    if (keys & INPUT_KEY_S)
+        input |= FLIGHT_PITCH_DOWN;
+
+    // A/D: Roll (banking left/right)
+    if (keys & INPUT_KEY_D)
+        input |= FLIGHT_ROLL_RIGHT;
+    if (keys & INPUT_KEY_A)
+        input |= FLIGHT_ROLL_LEFT;
+
+    // Z / X: adjust speed (forward velocity)
+    if (keys & INPUT_KEY_Z)
+        input |= FLIGHT_SPEED_UP;
+    if (keys & INPUT_KEY_X)
+        input |= FLIGHT_SPEED_DOWN;
+
+    return input;
+}
+
+// run the flight model from a --record input log without a window; the simulation is
+// stepped synchronously, so the final state hash matches the recording run's at the same tick
+// ---------------------------------------------------------------------------------------------
+int runHeadless(const HeadlessOptions& options)
+{
+    FlightInputLog inputLog;
+    if (!options.inputPath.empty() && !inputLog.Load(options.inputPath))
+        return -1;
+
+    FlightSimulation flightSim(FlightState(), simTickRate);
+    flightSim.Replay(&inputLog);
+    TimingStats frameStats("frame");
+    TimingStats simStats("flight sim");
+    frameStats.Reserve(options.frames);
+    simStats.Reserve(options.frames);
+
+    // proxy draws for the recording benchmark: made-up program, VAO and texture IDs, never
+    // drawn. Job i < cascadeCount records cascade i, the last job the view
+    std::vector<glm::vec3> proxyIslands;
+    std::mt19937 proxyRandom(1234u);
+    std::uniform_real_distribution<float> proxySpread(-1500.0f, 1500.0f);
+    for (int i = 0; i < PROXY_ISLANDS; ++i)
+        proxyIslands.emplace_back(proxySpread(proxyRandom), 26.0f, proxySpread(proxyRandom));
+    ShadowCascade cascades[MAX_SHADOW_CASCADES];
+    int cascadeCount = 0;
+    glm::mat4 viewProjection(1.0f);
+    RenderQueue proxyQueues[MAX_SHADOW_CASCADES + 1];
+    const CommandRecorder::RecordJob recordProxies = [&](int job, CommandBuffer& buffer) {
+        bool shadow = job < cascadeCount;
+        RenderQueue& queue = proxyQueues[job];
+        queue.Clear();
+        for (const glm::vec3& island : proxyIslands)
+        {
+            float distance = glm::length(island - camera.Position) - PROXY_RADIUS;
+            if (shadow ? !SphereInCascade(cascades[job], island, PROXY_RADIUS) : distance > FAR_PLANE)
+                continue;
+            glm::mat4 islandMatrix = glm::translate(glm::mat4(1.0f), island);
+            for (int m = 0; m < PROXY_MESHES; ++m)
+            {
+                DrawPacket packet;
+                packet.program = shadow ? 1 : 2;
+                packet.vao = 10 + m;
+                packet.textures[0] = 100 + m;
+                packet.textureCount = shadow ? 0 : 1;
+                packet.modelLocation = 0;
+                packet.model = islandMatrix;
+                packet.count = 3000;
+                packet.key = PackDrawKey(packet, 0, std::max(0.0f, distance) / FAR_PLANE);
+                queue.Push(packet);
+            }
+        }
+        buffer.UseProgram(shadow ? 1 : 2);
+        buffer.UniformMatrix4(1, 1, glm::value_ptr(shadow ? cascades[job].viewProjection : viewProjection));
+        queue.Record(buffer);
+    };
+    // workers record while this thread replays finished buffers, in job order. Queues and
+    // buffers are sized for every proxy mesh up front (at most a program, VAO and texture
+    // bind, a unit switch, the model matrix and the draw each), so frames don't grow them
+    const size_t proxyPackets = PROXY_ISLANDS * PROXY_MESHES;
+    for (RenderQueue& queue : proxyQueues)
+        queue.Reserve(proxyPackets);
+    CommandRecorder recorder(recordThreads);
+    CommandRecorder reference;
+    recorder.Reserve(MAX_SHADOW_CASCADES + 1, proxyPackets * 6 + 4, (proxyPackets + 1) * 16);
+    reference.Reserve(MAX_SHADOW_CASCADES + 1, proxyPackets * 6 + 4, (proxyPackets + 1) * 16);
+    auto recordAndReplay = [&](CommandRecorder& rec, NullCommandBackend& backend) {
+        rec.Dispatch(cascadeCount + 1, recordProxies);
+        for (int job = 0; job <= cascadeCount; ++job)
+        {
+            rec.Wait(job);
+            ReplayCommands(rec.Buffer(job), backend);
+        }
+    };
+    TimingStats recordStats("record+replay " + std::to_string(recordThreads) + " threads");
+    TimingStats referenceStats("record+replay inline");
+    recordStats.Reserve(options.frames);
+    referenceStats.Reserve(options.frames);
+    int replayMismatches = 0;
+    int proxyDraws = 0;
+    size_t proxyBytes = 0;
+
+    // heap allocations are counted over each frame's simulation and proxy record/replay
+    AllocationScope frameAllocations;
+    uint64_t warmupAllocations = 0, steadyAllocations = 0;
+
+    const double tickDt = 1.0 / simTickRate;
+    double accumulator = 0.0;
+    for (uint64_t frame = 0; frame < options.frames; ++frame)
+    {
+        uint64_t& allocations = frame < ALLOCATION_WARMUP_FRAMES ? warmupAllocations : steadyAllocations;
+        frameAllocations.Begin();
+        {
+            ScopedTimer frameTimer(frameStats);
+            accumulator += options.dt;
+            {
+                ScopedTimer simTimer(simStats);
+                while (accumulator >= tickDt)
+                {
+                    flightSim.StepTicks(1);
+                    accumulator -= tickDt;
+                }
+            }
+        }
+        if (recordThreads == 0)
+        {
+            allocations += frameAllocations.End();
+            continue;
+        }
+
+        // the proxy scene from the chase camera, recorded on the workers and then inline;
+        // both must replay to the same draws
+        updateChaseCamera(flightSim.GetState());
+        glm::mat4 view = camera.GetViewMatrix();
+        float aspect = (float)SCR_WIDTH / (float)SCR_HEIGHT;
+        viewProjection = glm::perspective(glm::radians(camera.Zoom), aspect, 0.1f, FAR_PLANE) * view;
+        cascadeCount = FitCascades(view, glm::radians(camera.Zoom), aspect, 0.1f, SHADOW_DISTANCE, SUN_DIRECTION, SHADOW_CASCADES,
+                                   SHADOW_MAP_SIZE, SHADOW_CASTER_REACH, cascades);
+        NullCommandBackend threaded;
+        {
+            ScopedTimer recordTimer(recordStats);
+            recordAndReplay(recorder, threaded);
+        }
+        NullCommandBackend inlined;
+        {
+            ScopedTimer referenceTimer(referenceStats);
+            recordAndReplay(reference, inlined);
+        }
+        if (threaded.Hash() != inlined.Hash() || threaded.Draws() != inlined.Draws())
+            ++replayMismatches;
+        proxyDraws = threaded.Draws();
+        proxyBytes = 0;
+        for (int job = 0; job <= cascadeCount; ++job)
+            proxyBytes += recorder.Buffer(job).Bytes();
+        allocations += frameAllocations.End();
+    }
+
+    frameStats.Print();
+    simStats.Print();
+    if (recordThreads > 0)
+    {
+        recordStats.Print();
+        referenceStats.Print();
+        std::cout << "command buffers: " << proxyDraws << " draws, " << proxyBytes / 1024 << " KB in the last frame, "
+                  << replayMismatches << " frames replayed differently" << std::endl;
+    }
+    FlightState plane = flightSim.GetState();
+    std::cout << "ticks " << flightSim.GetTick() << "  position " << plane.position.x << " " << plane.position.y << " " << plane.position.z
+              << "  state hash " << std::hex << HashFlightState(plane) << std::dec << std::endl;
+    bool allocationFailure = AllocationTrackingEnabled() && steadyAllocations > 0;
+    std::cout << "heap allocations: " << warmupAllocations << " in the first " << std::min(options.frames, ALLOCATION_WARMUP_FRAMES)
+              << " frames, " << steadyAllocations << " after" << (allocationFailure ? " (expected none)" : "") << std::endl;
+    int assetFailures = validateModelAssets ? validateAssets() : 0;
+    return replayMismatches > 0 || assetFailures != 0 || allocationFailure ? 1 : 0;
+}
+
+// load the models offscreen and check the managers that own their resources. Two loads of
+// the island model stand in for island variants sharing a material and, adopted, must share
+// one set of textures. With the plane and an island in one geometry arena, freeing the plane
+// and defragmenting must move the island's ranges to the front with their vertices and
+// indices intact. Returns the number of failures, -1 without a context
+// -------------------------------------------------------------------------------------
+int validateAssets()
+{
+    OffscreenContext context;
+    if (!CreateOffscreenContext(context))
+        return -1;
+
+    TextureManager textures;
+    Model first(FileSystem::getPath("resources/objects/island4/Untitled.dae"));
+    Model second(FileSystem::getPath("resources/objects/island4/Untitled.dae"));
+    textures.Adopt(first);
+    textures.Adopt(second);
+    int textureFailures = 0;
+    for (size_t m = 0; m < first.meshes.size(); ++m)
+        for (size_t t = 0; t < first.meshes[m].textures.size(); ++t)
+            textureFailures += first.meshes[m].textures[t].id != second.meshes[m].textures[t].id;
+    std::cout << "texture sharing: " << textures.TextureCount() << " textures for 2 island models, "
+              << textureFailures << " not shared" << std::endl;
+
+    Model plane(FileSystem::getPath("resources/objects/plane/plane.dae"));
+    textures.Adopt(plane);
+    BatchArena arena;
+    uint32_t arenaVertices = 0, arenaIndices = 0;
+    CountModelGeometry(plane, arenaVertices, arenaIndices);
+    CountModelGeometry(first, arenaVertices, arenaIndices);
+    arena.Init(arenaVertices, arenaIndices, SetupBatchVertexAttributes);
+    std::vector<int> planeHandles = AddModelToArena(plane, arena);
+    std::vector<int> islandHandles = AddModelToArena(first, arena);
+    for (int handle : planeHandles)
+        arena.Remove(handle);
+    arena.Defragment();
+    int arenaFailures = 0;
+    uint32_t expectedBase = 0;
+    for (size_t m = 0; m < islandHandles.size(); ++m)
+    {
+        const Mesh& mesh = first.meshes[m];
+        const BatchArena::Range& range = arena.Get(islandHandles[m]);
+        arenaFailures += range.baseVertex != expectedBase;
+        expectedBase += range.vertexCount;
+        std::vector<BatchVertex> vertices(range.vertexCount);
+        std::vector<unsigned int> indices(range.indexCount);
+        glBindBuffer(GL_COPY_READ_BUFFER, arena.IndexBuffer());
+        glGetBufferSubData(GL_COPY_READ_BUFFER, range.firstIndex * sizeof(unsigned int), indices.size() * sizeof(unsigned int), indices.data());
+        glBindBuffer(GL_COPY_READ_BUFFER, arena.VertexBuffer());
+        glGetBufferSubData(GL_COPY_READ_BUFFER, range.baseVertex * sizeof(BatchVertex), vertices.size() * sizeof(BatchVertex), vertices.data());
+        glBindBuffer(GL_COPY_READ_BUFFER, 0);
+        for (size_t i = 0; i < indices.size(); ++i)
+            arenaFailures += indices[i] != mesh.indices[i];
+        for (size_t v = 0; v < vertices.size(); ++v)
+            arenaFailures += vertices[v].position != mesh.vertices[v].Position;
+    }
+    std::cout << "arena defragment: " << planeHandles.size() << " plane meshes freed, " << islandHandles.size() << " island meshes packed to "
+              << arena.Vertices().UsedSize() << " vertices, " << arena.Indices().FreeBlockCount() << " free index block; " << arenaFailures << " failures" << std::endl;
+    arena.Release();
+
+    ReleaseModel(first, false);
+    ReleaseModel(second, false);
+    ReleaseModel(plane, false);
+    textures.ReleaseAll();
+    DestroyOffscreenContext(context);
+    return textureFailures + arenaFailures;
+}
+
+// CPU hot paths: flight step, texture decode and .dae model load
+// ---------------------------------------------------------------
+int runBenchmarks(const BenchOptions& options)
+{
+    BenchmarkRunner runner(options);
+
+    FlightState flight;
+    uint8_t input = FLIGHT_ROLL_LEFT | FLIGHT_PITCH_UP;
+    runner.Run("flight_step", [&]() {
+        StepFlight(flight, input, 1.0f / 240.0f);
+        DoNotOptimize(flight);
+    });
+
+    // shadow cascades fitted to the chase camera after a banking climb
+    FlightState chase;
+    for (int tick = 0; tick < 2400; ++tick)
+        StepFlight(chase, input, 1.0f / 240.0f);
+    updateChaseCamera(chase);
+    ShadowCascade cascades[MAX_SHADOW_CASCADES];
+    const float fovY = glm::radians(camera.Zoom);
+    const float aspect = (float)SCR_WIDTH / (float)SCR_HEIGHT;
+    glm::mat4 chaseView = camera.GetViewMatrix();
+    runner.Run("cascade_fit/" + std::to_string(SHADOW_CASCADES), [&]() {
+        int count = FitCascades(chaseView, fovY, aspect, 0.1f, SHADOW_DISTANCE, SUN_DIRECTION, SHADOW_CASCADES, SHADOW_MAP_SIZE, SHADOW_CASTER_REACH, cascades);
+        DoNotOptimize(cascades[count - 1].viewProjection);
+    });
+
+    // software Hi-Z: a view past the large hill towards a small one behind it (square
+    // pyramids standing in for islands); the culling decisions are checked in tests/
+    const glm::vec3 hills[] = { glm::vec3(0.0f), glm::vec3(450.0f, 0.0f, 100.0f), glm::vec3(-400.0f, 0.0f, -300.0f), glm::vec3(150.0f, 0.0f, -500.0f) };
+    const float hillScales[] = { 2.5f, 1.0f, 1.0f, 1.0f };
+    const float hillHalfWidth = 120.0f, hillHeight = 90.0f;
+    std::vector<glm::vec3> hillVertices = {
+        glm::vec3(-hillHalfWidth, 0.0f, -hillHalfWidth), glm::vec3(hillHalfWidth, 0.0f, -hillHalfWidth),
+        glm::vec3(hillHalfWidth, 0.0f, hillHalfWidth), glm::vec3(-hillHalfWidth, 0.0f, hillHalfWidth),
+        glm::vec3(0.0f, hillHeight, 0.0f)
+    };
+    std::vector<unsigned int> hillIndices = { 0, 1, 4, 1, 2, 4, 2, 3, 4, 3, 0, 4, 0, 2, 1, 0, 3, 2 };
+    DepthRaster raster(256, 144);
+    HiZPyramid hiZ;
+    glm::mat4 occlusionViewProjection = glm::perspective(fovY, aspect, 0.1f, FAR_PLANE) *
+        glm::lookAt(glm::vec3(-700.0f, 20.0f, -150.0f), glm::vec3(0.0f, 20.0f, 0.0f), glm::vec3(0.0f, 1.0f, 0.0f));
+    for (int hill = 0; hill < 4; ++hill)
+        if (hill != 1)
+            raster.RasterizeMesh(hillVertices, hillIndices, occlusionViewProjection * glm::scale(glm::translate(glm::mat4(1.0f), hills[hill]), glm::vec3(hillScales[hill])));
+    runner.Run("occlusion/hi_z_build/256x144", [&]() {
+        hiZ.Build(raster);
+        DoNotOptimize(hiZ.LevelCount());
+    });
+    runner.Run("occlusion/hi_z_test", [&]() {
+        bool culled = hiZ.BoxOccluded(hills[1] - glm::vec3(hillHalfWidth, 0.0f, hillHalfWidth), hills[1] + glm::vec3(hillHalfWidth, hillHeight, hillHalfWidth), occlusionViewProjection);
+        DoNotOptimize(culled);
+    });
+
+    // geometry arena allocator: one allocate and free in a half-full arena
+    OffsetAllocator halfFull(1u << 20);
+    for (uint32_t i = 0; i < 512; ++i)
+        halfFull.Allocate(1024);
+    for (uint32_t offset = 0; offset < (1u << 19); offset += 2048)
+        halfFull.Free(offset);
+    runner.Run("geometry_arena/allocate_free", [&]() {
+        uint32_t offset = halfFull.Allocate(700);
+        halfFull.Free(offset);
+        DoNotOptimize(offset);
+    });
+
+    const char* textures[] = {
+        "resources/textures/wave.png",
+        "resources/objects/plane/M_Plane.png",
+        "resources/objects/island4/island_baseColor.jpeg"
+    };
+    for (const char* texture : textures)
+    {
+        std::string path = FileSystem::getPath(texture);
+        int width, height, nrComponents;
+        if (!stbi_info(path.c_str(), &width, &height, &nrComponents))
+        {
+            std::cout << "Skipping texture_decode, failed to open " << path << std::endl;
+            continue;
+        }
+        runner.Run(std::string("texture_decode/") + texture, [&]() {
+            unsigned char *data = stbi_load(path.c_str(), &width, &height, &nrComponents, 0);
+            DoNotOptimize(data);
+            stbi_image_free(data);
+        });
+    }
+
+    // Model uploads meshes and textures, so loading needs a context
+    OffscreenContext context;
+    if (CreateOffscreenContext(context))
+    {
+        // startup shader time: a cold cache compiles and links, a warm one loads program binaries
+        const char* const programs[][2] = {
+            { "1.model_loading.vs", "1.model_loading.fs" },
+            { "1.model_loading.vs", "shadow_depth.fs" },
+            { "1.model_loading.vs", "overdraw.fs" },
+        };
+        ShaderStartupTimes startup = MeasureShaderStartup(programs, 3, "shader_cache_bench");
+        std::cout << "shader_cache/startup: " << startup.programs << " programs, cold " << startup.coldMs << " ms, warm "
+                  << startup.warmMs << " ms (" << startup.warmBinaryLoads << " from binaries";
+        if (!startup.binariesSupported)
+            std::cout << ", driver has no program binary formats";
+        std::cout << ")" << std::endl;
+
+        const char* models[] = { "resources/objects/plane/plane.dae", "resources/objects/island4/Untitled.dae" };
+        for (const char* modelPath : models)
+        {
+            std::string path = FileSystem::getPath(modelPath);
+            runner.Run(std::string("model_load/") + modelPath, [&]() {
+                Model model(path);
+                DoNotOptimize(model.meshes.size());
+                ReleaseModel(model);  // each iteration uploads its own buffers and textures
+            });
+        }
+
+        // two loads of the island model stand in for island variants sharing a material
+        // (checked by --headless --validate-assets). A budget of a third of their textures
+        // then evicts mip levels until they fit
+        TextureManager textures;
+        Model first(FileSystem::getPath(models[1])), second(FileSystem::getPath(models[1]));
+        textures.Adopt(first);
+        textures.Adopt(second);
+        size_t fullBytes = textures.ResidentBytes();
+        textures.SetBudget(fullBytes / 3);
+        textures.EndFrame();
+        std::cout << "texture_manager: " << textures.TextureCount() << " textures for 2 island models, "
+                  << fullBytes / 1024 << " KB -> " << textures.ResidentBytes() / 1024 << " KB under a " << fullBytes / 3 / 1024 << " KB budget" << std::endl;
+
+        // draws and texture binds per model, per mesh (Model::Draw) and batched, and for
+        // a frame of ocean, plane and four islands
+        Model plane(FileSystem::getPath(models[0]));
+        textures.Adopt(plane);
+        BatchedModel planeBatch = BuildBatchedModel(plane, textures);
+        BatchedModel islandBatch = BuildBatchedModel(first, textures);
+        std::vector<BatchVertex> mergedVertices;
+        std::vector<unsigned int> mergedIndices;
+        std::vector<std::string> layerPaths;
+        std::cout << "model_batching: plane " << planeBatch.meshCount << " draws, " << planeBatch.textureBindsPerDraw << " texture binds -> 1, 1 ("
+                  << planeBatch.layerCount << " layers); island " << islandBatch.meshCount << " draws, " << islandBatch.textureBindsPerDraw << " texture binds -> 1, 1 ("
+                  << islandBatch.layerCount << " layers); frame of ocean, plane and 4 islands " << 1 + planeBatch.meshCount + 4 * islandBatch.meshCount
+                  << " -> 6 draws" << std::endl;
+        runner.Run("model_batching/merge/island", [&]() {
+            MergeModelMeshes(first, mergedVertices, mergedIndices, layerPaths);
+            DoNotOptimize(mergedIndices.size());
+        });
+        ReleaseBatchedModel(planeBatch, textures);
+        ReleaseBatchedModel(islandBatch, textures);
+
+        // packed vertex size and worst decode error per model
+        std::vector<PackedVertex> packed;
+        const Model* packedModels[] = { &plane, &first };
+        for (const Model* packedModel : packedModels)
+        {
+            QuantizationError error;
+            for (const Mesh& mesh : packedModel->meshes)
+            {
+                glm::vec3 boundsMin, boundsExtent;
+                QuantizationError meshError;
+                PackMeshVertices(mesh, packed, boundsMin, boundsExtent, meshError);
+                error.Merge(meshError);
+            }
+            PrintQuantizationReport(packedModel == &plane ? "plane.dae" : "Untitled.dae", error, sizeof(Vertex));
+        }
+        runner.Run("vertex_quantization/pack/island", [&]() {
+            glm::vec3 boundsMin, boundsExtent;
+            QuantizationError error;
+            PackMeshVertices(first.meshes[0], packed, boundsMin, boundsExtent, error);
+            DoNotOptimize(packed.data());
+        });
+        ReleaseModel(first, false);
+        ReleaseModel(second, false);
+        ReleaseModel(plane, false);
+        textures.ReleaseAll();
+        DestroyOffscreenContext(context);
+    }
+
+    return runner.Finish();
 }
 
 // glfw: whenever the window size changed (by OS or user resize) this callback function executes
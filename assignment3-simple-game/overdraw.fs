@@ -0,0 +1,9 @@
+#version 330 core
+out vec4 FragColor;
+
+// overdraw view: drawn with additive blending, so every fragment that passes the
+// depth test adds one step and a pixel shaded eight times is full red
+void main()
+{
+    FragColor = vec4(1.0 / 8.0, 1.0 / 32.0, 0.0, 1.0);
+}
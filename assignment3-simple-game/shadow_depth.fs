@@ -0,0 +1,6 @@
+#version 330 core
+
+// depth only: the shadow map passes and the depth prepass pair this with the scene vertex shader
+void main()
+{
+}
@@ -0,0 +1,79 @@
+#version 330 core
+
+layout(location = 0) in vec3 pos;
+layout(location = 1) in vec3 norm;
+layout(location = 2) in vec2 tex;
+layout(location = 3) in vec3 tangent;
+layout(location = 4) in vec3 bitangent;
+layout(location = 5) in ivec4 boneIds; 
+layout(location = 6) in vec4 weights;
+
+uniform mat4 projection;
+uniform mat4 view;
+uniform mat4 model;
+
+// packed vertices (common/vertex_quantization.h), the QUANTIZED_VERTICES permutation:
+// pos is relative to the mesh box and bone id 255 means none
+#ifdef QUANTIZED_VERTICES
+uniform vec3 positionScale;
+uniform vec3 positionOffset;
+const int NO_BONE = 255;
+#else
+const int NO_BONE = -1;
+#endif
+
+const int MAX_BONES = 100;
+// bone slots read per vertex: 1, 2 or 4, set by the skinning permutation
+// (common/shader_permutations.h) to cover the model's vertices
+#ifndef BONE_INFLUENCES
+#define BONE_INFLUENCES 4
+#endif
+
+// baked skinning matrices (baked_animation.h): one row per frame, three texels per bone
+uniform sampler2D bakedPalette;
+uniform int bakedRow0;
+uniform int bakedRow1;
+uniform float bakedBlend;
+
+out vec2 TexCoords;
+out vec3 WorldPos;
+out float ViewDepth;
+
+mat4 bakedBone(int row, int bone)
+{
+    vec4 r0 = texelFetch(bakedPalette, ivec2(bone * 3 + 0, row), 0);
+    vec4 r1 = texelFetch(bakedPalette, ivec2(bone * 3 + 1, row), 0);
+    vec4 r2 = texelFetch(bakedPalette, ivec2(bone * 3 + 2, row), 0);
+    return mat4(vec4(r0.x, r1.x, r2.x, 0.0), vec4(r0.y, r1.y, r2.y, 0.0),
+                vec4(r0.z, r1.z, r2.z, 0.0), vec4(r0.w, r1.w, r2.w, 1.0));
+}
+
+void main()
+{
+#ifdef QUANTIZED_VERTICES
+    vec3 position = pos * positionScale + positionOffset;
+#else
+    vec3 position = pos;
+#endif
+    vec4 totalPosition = vec4(0.0f);
+    for(int i = 0 ; i < BONE_INFLUENCES ; i++)
+    {
+        int boneId = boneIds[i];
+        if(boneId == NO_BONE) 
+            continue;
+        if(boneId >=MAX_BONES) 
+        {
+            totalPosition = vec4(position,1.0f);
+            break;
+        }
+        mat4 bone = mix(bakedBone(bakedRow0, boneId), bakedBone(bakedRow1, boneId), bakedBlend);
+        totalPosition += bone * vec4(position,1.0f) * weights[i];
+    }
+	
+    vec4 worldPos = model * totalPosition;
+    WorldPos = worldPos.xyz;
+    vec4 viewPos = view * worldPos;
+    ViewDepth = -viewPos.z;
+    gl_Position =  projection * viewPos;
+	TexCoords = tex;
+}
@@ -2,10 +2,39 @@
 out vec4 FragColor;
 
 varying vec2 TexCoords;
+in vec3 WorldPos;
+in float ViewDepth;
 
 uniform sampler2D texture_diffuse1;
 
+// cascaded shadow map (common/cascaded_shadows.h)
+const int MAX_SHADOW_CASCADES = 4;
+uniform sampler2DArrayShadow shadowMap;
+uniform mat4 cascadeViewProjection[MAX_SHADOW_CASCADES];
+uniform float cascadeSplits[MAX_SHADOW_CASCADES];
+uniform int cascadeCount;
+
+// 1 = lit, 0 = in shadow; 3x3 hardware-filtered taps in the first cascade covering the fragment
+float shadowFactor()
+{
+    int cascade = 0;
+    while (cascade < cascadeCount && ViewDepth > cascadeSplits[cascade])
+        cascade++;
+    if (cascade >= cascadeCount)
+        return 1.0;
+
+    vec4 lightPos = cascadeViewProjection[cascade] * vec4(WorldPos, 1.0);
+    vec3 coords = lightPos.xyz / lightPos.w * 0.5 + 0.5;
+    vec2 texel = 1.0 / vec2(textureSize(shadowMap, 0).xy);
+    float lit = 0.0;
+    for (int x = -1; x <= 1; ++x)
+        for (int y = -1; y <= 1; ++y)
+            lit += texture(shadowMap, vec4(coords.xy + vec2(x, y) * texel, float(cascade), coords.z));
+    return lit / 9.0;
+}
+
 void main()
 {    
-    FragColor = texture(texture_diffuse1, TexCoords);
+    vec4 color = texture(texture_diffuse1, TexCoords);
+    FragColor = vec4(color.rgb * mix(0.55, 1.0, shadowFactor()), color.a);
 }
@@ -12,30 +12,66 @@ uniform mat4 projection;
 uniform mat4 view;
 uniform mat4 model;
 
+// packed vertices (common/vertex_quantization.h), the QUANTIZED_VERTICES permutation:
+// pos is relative to the mesh box, norm.xy is an octahedral normal and bone id 255 means none
+#ifdef QUANTIZED_VERTICES
+uniform vec3 positionScale;
+uniform vec3 positionOffset;
+const int NO_BONE = 255;
+#else
+const int NO_BONE = -1;
+#endif
+
 const int MAX_BONES = 100;
-const int MAX_BONE_INFLUENCE = 4;
+// bone slots read per vertex: 1, 2 or 4, set by the skinning permutation
+// (common/shader_permutations.h) to cover the model's vertices
+#ifndef BONE_INFLUENCES
+#define BONE_INFLUENCES 4
+#endif
 uniform mat4 finalBonesMatrices[MAX_BONES];
 
 out vec2 TexCoords;
+out vec3 WorldPos;
+out float ViewDepth;
+
+vec3 OctDecode(vec2 e)
+{
+    vec3 n = vec3(e, 1.0 - abs(e.x) - abs(e.y));
+    float t = max(-n.z, 0.0);
+    n.x += n.x >= 0.0 ? -t : t;
+    n.y += n.y >= 0.0 ? -t : t;
+    return normalize(n);
+}
 
 void main()
 {
+#ifdef QUANTIZED_VERTICES
+    vec3 position = pos * positionScale + positionOffset;
+    vec3 normal = OctDecode(norm.xy);
+#else
+    vec3 position = pos;
+    vec3 normal = norm;
+#endif
     vec4 totalPosition = vec4(0.0f);
-    for(int i = 0 ; i < MAX_BONE_INFLUENCE ; i++)
+    for(int i = 0 ; i < BONE_INFLUENCES ; i++)
     {
-        if(boneIds[i] == -1) 
+        int boneId = boneIds[i];
+        if(boneId == NO_BONE) 
             continue;
-        if(boneIds[i] >=MAX_BONES) 
+        if(boneId >=MAX_BONES) 
         {
-            totalPosition = vec4(pos,1.0f);
+            totalPosition = vec4(position,1.0f);
             break;
         }
-        vec4 localPosition = finalBonesMatrices[boneIds[i]] * vec4(pos,1.0f);
+        vec4 localPosition = finalBonesMatrices[boneId] * vec4(position,1.0f);
         totalPosition += localPosition * weights[i];
-        vec3 localNormal = mat3(finalBonesMatrices[boneIds[i]]) * norm;
+        vec3 localNormal = mat3(finalBonesMatrices[boneId]) * normal;
    }
 	
-    mat4 viewModel = view * model;
-    gl_Position =  projection * viewModel * totalPosition;
+    vec4 worldPos = model * totalPosition;
+    WorldPos = worldPos.xyz;
+    vec4 viewPos = view * worldPos;
+    ViewDepth = -viewPos.z;
+    gl_Position =  projection * viewPos;
 	TexCoords = tex;
 }
@@ -0,0 +1,86 @@
+#ifndef BAKED_ANIMATION_H
+#define BAKED_ANIMATION_H
+
+// Baked LOD playback: every clip's per-frame skinning matrices in one float
+// texture. Each row is one baked frame, each bone three texels holding the
+// rows of its upper 3x4; anim_baked.vs fetches and blends two rows per vertex,
+// so a far character costs one uniform update instead of a bone palette.
+
+#include <glad/glad.h>
+#include <glm/glm.hpp>
+
+#include <learnopengl/shader_m.h>
+
+#include "blend_graph.h"
+
+#include <algorithm>
+#include <vector>
+
+class BakedAnimationTexture
+{
+public:
+	static const int TEXTURE_UNIT = 8;  // clear of the units Mesh::Draw binds materials to
+
+	void Init(const BlendGraph& graph)
+	{
+		const int bones = std::max(graph.BoneCount(), 1);
+		width = bones * 3;
+		height = 0;
+		rowOffsets.clear();
+		for (const BakedClip& clip : graph.Clips())
+		{
+			rowOffsets.push_back(height);
+			height += clip.frameCount;
+		}
+
+		std::vector<glm::vec4> texels(static_cast<size_t>(width) * height);
+		for (size_t c = 0; c < graph.Clips().size(); ++c)
+			for (int frame = 0; frame < graph.Clips()[c].frameCount; ++frame)
+			{
+				const glm::mat4* palette = graph.BakedPalette(static_cast<int>(c), frame);
+				glm::vec4* row = &texels[static_cast<size_t>(rowOffsets[c] + frame) * width];
+				for (int bone = 0; bone < bones; ++bone)
+					for (int r = 0; r < 3; ++r)
+						row[bone * 3 + r] = glm::vec4(palette[bone][0][r], palette[bone][1][r], palette[bone][2][r], palette[bone][3][r]);
+			}
+
+		glGenTextures(1, &texture);
+		glBindTexture(GL_TEXTURE_2D, texture);
+		glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA32F, width, height, 0, GL_RGBA, GL_FLOAT, texels.data());
+		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+		glBindTexture(GL_TEXTURE_2D, 0);
+	}
+
+	// bind the texture and point the shader at the two rows around the frame
+	template <typename ShaderType>
+	void Bind(const ShaderType& shader, const BakedFrame& frame) const
+	{
+		glActiveTexture(GL_TEXTURE0 + TEXTURE_UNIT);
+		glBindTexture(GL_TEXTURE_2D, texture);
+		glActiveTexture(GL_TEXTURE0);
+		shader.setInt("bakedPalette", TEXTURE_UNIT);
+		shader.setInt("bakedRow0", rowOffsets[frame.clip] + frame.frame0);
+		shader.setInt("bakedRow1", rowOffsets[frame.clip] + frame.frame1);
+		shader.setFloat("bakedBlend", frame.blend);
+	}
+
+	size_t SizeBytes() const { return static_cast<size_t>(width) * height * sizeof(glm::vec4); }
+
+	void Release()
+	{
+		if (texture)
+			glDeleteTextures(1, &texture);
+		texture = 0;
+	}
+
+private:
+	unsigned int texture = 0;
+	int width = 0;
+	int height = 0;
+	std::vector<int> rowOffsets;  // first row of each clip
+};
+
+#endif
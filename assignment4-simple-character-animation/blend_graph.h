@@ -0,0 +1,1082 @@
+#ifndef BLEND_GRAPH_H
+#define BLEND_GRAPH_H
+
+// Data-driven animation blend graph. A graph file lists clips, boolean
+// parameters, states and transitions (see locomotion.graph). Compile() loads the
+// clips and bakes every skeleton node to fixed-rate local poses, so evaluation
+// never searches assimp keyframes.
+//
+// BlendGraphInstance is one character: its current state, a stack of fading
+// layers and the pose buffer all layers are blended into. Clips are only bound
+// when a transition fires; blend weights advance in seconds, not per frame.
+//
+// Clips with foot-contact sync markers play in phase: while such a clip leads,
+// every other marked layer derives its time from one shared normalized phase,
+// so walk and run plant their feet together during a blend.
+//
+// Root motion is extracted while baking: the root node's horizontal travel
+// becomes a per-frame curve and is removed from the pose, so the per-frame
+// root delta is two table lookups and a loop wrap adds the exact loop distance.
+//
+// The skeleton is flattened at compile time into arrays in depth-first order,
+// where every parent comes before its children, so model-space transforms are
+// one linear loop and skinning matrices use direct bone indices.
+// BlendGraphWorkers spreads many instances over worker threads.
+//
+// Animation LOD: the graph lists levels by on-screen height. Reduced levels
+// leave detail nodes (fingers, face) at their last pose, evaluate only every
+// few updates and interpolate the bone matrices towards a pose sampled ahead,
+// and the farthest level plays skinning matrices baked per clip frame from a
+// texture (baked_animation.h) with no per-character bone work at all.
+
+#include <glm/glm.hpp>
+#include <glm/gtc/matrix_transform.hpp>
+#include <glm/gtc/quaternion.hpp>
+
+#include <learnopengl/filesystem.h>
+#include <learnopengl/animation.h>
+
+#include <algorithm>
+#include <cmath>
+#include <condition_variable>
+#include <cstdint>
+#include <fstream>
+#include <iostream>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <vector>
+
+const float BLEND_GRAPH_SAMPLE_RATE = 60.0f;  // baked poses per second of clip time, at least
+const int BLEND_GRAPH_MAX_PARAMETERS = 32;
+
+struct LocalPose
+{
+	glm::vec3 translation = glm::vec3(0.0f);
+	glm::quat rotation = glm::quat(1.0f, 0.0f, 0.0f, 0.0f);
+	glm::vec3 scale = glm::vec3(1.0f);
+};
+
+// split a node transform built as T * R * S
+inline LocalPose DecomposeLocal(const glm::mat4& m)
+{
+	LocalPose pose;
+	pose.translation = glm::vec3(m[3]);
+	glm::vec3 x(m[0]), y(m[1]), z(m[2]);
+	pose.scale = glm::vec3(glm::length(x), glm::length(y), glm::length(z));
+	glm::mat3 rotation;
+	rotation[0] = x / pose.scale.x;
+	rotation[1] = y / pose.scale.y;
+	rotation[2] = z / pose.scale.z;
+	pose.rotation = glm::normalize(glm::quat_cast(rotation));
+	return pose;
+}
+
+// a t of the way from a to b: translation and scale lerp, rotation nlerp on the short arc
+inline LocalPose MixLocal(const LocalPose& a, const LocalPose& b, float t)
+{
+	LocalPose pose;
+	pose.translation = glm::mix(a.translation, b.translation, t);
+	pose.scale = glm::mix(a.scale, b.scale, t);
+	glm::quat to = glm::dot(a.rotation, b.rotation) < 0.0f ? -b.rotation : b.rotation;
+	pose.rotation = glm::normalize(a.rotation * (1.0f - t) + to * t);
+	return pose;
+}
+
+inline glm::mat4 ComposeLocal(const LocalPose& pose)
+{
+	glm::mat4 m = glm::mat4_cast(pose.rotation);
+	m[0] *= pose.scale.x;
+	m[1] *= pose.scale.y;
+	m[2] *= pose.scale.z;
+	m[3] = glm::vec4(pose.translation, 1.0f);
+	return m;
+}
+
+// one clip resampled at BLEND_GRAPH_SAMPLE_RATE or a little faster, so the frames divide the
+// duration evenly and the last one lands on the loop point; poses[frame * channelCount + channel]
+struct BakedClip
+{
+	std::string name;
+	Animation* source = nullptr;  // kept for root motion sampling
+	float duration = 0.0f;        // seconds
+	float ticksPerSecond = 25.0f;
+	int frameCount = 0;
+	float frameStep = 1.0f / BLEND_GRAPH_SAMPLE_RATE;  // seconds between frames, duration / (frameCount - 1)
+	std::vector<glm::mat4> palettes;  // frame * boneCount + bone, skinning matrices for baked LOD playback
+	std::vector<LocalPose> poses;
+
+	// foot contact times in seconds, ascending; phase k..k+1 spans markers[k]..markers[k+1]
+	std::vector<float> markers;
+
+	// horizontal root offset from frame 0 at every baked frame; empty if the clip has no root motion.
+	// The last frame is the loop point, so its value is the exact displacement of one loop
+	std::vector<glm::vec3> rootCurve;
+
+	// the frame before a clip time and the blend towards the next one. At the duration it is
+	// the second to last frame with blend 1, so every lookup reaches the loop point exactly
+	int FrameAt(float time, float& blend) const
+	{
+		if (time >= duration)
+		{
+			blend = 1.0f;
+			return frameCount - 2;
+		}
+		float frame = std::max(time, 0.0f) / frameStep;
+		int frame0 = std::min(static_cast<int>(frame), frameCount - 2);
+		blend = std::clamp(frame - frame0, 0.0f, 1.0f);
+		return frame0;
+	}
+
+	glm::vec3 RootAt(float time) const
+	{
+		if (time >= duration)
+			return rootCurve.back();
+		float blend;
+		int frame0 = FrameAt(time, blend);
+		return glm::mix(rootCurve[frame0], rootCurve[frame0 + 1], blend);
+	}
+
+	// root travel from one clip time to the next; to < from means the clip wrapped once
+	glm::vec3 RootDelta(float from, float to) const
+	{
+		if (rootCurve.empty())
+			return glm::vec3(0.0f);
+		glm::vec3 delta = RootAt(to) - RootAt(from);
+		if (to < from)
+			delta += rootCurve.back();
+		return delta;
+	}
+
+	bool Synced() const { return markers.size() >= 2; }
+
+	float MarkerSpan(int segment) const
+	{
+		int count = static_cast<int>(markers.size());
+		float span = markers[(segment + 1) % count] - markers[segment];
+		return segment + 1 == count ? span + duration : span;
+	}
+
+	float TimeAtPhase(float phase) const
+	{
+		int segment = std::min(static_cast<int>(phase), static_cast<int>(markers.size()) - 1);
+		float time = markers[segment] + (phase - segment) * MarkerSpan(segment);
+		return time >= duration ? time - duration : time;
+	}
+
+	float PhaseAtTime(float time) const
+	{
+		int count = static_cast<int>(markers.size());
+		if (time < markers[0])
+			time += duration;
+		for (int segment = 0; segment < count; ++segment)
+		{
+			float start = markers[segment];
+			float span = MarkerSpan(segment);
+			if (time < start + span || segment + 1 == count)
+				return segment + std::clamp((time - start) / span, 0.0f, 0.999f);
+		}
+		return 0.0f;
+	}
+};
+
+enum class AnimationLodMode
+{
+	Full,   // every node
+	Core,   // detail nodes keep their last pose
+	Baked   // skinning matrices come from the clip's baked palettes
+};
+
+struct AnimationLod
+{
+	float minScreenHeight = 0.0f;  // fraction of the viewport height
+	int updateInterval = 1;        // evaluate every n updates, interpolate in between
+	AnimationLodMode mode = AnimationLodMode::Full;
+};
+
+// the two baked frames around a clip time and the blend between them
+struct BakedFrame
+{
+	int clip = 0;
+	int frame0 = 0;
+	int frame1 = 1;
+	float blend = 0.0f;
+};
+
+struct BlendGraphState
+{
+	std::string name;
+	int clip = 0;
+	float playbackRate = 1.0f;
+	float moveSpeed = 0.0f;  // fallback ground speed when the clip has no root motion, 0 = stationary
+};
+
+// fires when every parameter in requireSet is true and every one in requireClear is false
+struct BlendGraphTransition
+{
+	int from = -1;  // -1 = any state
+	int to = 0;
+	float duration = 0.25f;  // seconds
+	uint32_t requireSet = 0;
+	uint32_t requireClear = 0;
+};
+
+// shared, immutable after Compile(); any number of instances evaluate against it
+// ------------------------------------------------------------------------------
+class BlendGraph
+{
+public:
+	// graph file format, one entry per line, '#' starts a comment:
+	//   clip <name> <path relative to the project root>
+	//   param <name>
+	//   state <name> <clip> <playback rate> <move speed>
+	//   transition <from|*> <to> <blend seconds> [param | !param ...]
+	//   markers <clip> <left foot node> <right foot node>
+	//   rootmotion <clip> <root node>
+	//   detail <node name fragment>...
+	//   lod <min screen height> <update interval> full|core|baked
+	// the first state is the initial one; transitions are tried in file order.
+	// markers finds each foot's lowest point in the clip and uses them as sync markers;
+	// rootmotion moves the node's horizontal travel out of the pose into BakedClip::rootCurve.
+	// detail nodes are those whose name contains a fragment, and their children;
+	// lod levels go from nearest to farthest, without any every character is full rate
+	bool Load(const std::string& path)
+	{
+		std::ifstream file(path);
+		if (!file)
+		{
+			std::cout << "Failed to read blend graph: " << path << std::endl;
+			return false;
+		}
+
+		std::string line;
+		int lineNumber = 0;
+		while (std::getline(file, line))
+		{
+			++lineNumber;
+			std::istringstream in(line);
+			std::string kind;
+			if (!(in >> kind) || kind[0] == '#')
+				continue;
+
+			bool ok = false;
+			if (kind == "clip")
+			{
+				std::string name, clipPath;
+				ok = static_cast<bool>(in >> name >> clipPath);
+				if (ok)
+				{
+					clipNames.push_back(name);
+					clipPaths.push_back(clipPath);
+				}
+			}
+			else if (kind == "param")
+			{
+				std::string name;
+				ok = (in >> name) && parameters.size() < BLEND_GRAPH_MAX_PARAMETERS;
+				if (ok)
+					parameters.push_back(name);
+			}
+			else if (kind == "state")
+			{
+				BlendGraphState state;
+				std::string clip;
+				ok = (in >> state.name >> clip >> state.playbackRate >> state.moveSpeed) && (state.clip = Find(clipNames, clip)) >= 0;
+				if (ok)
+					states.push_back(state);
+			}
+			else if (kind == "transition")
+			{
+				BlendGraphTransition transition;
+				std::string from, to, condition;
+				ok = (in >> from >> to >> transition.duration) && (transition.to = FindState(to)) >= 0;
+				if (ok && from != "*")
+					ok = (transition.from = FindState(from)) >= 0;
+				while (ok && in >> condition)
+				{
+					bool negate = condition[0] == '!';
+					int parameter = FindParameter(negate ? condition.substr(1) : condition);
+					ok = parameter >= 0;
+					if (ok)
+						(negate ? transition.requireClear : transition.requireSet) |= 1u << parameter;
+				}
+				if (ok)
+					transitions.push_back(transition);
+			}
+			else if (kind == "markers")
+			{
+				MarkerSpec spec;
+				std::string clip;
+				ok = (in >> clip >> spec.leftFoot >> spec.rightFoot) && (spec.clip = Find(clipNames, clip)) >= 0;
+				if (ok)
+					markerSpecs.push_back(spec);
+			}
+			else if (kind == "rootmotion")
+			{
+				RootSpec spec;
+				std::string clip;
+				ok = (in >> clip >> spec.node) && (spec.clip = Find(clipNames, clip)) >= 0;
+				if (ok)
+					rootSpecs.push_back(spec);
+			}
+			else if (kind == "detail")
+			{
+				std::string fragment;
+				while (in >> fragment)
+					detailFragments.push_back(fragment);
+				ok = !detailFragments.empty();
+			}
+			else if (kind == "lod")
+			{
+				AnimationLod lod;
+				std::string mode;
+				ok = static_cast<bool>(in >> lod.minScreenHeight >> lod.updateInterval >> mode) && lod.updateInterval >= 1;
+				if (mode == "full")
+					lod.mode = AnimationLodMode::Full;
+				else if (mode == "core")
+					lod.mode = AnimationLodMode::Core;
+				else if (mode == "baked")
+					lod.mode = AnimationLodMode::Baked;
+				else
+					ok = false;
+				if (ok)
+					lods.push_back(lod);
+			}
+
+			if (!ok)
+			{
+				std::cout << "Blend graph " << path << ":" << lineNumber << ": bad entry: " << line << std::endl;
+				return false;
+			}
+		}
+
+		if (states.empty())
+		{
+			std::cout << "Blend graph " << path << " has no states" << std::endl;
+			return false;
+		}
+		return true;
+	}
+
+	// load and bake every clip against the model's skeleton. Needs a GL context
+	// because Animation loads through the model
+	bool Compile(Model* model)
+	{
+		if (clipPaths.empty())
+			return false;
+		for (const std::string& clipPath : clipPaths)
+			animations.push_back(std::make_unique<Animation>(FileSystem::getPath(clipPath), model));
+
+		// channels are the skeleton nodes in depth-first order, so a parent always
+		// has a lower index than its children
+		Animation* skeleton = animations[0].get();
+		const std::map<std::string, BoneInfo>& boneInfoMap = skeleton->GetBoneIDMap();
+		CollectChannels(skeleton->GetRootNode(), -1, boneInfoMap);
+		boneCount = 0;
+		for (const auto& entry : boneInfoMap)
+			boneCount = std::max(boneCount, entry.second.id + 1);
+
+		for (size_t i = 0; i < animations.size(); ++i)
+			clips.push_back(Bake(clipNames[i], animations[i].get()));
+		for (const MarkerSpec& spec : markerSpecs)
+			FindFootMarkers(clips[spec.clip], spec);
+		for (const RootSpec& spec : rootSpecs)
+			ExtractRootMotion(clips[spec.clip], spec);
+
+		coreChannels.clear();
+		std::vector<bool> detail(ChannelCount(), false);
+		for (int channel = 0; channel < ChannelCount(); ++channel)
+		{
+			detail[channel] = channelParents[channel] >= 0 && detail[channelParents[channel]];
+			for (const std::string& fragment : detailFragments)
+				detail[channel] = detail[channel] || channelNames[channel].find(fragment) != std::string::npos;
+			if (!detail[channel])
+				coreChannels.push_back(channel);
+		}
+		if (lods.empty())
+			lods.push_back(AnimationLod());
+		for (BakedClip& clip : clips)
+			BakePalettes(clip);
+		return true;
+	}
+
+	int FindState(const std::string& name) const
+	{
+		for (size_t i = 0; i < states.size(); ++i)
+			if (states[i].name == name)
+				return static_cast<int>(i);
+		return -1;
+	}
+
+	int FindParameter(const std::string& name) const { return Find(parameters, name); }
+
+	const std::vector<BakedClip>& Clips() const { return clips; }
+	const std::vector<BlendGraphState>& States() const { return states; }
+	const std::vector<BlendGraphTransition>& Transitions() const { return transitions; }
+	int ChannelCount() const { return static_cast<int>(channelNames.size()); }
+	int BoneCount() const { return boneCount; }
+
+	const std::vector<AnimationLod>& Lods() const { return lods; }
+	const std::vector<int>& CoreChannels() const { return coreChannels; }
+
+	// the nearest level whose minimum on-screen height the character reaches, else the farthest
+	int SelectLod(float screenHeight) const
+	{
+		for (size_t i = 0; i < lods.size(); ++i)
+			if (screenHeight >= lods[i].minScreenHeight)
+				return static_cast<int>(i);
+		return static_cast<int>(lods.size()) - 1;
+	}
+
+	const glm::mat4* BakedPalette(int clip, int frame) const
+	{
+		return &clips[clip].palettes[static_cast<size_t>(frame) * std::max(boneCount, 1)];
+	}
+
+	// model-space transform of every channel: one pass in index order, parents first
+	void ComputeGlobals(const LocalPose* poses, glm::mat4* globals) const
+	{
+		const int channelCount = ChannelCount();
+		const int* parents = channelParents.data();
+		globals[0] = ComposeLocal(poses[0]);
+		for (int channel = 1; channel < channelCount; ++channel)
+			globals[channel] = globals[parents[channel]] * ComposeLocal(poses[channel]);
+	}
+
+	// skinning matrices for the channels that are bones, written by bone id
+	void ComputeSkinning(const glm::mat4* globals, glm::mat4* finalBoneMatrices) const
+	{
+		const int count = static_cast<int>(skinChannels.size());
+		for (int i = 0; i < count; ++i)
+			finalBoneMatrices[skinBones[i]] = globals[skinChannels[i]] * skinOffsets[i];
+	}
+
+private:
+	struct MarkerSpec
+	{
+		int clip = 0;
+		std::string leftFoot;
+		std::string rightFoot;
+	};
+
+	struct RootSpec
+	{
+		int clip = 0;
+		std::string node;
+	};
+
+	static int Find(const std::vector<std::string>& names, const std::string& name)
+	{
+		for (size_t i = 0; i < names.size(); ++i)
+			if (names[i] == name)
+				return static_cast<int>(i);
+		return -1;
+	}
+
+	void CollectChannels(const AssimpNodeData& node, int parent, const std::map<std::string, BoneInfo>& boneInfoMap)
+	{
+		int index = ChannelCount();
+		channelNames.push_back(node.name);
+		channelBind.push_back(node.transformation);
+		channelParents.push_back(parent);
+		auto it = boneInfoMap.find(node.name);
+		if (it != boneInfoMap.end())
+		{
+			skinChannels.push_back(index);
+			skinBones.push_back(it->second.id);
+			skinOffsets.push_back(it->second.offset);
+		}
+		for (int i = 0; i < node.childrenCount; ++i)
+			CollectChannels(node.children[i], index, boneInfoMap);
+	}
+
+	// a foot is planted where it is lowest; one marker per foot
+	void FindFootMarkers(BakedClip& clip, const MarkerSpec& spec) const
+	{
+		int left = Find(channelNames, spec.leftFoot);
+		int right = Find(channelNames, spec.rightFoot);
+		if (left < 0 || right < 0)
+		{
+			std::cout << "Blend graph: no foot node " << (left < 0 ? spec.leftFoot : spec.rightFoot) << " for clip " << clip.name << std::endl;
+			return;
+		}
+
+		const int channelCount = ChannelCount();
+		const int frames = clip.frameCount - 1;  // the last frame repeats the loop point
+		std::vector<glm::mat4> globals(channelCount);
+		int lowest[2] = { 0, 0 };
+		float lowestHeight[2] = { 0.0f, 0.0f };
+		for (int frame = 0; frame < frames; ++frame)
+		{
+			ComputeGlobals(&clip.poses[static_cast<size_t>(frame) * channelCount], globals.data());
+			float heights[2] = { globals[left][3].y, globals[right][3].y };
+			for (int foot = 0; foot < 2; ++foot)
+			{
+				if (frame == 0 || heights[foot] < lowestHeight[foot])
+				{
+					lowest[foot] = frame;
+					lowestHeight[foot] = heights[foot];
+				}
+			}
+		}
+		if (lowest[0] == lowest[1])
+		{
+			std::cout << "Blend graph: clip " << clip.name << " has no distinct foot contacts, playing unsynced" << std::endl;
+			return;
+		}
+
+		clip.markers = { std::min(lowest[0] * clip.frameStep, clip.duration), std::min(lowest[1] * clip.frameStep, clip.duration) };
+		std::sort(clip.markers.begin(), clip.markers.end());
+	}
+
+	void ExtractRootMotion(BakedClip& clip, const RootSpec& spec) const
+	{
+		int root = Find(channelNames, spec.node);
+		if (root < 0)
+		{
+			std::cout << "Blend graph: no root node " << spec.node << " for clip " << clip.name << std::endl;
+			return;
+		}
+
+		const int channelCount = ChannelCount();
+		const glm::vec3 start = clip.poses[root].translation;
+		clip.rootCurve.resize(clip.frameCount);
+		for (int frame = 0; frame < clip.frameCount; ++frame)
+		{
+			glm::vec3& translation = clip.poses[static_cast<size_t>(frame) * channelCount + root].translation;
+			clip.rootCurve[frame] = glm::vec3(translation.x - start.x, 0.0f, translation.z - start.z);
+			translation.x = start.x;
+			translation.z = start.z;
+		}
+	}
+
+	BakedClip Bake(const std::string& name, Animation* animation) const
+	{
+		BakedClip clip;
+		clip.name = name;
+		clip.source = animation;
+		clip.ticksPerSecond = animation->GetTicksPerSecond() > 0.0f ? animation->GetTicksPerSecond() : 25.0f;
+		clip.duration = animation->GetDuration() / clip.ticksPerSecond;
+		// one extra frame so the last interval interpolates into the loop point; the step is
+		// shortened to fit, so every interval is the same length
+		clip.frameCount = std::max(2, static_cast<int>(std::ceil(clip.duration * BLEND_GRAPH_SAMPLE_RATE)) + 1);
+		clip.frameStep = clip.duration > 0.0f ? clip.duration / (clip.frameCount - 1) : 1.0f / BLEND_GRAPH_SAMPLE_RATE;
+
+		const int channelCount = ChannelCount();
+		clip.poses.resize(static_cast<size_t>(clip.frameCount) * channelCount);
+		for (int channel = 0; channel < channelCount; ++channel)
+		{
+			Bone* bone = animation->FindBone(channelNames[channel]);
+			LocalPose bind = DecomposeLocal(channelBind[channel]);
+			for (int frame = 0; frame < clip.frameCount; ++frame)
+			{
+				LocalPose& pose = clip.poses[static_cast<size_t>(frame) * channelCount + channel];
+				if (!bone)
+				{
+					pose = bind;
+					continue;
+				}
+				float seconds = frame == clip.frameCount - 1 ? clip.duration : std::min(frame * clip.frameStep, clip.duration);
+				float ticks = seconds * clip.ticksPerSecond;
+				bone->Update(std::min(ticks, std::max(animation->GetDuration() - 0.0001f, 0.0f)));
+				pose = DecomposeLocal(bone->GetLocalTransform());
+			}
+		}
+		return clip;
+	}
+
+	// skinning matrices of every baked frame, after root motion has been taken out
+	void BakePalettes(BakedClip& clip) const
+	{
+		const int bones = std::max(boneCount, 1);
+		const int channelCount = ChannelCount();
+		std::vector<glm::mat4> globals(channelCount);
+		clip.palettes.assign(static_cast<size_t>(clip.frameCount) * bones, glm::mat4(1.0f));
+		for (int frame = 0; frame < clip.frameCount; ++frame)
+		{
+			ComputeGlobals(&clip.poses[static_cast<size_t>(frame) * channelCount], globals.data());
+			ComputeSkinning(globals.data(), &clip.palettes[static_cast<size_t>(frame) * bones]);
+		}
+	}
+
+	std::vector<std::string> clipNames;
+	std::vector<std::string> clipPaths;
+	std::vector<std::string> parameters;
+	std::vector<BlendGraphState> states;
+	std::vector<BlendGraphTransition> transitions;
+	std::vector<MarkerSpec> markerSpecs;
+	std::vector<RootSpec> rootSpecs;
+	std::vector<std::string> detailFragments;
+	std::vector<AnimationLod> lods;
+
+	std::vector<std::unique_ptr<Animation>> animations;
+	std::vector<BakedClip> clips;
+	std::vector<std::string> channelNames;
+	std::vector<glm::mat4> channelBind;
+	std::vector<int> channelParents;     // -1 for the root, otherwise a lower channel index
+	std::vector<int> skinChannels;       // channel, bone id and offset of every skinned bone
+	std::vector<int> skinBones;
+	std::vector<glm::mat4> skinOffsets;
+	std::vector<int> coreChannels;       // channels that are not detail nodes, in channel order
+	int boneCount = 0;
+};
+
+// one playing clip inside an instance
+struct BlendLayer
+{
+	int clip = 0;
+	float time = 0.0f;    // seconds into the clip
+	float weight = 0.0f;
+	float rate = 1.0f;
+};
+
+// per-character graph state and pose buffer
+// -----------------------------------------
+class BlendGraphInstance
+{
+public:
+	explicit BlendGraphInstance(const BlendGraph& graph) : graph(&graph)
+	{
+		pose.resize(graph.ChannelCount());
+		globals.resize(graph.ChannelCount());
+		lodFrom.resize(graph.ChannelCount());
+		lodTo.resize(graph.ChannelCount());
+		// a clip plays in one layer at most and a layer takes two samples, so Update never grows these
+		layers.reserve(graph.Clips().size());
+		samples.reserve(2 * graph.Clips().size());
+		finalBoneMatrices.assign(std::max(graph.BoneCount(), 1), glm::mat4(1.0f));
+		Enter(0, 0.0f);
+		// every node starts from a full pose, so reduced levels have one to keep
+		Evaluate(false, 0.0f);
+	}
+
+	void SetParameter(int parameter, bool value)
+	{
+		if (parameter < 0)
+			return;
+		if (value)
+			parameters |= 1u << parameter;
+		else
+			parameters &= ~(1u << parameter);
+	}
+
+	// take at most one transition, advance clip times and blend weights by dt seconds
+	// and rebuild the bone matrices. Returns true if a transition fired
+	bool Update(float dt)
+	{
+		bool transitioned = false;
+		for (const BlendGraphTransition& transition : graph->Transitions())
+		{
+			if (transition.from >= 0 && transition.from != state)
+				continue;
+			if (transition.to == state)
+				continue;
+			if ((parameters & transition.requireSet) != transition.requireSet || (parameters & transition.requireClear) != 0)
+				continue;
+			Enter(transition.to, transition.duration);
+			transitioned = true;
+			break;
+		}
+
+		Advance(dt);
+
+		const AnimationLod& level = graph->Lods()[lod];
+		bool coreOnly = level.mode == AnimationLodMode::Core;
+		if (level.mode == AnimationLodMode::Baked)
+			return transitioned;
+		if (level.updateInterval <= 1)
+		{
+			Evaluate(coreOnly, 0.0f);
+			return transitioned;
+		}
+
+		// every interval updates sample the pose where the last step will be, then walk the
+		// local pose from where it is towards it and rebuild the matrices. Blending the
+		// skinning matrices instead would shrink and shear bones that rotate in between
+		if (lodStep == 0 || lodStep >= level.updateInterval)
+		{
+			lodFrom = pose;
+			BlendPose(coreOnly, dt * (level.updateInterval - 1));
+			lodTo = pose;
+			lodStep = 0;
+		}
+		++lodStep;
+		float t = static_cast<float>(lodStep) / level.updateInterval;
+		for (size_t i = 0; i < pose.size(); ++i)
+			pose[i] = MixLocal(lodFrom[i], lodTo[i], t);
+		BuildMatrices();
+		return transitioned;
+	}
+
+	// index into graph.Lods(); takes effect on the next Update
+	void SetLod(int level)
+	{
+		if (level != lod)
+			lodStep = 0;
+		lod = level;
+	}
+
+	int GetLod() const { return lod; }
+
+	// where baked playback of the current state's clip is; the pose blend is not used
+	BakedFrame GetBakedFrame() const
+	{
+		const BlendLayer& layer = layers[motionLayer];
+		const BakedClip& clip = graph->Clips()[layer.clip];
+		BakedFrame out;
+		out.clip = layer.clip;
+		out.frame0 = clip.FrameAt(layer.time, out.blend);
+		out.frame1 = out.frame0 + 1;
+		return out;
+	}
+
+	int GetState() const { return state; }
+	const BlendGraphState& GetStateInfo() const { return graph->States()[state]; }
+	const std::vector<BlendLayer>& GetLayers() const { return layers; }
+
+	// the current state's layer, which drives root motion
+	const BlendLayer& GetMotionLayer() const { return layers[motionLayer]; }
+	const BakedClip& GetMotionClip() const { return graph->Clips()[layers[motionLayer].clip]; }
+
+	// root travel of the last Update, blended by layer weight, in the root node's parent space
+	glm::vec3 GetRootDelta() const { return rootDelta; }
+
+	std::vector<glm::mat4>& GetFinalBoneMatrices() { return finalBoneMatrices; }
+	const std::vector<LocalPose>& GetPose() const { return pose; }
+
+	// the blend as it was before sync: every layer slerps its own two frames and is
+	// accumulated separately. Kept to check Evaluate() against
+	void EvaluateReference(std::vector<LocalPose>& out) const
+	{
+		const int channelCount = graph->ChannelCount();
+		out.assign(channelCount, LocalPose());
+		float totalWeight = 0.0f;
+		for (const BlendLayer& layer : layers)
+			totalWeight += layer.weight;
+
+		bool first = true;
+		for (const BlendLayer& layer : layers)
+		{
+			const BakedClip& clip = graph->Clips()[layer.clip];
+			float weight = totalWeight > 0.0f ? layer.weight / totalWeight : 1.0f;
+			float t;
+			int frame0 = clip.FrameAt(layer.time, t);
+			const LocalPose* a = &clip.poses[static_cast<size_t>(frame0) * channelCount];
+			const LocalPose* b = a + channelCount;
+			for (int channel = 0; channel < channelCount; ++channel)
+			{
+				glm::quat rotation = glm::normalize(glm::slerp(a[channel].rotation, b[channel].rotation, t));
+				if (!first && glm::dot(out[channel].rotation, rotation) < 0.0f)
+					rotation = -rotation;
+				LocalPose& o = out[channel];
+				o.translation = (first ? glm::vec3(0.0f) : o.translation) + glm::mix(a[channel].translation, b[channel].translation, t) * weight;
+				o.scale = (first ? glm::vec3(0.0f) : o.scale) + glm::mix(a[channel].scale, b[channel].scale, t) * weight;
+				o.rotation = (first ? glm::quat(0.0f, 0.0f, 0.0f, 0.0f) : o.rotation) + rotation * weight;
+			}
+			first = false;
+		}
+		for (LocalPose& p : out)
+			p.rotation = glm::normalize(p.rotation);
+	}
+
+	// pose two clips at fixed times, weighted 1 - blend and blend, through the same fused
+	// evaluation Update uses; for checking the blend against another evaluator. It replaces
+	// the playing layers, so the next Update continues from these two
+	void EvaluateBlend(int clipA, float timeA, int clipB, float timeB, float blend)
+	{
+		layers.clear();
+		layers.push_back({ clipA, timeA, 1.0f - blend, 1.0f });
+		layers.push_back({ clipB, timeB, blend, 1.0f });
+		motionLayer = 0;
+		Evaluate(false, 0.0f);
+	}
+
+private:
+	// start fading into a state; a clip that is already playing keeps its time so
+	// an interrupted transition fades back without popping
+	void Enter(int next, float duration)
+	{
+		const BlendGraphState& info = graph->States()[next];
+		state = next;
+		fadeDuration = duration;
+
+		motionLayer = -1;
+		for (size_t i = 0; i < layers.size(); ++i)
+			if (layers[i].clip == info.clip)
+				motionLayer = static_cast<int>(i);
+		if (motionLayer < 0)
+		{
+			// a new marked clip joins at the shared phase instead of its first frame
+			BlendLayer layer;
+			layer.clip = info.clip;
+			const BakedClip& clip = graph->Clips()[info.clip];
+			if (clip.Synced() && phaseValid)
+				layer.time = clip.TimeAtPhase(std::fmod(phase, static_cast<float>(clip.markers.size())));
+			layers.push_back(layer);
+			motionLayer = static_cast<int>(layers.size()) - 1;
+		}
+		layers[motionLayer].rate = info.playbackRate;
+		if (duration <= 0.0f)
+			layers[motionLayer].weight = 1.0f;
+	}
+
+	void Advance(float dt)
+	{
+		// while a marked clip leads, phase advances at the weighted rate of all marked
+		// layers (each segment is one phase unit) and they all follow it
+		const BakedClip& leader = graph->Clips()[layers[motionLayer].clip];
+		phaseValid = leader.Synced();
+		if (phaseValid)
+		{
+			phase = leader.PhaseAtTime(layers[motionLayer].time);
+			float rate = 0.0f;
+			float weight = 0.0f;
+			for (const BlendLayer& layer : layers)
+			{
+				const BakedClip& clip = graph->Clips()[layer.clip];
+				if (!clip.Synced() || clip.markers.size() != leader.markers.size())
+					continue;
+				int segment = std::min(static_cast<int>(phase), static_cast<int>(clip.markers.size()) - 1);
+				rate += layer.weight * layer.rate / clip.MarkerSpan(segment);
+				weight += layer.weight;
+			}
+			phase += dt * (weight > 0.0f ? rate / weight : 0.0f);
+			phase = std::fmod(phase, static_cast<float>(leader.markers.size()));
+		}
+
+		// clip times, and root travel weighted by the layer weights the pose was blended with.
+		// An update is assumed to be shorter than one loop of any clip
+		rootDelta = glm::vec3(0.0f);
+		float totalWeight = 0.0f;
+		for (BlendLayer& layer : layers)
+		{
+			const BakedClip& clip = graph->Clips()[layer.clip];
+			float previous = layer.time;
+			if (phaseValid && clip.Synced() && clip.markers.size() == leader.markers.size())
+			{
+				layer.time = clip.TimeAtPhase(phase);
+			}
+			else
+			{
+				layer.time += dt * layer.rate;
+				if (clip.duration > 0.0f)
+				{
+					layer.time = std::fmod(layer.time, clip.duration);
+					if (layer.time < 0.0f)
+						layer.time += clip.duration;
+				}
+			}
+			rootDelta += clip.RootDelta(previous, layer.time) * layer.weight;
+			totalWeight += layer.weight;
+		}
+		if (totalWeight > 0.0f)
+			rootDelta /= totalWeight;
+
+		// the target layer gains dt / fadeDuration; the others share what is left in proportion
+		BlendLayer& target = layers[motionLayer];
+		target.weight = fadeDuration > 0.0f ? std::min(target.weight + dt / fadeDuration, 1.0f) : 1.0f;
+		float others = 0.0f;
+		for (size_t i = 0; i < layers.size(); ++i)
+			if (static_cast<int>(i) != motionLayer)
+				others += layers[i].weight;
+		float scale = others > 0.0f ? (1.0f - target.weight) / others : 0.0f;
+
+		// drop layers that have faded out
+		size_t kept = 0;
+		for (size_t i = 0; i < layers.size(); ++i)
+		{
+			if (static_cast<int>(i) != motionLayer)
+			{
+				layers[i].weight *= scale;
+				if (layers[i].weight < 0.0001f)
+					continue;
+			}
+			if (static_cast<int>(i) == motionLayer)
+				motionLayer = static_cast<int>(kept);
+			layers[kept++] = layers[i];
+		}
+		layers.resize(kept);
+		if (kept == 1)
+			layers[0].weight = 1.0f;
+	}
+
+	void Evaluate(bool coreOnly, float lookahead)
+	{
+		BlendPose(coreOnly, lookahead);
+		BuildMatrices();
+	}
+
+	// every layer contributes its two neighbouring baked frames as weighted samples;
+	// each bone then sums all samples in one branch-free loop and normalizes once.
+	// lookahead samples that many seconds past the layer times without advancing them
+	void BlendPose(bool coreOnly, float lookahead)
+	{
+		const int channelCount = graph->ChannelCount();
+		float totalWeight = 0.0f;
+		for (const BlendLayer& layer : layers)
+			totalWeight += layer.weight;
+
+		samples.clear();
+		for (const BlendLayer& layer : layers)
+		{
+			const BakedClip& clip = graph->Clips()[layer.clip];
+			float weight = totalWeight > 0.0f ? layer.weight / totalWeight : 1.0f;
+			float time = layer.time;
+			if (lookahead > 0.0f && clip.duration > 0.0f)
+				time = std::fmod(time + lookahead * layer.rate, clip.duration);
+			float t;
+			int frame0 = clip.FrameAt(time, t);
+			const LocalPose* a = &clip.poses[static_cast<size_t>(frame0) * channelCount];
+			samples.push_back({ a, weight * (1.0f - t) });
+			samples.push_back({ a + channelCount, weight * t });
+		}
+
+		const PoseSample* sample = samples.data();
+		const int sampleCount = static_cast<int>(samples.size());
+		const int* core = graph->CoreChannels().data();
+		const int count = coreOnly ? static_cast<int>(graph->CoreChannels().size()) : channelCount;
+		for (int n = 0; n < count; ++n)
+		{
+			const int channel = coreOnly ? core[n] : n;
+			const glm::quat reference = sample[0].poses[channel].rotation;
+			glm::vec3 translation(0.0f);
+			glm::vec3 scale(0.0f);
+			glm::quat rotation(0.0f, 0.0f, 0.0f, 0.0f);
+			for (int i = 0; i < sampleCount; ++i)
+			{
+				const LocalPose& p = sample[i].poses[channel];
+				float w = sample[i].weight;
+				// flip into the reference hemisphere by the sign of the weight, not a branch
+				float rw = glm::dot(reference, p.rotation) < 0.0f ? -w : w;
+				translation += p.translation * w;
+				scale += p.scale * w;
+				rotation = rotation + p.rotation * rw;
+			}
+			pose[channel].translation = translation;
+			pose[channel].scale = scale;
+			pose[channel].rotation = glm::normalize(rotation);
+		}
+	}
+
+	void BuildMatrices()
+	{
+		graph->ComputeGlobals(pose.data(), globals.data());
+		graph->ComputeSkinning(globals.data(), finalBoneMatrices.data());
+	}
+
+	struct PoseSample
+	{
+		const LocalPose* poses;
+		float weight;
+	};
+
+	const BlendGraph* graph;
+	int state = 0;
+	uint32_t parameters = 0;
+	std::vector<BlendLayer> layers;
+	int motionLayer = 0;
+	float fadeDuration = 0.0f;
+	glm::vec3 rootDelta = glm::vec3(0.0f);
+	float phase = 0.0f;       // shared sync phase, in markers
+	bool phaseValid = false;
+	std::vector<PoseSample> samples;
+	std::vector<LocalPose> pose;
+	std::vector<glm::mat4> globals;
+	std::vector<glm::mat4> finalBoneMatrices;
+	int lod = 0;
+	int lodStep = 0;                   // updates since the last reduced-rate evaluation
+	std::vector<LocalPose> lodFrom;    // local poses interpolated between at reduced rate
+	std::vector<LocalPose> lodTo;
+};
+
+// updates many instances per frame on persistent worker threads. Each worker,
+// and the calling thread, takes one contiguous slice of the instances
+// ---------------------------------------------------------------------------
+class BlendGraphWorkers
+{
+public:
+	explicit BlendGraphWorkers(int threadCount)
+	{
+		for (int i = 1; i < threadCount; ++i)
+			threads.emplace_back(&BlendGraphWorkers::Run, this, i);
+	}
+
+	~BlendGraphWorkers()
+	{
+		{
+			std::lock_guard<std::mutex> lock(mutex);
+			stopping = true;
+		}
+		wake.notify_all();
+		for (std::thread& thread : threads)
+			thread.join();
+	}
+
+	int ThreadCount() const { return static_cast<int>(threads.size()) + 1; }
+
+	// parameters must already be set; returns once every instance is updated
+	void Update(std::vector<BlendGraphInstance>& instances, float dt)
+	{
+		{
+			std::lock_guard<std::mutex> lock(mutex);
+			batch = instances.data();
+			batchSize = instances.size();
+			batchDt = dt;
+			pending = static_cast<int>(threads.size());
+			++generation;
+		}
+		wake.notify_all();
+		UpdateSlice(0);
+
+		std::unique_lock<std::mutex> lock(mutex);
+		finished.wait(lock, [&]() { return pending == 0; });
+	}
+
+private:
+	void UpdateSlice(int worker)
+	{
+		size_t count = static_cast<size_t>(ThreadCount());
+		size_t begin = batchSize * worker / count;
+		size_t end = batchSize * (worker + 1) / count;
+		for (size_t i = begin; i < end; ++i)
+			batch[i].Update(batchDt);
+	}
+
+	void Run(int worker)
+	{
+		uint64_t seen = 0;
+		while (true)
+		{
+			{
+				std::unique_lock<std::mutex> lock(mutex);
+				wake.wait(lock, [&]() { return stopping || generation != seen; });
+				if (stopping)
+					return;
+				seen = generation;
+			}
+			UpdateSlice(worker);
+			{
+				std::lock_guard<std::mutex> lock(mutex);
+				--pending;
+			}
+			finished.notify_one();
+		}
+	}
+
+	std::vector<std::thread> threads;
+	std::mutex mutex;
+	std::condition_variable wake;
+	std::condition_variable finished;
+	uint64_t generation = 0;
+	int pending = 0;
+	bool stopping = false;
+
+	BlendGraphInstance* batch = nullptr;
+	size_t batchSize = 0;
+	float batchDt = 0.0f;
+};
+
+#endif
@@ -0,0 +1,206 @@
+#ifndef GPU_SKINNING_H
+#define GPU_SKINNING_H
+
+// Skins every mesh of a model once per frame into its own buffer with transform
+// feedback (GL 3.3 has no compute shaders) and draws the result as static
+// geometry, so extra passes over the character don't repeat the skinning.
+//
+// Output per vertex, interleaved: vec3 position, vec3 normal, vec2 texcoords.
+
+#include <glad/glad.h>
+#include <glm/glm.hpp>
+#include <glm/gtc/type_ptr.hpp>
+
+#include <learnopengl/shader_m.h>
+#include <learnopengl/model_animation.h>
+
+#include "skinning.h"
+#include "../common/shader_cache.h"
+
+#include <algorithm>
+#include <fstream>
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <vector>
+
+class GpuSkinning
+{
+public:
+	static const int OUTPUT_FLOATS = 8;
+
+	// compile the feedback program and create an output buffer and draw VAO per mesh
+	bool Init(Model& model, const char* vertexPath)
+	{
+		std::ifstream file(vertexPath);
+		if (!file)
+		{
+			std::cout << "ERROR::SHADER::FILE_NOT_SUCCESFULLY_READ: " << vertexPath << std::endl;
+			return false;
+		}
+		std::stringstream stream;
+		stream << file.rdbuf();
+		std::string code = stream.str();
+		const char* source = code.c_str();
+
+		unsigned int vertex = glCreateShader(GL_VERTEX_SHADER);
+		glShaderSource(vertex, 1, &source, NULL);
+		glCompileShader(vertex);
+		if (!CheckErrors(vertex, false))
+		{
+			glDeleteShader(vertex);
+			return false;
+		}
+
+		// varyings must be named before linking; no fragment shader, rasterization is discarded
+		program = glCreateProgram();
+		glAttachShader(program, vertex);
+		const char* varyings[] = { "skinnedPosition", "skinnedNormal", "skinnedTexCoords" };
+		glTransformFeedbackVaryings(program, 3, varyings, GL_INTERLEAVED_ATTRIBS);
+		glLinkProgram(program);
+		glDeleteShader(vertex);
+		if (!CheckErrors(program, true))
+			return false;
+		paletteLocation = glGetUniformLocation(program, "finalBonesMatrices");
+
+		for (Mesh& mesh : model.meshes)
+		{
+			SkinnedMesh out;
+			out.mesh = &mesh;
+			out.vertexCount = static_cast<int>(mesh.vertices.size());
+			out.indexCount = static_cast<int>(mesh.indices.size());
+
+			glGenBuffers(1, &out.outputBuffer);
+			glBindBuffer(GL_ARRAY_BUFFER, out.outputBuffer);
+			glBufferData(GL_ARRAY_BUFFER, out.vertexCount * OUTPUT_FLOATS * sizeof(float), NULL, GL_DYNAMIC_COPY);
+
+			glGenVertexArrays(1, &out.drawVAO);
+			glBindVertexArray(out.drawVAO);
+			glEnableVertexAttribArray(0);
+			glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, OUTPUT_FLOATS * sizeof(float), (void*)0);
+			glEnableVertexAttribArray(1);
+			glVertexAttribPointer(1, 3, GL_FLOAT, GL_FALSE, OUTPUT_FLOATS * sizeof(float), (void*)(3 * sizeof(float)));
+			glEnableVertexAttribArray(2);
+			glVertexAttribPointer(2, 2, GL_FLOAT, GL_FALSE, OUTPUT_FLOATS * sizeof(float), (void*)(6 * sizeof(float)));
+
+			glGenBuffers(1, &out.indexBuffer);
+			glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, out.indexBuffer);
+			glBufferData(GL_ELEMENT_ARRAY_BUFFER, mesh.indices.size() * sizeof(unsigned int), mesh.indices.data(), GL_STATIC_DRAW);
+			glBindVertexArray(0);
+
+			meshes.push_back(out);
+		}
+		glBindBuffer(GL_ARRAY_BUFFER, 0);
+		return true;
+	}
+
+	// one feedback pass over every mesh with the given finalBonesMatrices palette
+	void Skin(const glm::mat4* palette, int count)
+	{
+		glUseProgram(program);
+		glUniformMatrix4fv(paletteLocation, std::min(count, SKINNING_MAX_BONES), GL_FALSE, glm::value_ptr(palette[0]));
+		glEnable(GL_RASTERIZER_DISCARD);
+		for (const SkinnedMesh& out : meshes)
+		{
+			glBindVertexArray(out.mesh->VAO);
+			glBindBufferBase(GL_TRANSFORM_FEEDBACK_BUFFER, 0, out.outputBuffer);
+			glBeginTransformFeedback(GL_POINTS);
+			glDrawArrays(GL_POINTS, 0, out.vertexCount);
+			glEndTransformFeedback();
+		}
+		glBindBufferBase(GL_TRANSFORM_FEEDBACK_BUFFER, 0, 0);
+		glDisable(GL_RASTERIZER_DISCARD);
+		glBindVertexArray(0);
+	}
+
+	// draw the last Skin() result; texture binding follows Mesh::Draw
+	template <typename ShaderType>
+	void Draw(const ShaderType& shader) const
+	{
+		for (const SkinnedMesh& out : meshes)
+		{
+			BindMeshTextures(shader, out.mesh->textures);
+			glBindVertexArray(out.drawVAO);
+			glDrawElements(GL_TRIANGLES, out.indexCount, GL_UNSIGNED_INT, 0);
+		}
+		glBindVertexArray(0);
+		glActiveTexture(GL_TEXTURE0);
+	}
+
+	int MeshCount() const { return static_cast<int>(meshes.size()); }
+
+	// copy one mesh's skinned positions and normals back to the CPU (stalls; for validation)
+	void ReadBack(int mesh, std::vector<glm::vec3>& positions, std::vector<glm::vec3>& normals) const
+	{
+		const SkinnedMesh& out = meshes[mesh];
+		std::vector<float> data(static_cast<size_t>(out.vertexCount) * OUTPUT_FLOATS);
+		glBindBuffer(GL_ARRAY_BUFFER, out.outputBuffer);
+		glGetBufferSubData(GL_ARRAY_BUFFER, 0, data.size() * sizeof(float), data.data());
+		glBindBuffer(GL_ARRAY_BUFFER, 0);
+
+		positions.resize(out.vertexCount);
+		normals.resize(out.vertexCount);
+		for (int i = 0; i < out.vertexCount; ++i)
+		{
+			const float* v = &data[static_cast<size_t>(i) * OUTPUT_FLOATS];
+			positions[i] = glm::vec3(v[0], v[1], v[2]);
+			normals[i] = glm::vec3(v[3], v[4], v[5]);
+		}
+	}
+
+	void Release()
+	{
+		for (SkinnedMesh& out : meshes)
+		{
+			glDeleteBuffers(1, &out.outputBuffer);
+			glDeleteBuffers(1, &out.indexBuffer);
+			glDeleteVertexArrays(1, &out.drawVAO);
+		}
+		meshes.clear();
+		if (program)
+			glDeleteProgram(program);
+		program = 0;
+	}
+
+private:
+	struct SkinnedMesh
+	{
+		const Mesh* mesh = nullptr;
+		unsigned int outputBuffer = 0;
+		unsigned int drawVAO = 0;
+		unsigned int indexBuffer = 0;
+		int vertexCount = 0;
+		int indexCount = 0;
+	};
+
+	static bool CheckErrors(unsigned int object, bool isProgram)
+	{
+		int success;
+		char infoLog[1024];
+		if (isProgram)
+		{
+			glGetProgramiv(object, GL_LINK_STATUS, &success);
+			if (!success)
+			{
+				glGetProgramInfoLog(object, 1024, NULL, infoLog);
+				std::cout << "ERROR::PROGRAM_LINKING_ERROR of type: FEEDBACK\n" << infoLog << std::endl;
+			}
+		}
+		else
+		{
+			glGetShaderiv(object, GL_COMPILE_STATUS, &success);
+			if (!success)
+			{
+				glGetShaderInfoLog(object, 1024, NULL, infoLog);
+				std::cout << "ERROR::SHADER_COMPILATION_ERROR of type: VERTEX\n" << infoLog << std::endl;
+			}
+		}
+		return success != 0;
+	}
+
+	unsigned int program = 0;
+	int paletteLocation = -1;
+	std::vector<SkinnedMesh> meshes;
+};
+
+#endif
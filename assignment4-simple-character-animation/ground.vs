@@ -8,10 +8,16 @@ uniform mat4 view;
 uniform mat4 model;
 
 out vec2 TexCoords;
+out vec3 WorldPos;
+out float ViewDepth;
 
 void main()
 {
     TexCoords = aTexCoords;
-    gl_Position = projection * view * model * vec4(aPos, 1.0);
+    vec4 worldPos = model * vec4(aPos, 1.0);
+    WorldPos = worldPos.xyz;
+    vec4 viewPos = view * worldPos;
+    ViewDepth = -viewPos.z;
+    gl_Position = projection * viewPos;
 }
 
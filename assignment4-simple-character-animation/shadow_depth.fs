@@ -0,0 +1,6 @@
+#version 330 core
+
+// depth only: shadow map passes pair this with the scene vertex shaders
+void main()
+{
+}
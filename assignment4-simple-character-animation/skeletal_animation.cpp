@@ -3,6 +3,7 @@
 
 #include <glm/glm.hpp>
 #include <glm/gtc/matrix_transform.hpp>
+#include <glm/gtc/type_ptr.hpp>
 
 #include <learnopengl/filesystem.h>
 #include <learnopengl/shader_m.h>
@@ -11,20 +12,48 @@
 #include <learnopengl/model_animation.h>
 #include <stb_image.h>
 
+#include "../common/headless.h"
+#include "../common/frame_profiler.h"
+#include "../common/bench.h"
+#include "blend_graph.h"
+#include "skinning.h"
+#include "gpu_skinning.h"
+#include "skinned_bounds.h"
+#include "baked_animation.h"
+#include "../common/cascaded_shadows.h"
+#include "../common/texture_manager.h"
+#include "../common/model_batch.h"
+#include "../common/vertex_quantization.h"
+#include "../common/shader_permutations.h"
+#include "../common/frame_pipeline.h"
+#include "../common/render_queue.h"
+#define ALLOCATION_TRACKER_IMPLEMENTATION
+#include "../common/frame_arena.h"
+
 #include <algorithm>
 #include <cmath>
+#include <cstring>
 #include <iostream>
-#include <unordered_map>
 
 void framebuffer_size_callback(GLFWwindow* window, int width, int height);
 void mouse_callback(GLFWwindow* window, double xpos, double ypos);
 void scroll_callback(GLFWwindow* window, double xoffset, double yoffset);
 void processInput(GLFWwindow* window);
-unsigned int loadTexture(const char* path);
 void updateThirdPersonCamera();
-glm::vec3 SampleRootTranslation(Animation* animation, const std::string& rootBoneName, float animationTime);
-glm::vec3 EstimateRootLoopDisplacement(Animation* animation, const std::string& rootBoneName);
 glm::vec3 RotateDeltaByYaw(const glm::vec3& delta, float yawDegrees);
+uint32_t sampleInputKeys(GLFWwindow* window);
+void applyOrbitInput(const InputFrame& input);
+glm::mat4 characterSkeletonTransform();
+void buildBonePalette(const glm::mat4* bones, int count, glm::mat4* palette);
+int validateSkinning(Model& model, GpuSkinning& skinning, const std::vector<glm::mat4>& palette);
+int validateCpuSkinning(Model& model, CpuSkinning& skinning, const std::vector<glm::mat4>& palette);
+int validateBounds(const SkinnedBounds& bounds, CpuSkinning& skinning, const std::vector<glm::mat4>& palette);
+int validateBlend(BlendGraph& graph, Model& model);
+int validateRootMotion(BlendGraph& graph);
+bool setupBlendGraph(BlendGraph& graph, Model* model);
+void updateCharacter(BlendGraphInstance& character, const InputFrame& input, float dt);
+int runHeadless(const HeadlessOptions& options);
+int runBenchmarks(const BenchOptions& options);
 
 // settings
 const unsigned int SCR_WIDTH = 1920;
@@ -46,41 +75,103 @@ float lastFrame = 0.0f;
 
 glm::vec3 characterPosition = glm::vec3(0.0f); // Character stays at origin
 const float characterYaw = 0.0f; // Static character rotation
-const float walkSpeed = 1.25f;
-const float runSpeed = 4.0f;
 const float characterHeightOffset = -0.0f;
-const std::string ROOT_BONE_NAME = "mixamorig:Hips";
-Animation* activeAnimation = nullptr;
-std::unordered_map<const Animation*, glm::vec3> rootLoopDisplacements;
-glm::vec3 previousRootSample(0.0f);
-float previousRootTime = 0.0f;
-bool rootMotionInitialized = false;
-AnimBlendState animBlendState = AnimBlendState::IDLE;
-float blendAmount = 0.1f;
-const float blendRate = 0.00001f; 
+const std::string ROOT_BONE_NAME = "mixamorig:Hips"; // rootmotion node in locomotion.graph
+
+// blend graph parameters driven by input
+int forwardParameter = -1;
+int runParameter = -1;
+
+// --gpu-skinning: skin once per frame with transform feedback and draw the result as static geometry.
+// --validate-skinning (headless): compare the feedback output and the SoA kernel against CPU skinning
+bool useGpuSkinning = false;
+bool validateGpuSkinning = false;
+bool validateCharacterBounds = false;
+bool validateBlendGraph = false;   // --validate-blend (headless)
+bool validateRootCurves = false;   // --validate-root-motion (headless)
+bool useAnimationLod = true;
+
+// --quantized-vertices: draw the character from 28-byte packed vertices (common/vertex_quantization.h)
+bool useQuantizedVertices = false;
+
+// shadows: sun direction, cascades over the first SHADOW_DISTANCE units of the orbit camera
+const glm::vec3 SUN_DIRECTION = glm::normalize(glm::vec3(-0.4f, -1.0f, -0.3f));
+const int SHADOW_MAP_SIZE = 2048;
+const int SHADOW_CASCADES = 3;
+const float SHADOW_DISTANCE = 25.0f;
+const float SHADOW_CASTER_REACH = 20.0f;
+bool shadowsEnabled = true;
+
+// transient per-frame memory (bone palettes); frames after the first ALLOCATION_WARMUP_FRAMES
+// of a headless run must not touch the heap
+const size_t FRAME_ARENA_SIZE = 64 * 1024;
+const uint64_t ALLOCATION_WARMUP_FRAMES = 10;
 
 // ground plane move instead of character
 glm::vec3 groundPosition = glm::vec3(0.0f); 
 float groundYaw = 0.0f; 
 
-enum class MovementState {
-	IDLE,
-	WALK,
-	RUN
-};
+// input gathered from callbacks during the frame, applied once per frame
+InputFrame pendingInput;
+
+// --pipelined: the next frame's animation and camera update on a worker while this frame draws.
+// --pipeline-stress: uncapped frame rate, alternating sequential and pipelined phases that
+// report their frame rate and update/render overlap
+bool usePipeline = false;
+bool pipelineStress = false;
 
-enum class AnimBlendState {
-	IDLE,
-	IDLE_TO_WALK,
-	WALK,
-	WALK_TO_IDLE,
-	WALK_TO_RUN,
-	RUN,
-	RUN_TO_WALK
+// everything the render loop draws from: the output of one simulation step.
+// Pipelined, the worker writes the next frame's while the render thread draws this one
+struct FrameSnapshot
+{
+	glm::mat4 projection = glm::mat4(1.0f);
+	glm::mat4 view = glm::mat4(1.0f);
+	glm::mat4 groundModel = glm::mat4(1.0f);
+	glm::mat4 skeletonTransform = glm::mat4(1.0f);
+	int lod = 0;
+	bool bakedLod = false;
+	BakedFrame bakedFrame;
+	glm::mat4* bonePalette = nullptr;
+	std::vector<glm::mat4> paletteStorage;   // the worker's palette; the frame arena belongs to the render thread
+	bool characterVisible = false;
+	ShadowCascade cascades[MAX_SHADOW_CASCADES];
+	int cascadeCount = 0;
+	bool castsShadow = false;
+	bool inCascade[MAX_SHADOW_CASCADES] = {};
 };
 
-int main()
+int main(int argc, char** argv)
 {
+	HeadlessOptions options = ParseHeadlessOptions(argc, argv);
+	for (int i = 1; i < argc; ++i)
+	{
+		if (std::strcmp(argv[i], "--gpu-skinning") == 0)
+			useGpuSkinning = true;
+		else if (std::strcmp(argv[i], "--validate-skinning") == 0)
+			validateGpuSkinning = true;
+		else if (std::strcmp(argv[i], "--validate-bounds") == 0)
+			validateCharacterBounds = true;
+		else if (std::strcmp(argv[i], "--validate-blend") == 0)
+			validateBlendGraph = true;
+		else if (std::strcmp(argv[i], "--validate-root-motion") == 0)
+			validateRootCurves = true;
+		else if (std::strcmp(argv[i], "--no-animation-lod") == 0)
+			useAnimationLod = false;
+		else if (std::strcmp(argv[i], "--no-shadows") == 0)
+			shadowsEnabled = false;
+		else if (std::strcmp(argv[i], "--quantized-vertices") == 0)
+			useQuantizedVertices = true;
+		else if (std::strcmp(argv[i], "--pipelined") == 0)
+			usePipeline = true;
+		else if (std::strcmp(argv[i], "--pipeline-stress") == 0)
+			usePipeline = pipelineStress = true;
+	}
+	BenchOptions benchOptions = ParseBenchOptions(argc, argv);
+	if (benchOptions.enabled)
+		return runBenchmarks(benchOptions);
+	if (options.enabled)
+		return runHeadless(options);
+
 	// glfw: initialize and configure
 	// ------------------------------
 	glfwInit();
@@ -102,6 +193,8 @@ int main()
 		return -1;
 	}
 	glfwMakeContextCurrent(window);
+	if (pipelineStress)
+		glfwSwapInterval(0);
 	glfwSetFramebufferSizeCallback(window, framebuffer_size_callback);
 	glfwSetCursorPosCallback(window, mouse_callback);
 	glfwSetScrollCallback(window, scroll_callback);
@@ -124,25 +217,60 @@ int main()
 	// -----------------------------
 	glEnable(GL_DEPTH_TEST);
 
-	// build and compile shaders
-	// -------------------------
-	Shader ourShader("anim_model.vs", "anim_model.fs");
-	Shader groundShader("ground.vs", "ground.fs");
+	// build and compile shaders, or load them from the program binary cache
+	// ----------------------------------------------------------------------
+	ShaderCache shaders;
+	shaders.ParseOptions(argc, argv);
+	ShaderProgram& groundShader = shaders.Load("ground.vs", "ground.fs");
+	ShaderProgram& skinnedShader = shaders.Load("skinned_static.vs", "anim_model.fs");
+	ShaderProgram& skinnedDepthShader = shaders.Load("skinned_static.vs", "shadow_depth.fs");
 
 	
 	// load models
 	// -----------
 	Model ourModel(FileSystem::getPath("resources/objects/mixamo/warrock.dae"));
-	Animation idleAnimation(FileSystem::getPath("resources/objects/mixamo/idle.dae"),&ourModel);
-	Animation walkAnimation(FileSystem::getPath("resources/objects/mixamo/walk.dae"), &ourModel);
-	Animation runAnimation(FileSystem::getPath("resources/objects/mixamo/run.dae"), &ourModel);
-	Animator animator(&idleAnimation);
-	MovementState movementState = MovementState::IDLE;
-	activeAnimation = &idleAnimation;
-	rootLoopDisplacements[&idleAnimation] = glm::vec3(0.0f);
-	rootLoopDisplacements[&walkAnimation] = EstimateRootLoopDisplacement(&walkAnimation, ROOT_BONE_NAME);
-	rootLoopDisplacements[&runAnimation] = EstimateRootLoopDisplacement(&runAnimation, ROOT_BONE_NAME);
-	rootMotionInitialized = false;
+
+	// the skinning shaders are built for as many bone influences as the model's vertices use
+	// (1, 2 or 4), so the per-vertex loop has no slots to skip
+	const int modelInfluences = MaxBoneInfluences(ourModel);
+	ShaderPermutation skinning;
+	skinning.boneInfluences = SkinningVariant(modelInfluences);
+	skinning.quantizedVertices = useQuantizedVertices;
+	std::cout << "Skinning permutation: " << skinning.boneInfluences << " bone influences (warrock.dae uses up to " << modelInfluences << ")" << std::endl;
+	ShaderPermutations animShaders(shaders, "anim_model.vs", "anim_model.fs");
+	ShaderPermutations animDepthShaders(shaders, "anim_model.vs", "shadow_depth.fs");
+	ShaderPermutations bakedShaders(shaders, "anim_baked.vs", "anim_model.fs");
+	ShaderPermutations bakedDepthShaders(shaders, "anim_baked.vs", "shadow_depth.fs");
+	ShaderProgram& ourShader = animShaders.Get(skinning);
+	ShaderProgram& depthShader = animDepthShaders.Get(skinning);
+	ShaderProgram& bakedShader = bakedShaders.Get(skinning);
+	ShaderProgram& bakedDepthShader = bakedDepthShaders.Get(skinning);
+	shaders.StartHotReload(window);
+
+	BlendGraph blendGraph;
+	if (!setupBlendGraph(blendGraph, &ourModel))
+	{
+		glfwTerminate();
+		return -1;
+	}
+	BlendGraphInstance character(blendGraph);
+	const int boneCount = static_cast<int>(character.GetFinalBoneMatrices().size());
+	SkinnedBounds characterBounds;
+	characterBounds.Init(ourModel);
+	BakedAnimationTexture bakedAnimation;
+	bakedAnimation.Init(blendGraph);
+
+	GpuSkinning gpuSkinning;
+	if (useGpuSkinning && !gpuSkinning.Init(ourModel, "skin_feedback.vs"))
+		useGpuSkinning = false;
+
+	// transform feedback reads the float mesh VAOs, so their buffers stay when GPU skinning is on
+	QuantizedModel<Model> quantizedModel;
+	if (useQuantizedVertices)
+	{
+		quantizedModel.Init(ourModel, !useGpuSkinning);
+		PrintQuantizationReport("warrock.dae", quantizedModel.Error(), sizeof(Vertex));
+	}
 
 	const float groundHalfSize = 5.0f; 
 	const float groundHeight = characterHeightOffset - 0.1f;
@@ -171,12 +299,121 @@ int main()
 	glVertexAttribPointer(2, 2, GL_FLOAT, GL_FALSE, 8 * sizeof(float), (void*)(6 * sizeof(float)));
 	glBindVertexArray(0);
 
-	unsigned int groundTexture = loadTexture(FileSystem::getPath("resources/textures/checkerboard.png").c_str());
+	// textures flipped like the model's, which loaded with the flag set above
+	TextureOptions flipped;
+	flipped.flipVertically = true;
+	TextureManager textures;
+	textures.ParseOptions(argc, argv);
+	textures.Adopt(ourModel, flipped);
+	TextureOptions groundOptions = flipped;
+	groundOptions.wrap = GL_CLAMP_TO_EDGE;
+	unsigned int groundTexture = textures.Load(FileSystem::getPath("resources/textures/checkerboard.png"), groundOptions);
 	groundShader.use();
 	groundShader.setInt("groundTexture", 0);
 
 	updateThirdPersonCamera();
 
+	InputRecording recording;
+	uint64_t frameIndex = 0;
+
+	// per-stage CPU scopes and GPU passes
+	// -----------------------------------
+	FrameProfiler profiler;
+	profiler.ParseOptions(argc, argv);
+	const int inputScope = profiler.RegisterScope("input");
+	const int animationScope = profiler.RegisterScope("animation");
+	const int boneUploadScope = profiler.RegisterScope("bone upload");
+	const int drawScope = profiler.RegisterScope("draw submission");
+	const int groundPass = profiler.RegisterGpuPass("ground");
+	const int characterPass = profiler.RegisterGpuPass("character");
+	const int skinningPass = profiler.RegisterGpuPass("skinning");
+	const int charactersDrawnCounter = profiler.RegisterCounter("characters drawn");
+	const int animationLodCounter = profiler.RegisterCounter("animation lod");
+	const int textureCounter = profiler.RegisterCounter("texture MB resident");
+	const int allocationCounter = profiler.RegisterCounter("heap allocations");
+	int cascadePasses[MAX_SHADOW_CASCADES];
+	int cascadeCasterCounters[MAX_SHADOW_CASCADES];
+	for (int i = 0; i < SHADOW_CASCADES; ++i)
+	{
+		cascadePasses[i] = profiler.RegisterGpuPass("shadow cascade " + std::to_string(i));
+		cascadeCasterCounters[i] = profiler.RegisterCounter("casters in cascade " + std::to_string(i));
+	}
+
+	CascadedShadowMap shadowMap;
+	if (shadowsEnabled && !shadowMap.Init(SHADOW_MAP_SIZE, SHADOW_CASCADES))
+		shadowsEnabled = false;
+
+	// bone palettes and other per-frame data live in the frame arena; the skinning
+	// programs take the palette as one array upload
+	FrameArena frameArena(FRAME_ARENA_SIZE);
+	AllocationScope frameAllocations;
+	int animBonesLocation = glGetUniformLocation(ourShader.ID, "finalBonesMatrices");
+	int depthBonesLocation = glGetUniformLocation(depthShader.ID, "finalBonesMatrices");
+
+	// one simulation step: orbit input, blend graph and root motion, camera, bone palette,
+	// visibility, animation LOD and shadow cascades. Runs on the pipeline's worker;
+	// frame.bonePalette must already point at boneCount matrices
+	auto simulate = [&](FrameSnapshot& frame, const InputFrame& input, float dt) {
+		applyOrbitInput(input);
+		updateCharacter(character, input, dt);
+		updateThirdPersonCamera();
+
+		// view/projection transformations
+		frame.projection = glm::perspective(glm::radians(camera.Zoom), (float)SCR_WIDTH / (float)SCR_HEIGHT, 0.1f, 100.0f);
+		frame.view = camera.GetViewMatrix();
+		frame.groundModel = glm::translate(glm::mat4(1.0f), groundPosition);
+		frame.groundModel = glm::rotate(frame.groundModel, glm::radians(groundYaw), glm::vec3(0.0f, 1.0f, 0.0f));
+		frame.skeletonTransform = characterSkeletonTransform();
+
+		// skip skinning and drawing when the character's bounds are off screen; their
+		// height on screen picks the animation LOD for the next update
+		frame.lod = character.GetLod();
+		const AnimationLod& lod = blendGraph.Lods()[frame.lod];
+		frame.bakedLod = lod.mode == AnimationLodMode::Baked;
+		frame.bakedFrame = character.GetBakedFrame();
+		if (frame.bakedLod)
+			buildBonePalette(blendGraph.BakedPalette(frame.bakedFrame.clip, frame.bakedFrame.frame0), boneCount, frame.bonePalette);
+		else
+			buildBonePalette(character.GetFinalBoneMatrices().data(), boneCount, frame.bonePalette);
+		BoundingBox bounds = characterBounds.Compute(frame.bonePalette, boneCount);
+		frame.characterVisible = !BoundsOutsideFrustum(bounds, frame.projection * frame.view);
+		if (useAnimationLod)
+			character.SetLod(blendGraph.SelectLod(ScreenHeight(bounds, frame.projection * frame.view)));
+
+		// cascades fitted to the orbit camera; the character is the only caster
+		frame.cascadeCount = 0;
+		frame.castsShadow = false;
+		glm::vec3 boundsCentre = (bounds.min + bounds.max) * 0.5f;
+		float boundsRadius = glm::length(bounds.max - bounds.min) * 0.5f;
+		if (shadowsEnabled)
+		{
+			frame.cascadeCount = FitCascades(frame.view, glm::radians(camera.Zoom), (float)SCR_WIDTH / (float)SCR_HEIGHT, 0.1f, SHADOW_DISTANCE,
+			                                 SUN_DIRECTION, SHADOW_CASCADES, shadowMap.Size(), SHADOW_CASTER_REACH, frame.cascades);
+			for (int i = 0; i < frame.cascadeCount; ++i)
+			{
+				frame.inCascade[i] = SphereInCascade(frame.cascades[i], boundsCentre, boundsRadius);
+				frame.castsShadow = frame.castsShadow || frame.inCascade[i];
+			}
+		}
+	};
+
+	// --pipelined: the worker simulates from the input handed over before BeginUpdate.
+	// Callbacks run in glfwPollEvents, after FinishUpdate, so they never race the worker
+	FrameSnapshot sequentialFrame;
+	FramePipeline<FrameSnapshot> pipeline;
+	InputFrame stageInput;
+	float stageDelta = 0.0f;
+	const FramePipeline<FrameSnapshot>::UpdateStage updateStage = [&](FrameSnapshot& next) {
+		next.paletteStorage.resize(boneCount);
+		next.bonePalette = next.paletteStorage.data();
+		simulate(next, stageInput, stageDelta);
+	};
+	bool pipelined = usePipeline;
+	if (pipelined)
+		pipeline.Start(updateStage);
+	PipelineStress stress;
+	stress.Begin(glfwGetTime());
+
 	// render loop
 	// -----------
 	while (!glfwWindowShouldClose(window))
@@ -187,274 +424,221 @@ int main()
 		deltaTime = currentFrame - lastFrame;
 		lastFrame = currentFrame;
 
+		profiler.BeginFrame();
+		frameAllocations.Begin();
+
+		// shaders edited on disk (--hot-reload); a relinked program may move its uniforms
+		if (shaders.Poll() > 0)
+		{
+			animBonesLocation = glGetUniformLocation(ourShader.ID, "finalBonesMatrices");
+			depthBonesLocation = glGetUniformLocation(depthShader.ID, "finalBonesMatrices");
+		}
+
 		// input
 		// -----
-		processInput(window);
-
-		bool forwardPressed = glfwGetKey(window, GLFW_KEY_W) == GLFW_PRESS;
-		bool runPressed = glfwGetKey(window, GLFW_KEY_LEFT_SHIFT) == GLFW_PRESS;
+		{
+			ProfileScope scope(profiler, inputScope);
+			processInput(window);
 
-		// Static facing direction (no camera-based rotation)
-		glm::vec3 facingDir = glm::vec3(0.0f, 0.0f, -1.0f); // Fixed forward direction
+			pendingInput.keys = sampleInputKeys(window);
+			if (!options.recordPath.empty())
+				recording.Push(frameIndex, pendingInput);
+		}
 
-		switch (animBlendState)
+		// simulate this frame, or hand its input to the worker and draw the last one
+		// ---------------------------------------------------------------------------
+		if (pipelined)
 		{
-		case AnimBlendState::IDLE:
-			movementState = MovementState::IDLE;
-			activeAnimation = &idleAnimation;
-			animator.PlayAnimation(&idleAnimation, NULL, animator.m_CurrentTime, 0.0f, 0.0f);
-			if (forwardPressed)
-			{
-				blendAmount = 0.0f;
-				animator.PlayAnimation(&idleAnimation, &walkAnimation, animator.m_CurrentTime, 0.0f, blendAmount);
-				animBlendState = AnimBlendState::IDLE_TO_WALK;
-				activeAnimation = &walkAnimation;
-			}
-			break;
-
-		case AnimBlendState::IDLE_TO_WALK:
-			movementState = MovementState::WALK;
-			activeAnimation = &walkAnimation;
-			blendAmount += blendRate;
-			blendAmount = std::min(blendAmount, 1.0f);
-			animator.PlayAnimation(&idleAnimation, &walkAnimation, animator.m_CurrentTime, animator.m_CurrentTime2, blendAmount);
-			if (blendAmount >= 1.0f)
-			{
-				blendAmount = 0.0f;
-				float startTime = animator.m_CurrentTime2;
-				animator.PlayAnimation(&walkAnimation, NULL, startTime, 0.0f, 0.0f);
-				animBlendState = AnimBlendState::WALK;
-			}
-			break;
+			stageInput = pendingInput;
+			stageDelta = deltaTime;
+			pipeline.BeginUpdate();
+			pipeline.BeginRender();
+		}
+		else
+		{
+			ProfileScope scope(profiler, animationScope);
+			sequentialFrame.bonePalette = frameArena.Allocate<glm::mat4>(boneCount);
+			simulate(sequentialFrame, pendingInput, deltaTime);
+		}
+		pendingInput = InputFrame();
+		++frameIndex;
 
-		case AnimBlendState::WALK:
-			movementState = MovementState::WALK;
-			activeAnimation = &walkAnimation;
-			animator.PlayAnimation(&walkAnimation, NULL, animator.m_CurrentTime, animator.m_CurrentTime2, 0.0f);
-			if (!forwardPressed)
-			{
-				blendAmount = 0.0f;
-				animator.PlayAnimation(&walkAnimation, &idleAnimation, animator.m_CurrentTime, animator.m_CurrentTime2, blendAmount);
-				animBlendState = AnimBlendState::WALK_TO_IDLE;
-				activeAnimation = &idleAnimation;
-				movementState = MovementState::IDLE;
-			}
-			else if (runPressed)
-			{
-				blendAmount = 0.0f;
-				animator.PlayAnimation(&walkAnimation, &runAnimation, animator.m_CurrentTime, 0.0f, blendAmount);
-				animBlendState = AnimBlendState::WALK_TO_RUN;
-				activeAnimation = &runAnimation;
-				movementState = MovementState::RUN;
-			}
-			break;
-
-		case AnimBlendState::WALK_TO_IDLE:
-			movementState = MovementState::IDLE;
-			activeAnimation = &idleAnimation;
-			blendAmount += blendRate;
-			blendAmount = std::min(blendAmount, 1.0f);
-			animator.PlayAnimation(&walkAnimation, &idleAnimation, animator.m_CurrentTime, animator.m_CurrentTime2, blendAmount);
-			if (forwardPressed)
-			{
-				blendAmount = 0.0f;
-				animator.PlayAnimation(&idleAnimation, &walkAnimation, animator.m_CurrentTime, animator.m_CurrentTime2, blendAmount);
-				animBlendState = AnimBlendState::IDLE_TO_WALK;
-				activeAnimation = &walkAnimation;
-				movementState = MovementState::WALK;
-			}
-			else if (blendAmount >= 1.0f)
-			{
-				blendAmount = 0.0f;
-				float startTime = animator.m_CurrentTime2;
-				animator.PlayAnimation(&idleAnimation, NULL, startTime, 0.0f, 0.0f);
-				animBlendState = AnimBlendState::IDLE;
-			}
-			break;
-
-		case AnimBlendState::WALK_TO_RUN:
-			movementState = MovementState::RUN;
-			activeAnimation = &runAnimation;
-			blendAmount += blendRate;
-			blendAmount = std::min(blendAmount, 1.0f);
-			animator.PlayAnimation(&walkAnimation, &runAnimation, animator.m_CurrentTime, animator.m_CurrentTime2, blendAmount);
-			if (!forwardPressed || !runPressed)
-			{
-				blendAmount = 0.0f;
-				animator.PlayAnimation(&runAnimation, &walkAnimation, animator.m_CurrentTime, animator.m_CurrentTime2, blendAmount);
-				animBlendState = AnimBlendState::RUN_TO_WALK;
-				activeAnimation = &walkAnimation;
-				movementState = MovementState::WALK;
-			}
-			else if (blendAmount >= 1.0f)
-			{
-				blendAmount = 0.0f;
-				float startTime = animator.m_CurrentTime2;
-				animator.PlayAnimation(&runAnimation, NULL, startTime, 0.0f, 0.0f);
-				animBlendState = AnimBlendState::RUN;
-			}
-			break;
+		const FrameSnapshot& frame = pipelined ? pipeline.Front() : sequentialFrame;
+		profiler.SetCounter(charactersDrawnCounter, frame.characterVisible ? 1.0 : 0.0);
+		profiler.SetCounter(animationLodCounter, frame.lod);
 
-		case AnimBlendState::RUN:
-			movementState = MovementState::RUN;
-			activeAnimation = &runAnimation;
-			animator.PlayAnimation(&runAnimation, NULL, animator.m_CurrentTime, animator.m_CurrentTime2, 0.0f);
-			if (!forwardPressed || !runPressed)
+		// one character draw with the program matching its skinning path
+		auto drawCharacter = [&](ShaderProgram& animProgram, ShaderProgram& staticProgram, ShaderProgram& bakedProgram, const glm::mat4& projection, const glm::mat4& view) {
+			glm::mat4 model = glm::mat4(1.0f);
+			if (frame.bakedLod)
 			{
-				blendAmount = 0.0f;
-				animator.PlayAnimation(&runAnimation, &walkAnimation, animator.m_CurrentTime, animator.m_CurrentTime2, blendAmount);
-				animBlendState = AnimBlendState::RUN_TO_WALK;
-				activeAnimation = &walkAnimation;
-				movementState = forwardPressed ? MovementState::WALK : MovementState::IDLE;
+				// baked matrices are in skeleton space; the character transform goes in model
+				bakedProgram.use();
+				bakedProgram.setMat4("projection", projection);
+				bakedProgram.setMat4("view", view);
+				bakedProgram.setMat4("model", frame.skeletonTransform);
+				bakedAnimation.Bind(bakedProgram, frame.bakedFrame);
+				if (useQuantizedVertices)
+					quantizedModel.Draw(bakedProgram);
+				else
+					DrawModel(ourModel, bakedProgram);
 			}
-			break;
-
-		case AnimBlendState::RUN_TO_WALK:
-			movementState = forwardPressed ? MovementState::WALK : MovementState::IDLE;
-			activeAnimation = forwardPressed ? &walkAnimation : &idleAnimation;
-			blendAmount += blendRate;
-			blendAmount = std::min(blendAmount, 1.0f);
-			animator.PlayAnimation(&runAnimation, &walkAnimation, animator.m_CurrentTime, animator.m_CurrentTime2, blendAmount);
-			if (forwardPressed && runPressed)
+			else if (useGpuSkinning)
 			{
-				blendAmount = 0.0f;
-				animator.PlayAnimation(&walkAnimation, &runAnimation, animator.m_CurrentTime, animator.m_CurrentTime2, blendAmount);
-				animBlendState = AnimBlendState::WALK_TO_RUN;
-				activeAnimation = &runAnimation;
-				movementState = MovementState::RUN;
+				staticProgram.use();
+				staticProgram.setMat4("projection", projection);
+				staticProgram.setMat4("view", view);
+				staticProgram.setMat4("model", model);
+				gpuSkinning.Draw(staticProgram);
 			}
-			else if (blendAmount >= 1.0f)
+			else
 			{
-				blendAmount = 0.0f;
-				float startTime = animator.m_CurrentTime2;
-				if (forwardPressed)
-				{
-					animator.PlayAnimation(&walkAnimation, NULL, startTime, 0.0f, 0.0f);
-					animBlendState = AnimBlendState::WALK;
-					activeAnimation = &walkAnimation;
-					movementState = MovementState::WALK;
-				}
+				animProgram.use();
+				animProgram.setMat4("projection", projection);
+				animProgram.setMat4("view", view);
+				animProgram.setMat4("model", model);
+				if (useQuantizedVertices)
+					quantizedModel.Draw(animProgram);
 				else
-				{
-					animator.PlayAnimation(&idleAnimation, NULL, 0.0f, 0.0f, 0.0f);
-					animBlendState = AnimBlendState::IDLE;
-					activeAnimation = &idleAnimation;
-					movementState = MovementState::IDLE;
-				}
+					DrawModel(ourModel, animProgram);
 			}
-			break;
-		}
+		};
 
-		animator.UpdateAnimation(deltaTime);
-
-		Animation* motionAnimation = activeAnimation != nullptr ? activeAnimation : animator.GetCurrentAnimation();
-		if (motionAnimation != nullptr)
+		if ((frame.characterVisible || frame.castsShadow) && !frame.bakedLod)
 		{
-			float animationTime = animator.GetCurrentTime();
-			glm::vec3 rootSample = SampleRootTranslation(motionAnimation, ROOT_BONE_NAME, animationTime);
-
-			if (!rootMotionInitialized)
+			ProfileScope scope(profiler, boneUploadScope);
+			if (useGpuSkinning)
 			{
-				previousRootSample = rootSample;
-				previousRootTime = animationTime;
-				rootMotionInitialized = true;
+				// skin once; every pass after this draws the output as static geometry
+				ProfileGpuPass gpuTimer(profiler, skinningPass);
+				gpuSkinning.Skin(frame.bonePalette, boneCount);
 			}
 			else
 			{
-				glm::vec3 localDelta = rootSample - previousRootSample;
-
-				if (animationTime < previousRootTime)
-				{
-					glm::vec3 loopDisplacement = glm::vec3(0.0f);
-					auto it = rootLoopDisplacements.find(motionAnimation);
-					if (it != rootLoopDisplacements.end())
-						loopDisplacement = it->second;
-					localDelta = (loopDisplacement - previousRootSample) + rootSample;
-				}
-
-				previousRootSample = rootSample;
-				previousRootTime = animationTime;
-
-				if (movementState != MovementState::IDLE)
+				// the shadow program skins in its own vertex shader, so it needs the palette too
+				ShaderProgram* programs[] = { &ourShader, &depthShader };
+				const int locations[] = { animBonesLocation, depthBonesLocation };
+				for (int p = 0; p < 2; ++p)
 				{
-					glm::vec3 worldDelta(0.0f);
-					if (glm::length(localDelta) < 0.0001f)
-					{
-						float fallbackSpeed = (movementState == MovementState::RUN) ? runSpeed : walkSpeed;
-						worldDelta = facingDir * fallbackSpeed * deltaTime;
-					}
-					else
-					{
-						localDelta.y = 0.0f;
-						worldDelta = RotateDeltaByYaw(localDelta, characterYaw);
-					}
-					// Move ground plane in opposite direction instead of character
-					groundPosition -= worldDelta;
-					// Update ground rotation based on movement direction
-					if (glm::length(worldDelta) > 0.0001f)
-					{
-						groundYaw = glm::degrees(atan2(worldDelta.x, -worldDelta.z));
-					}
+					if (programs[p] == &depthShader && !frame.castsShadow)
+						continue;
+					programs[p]->use();
+					glUniformMatrix4fv(locations[p], std::min(boneCount, SKINNING_MAX_BONES), GL_FALSE, glm::value_ptr(frame.bonePalette[0]));
 				}
 			}
 		}
 
-		updateThirdPersonCamera();
-		
+		// shadow cascades: the light's projection goes in projection, view is identity
+		for (int i = 0; i < frame.cascadeCount; ++i)
+		{
+			ProfileGpuPass gpuTimer(profiler, cascadePasses[i]);
+			shadowMap.BeginCascade(i);
+			if (frame.inCascade[i])
+				drawCharacter(depthShader, skinnedDepthShader, bakedDepthShader, frame.cascades[i].viewProjection, glm::mat4(1.0f));
+			shadowMap.EndCascade();
+			profiler.SetCounter(cascadeCasterCounters[i], frame.inCascade[i] ? 1.0 : 0.0);
+		}
+
 		// render
 		// ------
 		glClearColor(0.05f, 0.05f, 0.05f, 1.0f);
 		glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
 
-		// view/projection transformations
-		glm::mat4 projection = glm::perspective(glm::radians(camera.Zoom), (float)SCR_WIDTH / (float)SCR_HEIGHT, 0.1f, 100.0f);
-		glm::mat4 view = camera.GetViewMatrix();
-
-		groundShader.use();
-		groundShader.setMat4("projection", projection);
-		groundShader.setMat4("view", view);
-		// Apply ground plane transformation (translation and rotation)
-		glm::mat4 groundModel = glm::mat4(1.0f);
-		groundModel = glm::translate(groundModel, groundPosition);
-		groundModel = glm::rotate(groundModel, glm::radians(groundYaw), glm::vec3(0.0f, 1.0f, 0.0f));
-		groundShader.setMat4("model", groundModel);
-		glActiveTexture(GL_TEXTURE0);
-		glBindTexture(GL_TEXTURE_2D, groundTexture);
-		glBindVertexArray(groundVAO);
-		glDrawArrays(GL_TRIANGLES, 0, 6);
-		glBindVertexArray(0);
-
-		// don't forget to enable shader before setting uniforms
-		ourShader.use();
-		ourShader.setMat4("projection", projection);
-		ourShader.setMat4("view", view);
-
-        auto transforms = animator.GetFinalBoneMatrices();
-		glm::mat4 skeletonTransform = glm::mat4(1.0f);
-		// Character stays at origin with static rotation
-		skeletonTransform = glm::translate(skeletonTransform, characterPosition + glm::vec3(0.0f, characterHeightOffset, 0.0f));
-		skeletonTransform = glm::rotate(skeletonTransform, glm::radians(-characterYaw - 180.0f), glm::vec3(0.0f, 1.0f, 0.0f));
-		skeletonTransform = glm::scale(skeletonTransform, glm::vec3(0.5f));
-
-		for (int i = 0; i < transforms.size(); ++i)
+		// shadow receivers
+		ShaderProgram* receivers[] = { &groundShader, &ourShader, &skinnedShader, &bakedShader };
+		for (ShaderProgram* receiver : receivers)
 		{
-			glm::mat4 skinnedMatrix = skeletonTransform * transforms[i];
-			ourShader.setMat4("finalBonesMatrices[" + std::to_string(i) + "]", skinnedMatrix);
+			receiver->use();
+			if (shadowsEnabled)
+				shadowMap.Bind(*receiver, frame.cascades, frame.cascadeCount);
+			else
+				receiver->setInt("cascadeCount", 0);
 		}
 
+		{
+			ProfileScope drawTimer(profiler, drawScope);
+			ProfileGpuPass gpuTimer(profiler, groundPass);
+			groundShader.use();
+			groundShader.setMat4("projection", frame.projection);
+			groundShader.setMat4("view", frame.view);
+			// ground plane transformation (translation and rotation) from the simulation step
+			groundShader.setMat4("model", frame.groundModel);
+			glActiveTexture(GL_TEXTURE0);
+			glBindTexture(GL_TEXTURE_2D, groundTexture);
+			textures.Use(groundTexture);
+			glBindVertexArray(groundVAO);
+			glDrawArrays(GL_TRIANGLES, 0, 6);
+			glBindVertexArray(0);
+		}
 
 		// render the loaded model
-		glm::mat4 model = glm::mat4(1.0f);
-		ourShader.setMat4("model", model);
-		ourModel.Draw(ourShader);
+		if (frame.characterVisible)
+		{
+			ProfileScope drawTimer(profiler, drawScope);
+			ProfileGpuPass gpuTimer(profiler, characterPass);
+			drawCharacter(ourShader, skinnedShader, bakedShader, frame.projection, frame.view);
+			textures.UseModel(ourModel);
+		}
 
 
 		// glfw: swap buffers and poll IO events (keys pressed/released, mouse moved etc.)
 		// -------------------------------------------------------------------------------
+		// the swap stays on this thread with the same interval, pipelined or not. The
+		// worker's snapshot becomes the front one before callbacks run
 		glfwSwapBuffers(window);
+		if (pipelined)
+		{
+			pipeline.EndRender();
+			ProfileScope scope(profiler, animationScope);
+			pipeline.FinishUpdate();
+		}
 		glfwPollEvents();
+		textures.EndFrame();
+		profiler.SetCounter(textureCounter, textures.ResidentBytes() / (1024.0 * 1024.0));
+		frameArena.Reset();
+		profiler.SetCounter(allocationCounter, static_cast<double>(frameAllocations.End()));
+		profiler.EndFrame();
+
+		// --pipeline-stress: report the phase that just ended and switch modes
+		if (pipelineStress && stress.EndFrame(glfwGetTime(), pipelined, pipeline.Overlap()))
+		{
+			if (pipelined)
+			{
+				pipeline.Stop();
+				pipeline.ResetOverlap();
+			}
+			else
+			{
+				stageInput = InputFrame();
+				stageDelta = 0.0f;
+				pipeline.Start(updateStage);
+			}
+			pipelined = !pipelined;
+		}
+	}
+
+	if (pipeline.Running())
+	{
+		pipeline.Stop();
+		if (pipeline.Overlap().frames > 0)
+			pipeline.Overlap().Print("pipeline/overlap");
 	}
 
+	profiler.PrintSummary();
+	profiler.WriteTrace();
+	profiler.ReleaseGpu();
+	gpuSkinning.Release();
+	quantizedModel.Release();
+	bakedAnimation.Release();
+	shadowMap.Release();
+	textures.PrintReport();
+	textures.ReleaseAll();
+	shaders.PrintReport();
+	shaders.Release();
+
+	if (!options.recordPath.empty())
+		recording.Save(options.recordPath);
+
 	// glfw: terminate, clearing all previously allocated GLFW resources.
 	// ------------------------------------------------------------------
 	glfwTerminate();
@@ -469,6 +653,470 @@ void processInput(GLFWwindow* window)
 		glfwSetWindowShouldClose(window, true);
 }
 
+// pack the movement keys for this frame
+// -------------------------------------
+uint32_t sampleInputKeys(GLFWwindow* window)
+{
+	uint32_t keys = 0;
+	if (glfwGetKey(window, GLFW_KEY_W) == GLFW_PRESS)
+		keys |= INPUT_KEY_W;
+	if (glfwGetKey(window, GLFW_KEY_LEFT_SHIFT) == GLFW_PRESS)
+		keys |= INPUT_KEY_SHIFT;
+	return keys;
+}
+
+// only allow pitch changes from mouse movement
+// --------------------------------------------
+void applyOrbitInput(const InputFrame& input)
+{
+	if (input.mouseDy == 0.0f)
+		return;
+	orbitPitch += input.mouseDy * camera.MouseSensitivity;
+	orbitPitch = std::clamp(orbitPitch, -30.0f, 75.0f);
+}
+
+// the character stays at the origin with a static rotation; applied to every bone matrix
+// -------------------------------------------------------------------------------------
+glm::mat4 characterSkeletonTransform()
+{
+	glm::mat4 skeletonTransform = glm::mat4(1.0f);
+	skeletonTransform = glm::translate(skeletonTransform, characterPosition + glm::vec3(0.0f, characterHeightOffset, 0.0f));
+	skeletonTransform = glm::rotate(skeletonTransform, glm::radians(-characterYaw - 180.0f), glm::vec3(0.0f, 1.0f, 0.0f));
+	skeletonTransform = glm::scale(skeletonTransform, glm::vec3(0.5f));
+	return skeletonTransform;
+}
+
+// finalBonesMatrices as uploaded: skeleton transform times each bone matrix
+// -------------------------------------------------------------------------
+void buildBonePalette(const glm::mat4* bones, int count, glm::mat4* palette)
+{
+	glm::mat4 skeletonTransform = characterSkeletonTransform();
+	for (int i = 0; i < count; ++i)
+		palette[i] = skeletonTransform * bones[i];
+}
+
+// skin with transform feedback, read the result back and compare every vertex with CPU
+// skinning. Returns the number of vertices further apart than the tolerance
+// -------------------------------------------------------------------------------------
+int validateSkinning(Model& model, GpuSkinning& skinning, const std::vector<glm::mat4>& palette)
+{
+	skinning.Skin(palette.data(), static_cast<int>(palette.size()));
+	glFinish();
+
+	std::vector<glm::vec3> gpuPositions, gpuNormals, cpuPositions, cpuNormals;
+	float maxError = 0.0f;
+	int vertexCount = 0;
+	int failures = 0;
+	for (int mesh = 0; mesh < skinning.MeshCount(); ++mesh)
+	{
+		skinning.ReadBack(mesh, gpuPositions, gpuNormals);
+		SkinMeshReference(model.meshes[mesh], palette.data(), cpuPositions, cpuNormals);
+		for (size_t i = 0; i < cpuPositions.size(); ++i)
+		{
+			float error = glm::length(gpuPositions[i] - cpuPositions[i]);
+			maxError = std::max(maxError, error);
+			if (error > 1.0e-4f * std::max(1.0f, glm::length(cpuPositions[i])))
+				++failures;
+		}
+		vertexCount += static_cast<int>(cpuPositions.size());
+	}
+	std::cout << "skinning validation: " << vertexCount << " vertices, max position error " << maxError
+	          << ", " << failures << " outside tolerance" << std::endl;
+	return failures;
+}
+
+// skin with the SoA kernel on one thread and on every thread and compare every vertex
+// with the per-vertex reference. Returns the number of vertices outside the tolerance
+// -------------------------------------------------------------------------------------
+int validateCpuSkinning(Model& model, CpuSkinning& skinning, const std::vector<glm::mat4>& palette)
+{
+	std::vector<glm::vec3> referencePositions, referenceNormals;
+	const int runs[] = { 1, static_cast<int>(std::max(1u, std::thread::hardware_concurrency())) };
+	int failures = 0;
+	for (int threads : runs)
+	{
+		skinning.Skin(palette, threads);
+		float maxPositionError = 0.0f;
+		float maxNormalError = 0.0f;
+		size_t vertexCount = 0;
+		int runFailures = 0;
+		for (int mesh = 0; mesh < skinning.MeshCount(); ++mesh)
+		{
+			SkinMeshReference(model.meshes[mesh], palette.data(), referencePositions, referenceNormals);
+			for (size_t i = 0; i < referencePositions.size(); ++i)
+			{
+				float positionError = glm::length(skinning.Positions(mesh)[i] - referencePositions[i]);
+				float normalError = glm::length(skinning.Normals(mesh)[i] - referenceNormals[i]);
+				maxPositionError = std::max(maxPositionError, positionError);
+				maxNormalError = std::max(maxNormalError, normalError);
+				if (positionError > 1.0e-4f * std::max(1.0f, glm::length(referencePositions[i])) || normalError > 1.0e-3f)
+					++runFailures;
+			}
+			vertexCount += referencePositions.size();
+		}
+		std::printf("cpu skinning validation, %d threads: %zu vertices, max position error %g, max normal error %g, %d outside tolerance\n",
+			threads, vertexCount, maxPositionError, maxNormalError, runFailures);
+		failures += runFailures;
+	}
+	return failures;
+}
+
+// skin on the CPU and check every vertex lies inside the per-bone bounds.
+// Returns the number of vertices outside; also reports how loose the bounds are
+// ----------------------------------------------------------------------------
+int validateBounds(const SkinnedBounds& bounds, CpuSkinning& skinning, const std::vector<glm::mat4>& palette)
+{
+	BoundingBox box = bounds.Compute(palette.data(), static_cast<int>(palette.size()));
+	skinning.Skin(palette, 1);
+
+	BoundingBox exact;
+	int failures = 0;
+	for (int mesh = 0; mesh < skinning.MeshCount(); ++mesh)
+		for (const glm::vec3& p : skinning.Positions(mesh))
+		{
+			exact.Add(p);
+			if (!box.Contains(p, 1.0e-4f * std::max(1.0f, glm::length(p))))
+				++failures;
+		}
+	glm::vec3 boxSize = box.max - box.min;
+	glm::vec3 exactSize = exact.max - exact.min;
+	std::cout << "bounds validation: volume ratio " << (boxSize.x * boxSize.y * boxSize.z) / std::max(exactSize.x * exactSize.y * exactSize.z, 1.0e-12f)
+	          << ", " << failures << " vertices outside" << std::endl;
+	return failures;
+}
+
+// pose the blend graph against the two-clip Animator blend it replaced and against the
+// per-layer reference path. Returns the number of poses outside tolerance
+// -------------------------------------------------------------------------------------
+int validateBlend(BlendGraph& graph, Model& model)
+{
+	int failures = 0;
+	// the blend against the two-clip Animator blend it replaced: idle/walk and walk/run at five
+	// weights and twelve times per clip, the last just before the loop point. Root motion takes
+	// the hips' horizontal travel out of the graph's pose, which moves every bone by the same
+	// offset, so translations are compared after removing the hips bone's difference
+	{
+		BlendGraphInstance check(graph);
+		const auto& boneInfo = model.GetBoneInfoMap();
+		auto hipsInfo = boneInfo.find(ROOT_BONE_NAME);
+		const int hipsBone = hipsInfo != boneInfo.end() ? hipsInfo->second.id : -1;
+		const float blends[] = { 0.0f, 0.25f, 0.5f, 0.75f, 1.0f };
+		const int timeSteps = 12;
+		float maxLinearError = 0.0f;
+		float maxTranslationError = 0.0f;
+		int blendSamples = 0;
+		for (size_t pair = 0; pair + 1 < graph.Clips().size(); ++pair)
+		{
+			const BakedClip& clipA = graph.Clips()[pair];
+			const BakedClip& clipB = graph.Clips()[pair + 1];
+			Animator reference(clipA.source);
+			for (float blend : blends)
+				for (int step = 0; step < timeSteps; ++step)
+				{
+					float fraction = step + 1 < timeSteps ? static_cast<float>(step) / timeSteps : 0.999f;
+					float timeA = clipA.duration * fraction;
+					float timeB = clipB.duration * fraction;
+					reference.PlayAnimation(clipA.source, clipB.source, timeA * clipA.ticksPerSecond, timeB * clipB.ticksPerSecond, blend);
+					reference.UpdateAnimation(0.0f);
+					std::vector<glm::mat4> expected = reference.GetFinalBoneMatrices();
+					check.EvaluateBlend(static_cast<int>(pair), timeA, static_cast<int>(pair + 1), timeB, blend);
+					const std::vector<glm::mat4>& actual = check.GetFinalBoneMatrices();
+
+					const size_t bones = std::min(expected.size(), actual.size());
+					glm::vec3 shift(0.0f);
+					if (hipsBone >= 0 && static_cast<size_t>(hipsBone) < bones)
+						shift = glm::vec3(expected[hipsBone][3]) - glm::vec3(actual[hipsBone][3]);
+					float reach = 1.0f;
+					for (size_t i = 0; i < bones; ++i)
+						reach = std::max(reach, glm::length(glm::vec3(expected[i][3])));
+					float linearError = 0.0f;
+					float translationError = 0.0f;
+					for (size_t i = 0; i < bones; ++i)
+					{
+						for (int column = 0; column < 3; ++column)
+						{
+							glm::vec3 e(expected[i][column]), a(actual[i][column]);
+							linearError = std::max(linearError, glm::length(e - a) / std::max(glm::length(e), 1e-6f));
+						}
+						glm::vec3 e(expected[i][3]), a(actual[i][3]);
+						translationError = std::max(translationError, glm::length(e - shift - a) / reach);
+					}
+					maxLinearError = std::max(maxLinearError, linearError);
+					maxTranslationError = std::max(maxTranslationError, translationError);
+					if (linearError > 0.05f || translationError > 0.02f)
+						++failures;
+					++blendSamples;
+				}
+		}
+		std::printf("blend_graph/vs_animator: %d poses, max rotation/scale error %g, max translation error %g of reach, %d failures\n",
+			blendSamples, maxLinearError, maxTranslationError, failures);
+	}
+
+	// the fused per-bone blend against the per-layer slerp path it replaced, idle -> walk -> run
+	{
+		BlendGraphInstance check(graph);
+		std::vector<LocalPose> reference;
+		float maxTranslationError = 0.0f;
+		float maxRotationError = 0.0f;
+		int fusedFailures = 0;
+		for (int frame = 0; frame < 240; ++frame)
+		{
+			check.SetParameter(forwardParameter, frame >= 30);
+			check.SetParameter(runParameter, frame >= 90 && frame < 180);
+			check.Update(1.0f / 60.0f);
+			check.EvaluateReference(reference);
+			const std::vector<LocalPose>& fused = check.GetPose();
+			bool failed = false;
+			for (size_t i = 0; i < reference.size(); ++i)
+			{
+				float translationError = glm::length(fused[i].translation - reference[i].translation);
+				float cosHalf = std::min(std::fabs(glm::dot(fused[i].rotation, reference[i].rotation)), 1.0f);
+				float rotationError = glm::degrees(2.0f * std::acos(cosHalf));
+				maxTranslationError = std::max(maxTranslationError, translationError);
+				maxRotationError = std::max(maxRotationError, rotationError);
+				failed = failed || rotationError > 1.0f || translationError > 0.01f * std::max(glm::length(reference[i].translation), 1.0f);
+			}
+			if (failed)
+				++fusedFailures;
+		}
+		failures += fusedFailures;
+		std::printf("blend_graph/fused_vs_reference: max translation error %g, max rotation error %g deg, %d failures\n",
+			maxTranslationError, maxRotationError, fusedFailures);
+	}
+	return failures;
+}
+
+// each root motion curve against the hips track of its source clip: sampled seven times
+// per baked interval, and summed over three loops of 1/60 s updates with their wraps.
+// Either may be off by 1% of the loop distance, and the loop point must be exact.
+// Returns the number of clips that fail
+// -------------------------------------------------------------------------------------
+int validateRootMotion(BlendGraph& graph)
+{
+	int failures = 0;
+	for (const BakedClip& clip : graph.Clips())
+	{
+		Bone* root = clip.source->FindBone(ROOT_BONE_NAME);
+		if (clip.rootCurve.empty() || !root)
+			continue;
+		const float lastTick = std::max(clip.source->GetDuration() - 0.0001f, 0.0f);
+		auto sourceAt = [&](float seconds) {
+			glm::vec3 position(0.0f);
+			root->InterpolatePosition(std::min(seconds * clip.ticksPerSecond, lastTick), position);
+			return glm::vec3(position.x, 0.0f, position.z);
+		};
+		const glm::vec3 origin = sourceAt(0.0f);
+		const glm::vec3 loop = sourceAt(clip.duration) - origin;
+		const float tolerance = 0.01f * std::max(glm::length(loop), 1.0f);
+
+		float curveError = 0.0f;
+		const int samples = (clip.frameCount - 1) * 7;
+		for (int i = 0; i <= samples; ++i)
+		{
+			float time = clip.duration * i / samples;
+			curveError = std::max(curveError, glm::length(clip.RootAt(time) - (sourceAt(time) - origin)));
+		}
+
+		glm::vec3 travelled(0.0f), expected(0.0f);
+		float time = 0.0f;
+		const int steps = static_cast<int>(std::ceil(clip.duration * 3.0f * 60.0f));
+		for (int step = 0; step < steps; ++step)
+		{
+			float next = std::fmod(time + 1.0f / 60.0f, clip.duration);
+			travelled += clip.RootDelta(time, next);
+			if (next < time)
+				expected += sourceAt(clip.duration) - sourceAt(time) + sourceAt(next) - origin;
+			else
+				expected += sourceAt(next) - sourceAt(time);
+			time = next;
+		}
+		float travelError = glm::length(travelled - expected);
+		bool loopPointExact = clip.RootAt(clip.duration) == clip.rootCurve.back();
+		if (curveError > tolerance || travelError > tolerance || !loopPointExact)
+			++failures;
+		std::printf("root_motion/source_track/%s: loop %g, curve error %g, 3-loop travel error %g, loop point %s\n",
+			clip.name.c_str(), glm::length(loop), curveError, travelError, loopPointExact ? "exact" : "off");
+	}
+	return failures;
+}
+
+// load locomotion.graph and bake its clips, sync markers and root motion curves
+// ----------------------------------------------------------------------------
+bool setupBlendGraph(BlendGraph& graph, Model* model)
+{
+	if (!graph.Load("locomotion.graph") || !graph.Compile(model))
+		return false;
+	forwardParameter = graph.FindParameter("forward");
+	runParameter = graph.FindParameter("run");
+	return true;
+}
+
+// blend graph update and root motion for one frame of input
+// ----------------------------------------------------------
+void updateCharacter(BlendGraphInstance& character, const InputFrame& input, float dt)
+{
+	character.SetParameter(forwardParameter, (input.keys & INPUT_KEY_W) != 0);
+	character.SetParameter(runParameter, (input.keys & INPUT_KEY_SHIFT) != 0);
+
+	// Static facing direction (no camera-based rotation)
+	glm::vec3 facingDir = glm::vec3(0.0f, 0.0f, -1.0f); // Fixed forward direction
+
+	character.Update(dt);
+
+	// root travel baked from the clips; states without it slide at their move speed
+	glm::vec3 localDelta = character.GetRootDelta();
+	glm::vec3 worldDelta(0.0f);
+	if (glm::length(localDelta) >= 0.0001f)
+	{
+		localDelta.y = 0.0f;
+		worldDelta = RotateDeltaByYaw(localDelta, characterYaw);
+	}
+	else if (character.GetStateInfo().moveSpeed > 0.0f)
+	{
+		worldDelta = facingDir * character.GetStateInfo().moveSpeed * dt;
+	}
+
+	// Move ground plane in opposite direction instead of character
+	groundPosition -= worldDelta;
+	// Update ground rotation based on movement direction
+	if (glm::length(worldDelta) > 0.0001f)
+	{
+		groundYaw = glm::degrees(atan2(worldDelta.x, -worldDelta.z));
+	}
+}
+
+// run input, blend graph and root motion from recorded input without a window.
+// Model and Animation still upload their meshes, so an offscreen context is created first
+// ----------------------------------------------------------------------------------------
+int runHeadless(const HeadlessOptions& options)
+{
+	InputRecording recording;
+	if (!options.inputPath.empty() && !recording.Load(options.inputPath))
+		return -1;
+
+	OffscreenContext context;
+	if (!CreateOffscreenContext(context))
+		return -1;
+
+	Model ourModel(FileSystem::getPath("resources/objects/mixamo/warrock.dae"));
+	BlendGraph blendGraph;
+	if (!setupBlendGraph(blendGraph, &ourModel))
+	{
+		DestroyOffscreenContext(context);
+		return -1;
+	}
+	BlendGraphInstance character(blendGraph);
+	int blendFailures = validateBlendGraph ? validateBlend(blendGraph, ourModel) : 0;
+	int rootMotionFailures = validateRootCurves ? validateRootMotion(blendGraph) : 0;
+
+	GpuSkinning gpuSkinning;
+	if (validateGpuSkinning && !gpuSkinning.Init(ourModel, "skin_feedback.vs"))
+	{
+		DestroyOffscreenContext(context);
+		return -1;
+	}
+	const int boneCount = static_cast<int>(character.GetFinalBoneMatrices().size());
+	std::vector<glm::mat4> bonePalette;
+	int skinningFailures = 0;
+	SkinnedBounds characterBounds;
+	CpuSkinning cpuSkinning;
+	if (validateCharacterBounds)
+		characterBounds.Init(ourModel);
+	if (validateGpuSkinning || validateCharacterBounds)
+		cpuSkinning.Init(ourModel);
+	int boundsFailures = 0;
+
+	// the character's draws as the window would submit them: one packet per mesh, recorded
+	// with the camera and the bone palette into a command buffer and replayed into the null
+	// backend. Program and uniform locations are made up, nothing is drawn. Both are sized
+	// up front (at most six commands per packet), so frames don't grow them
+	const unsigned int characterProgram = 1;
+	const int projectionLocation = 0, viewLocation = 1, bonesLocation = 2, modelLocation = 3;
+	const int characterPackets = static_cast<int>(ourModel.meshes.size());
+	RenderQueue characterQueue;
+	CommandBuffer characterCommands;
+	characterQueue.Reserve(characterPackets);
+	characterCommands.Reserve(characterPackets * 6 + 8, (characterPackets + 2 + SKINNING_MAX_BONES) * 16);
+	int submittedDraws = 0, submittedUploads = 0;
+
+	// heap allocations are counted over each frame's update, palette assembly and submission
+	FrameArena frameArena(FRAME_ARENA_SIZE);
+	AllocationScope frameAllocations;
+	uint64_t warmupAllocations = 0, steadyAllocations = 0;
+
+	TimingStats frameStats("frame");
+	frameStats.Reserve(options.frames);
+	for (uint64_t frame = 0; frame < options.frames; ++frame)
+	{
+		glm::mat4* palette;
+		{
+			ScopedTimer frameTimer(frameStats);
+			frameAllocations.Begin();
+			InputFrame input = recording.At(frame);
+			applyOrbitInput(input);
+			updateCharacter(character, input, options.dt);
+			updateThirdPersonCamera();
+			palette = frameArena.Allocate<glm::mat4>(boneCount);
+			buildBonePalette(character.GetFinalBoneMatrices().data(), boneCount, palette);
+
+			glm::mat4 projection = glm::perspective(glm::radians(camera.Zoom), (float)SCR_WIDTH / (float)SCR_HEIGHT, 0.1f, 100.0f);
+			glm::mat4 view = camera.GetViewMatrix();
+			characterQueue.Clear();
+			for (const auto& mesh : ourModel.meshes)
+			{
+				DrawPacket packet;
+				packet.program = characterProgram;
+				packet.vao = mesh.VAO;
+				if (!mesh.textures.empty())
+				{
+					packet.textures[0] = mesh.textures[0].id;
+					packet.textureCount = 1;
+				}
+				packet.modelLocation = modelLocation;
+				packet.count = static_cast<int>(mesh.indices.size());
+				packet.key = PackDrawKey(packet, 0, 0.0f);
+				characterQueue.Push(packet);
+			}
+			characterCommands.Clear();
+			characterCommands.UseProgram(characterProgram);
+			characterCommands.UniformMatrix4(projectionLocation, 1, glm::value_ptr(projection));
+			characterCommands.UniformMatrix4(viewLocation, 1, glm::value_ptr(view));
+			characterCommands.UniformMatrix4(bonesLocation, std::min(boneCount, SKINNING_MAX_BONES), glm::value_ptr(palette[0]));
+			characterQueue.Record(characterCommands);
+			NullCommandBackend backend;
+			ReplayCommands(characterCommands, backend);
+			submittedDraws = backend.Draws();
+			submittedUploads = backend.Uploads();
+			(frame < ALLOCATION_WARMUP_FRAMES ? warmupAllocations : steadyAllocations) += frameAllocations.End();
+		}
+
+		// a few poses spread over the run, checked outside the frame timer
+		if ((validateGpuSkinning || validateCharacterBounds) && frame % 120 == 0)
+			bonePalette.assign(palette, palette + boneCount);
+		if (validateGpuSkinning && frame % 120 == 0)
+		{
+			skinningFailures += validateSkinning(ourModel, gpuSkinning, bonePalette);
+			skinningFailures += validateCpuSkinning(ourModel, cpuSkinning, bonePalette);
+		}
+		if (validateCharacterBounds && frame % 120 == 0)
+			boundsFailures += validateBounds(characterBounds, cpuSkinning, bonePalette);
+		frameArena.Reset();
+	}
+
+	frameStats.Print();
+	bool allocationFailure = AllocationTrackingEnabled() && steadyAllocations > 0;
+	std::cout << "heap allocations: " << warmupAllocations << " in the first " << std::min(options.frames, ALLOCATION_WARMUP_FRAMES)
+	          << " frames, " << steadyAllocations << " after" << (allocationFailure ? " (expected none)" : "")
+	          << "; frame arena high water " << frameArena.HighWater() << " bytes" << std::endl;
+	std::cout << "submitted per frame: " << submittedDraws << " draws, " << submittedUploads << " uniform uploads" << std::endl;
+	std::cout << "ground " << groundPosition.x << " " << groundPosition.y << " " << groundPosition.z
+	          << "  state " << character.GetStateInfo().name << std::endl;
+
+	gpuSkinning.Release();
+	DestroyOffscreenContext(context);
+	return skinningFailures + boundsFailures + blendFailures + rootMotionFailures > 0 || allocationFailure ? 1 : 0;
+}
+
 // glfw: whenever the window size changed (by OS or user resize) this callback function executes
 // ---------------------------------------------------------------------------------------------
 void framebuffer_size_callback(GLFWwindow* window, int width, int height)
@@ -494,11 +1142,7 @@ void mouse_callback(GLFWwindow* window, double xpos, double ypos)
 	lastX = xpos;
 	lastY = ypos;
 
-	// only allow pitch changes
-	orbitPitch += yoffset * camera.MouseSensitivity;
-	orbitPitch = std::clamp(orbitPitch, -30.0f, 75.0f);
-
-	updateThirdPersonCamera();
+	pendingInput.mouseDy += yoffset;
 }
 
 // glfw: whenever the mouse scroll wheel scrolls, this callback is called
@@ -510,43 +1154,6 @@ void scroll_callback(GLFWwindow* window, double xoffset, double yoffset)
 	updateThirdPersonCamera();
 }
 
-unsigned int loadTexture(const char* path)
-{
-	unsigned int textureID;
-	glGenTextures(1, &textureID);
-
-	int width, height, nrComponents;
-	unsigned char* data = stbi_load(path, &width, &height, &nrComponents, 0);
-	if (data)
-	{
-		GLenum format = GL_RGB;
-		if (nrComponents == 1)
-			format = GL_RED;
-		else if (nrComponents == 3)
-			format = GL_RGB;
-		else if (nrComponents == 4)
-			format = GL_RGBA;
-
-		glBindTexture(GL_TEXTURE_2D, textureID);
-		glTexImage2D(GL_TEXTURE_2D, 0, format, width, height, 0, format, GL_UNSIGNED_BYTE, data);
-		glGenerateMipmap(GL_TEXTURE_2D);
-
-		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
-		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
-		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_LINEAR);
-		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
-
-		stbi_image_free(data);
-	}
-	else
-	{
-		std::cout << "Texture failed to load at path: " << path << std::endl;
-		stbi_image_free(data);
-	}
-
-	return textureID;
-}
-
 void updateThirdPersonCamera()
 {
 	float clampedPitch = std::clamp(orbitPitch, -30.0f, 75.0f);
@@ -568,40 +1175,295 @@ void updateThirdPersonCamera()
 	camera.Up = glm::normalize(glm::cross(camera.Right, camera.Front));
 }
 
-glm::vec3 SampleRootTranslation(Animation* animation, const std::string& rootBoneName, float animationTime)
+// CPU hot paths: root motion lookup, keyframe interpolation, blend graph evaluation,
+// bone palette assembly, texture decode and .dae loading. Model and Animation need GL, so this runs offscreen
+// -------------------------------------------------------------------------------------
+int runBenchmarks(const BenchOptions& options)
 {
-	glm::vec3 translation(0.0f);
-	if (!animation)
-		return translation;
+	BenchmarkRunner runner(options);
 
-	Bone* rootBone = animation->FindBone(rootBoneName);
-	if (!rootBone)
-		return translation;
+	// shadow cascades fitted to the orbit camera
+	ShadowCascade cascades[MAX_SHADOW_CASCADES];
+	const float fovY = glm::radians(camera.Zoom);
+	const float aspect = (float)SCR_WIDTH / (float)SCR_HEIGHT;
+	updateThirdPersonCamera();
+	glm::mat4 orbitView = camera.GetViewMatrix();
+	runner.Run("cascade_fit/" + std::to_string(SHADOW_CASCADES), [&]() {
+		int count = FitCascades(orbitView, fovY, aspect, 0.1f, SHADOW_DISTANCE, SUN_DIRECTION, SHADOW_CASCADES, SHADOW_MAP_SIZE, SHADOW_CASTER_REACH, cascades);
+		DoNotOptimize(cascades[count - 1].viewProjection);
+	});
+
+	const char* textures[] = { "resources/textures/checkerboard.png", "resources/objects/mixamo/textures/bear_diffuse.png" };
+	for (const char* texture : textures)
+	{
+		std::string path = FileSystem::getPath(texture);
+		int width, height, nrComponents;
+		if (!stbi_info(path.c_str(), &width, &height, &nrComponents))
+		{
+			std::cout << "Skipping texture_decode, failed to open " << path << std::endl;
+			continue;
+		}
+		runner.Run(std::string("texture_decode/") + texture, [&]() {
+			unsigned char* data = stbi_load(path.c_str(), &width, &height, &nrComponents, 0);
+			DoNotOptimize(data);
+			stbi_image_free(data);
+		});
+	}
 
-	float duration = animation->GetDuration();
-	if (duration <= 0.0f)
-		return translation;
+	OffscreenContext context;
+	if (!CreateOffscreenContext(context))
+		return runner.Finish();
 
-	float wrappedTime = fmod(animationTime, duration);
-	if (wrappedTime < 0.0f)
-		wrappedTime += duration;
+	// startup shader time: a cold cache compiles and links, a warm one loads program binaries.
+	// The driver may keep a cache of its own (Mesa does), which speeds up the cold pass too
+	{
+		const char* const programs[][2] = {
+			{ "anim_model.vs", "anim_model.fs" },
+			{ "ground.vs", "ground.fs" },
+			{ "skinned_static.vs", "anim_model.fs" },
+			{ "anim_baked.vs", "anim_model.fs" },
+			{ "anim_model.vs", "shadow_depth.fs" },
+			{ "skinned_static.vs", "shadow_depth.fs" },
+			{ "anim_baked.vs", "shadow_depth.fs" },
+		};
+		ShaderStartupTimes startup = MeasureShaderStartup(programs, 7, "shader_cache_bench");
+		std::cout << "shader_cache/startup: " << startup.programs << " programs, cold " << startup.coldMs << " ms, warm "
+			<< startup.warmMs << " ms (" << startup.warmBinaryLoads << " from binaries";
+		if (!startup.binariesSupported)
+			std::cout << ", driver has no program binary formats";
+		std::cout << ")" << std::endl;
+	}
 
-	rootBone->InterpolatePosition(wrappedTime, translation);
-	return translation;
-}
+	const std::string modelPath = FileSystem::getPath("resources/objects/mixamo/warrock.dae");
+	const std::string runPath = FileSystem::getPath("resources/objects/mixamo/run.dae");
+	runner.Run("model_load/warrock.dae", [&]() {
+		Model model(modelPath);
+		DoNotOptimize(model.meshes.size());
+		ReleaseModel(model);  // each iteration uploads its own buffers and textures
+	});
 
-glm::vec3 EstimateRootLoopDisplacement(Animation* animation, const std::string& rootBoneName)
-{
-	if (!animation)
-		return glm::vec3(0.0f);
+	Model ourModel(modelPath);
+	{
+		int influences = MaxBoneInfluences(ourModel);
+		std::cout << "shader_permutations/warrock: up to " << influences << " bone influences, skinning variant " << SkinningVariant(influences) << std::endl;
+	}
 
-	float duration = animation->GetDuration();
-	if (duration <= 0.0f)
-		return glm::vec3(0.0f);
+	// draws and texture binds for the character, per mesh and merged (common/model_batch.h).
+	// It is one mesh already, so merging only saves texture binds; the demo keeps per-mesh draws
+	{
+		std::vector<BatchVertex> vertices;
+		std::vector<unsigned int> indices;
+		std::vector<std::string> layerPaths;
+		MergeModelMeshes(ourModel, vertices, indices, layerPaths);
+		int textureBinds = 0;
+		for (const Mesh& mesh : ourModel.meshes)
+			textureBinds += std::max(1, static_cast<int>(mesh.textures.size()));
+		std::printf("model_batching/warrock: %d draws, %d texture binds -> 1, 1 (%d layers, %zu indices)\n",
+			static_cast<int>(ourModel.meshes.size()), textureBinds, static_cast<int>(layerPaths.size()), indices.size());
+	}
+
+	// packed vertex size and worst decode error for the character, and the packing time
+	{
+		std::vector<PackedVertex> packed;
+		glm::vec3 boundsMin, boundsExtent;
+		QuantizationError error;
+		for (const Mesh& mesh : ourModel.meshes)
+		{
+			QuantizationError meshError;
+			PackMeshVertices(mesh, packed, boundsMin, boundsExtent, meshError);
+			error.Merge(meshError);
+		}
+		PrintQuantizationReport("warrock.dae", error, sizeof(Vertex));
+		runner.Run("vertex_quantization/pack/warrock", [&]() {
+			QuantizationError packError;
+			PackMeshVertices(ourModel.meshes[0], packed, boundsMin, boundsExtent, packError);
+			DoNotOptimize(packed.data());
+		});
+	}
+
+	runner.Run("animation_load/run.dae", [&]() {
+		Animation animation(runPath, &ourModel);
+		DoNotOptimize(animation.GetDuration());
+	});
+
+	Animation runAnimation(runPath, &ourModel);
+	Animator animator(&runAnimation);
+	animator.PlayAnimation(&runAnimation, NULL, 0.0f, 0.0f, 0.0f);
+	runner.Run("keyframe_interpolation/run.dae", [&]() {
+		animator.UpdateAnimation(1.0f / 60.0f);
+		DoNotOptimize(animator.m_CurrentTime);
+	});
+
+	// many characters on one compiled graph, each switching locomotion state on its own schedule
+	BlendGraph blendGraph;
+	if (setupBlendGraph(blendGraph, &ourModel))
+	{
+		for (const BakedClip& clip : blendGraph.Clips())
+		{
+			if (clip.rootCurve.empty())
+				continue;
+			float rootTime = 0.0f;
+			runner.Run("root_motion/curve_delta/" + clip.name, [&]() {
+				float next = std::fmod(rootTime + 1.0f / 60.0f, clip.duration);
+				glm::vec3 delta = clip.RootDelta(rootTime, next);
+				rootTime = next;
+				DoNotOptimize(delta);
+			});
+		}
+
+		const int characterCounts[] = { 1, 64, 256 };
+		for (int count : characterCounts)
+		{
+			std::vector<BlendGraphInstance> characters(count, BlendGraphInstance(blendGraph));
+			uint64_t frame = 0;
+			runner.Run("blend_graph/characters/" + std::to_string(count), [&]() {
+				for (int i = 0; i < count; ++i)
+				{
+					uint64_t phase = (frame + i * 37) % 240;
+					characters[i].SetParameter(forwardParameter, phase >= 40);
+					characters[i].SetParameter(runParameter, phase >= 120 && phase < 200);
+					characters[i].Update(1.0f / 60.0f);
+				}
+				++frame;
+				DoNotOptimize(characters.back().GetFinalBoneMatrices().data());
+			});
+		}
+
+		// the same 256 characters spread over every hardware thread
+		BlendGraphWorkers workers(std::max(1u, std::thread::hardware_concurrency()));
+		std::vector<BlendGraphInstance> crowd(256, BlendGraphInstance(blendGraph));
+		uint64_t crowdFrame = 0;
+		runner.Run("blend_graph/characters/256/threads/" + std::to_string(workers.ThreadCount()), [&]() {
+			for (size_t i = 0; i < crowd.size(); ++i)
+			{
+				uint64_t phase = (crowdFrame + i * 37) % 240;
+				crowd[i].SetParameter(forwardParameter, phase >= 40);
+				crowd[i].SetParameter(runParameter, phase >= 120 && phase < 200);
+			}
+			workers.Update(crowd, 1.0f / 60.0f);
+			++crowdFrame;
+			DoNotOptimize(crowd.back().GetFinalBoneMatrices().data());
+		});
+
+		// animation LOD: the same crowd spread evenly from 2 to 80 units from the camera, the
+		// character 1.8 units tall under a 45 degree field of view, against everyone at full rate
+		const int lodCrowdSize = 256;
+		std::vector<int> crowdLods(lodCrowdSize);
+		std::vector<int> lodHistogram(blendGraph.Lods().size(), 0);
+		for (int i = 0; i < lodCrowdSize; ++i)
+		{
+			float distance = 2.0f + 78.0f * i / (lodCrowdSize - 1);
+			float screenHeight = 1.8f / (2.0f * distance * std::tan(glm::radians(22.5f)));
+			crowdLods[i] = blendGraph.SelectLod(screenHeight);
+			++lodHistogram[crowdLods[i]];
+		}
+		std::printf("animation_lod/distribution:");
+		for (size_t level = 0; level < lodHistogram.size(); ++level)
+			std::printf(" lod%zu=%d", level, lodHistogram[level]);
+		std::printf(" (%zu of %d core bones)\n", blendGraph.CoreChannels().size(), blendGraph.ChannelCount());
+
+		for (int pass = 0; pass < 2; ++pass)
+		{
+			std::vector<BlendGraphInstance> lodCrowd(lodCrowdSize, BlendGraphInstance(blendGraph));
+			for (int i = 0; i < lodCrowdSize; ++i)
+				lodCrowd[i].SetLod(pass == 0 ? 0 : crowdLods[i]);
+			uint64_t lodFrame = 0;
+			runner.Run(std::string("animation_lod/crowd/256/") + (pass == 0 ? "full" : "by_distance"), [&]() {
+				for (int i = 0; i < lodCrowdSize; ++i)
+				{
+					uint64_t phase = (lodFrame + i * 37) % 240;
+					lodCrowd[i].SetParameter(forwardParameter, phase >= 40);
+					lodCrowd[i].SetParameter(runParameter, phase >= 120 && phase < 200);
+					lodCrowd[i].Update(1.0f / 60.0f);
+				}
+				++lodFrame;
+				DoNotOptimize(lodCrowd.back().GetFinalBoneMatrices().data());
+			});
+		}
+
+		// 64 characters held at each level
+		for (size_t level = 0; level < blendGraph.Lods().size(); ++level)
+		{
+			std::vector<BlendGraphInstance> levelCrowd(64, BlendGraphInstance(blendGraph));
+			for (BlendGraphInstance& instance : levelCrowd)
+				instance.SetLod(static_cast<int>(level));
+			uint64_t levelFrame = 0;
+			runner.Run("animation_lod/level/" + std::to_string(level) + "/64", [&]() {
+				for (size_t i = 0; i < levelCrowd.size(); ++i)
+				{
+					uint64_t phase = (levelFrame + i * 37) % 240;
+					levelCrowd[i].SetParameter(forwardParameter, phase >= 40);
+					levelCrowd[i].Update(1.0f / 60.0f);
+				}
+				++levelFrame;
+				DoNotOptimize(levelCrowd.back().GetFinalBoneMatrices().data());
+			});
+		}
+
+		// hierarchy and skinning matrices for one warrock skeleton from a blended pose
+		BlendGraphInstance skeleton(blendGraph);
+		skeleton.Update(1.0f / 60.0f);
+		std::vector<glm::mat4> globals(blendGraph.ChannelCount());
+		std::vector<glm::mat4> bones(blendGraph.BoneCount());
+		runner.Run("skeleton/warrock", [&]() {
+			blendGraph.ComputeGlobals(skeleton.GetPose().data(), globals.data());
+			blendGraph.ComputeSkinning(globals.data(), bones.data());
+			DoNotOptimize(bones.data());
+		});
+
+		// CPU skinning of the whole model: the per-vertex reference, the SoA kernel and the kernel over threads
+		const std::vector<glm::mat4>& skeletonBones = skeleton.GetFinalBoneMatrices();
+		std::vector<glm::mat4> skinPalette(std::max<size_t>(skeletonBones.size(), SKINNING_MAX_BONES), glm::mat4(1.0f));
+		buildBonePalette(skeletonBones.data(), static_cast<int>(skeletonBones.size()), skinPalette.data());
+		skinPalette.resize(SKINNING_MAX_BONES);
+		CpuSkinning cpuSkinning;
+		cpuSkinning.Init(ourModel);
+		std::vector<glm::vec3> referencePositions, referenceNormals;
+		int skinningThreads = static_cast<int>(std::max(1u, std::thread::hardware_concurrency()));
+
+		runner.Run("cpu_skinning/reference", [&]() {
+			for (const Mesh& mesh : ourModel.meshes)
+				SkinMeshReference(mesh, skinPalette.data(), referencePositions, referenceNormals);
+			DoNotOptimize(referencePositions.data());
+		});
+		runner.Run("cpu_skinning/simd", [&]() {
+			cpuSkinning.Skin(skinPalette, 1);
+			DoNotOptimize(cpuSkinning.Positions(0).data());
+		});
+		// the same pose's bounds from per-bone boxes against skinning every vertex
+		SkinnedBounds skinnedBounds;
+		skinnedBounds.Init(ourModel);
+		runner.Run("character_bounds/bone_boxes", [&]() {
+			BoundingBox box = skinnedBounds.Compute(skinPalette.data(), static_cast<int>(skinPalette.size()));
+			DoNotOptimize(box);
+		});
+		runner.Run("character_bounds/cpu_skinning", [&]() {
+			cpuSkinning.Skin(skinPalette, 1);
+			BoundingBox box;
+			for (int mesh = 0; mesh < cpuSkinning.MeshCount(); ++mesh)
+				for (const glm::vec3& p : cpuSkinning.Positions(mesh))
+					box.Add(p);
+			DoNotOptimize(box);
+		});
+
+		runner.Run("cpu_skinning/simd/threads/" + std::to_string(skinningThreads), [&]() {
+			cpuSkinning.Skin(skinPalette, skinningThreads);
+			DoNotOptimize(cpuSkinning.Positions(0).data());
+		});
+	}
 
-	glm::vec3 start = SampleRootTranslation(animation, rootBoneName, 0.0f);
-	glm::vec3 end = SampleRootTranslation(animation, rootBoneName, duration - 0.0001f);
-	return end - start;
+	glm::mat4 skeletonTransform = glm::scale(glm::mat4(1.0f), glm::vec3(0.5f));
+	std::vector<glm::mat4> palette;
+	runner.Run("bone_palette/assemble", [&]() {
+		const std::vector<glm::mat4>& transforms = animator.GetFinalBoneMatrices();
+		palette.resize(transforms.size());
+		for (size_t i = 0; i < transforms.size(); ++i)
+			palette[i] = skeletonTransform * transforms[i];
+		DoNotOptimize(palette.data());
+	});
+
+	DestroyOffscreenContext(context);
+	return runner.Finish();
 }
 
 glm::vec3 RotateDeltaByYaw(const glm::vec3& delta, float yawDegrees)
@@ -0,0 +1,41 @@
+#version 330 core
+
+// Skins each vertex once and writes the result back through transform feedback
+// (see gpu_skinning.h). Same bone rules as anim_model.vs.
+
+layout(location = 0) in vec3 pos;
+layout(location = 1) in vec3 norm;
+layout(location = 2) in vec2 tex;
+layout(location = 5) in ivec4 boneIds;
+layout(location = 6) in vec4 weights;
+
+const int MAX_BONES = 100;
+const int MAX_BONE_INFLUENCE = 4;
+uniform mat4 finalBonesMatrices[MAX_BONES];
+
+out vec3 skinnedPosition;
+out vec3 skinnedNormal;
+out vec2 skinnedTexCoords;
+
+void main()
+{
+    vec4 totalPosition = vec4(0.0f);
+    vec3 totalNormal = vec3(0.0f);
+    for(int i = 0 ; i < MAX_BONE_INFLUENCE ; i++)
+    {
+        if(boneIds[i] == -1)
+            continue;
+        if(boneIds[i] >= MAX_BONES)
+        {
+            totalPosition = vec4(pos, 1.0f);
+            totalNormal = norm;
+            break;
+        }
+        totalPosition += finalBonesMatrices[boneIds[i]] * vec4(pos, 1.0f) * weights[i];
+        totalNormal += mat3(finalBonesMatrices[boneIds[i]]) * norm * weights[i];
+    }
+
+    skinnedPosition = totalPosition.xyz;
+    skinnedNormal = length(totalNormal) > 0.0f ? normalize(totalNormal) : totalNormal;
+    skinnedTexCoords = tex;
+}
@@ -0,0 +1,166 @@
+#ifndef SKINNED_BOUNDS_H
+#define SKINNED_BOUNDS_H
+
+// Character bounds without skinning any vertices: at load every bone gets the
+// bind-pose box of the vertices it influences, and each frame those boxes are
+// moved by the bone palette and merged.
+//
+// A skinned vertex is a weighted average of its bones' transforms applied to a
+// point inside each of their boxes, so it lands inside the merged box. Weights
+// that don't sum to one pull the vertex towards the origin, which is added to
+// the bounds for meshes that have such vertices.
+
+#include <glm/glm.hpp>
+
+#include <learnopengl/model_animation.h>
+
+#include "skinning.h"
+
+#include <algorithm>
+#include <cfloat>
+#include <cmath>
+#include <vector>
+
+struct BoundingBox
+{
+	glm::vec3 min = glm::vec3(FLT_MAX);
+	glm::vec3 max = glm::vec3(-FLT_MAX);
+
+	bool Empty() const { return min.x > max.x; }
+
+	void Add(const glm::vec3& p)
+	{
+		min = glm::vec3(std::min(min.x, p.x), std::min(min.y, p.y), std::min(min.z, p.z));
+		max = glm::vec3(std::max(max.x, p.x), std::max(max.y, p.y), std::max(max.z, p.z));
+	}
+
+	void Add(const BoundingBox& box)
+	{
+		if (!box.Empty())
+		{
+			Add(box.min);
+			Add(box.max);
+		}
+	}
+
+	bool Contains(const glm::vec3& p, float tolerance) const
+	{
+		return p.x >= min.x - tolerance && p.y >= min.y - tolerance && p.z >= min.z - tolerance &&
+		       p.x <= max.x + tolerance && p.y <= max.y + tolerance && p.z <= max.z + tolerance;
+	}
+};
+
+// box around the transformed box: centre moved by the matrix, extent by its absolute upper 3x3
+inline BoundingBox TransformBounds(const BoundingBox& box, const glm::mat4& transform)
+{
+	glm::vec3 centre = (box.min + box.max) * 0.5f;
+	glm::vec3 extent = (box.max - box.min) * 0.5f;
+	glm::vec3 movedCentre = glm::vec3(transform * glm::vec4(centre, 1.0f));
+	glm::vec3 movedExtent(0.0f);
+	for (int column = 0; column < 3; ++column)
+		for (int row = 0; row < 3; ++row)
+			movedExtent[row] += std::fabs(transform[column][row]) * extent[column];
+	BoundingBox out;
+	out.min = movedCentre - movedExtent;
+	out.max = movedCentre + movedExtent;
+	return out;
+}
+
+// true when the box is entirely outside one clip plane of viewProjection
+inline bool BoundsOutsideFrustum(const BoundingBox& box, const glm::mat4& viewProjection)
+{
+	glm::vec4 corners[8];
+	for (int i = 0; i < 8; ++i)
+	{
+		glm::vec3 corner((i & 1) ? box.max.x : box.min.x, (i & 2) ? box.max.y : box.min.y, (i & 4) ? box.max.z : box.min.z);
+		corners[i] = viewProjection * glm::vec4(corner, 1.0f);
+	}
+	for (int axis = 0; axis < 3; ++axis)
+	{
+		bool allBelow = true, allAbove = true;
+		for (const glm::vec4& c : corners)
+		{
+			allBelow = allBelow && c[axis] < -c.w;
+			allAbove = allAbove && c[axis] > c.w;
+		}
+		if (allBelow || allAbove)
+			return true;
+	}
+	return false;
+}
+
+// fraction of the viewport height the box covers; 1 when it reaches behind the camera
+inline float ScreenHeight(const BoundingBox& box, const glm::mat4& viewProjection)
+{
+	float low = FLT_MAX, high = -FLT_MAX;
+	for (int i = 0; i < 8; ++i)
+	{
+		glm::vec3 corner((i & 1) ? box.max.x : box.min.x, (i & 2) ? box.max.y : box.min.y, (i & 4) ? box.max.z : box.min.z);
+		glm::vec4 clip = viewProjection * glm::vec4(corner, 1.0f);
+		if (clip.w <= 0.0f)
+			return 1.0f;
+		low = std::min(low, clip.y / clip.w);
+		high = std::max(high, clip.y / clip.w);
+	}
+	return std::clamp((std::min(high, 1.0f) - std::max(low, -1.0f)) * 0.5f, 0.0f, 1.0f);
+}
+
+class SkinnedBounds
+{
+public:
+	// bind-pose box per bone from every vertex it has a non-zero weight on
+	void Init(const Model& model)
+	{
+		bones.assign(SKINNING_MAX_BONES, BoundingBox());
+		unskinned = BoundingBox();
+		includeOrigin = false;
+		for (const Mesh& mesh : model.meshes)
+			for (const Vertex& v : mesh.vertices)
+			{
+				bool rest = false;
+				float weightSum = 0.0f;
+				for (int k = 0; k < MAX_BONE_INFLUENCE && !rest; ++k)
+				{
+					int bone = v.m_BoneIDs[k];
+					if (bone >= SKINNING_MAX_BONES)
+						rest = true;
+					else if (bone >= 0 && v.m_Weights[k] != 0.0f)
+					{
+						bones[bone].Add(v.Position);
+						weightSum += v.m_Weights[k];
+					}
+				}
+				if (rest)
+					unskinned.Add(v.Position);
+				else if (std::fabs(weightSum - 1.0f) > 1.0e-4f)
+					includeOrigin = true;
+			}
+
+		used.clear();
+		for (int bone = 0; bone < SKINNING_MAX_BONES; ++bone)
+			if (!bones[bone].Empty())
+				used.push_back(bone);
+	}
+
+	// bounds of the skinned model for the palette uploaded to finalBonesMatrices
+	BoundingBox Compute(const glm::mat4* palette, int count) const
+	{
+		BoundingBox out;
+		for (int bone : used)
+			out.Add(TransformBounds(bones[bone], bone < count ? palette[bone] : glm::mat4(1.0f)));
+		out.Add(unskinned);
+		if (includeOrigin)
+			out.Add(glm::vec3(0.0f));
+		return out;
+	}
+
+	int BoneBoxCount() const { return static_cast<int>(used.size()); }
+
+private:
+	std::vector<BoundingBox> bones;
+	std::vector<int> used;
+	BoundingBox unskinned;
+	bool includeOrigin = false;
+};
+
+#endif
@@ -0,0 +1,25 @@
+#version 330 core
+
+// Draws vertices already skinned by skin_feedback.vs as static geometry.
+
+layout(location = 0) in vec3 pos;
+layout(location = 1) in vec3 norm;
+layout(location = 2) in vec2 tex;
+
+uniform mat4 projection;
+uniform mat4 view;
+uniform mat4 model;
+
+out vec2 TexCoords;
+out vec3 WorldPos;
+out float ViewDepth;
+
+void main()
+{
+    vec4 worldPos = model * vec4(pos, 1.0f);
+    WorldPos = worldPos.xyz;
+    vec4 viewPos = view * worldPos;
+    ViewDepth = -viewPos.z;
+    gl_Position = projection * viewPos;
+    TexCoords = tex;
+}
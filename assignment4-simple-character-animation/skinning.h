@@ -0,0 +1,236 @@
+#ifndef SKINNING_H
+#define SKINNING_H
+
+// CPU skinning with the same rules as anim_model.vs and skin_feedback.vs: bone
+// id -1 is an unused slot and an id past MAX_BONES leaves the vertex unskinned.
+// The palette is what the demo uploads to finalBonesMatrices.
+//
+// SkinMeshReference is the plain per-vertex version. CpuSkinning keeps each mesh
+// in structure-of-arrays form, blends the bone matrices of eight vertices at a
+// time with AVX2 gathers (build with -mavx2; otherwise the same math runs one
+// vertex at a time) and spreads meshes over threads.
+
+#include <glm/glm.hpp>
+
+#include <learnopengl/mesh.h>
+#include <learnopengl/model_animation.h>
+
+#if defined(__AVX2__)
+#include <immintrin.h>
+#endif
+
+#include <algorithm>
+#include <atomic>
+#include <cmath>
+#include <thread>
+#include <vector>
+
+const int SKINNING_MAX_BONES = 100;  // MAX_BONES in the skinning shaders
+
+inline void SkinVertex(const Vertex& vertex, const glm::mat4* palette, glm::vec3& position, glm::vec3& normal)
+{
+	glm::vec4 totalPosition(0.0f);
+	glm::vec3 totalNormal(0.0f);
+	for (int i = 0; i < MAX_BONE_INFLUENCE; ++i)
+	{
+		int bone = vertex.m_BoneIDs[i];
+		if (bone == -1)
+			continue;
+		if (bone >= SKINNING_MAX_BONES)
+		{
+			totalPosition = glm::vec4(vertex.Position, 1.0f);
+			totalNormal = vertex.Normal;
+			break;
+		}
+		totalPosition += palette[bone] * glm::vec4(vertex.Position, 1.0f) * vertex.m_Weights[i];
+		totalNormal += glm::mat3(palette[bone]) * vertex.Normal * vertex.m_Weights[i];
+	}
+	position = glm::vec3(totalPosition);
+	normal = glm::length(totalNormal) > 0.0f ? glm::normalize(totalNormal) : totalNormal;
+}
+
+// one vertex at a time; the golden reference for the GPU path
+inline void SkinMeshReference(const Mesh& mesh, const glm::mat4* palette, std::vector<glm::vec3>& positions, std::vector<glm::vec3>& normals)
+{
+	positions.resize(mesh.vertices.size());
+	normals.resize(mesh.vertices.size());
+	for (size_t i = 0; i < mesh.vertices.size(); ++i)
+		SkinVertex(mesh.vertices[i], palette, positions[i], normals[i]);
+}
+
+// one mesh in structure-of-arrays form, padded to a multiple of SKINNING_LANES vertices.
+// Unused slots get weight 0; an unskinned vertex uses the identity at index SKINNING_MAX_BONES
+struct SkinningMesh
+{
+	int count = 0;
+	int paddedCount = 0;
+	std::vector<float> px, py, pz;
+	std::vector<float> nx, ny, nz;
+	std::vector<int> bones[MAX_BONE_INFLUENCE];
+	std::vector<float> weights[MAX_BONE_INFLUENCE];
+};
+
+const int SKINNING_LANES = 8;
+
+inline SkinningMesh PrepareSkinningMesh(const Mesh& mesh)
+{
+	SkinningMesh out;
+	out.count = static_cast<int>(mesh.vertices.size());
+	out.paddedCount = (out.count + SKINNING_LANES - 1) / SKINNING_LANES * SKINNING_LANES;
+	size_t n = out.paddedCount;
+	out.px.assign(n, 0.0f); out.py.assign(n, 0.0f); out.pz.assign(n, 0.0f);
+	out.nx.assign(n, 0.0f); out.ny.assign(n, 0.0f); out.nz.assign(n, 0.0f);
+	for (int k = 0; k < MAX_BONE_INFLUENCE; ++k)
+	{
+		out.bones[k].assign(n, 0);
+		out.weights[k].assign(n, 0.0f);
+	}
+
+	for (int i = 0; i < out.count; ++i)
+	{
+		const Vertex& v = mesh.vertices[i];
+		out.px[i] = v.Position.x; out.py[i] = v.Position.y; out.pz[i] = v.Position.z;
+		out.nx[i] = v.Normal.x; out.ny[i] = v.Normal.y; out.nz[i] = v.Normal.z;
+
+		bool unskinned = false;
+		for (int k = 0; k < MAX_BONE_INFLUENCE && !unskinned; ++k)
+			unskinned = v.m_BoneIDs[k] >= SKINNING_MAX_BONES;
+		for (int k = 0; k < MAX_BONE_INFLUENCE; ++k)
+		{
+			int bone = v.m_BoneIDs[k];
+			if (unskinned)
+			{
+				out.bones[k][i] = k == 0 ? SKINNING_MAX_BONES : 0;
+				out.weights[k][i] = k == 0 ? 1.0f : 0.0f;
+			}
+			else if (bone >= 0)
+			{
+				out.bones[k][i] = bone;
+				out.weights[k][i] = v.m_Weights[k];
+			}
+		}
+	}
+	return out;
+}
+
+// position and normal of vertices [first, first + count) with the blended matrix
+inline void SkinBlockScalar(const SkinningMesh& mesh, const glm::mat4* palette, int first, int count, glm::vec3* positions, glm::vec3* normals)
+{
+	for (int i = first; i < first + count; ++i)
+	{
+		glm::mat4 blended(0.0f);
+		for (int k = 0; k < MAX_BONE_INFLUENCE; ++k)
+			blended = blended + palette[mesh.bones[k][i]] * mesh.weights[k][i];
+		glm::vec3 normal = glm::mat3(blended) * glm::vec3(mesh.nx[i], mesh.ny[i], mesh.nz[i]);
+		positions[i] = glm::vec3(blended * glm::vec4(mesh.px[i], mesh.py[i], mesh.pz[i], 1.0f));
+		normals[i] = glm::length(normal) > 0.0f ? glm::normalize(normal) : normal;
+	}
+}
+
+#if defined(__AVX2__)
+// eight vertices: gather and blend the upper 3x4 of each influence's matrix, then transform
+inline void SkinBlockAvx2(const SkinningMesh& mesh, const float* palette, int first, glm::vec3* positions, glm::vec3* normals)
+{
+	__m256 m[12];
+	for (int e = 0; e < 12; ++e)
+		m[e] = _mm256_setzero_ps();
+	for (int k = 0; k < MAX_BONE_INFLUENCE; ++k)
+	{
+		__m256i base = _mm256_slli_epi32(_mm256_loadu_si256(reinterpret_cast<const __m256i*>(&mesh.bones[k][first])), 4);
+		__m256 w = _mm256_loadu_ps(&mesh.weights[k][first]);
+		for (int column = 0; column < 4; ++column)
+			for (int row = 0; row < 3; ++row)
+			{
+				__m256 value = _mm256_i32gather_ps(palette + column * 4 + row, base, 4);
+				m[column * 3 + row] = _mm256_add_ps(m[column * 3 + row], _mm256_mul_ps(value, w));
+			}
+	}
+
+	__m256 px = _mm256_loadu_ps(&mesh.px[first]), py = _mm256_loadu_ps(&mesh.py[first]), pz = _mm256_loadu_ps(&mesh.pz[first]);
+	__m256 nx = _mm256_loadu_ps(&mesh.nx[first]), ny = _mm256_loadu_ps(&mesh.ny[first]), nz = _mm256_loadu_ps(&mesh.nz[first]);
+	__m256 p[3], n[3];
+	for (int row = 0; row < 3; ++row)
+	{
+		n[row] = _mm256_add_ps(_mm256_add_ps(_mm256_mul_ps(m[row], nx), _mm256_mul_ps(m[3 + row], ny)), _mm256_mul_ps(m[6 + row], nz));
+		p[row] = _mm256_add_ps(_mm256_add_ps(_mm256_mul_ps(m[row], px), _mm256_mul_ps(m[3 + row], py)), _mm256_add_ps(_mm256_mul_ps(m[6 + row], pz), m[9 + row]));
+	}
+	__m256 length2 = _mm256_add_ps(_mm256_add_ps(_mm256_mul_ps(n[0], n[0]), _mm256_mul_ps(n[1], n[1])), _mm256_mul_ps(n[2], n[2]));
+	__m256 nonZero = _mm256_cmp_ps(length2, _mm256_setzero_ps(), _CMP_GT_OQ);
+	__m256 scale = _mm256_blendv_ps(_mm256_set1_ps(1.0f), _mm256_div_ps(_mm256_set1_ps(1.0f), _mm256_sqrt_ps(length2)), nonZero);
+
+	alignas(32) float out[6][SKINNING_LANES];
+	for (int row = 0; row < 3; ++row)
+	{
+		_mm256_store_ps(out[row], p[row]);
+		_mm256_store_ps(out[3 + row], _mm256_mul_ps(n[row], scale));
+	}
+	int lanes = std::min(SKINNING_LANES, mesh.count - first);
+	for (int lane = 0; lane < lanes; ++lane)
+	{
+		positions[first + lane] = glm::vec3(out[0][lane], out[1][lane], out[2][lane]);
+		normals[first + lane] = glm::vec3(out[3][lane], out[4][lane], out[5][lane]);
+	}
+}
+#endif
+
+// palette: SKINNING_MAX_BONES + 1 matrices, the last one identity (see CpuSkinning::Skin)
+inline void SkinMesh(const SkinningMesh& mesh, const glm::mat4* palette, std::vector<glm::vec3>& positions, std::vector<glm::vec3>& normals)
+{
+	positions.resize(mesh.count);
+	normals.resize(mesh.count);
+#if defined(__AVX2__)
+	const float* base = &palette[0][0][0];
+	for (int first = 0; first < mesh.count; first += SKINNING_LANES)
+		SkinBlockAvx2(mesh, base, first, positions.data(), normals.data());
+#else
+	SkinBlockScalar(mesh, palette, 0, mesh.count, positions.data(), normals.data());
+#endif
+}
+
+// every mesh of a model, skinned on the CPU; meshes are shared out over threads
+// ------------------------------------------------------------------------------
+class CpuSkinning
+{
+public:
+	void Init(const Model& model)
+	{
+		meshes.clear();
+		for (const Mesh& mesh : model.meshes)
+			meshes.push_back(PrepareSkinningMesh(mesh));
+		positions.resize(meshes.size());
+		normals.resize(meshes.size());
+		palette.assign(SKINNING_MAX_BONES + 1, glm::mat4(1.0f));
+	}
+
+	// bones missing from the palette skin as identity
+	void Skin(const std::vector<glm::mat4>& bones, int threadCount)
+	{
+		size_t count = std::min<size_t>(bones.size(), SKINNING_MAX_BONES);
+		std::copy(bones.begin(), bones.begin() + count, palette.begin());
+		std::fill(palette.begin() + count, palette.end(), glm::mat4(1.0f));
+
+		std::atomic<int> next{ 0 };
+		auto work = [&]() {
+			for (int mesh = next++; mesh < MeshCount(); mesh = next++)
+				SkinMesh(meshes[mesh], palette.data(), positions[mesh], normals[mesh]);
+		};
+		std::vector<std::thread> threads;
+		for (int i = 1; i < std::min(threadCount, MeshCount()); ++i)
+			threads.emplace_back(work);
+		work();
+		for (std::thread& thread : threads)
+			thread.join();
+	}
+
+	int MeshCount() const { return static_cast<int>(meshes.size()); }
+	const std::vector<glm::vec3>& Positions(int mesh) const { return positions[mesh]; }
+	const std::vector<glm::vec3>& Normals(int mesh) const { return normals[mesh]; }
+
+private:
+	std::vector<SkinningMesh> meshes;
+	std::vector<glm::mat4> palette;
+	std::vector<std::vector<glm::vec3>> positions;
+	std::vector<std::vector<glm::vec3>> normals;
+};
+
+#endif
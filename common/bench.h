@@ -0,0 +1,200 @@
+#ifndef BENCH_H
+#define BENCH_H
+
+// Minimal benchmark harness for the demos' CPU hot paths.
+// Each benchmark is timed over enough iterations to run for a minimum time,
+// repeated a few times, and the fastest repetition is reported as ns/op.
+// Results are written as JSON and compared against a stored baseline: any
+// benchmark slower than baseline * (1 + threshold) fails the run.
+//
+// command line: --bench [--bench-filter <substring>] [--bench-out <file>]
+//               [--bench-baseline <file>] [--bench-threshold <fraction>]
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <vector>
+
+struct BenchOptions
+{
+    bool enabled = false;
+    std::string filter;
+    std::string outPath;
+    std::string baselinePath;
+    double threshold = 0.10;   // allowed slowdown before a benchmark counts as a regression
+    double minTimeSeconds = 0.2;
+    int repetitions = 5;
+};
+
+inline BenchOptions ParseBenchOptions(int argc, char** argv)
+{
+    BenchOptions options;
+    for (int i = 1; i < argc; ++i)
+    {
+        if (std::strcmp(argv[i], "--bench") == 0)
+            options.enabled = true;
+        else if (std::strcmp(argv[i], "--bench-filter") == 0 && i + 1 < argc)
+            options.filter = argv[++i];
+        else if (std::strcmp(argv[i], "--bench-out") == 0 && i + 1 < argc)
+            options.outPath = argv[++i];
+        else if (std::strcmp(argv[i], "--bench-baseline") == 0 && i + 1 < argc)
+            options.baselinePath = argv[++i];
+        else if (std::strcmp(argv[i], "--bench-threshold") == 0 && i + 1 < argc)
+            options.threshold = std::atof(argv[++i]);
+    }
+    return options;
+}
+
+// keeps the optimizer from discarding a benchmark's result
+template <typename T>
+inline void DoNotOptimize(const T& value)
+{
+#if defined(__GNUC__) || defined(__clang__)
+    asm volatile("" : : "g"(&value) : "memory");
+#else
+    static volatile const void* sink;
+    sink = &value;
+#endif
+}
+
+class BenchmarkRunner
+{
+public:
+    struct Result
+    {
+        std::string name;
+        double nsPerOp = 0.0;
+        unsigned long long iterations = 0;
+    };
+
+    explicit BenchmarkRunner(const BenchOptions& options) : options(options) {}
+
+    // fn runs one operation; it is called repeatedly until minTimeSeconds has passed
+    template <typename Fn>
+    void Run(const std::string& name, Fn&& fn)
+    {
+        if (!options.filter.empty() && name.find(options.filter) == std::string::npos)
+            return;
+
+        // find an iteration count that runs long enough to time reliably
+        unsigned long long iterations = 1;
+        double seconds = TimeIterations(fn, iterations);
+        while (seconds < options.minTimeSeconds && iterations < (1ull << 40))
+        {
+            double scale = seconds > 0.0 ? options.minTimeSeconds / seconds * 1.2 : 10.0;
+            iterations = std::max(iterations + 1, static_cast<unsigned long long>(iterations * std::min(scale, 10.0)));
+            seconds = TimeIterations(fn, iterations);
+        }
+
+        double best = seconds;
+        for (int rep = 1; rep < options.repetitions; ++rep)
+            best = std::min(best, TimeIterations(fn, iterations));
+
+        Result result;
+        result.name = name;
+        result.iterations = iterations;
+        result.nsPerOp = best * 1.0e9 / iterations;
+        results.push_back(result);
+        std::printf("%-48s %14.1f ns/op  (%llu iterations)\n", name.c_str(), result.nsPerOp, iterations);
+    }
+
+    // write results, compare to the baseline; returns the process exit code
+    int Finish() const
+    {
+        if (!options.outPath.empty())
+            WriteJson(options.outPath);
+        if (options.baselinePath.empty())
+            return 0;
+
+        std::vector<Result> baseline;
+        if (!ReadJson(options.baselinePath, baseline))
+            return 1;
+
+        int regressions = 0;
+        for (const Result& current : results)
+        {
+            auto it = std::find_if(baseline.begin(), baseline.end(), [&](const Result& b) { return b.name == current.name; });
+            if (it == baseline.end() || it->nsPerOp <= 0.0)
+                continue;
+            double change = current.nsPerOp / it->nsPerOp - 1.0;
+            bool regressed = change > options.threshold;
+            std::printf("%-48s %+7.1f%%%s\n", current.name.c_str(), change * 100.0, regressed ? "  REGRESSION" : "");
+            if (regressed)
+                ++regressions;
+        }
+        if (regressions > 0)
+            std::printf("%d benchmark(s) regressed by more than %.1f%%\n", regressions, options.threshold * 100.0);
+        return regressions > 0 ? 1 : 0;
+    }
+
+    const std::vector<Result>& Results() const { return results; }
+
+private:
+    template <typename Fn>
+    static double TimeIterations(Fn& fn, unsigned long long iterations)
+    {
+        auto start = std::chrono::steady_clock::now();
+        for (unsigned long long i = 0; i < iterations; ++i)
+            fn();
+        return std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    }
+
+    bool WriteJson(const std::string& path) const
+    {
+        std::ofstream file(path);
+        if (!file)
+        {
+            std::cout << "Failed to write benchmark results: " << path << std::endl;
+            return false;
+        }
+        file << "{\n  \"benchmarks\": [\n";
+        for (size_t i = 0; i < results.size(); ++i)
+        {
+            file << "    {\"name\": \"" << results[i].name << "\", \"ns_per_op\": " << results[i].nsPerOp
+                 << ", \"iterations\": " << results[i].iterations << "}" << (i + 1 < results.size() ? "," : "") << "\n";
+        }
+        file << "  ]\n}\n";
+        return true;
+    }
+
+    // reads the format written by WriteJson; not a general JSON parser
+    static bool ReadJson(const std::string& path, std::vector<Result>& out)
+    {
+        std::ifstream file(path);
+        if (!file)
+        {
+            std::cout << "Failed to read benchmark baseline: " << path << std::endl;
+            return false;
+        }
+        std::stringstream buffer;
+        buffer << file.rdbuf();
+        const std::string text = buffer.str();
+
+        size_t pos = 0;
+        while ((pos = text.find("\"name\"", pos)) != std::string::npos)
+        {
+            size_t open = text.find('"', text.find(':', pos) + 1);
+            size_t close = text.find('"', open + 1);
+            size_t nsKey = text.find("\"ns_per_op\"", close);
+            if (open == std::string::npos || close == std::string::npos || nsKey == std::string::npos)
+                break;
+            Result result;
+            result.name = text.substr(open + 1, close - open - 1);
+            result.nsPerOp = std::atof(text.c_str() + text.find(':', nsKey) + 1);
+            out.push_back(result);
+            pos = close;
+        }
+        return true;
+    }
+
+    BenchOptions options;
+    std::vector<Result> results;
+};
+
+#endif
@@ -0,0 +1,297 @@
+#ifndef CASCADED_SHADOWS_H
+#define CASCADED_SHADOWS_H
+
+// Cascaded shadow maps for a directional light.
+//
+// The camera's shadow range is split into cascades (a blend of logarithmic and
+// uniform splits). Each cascade is an orthographic light box around the
+// bounding sphere of its slice of the camera frustum: the sphere keeps the box
+// size fixed while the camera turns, and the box centre is snapped to whole
+// shadow texels in light space so edges don't shimmer while it moves. The box
+// reaches casterReach units further towards the light for casters outside the
+// slice.
+//
+// CascadedShadowMap owns the depth texture array and framebuffer.
+//
+// Receiving shaders declare:
+//   uniform sampler2DArrayShadow shadowMap;
+//   uniform mat4 cascadeViewProjection[MAX_SHADOW_CASCADES];
+//   uniform float cascadeSplits[MAX_SHADOW_CASCADES];   // far view distance of each cascade
+//   uniform int cascadeCount;                           // 0 = shadows off
+
+#include <glad/glad.h>
+#include <glm/glm.hpp>
+#include <glm/gtc/matrix_transform.hpp>
+
+#include <algorithm>
+#include <cmath>
+#include <iostream>
+#include <string>
+
+const int MAX_SHADOW_CASCADES = 4;
+
+struct ShadowCascade
+{
+    float splitNear = 0.0f;           // view distance range of the slice
+    float splitFar = 0.0f;
+    float radius = 0.0f;              // slice bounding sphere, quantized
+    float texelSize = 0.0f;           // world units per shadow texel
+    glm::mat4 lightView = glm::mat4(1.0f);   // rotation only, light looks down -z
+    glm::vec3 boxMin = glm::vec3(0.0f);      // light-space box the projection covers
+    glm::vec3 boxMax = glm::vec3(0.0f);
+    glm::mat4 viewProjection = glm::mat4(1.0f);
+};
+
+// far distance of each cascade; lambda 1 is fully logarithmic, 0 uniform
+inline void ComputeCascadeSplits(float nearZ, float farZ, int count, float lambda, float* splits)
+{
+    for (int i = 1; i <= count; ++i)
+    {
+        float f = static_cast<float>(i) / count;
+        float logSplit = nearZ * std::pow(farZ / nearZ, f);
+        float uniformSplit = nearZ + (farZ - nearZ) * f;
+        splits[i - 1] = lambda * logSplit + (1.0f - lambda) * uniformSplit;
+    }
+    splits[count - 1] = farZ;
+}
+
+// world-space corners of the camera frustum between two view distances
+inline void FrustumSliceCorners(const glm::mat4& view, float fovY, float aspect, float nearZ, float farZ, glm::vec3* corners)
+{
+    glm::mat4 cameraToWorld = glm::inverse(view);
+    float tanHalf = std::tan(fovY * 0.5f);
+    const float distances[2] = { nearZ, farZ };
+    for (int d = 0; d < 2; ++d)
+    {
+        float halfHeight = tanHalf * distances[d];
+        float halfWidth = halfHeight * aspect;
+        for (int i = 0; i < 4; ++i)
+        {
+            glm::vec3 corner((i & 1) ? halfWidth : -halfWidth, (i & 2) ? halfHeight : -halfHeight, -distances[d]);
+            corners[d * 4 + i] = glm::vec3(cameraToWorld * glm::vec4(corner, 1.0f));
+        }
+    }
+}
+
+// rotation into light space; the light travels along -z
+inline glm::mat4 LightRotation(const glm::vec3& lightDir)
+{
+    glm::vec3 up = std::fabs(lightDir.y) > 0.99f ? glm::vec3(0.0f, 0.0f, 1.0f) : glm::vec3(0.0f, 1.0f, 0.0f);
+    return glm::lookAt(glm::vec3(0.0f), lightDir, up);
+}
+
+inline ShadowCascade FitCascade(const glm::vec3* corners, const glm::vec3& lightDir, int mapSize, float casterReach)
+{
+    ShadowCascade cascade;
+    glm::vec3 centre(0.0f);
+    for (int i = 0; i < 8; ++i)
+        centre += corners[i];
+    centre /= 8.0f;
+    float radius = 0.0f;
+    for (int i = 0; i < 8; ++i)
+        radius = std::max(radius, glm::length(corners[i] - centre));
+    // quantized so float noise in the corners can't change the texel size frame to frame
+    radius = std::ceil(radius * 16.0f) / 16.0f;
+    cascade.radius = radius;
+
+    // two texels of slack cover the snap below
+    float extent = radius * mapSize / (mapSize - 4.0f);
+    float texel = 2.0f * extent / mapSize;
+    cascade.texelSize = texel;
+
+    cascade.lightView = LightRotation(lightDir);
+    glm::vec3 lightCentre = glm::vec3(cascade.lightView * glm::vec4(centre, 1.0f));
+    lightCentre.x = std::floor(lightCentre.x / texel) * texel;
+    lightCentre.y = std::floor(lightCentre.y / texel) * texel;
+
+    // z runs from behind the slice to casterReach past it towards the light
+    cascade.boxMin = glm::vec3(lightCentre.x - extent, lightCentre.y - extent, lightCentre.z - radius);
+    cascade.boxMax = glm::vec3(lightCentre.x + extent, lightCentre.y + extent, lightCentre.z + radius + casterReach);
+    glm::mat4 projection = glm::ortho(cascade.boxMin.x, cascade.boxMax.x, cascade.boxMin.y, cascade.boxMax.y, -cascade.boxMax.z, -cascade.boxMin.z);
+    cascade.viewProjection = projection * cascade.lightView;
+    return cascade;
+}
+
+// split the range and fit every cascade; returns the number of cascades
+inline int FitCascades(const glm::mat4& view, float fovY, float aspect, float nearZ, float shadowDistance,
+                       const glm::vec3& lightDir, int count, int mapSize, float casterReach, ShadowCascade* cascades)
+{
+    count = std::clamp(count, 1, MAX_SHADOW_CASCADES);
+    float splits[MAX_SHADOW_CASCADES];
+    ComputeCascadeSplits(nearZ, shadowDistance, count, 0.75f, splits);
+    float splitNear = nearZ;
+    for (int i = 0; i < count; ++i)
+    {
+        glm::vec3 corners[8];
+        FrustumSliceCorners(view, fovY, aspect, splitNear, splits[i], corners);
+        cascades[i] = FitCascade(corners, lightDir, mapSize, casterReach);
+        cascades[i].splitNear = splitNear;
+        cascades[i].splitFar = splits[i];
+        splitNear = splits[i];
+    }
+    return count;
+}
+
+// a caster's bounding sphere against the cascade box; casters outside are not drawn into it
+inline bool SphereInCascade(const ShadowCascade& cascade, const glm::vec3& centre, float radius)
+{
+    glm::vec3 p = glm::vec3(cascade.lightView * glm::vec4(centre, 1.0f));
+    return p.x + radius >= cascade.boxMin.x && p.x - radius <= cascade.boxMax.x &&
+           p.y + radius >= cascade.boxMin.y && p.y - radius <= cascade.boxMax.y &&
+           p.z + radius >= cascade.boxMin.z && p.z - radius <= cascade.boxMax.z;
+}
+
+// CPU checks of a fitted set: splits increase and end at the shadow distance, every
+// slice corner projects inside its cascade, and each box centre sits on a whole
+// light-space texel (so a moving camera shifts the map by whole texels). Returns the failures
+inline int CheckCascadeFit(const glm::mat4& view, float fovY, float aspect, float nearZ, float shadowDistance,
+                           const ShadowCascade* cascades, int count, int mapSize)
+{
+    int failures = 0;
+    auto fail = [&](int cascade, const std::string& what) {
+        std::cout << "cascade " << cascade << ": " << what << std::endl;
+        ++failures;
+    };
+
+    float previous = nearZ;
+    for (int i = 0; i < count; ++i)
+    {
+        const ShadowCascade& cascade = cascades[i];
+        if (cascade.splitNear != previous || cascade.splitFar <= cascade.splitNear)
+            fail(i, "split does not continue the previous one");
+        previous = cascade.splitFar;
+
+        glm::vec3 corners[8];
+        FrustumSliceCorners(view, fovY, aspect, cascade.splitNear, cascade.splitFar, corners);
+        for (const glm::vec3& corner : corners)
+        {
+            glm::vec4 clip = cascade.viewProjection * glm::vec4(corner, 1.0f);
+            if (std::fabs(clip.x) > 1.0001f || std::fabs(clip.y) > 1.0001f || std::fabs(clip.z) > 1.0001f)
+                fail(i, "slice corner outside the cascade");
+        }
+
+        // the texel size the shadow map really has: the box width over mapSize texels,
+        // with two texels of slack past the slice sphere on each side
+        for (int axis = 0; axis < 2; ++axis)
+        {
+            double width = static_cast<double>(cascade.boxMax[axis]) - cascade.boxMin[axis];
+            double texel = width / mapSize;
+            if (std::fabs(texel - cascade.texelSize) > 1e-4 * texel)
+                fail(i, "texel size does not match the box over the map size");
+            if (width < 2.0 * cascade.radius + 4.0 * texel - 1e-3 * texel)
+                fail(i, "box leaves less than two texels of slack for the snap");
+            double centre = (static_cast<double>(cascade.boxMin[axis]) + cascade.boxMax[axis]) * 0.5;
+            double texels = centre / texel;
+            if (std::fabs(texels - std::round(texels)) > 0.05)
+                fail(i, "box centre is not on a whole light-space texel");
+        }
+    }
+    if (count > 0 && previous != shadowDistance)
+        fail(count - 1, "last split is not the shadow distance");
+    return failures;
+}
+
+// depth texture array with one layer per cascade, sampled with hardware comparison
+// --------------------------------------------------------------------------------
+class CascadedShadowMap
+{
+public:
+    static const int TEXTURE_UNIT = 7;  // clear of the material units
+
+    bool Init(int size, int cascadeCount)
+    {
+        mapSize = size;
+        layers = std::clamp(cascadeCount, 1, MAX_SHADOW_CASCADES);
+
+        glGenTextures(1, &depthArray);
+        glBindTexture(GL_TEXTURE_2D_ARRAY, depthArray);
+        glTexImage3D(GL_TEXTURE_2D_ARRAY, 0, GL_DEPTH_COMPONENT32F, mapSize, mapSize, layers, 0, GL_DEPTH_COMPONENT, GL_FLOAT, NULL);
+        glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+        glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+        glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+        glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+        glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_COMPARE_MODE, GL_COMPARE_REF_TO_TEXTURE);
+        glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_COMPARE_FUNC, GL_LEQUAL);
+        glBindTexture(GL_TEXTURE_2D_ARRAY, 0);
+
+        glGenFramebuffers(1, &framebuffer);
+        glBindFramebuffer(GL_FRAMEBUFFER, framebuffer);
+        glFramebufferTextureLayer(GL_FRAMEBUFFER, GL_DEPTH_ATTACHMENT, depthArray, 0, 0);
+        glDrawBuffer(GL_NONE);
+        glReadBuffer(GL_NONE);
+        bool complete = glCheckFramebufferStatus(GL_FRAMEBUFFER) == GL_FRAMEBUFFER_COMPLETE;
+        glBindFramebuffer(GL_FRAMEBUFFER, 0);
+        if (!complete)
+        {
+            std::cout << "ERROR::FRAMEBUFFER:: Shadow map framebuffer is not complete!" << std::endl;
+            Release();
+        }
+        return complete;
+    }
+
+    // render target for one cascade: its layer attached, cleared, viewport set.
+    // Slope-scaled offset keeps lit surfaces from shadowing themselves
+    void BeginCascade(int cascade)
+    {
+        glGetIntegerv(GL_VIEWPORT, savedViewport);
+        glBindFramebuffer(GL_FRAMEBUFFER, framebuffer);
+        glFramebufferTextureLayer(GL_FRAMEBUFFER, GL_DEPTH_ATTACHMENT, depthArray, 0, cascade);
+        glViewport(0, 0, mapSize, mapSize);
+        glClear(GL_DEPTH_BUFFER_BIT);
+        glEnable(GL_POLYGON_OFFSET_FILL);
+        glPolygonOffset(2.0f, 4.0f);
+    }
+
+    void EndCascade()
+    {
+        glDisable(GL_POLYGON_OFFSET_FILL);
+        glBindFramebuffer(GL_FRAMEBUFFER, 0);
+        glViewport(savedViewport[0], savedViewport[1], savedViewport[2], savedViewport[3]);
+    }
+
+    // bind the map and set the receiver uniforms on the shader's program (must be in use)
+    template <typename ShaderType>
+    void Bind(ShaderType& shader, const ShadowCascade* cascades, int count) const
+    {
+        glActiveTexture(GL_TEXTURE0 + TEXTURE_UNIT);
+        glBindTexture(GL_TEXTURE_2D_ARRAY, depthArray);
+        glActiveTexture(GL_TEXTURE0);
+        shader.setInt("shadowMap", TEXTURE_UNIT);
+        shader.setInt("cascadeCount", count);
+        if (count <= 0)
+            return;
+        // both arrays in one upload each, and no per-element name strings
+        glm::mat4 viewProjections[MAX_SHADOW_CASCADES];
+        float splits[MAX_SHADOW_CASCADES];
+        count = std::min(count, MAX_SHADOW_CASCADES);
+        for (int i = 0; i < count; ++i)
+        {
+            viewProjections[i] = cascades[i].viewProjection;
+            splits[i] = cascades[i].splitFar;
+        }
+        glUniformMatrix4fv(glGetUniformLocation(shader.ID, "cascadeViewProjection"), count, GL_FALSE, &viewProjections[0][0][0]);
+        glUniform1fv(glGetUniformLocation(shader.ID, "cascadeSplits"), count, splits);
+    }
+
+    int Size() const { return mapSize; }
+    int Layers() const { return layers; }
+
+    void Release()
+    {
+        if (framebuffer)
+            glDeleteFramebuffers(1, &framebuffer);
+        if (depthArray)
+            glDeleteTextures(1, &depthArray);
+        framebuffer = 0;
+        depthArray = 0;
+    }
+
+private:
+    unsigned int depthArray = 0;
+    unsigned int framebuffer = 0;
+    int mapSize = 0;
+    int layers = 0;
+    int savedViewport[4] = { 0, 0, 0, 0 };
+};
+
+#endif
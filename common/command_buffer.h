@@ -0,0 +1,346 @@
+#ifndef COMMAND_BUFFER_H
+#define COMMAND_BUFFER_H
+
+// GL commands recorded now and replayed later, on the thread that owns the context.
+//
+// A CommandBuffer is a flat list of small commands: bind a program, VAO or
+// texture, upload a uniform, draw. Culling, sorting and uniform packing can fill
+// buffers on worker threads while the GL thread is busy submitting. ReplayCommands then plays a buffer into a backend:
+// GLCommandBackend makes the GL calls, NullCommandBackend only follows the state
+// and hashes every draw and uniform upload, for headless runs and for checking
+// that a scene recorded in pieces draws the same as one recorded whole.
+//
+// CommandBuffer has the same recording methods as the backends, so code that
+// emits draws (RenderQueue) can write to either.
+//
+// CommandRecorder keeps worker threads and one buffer per job. Dispatch starts
+// the jobs, Wait(job) returns once that job's buffer is complete, so job 0 can
+// be replayed while later jobs still record. A waiting thread runs unclaimed
+// jobs itself, so with no workers everything runs on the caller. Buffers and
+// job state keep their capacity, so steady frames don't allocate.
+
+#include <glad/glad.h>
+
+#include <condition_variable>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+enum class CommandType : uint8_t
+{
+    UseProgram,
+    BindVertexArray,
+    ActiveTexture,
+    BindTexture,
+    Uniform1i,
+    Uniform1f,
+    Uniform3f,
+    UniformMatrix4,
+    DrawElements,
+    DrawArrays,
+};
+
+// 24 bytes; float data (uniform values) lives in the buffer's payload
+struct Command
+{
+    CommandType type;
+    GLenum target;        // texture target or primitive mode
+    int32_t a;            // program, VAO, unit, texture or location
+    int32_t b;            // count, value or first
+    int32_t c;            // first index
+    int32_t d;            // base vertex, or the payload offset of uniform data
+};
+
+class CommandBuffer
+{
+public:
+    void Clear()
+    {
+        commands.clear();
+        payload.clear();
+    }
+
+    void Reserve(size_t commandCount, size_t floats)
+    {
+        commands.reserve(commandCount);
+        payload.reserve(floats);
+    }
+
+    void UseProgram(unsigned int program) { Push(CommandType::UseProgram, 0, static_cast<int32_t>(program)); }
+    void BindVertexArray(unsigned int vao) { Push(CommandType::BindVertexArray, 0, static_cast<int32_t>(vao)); }
+    void ActiveTexture(int unit) { Push(CommandType::ActiveTexture, 0, unit); }
+    void BindTexture(GLenum target, unsigned int texture) { Push(CommandType::BindTexture, target, static_cast<int32_t>(texture)); }
+    void Uniform1i(int location, int value) { Push(CommandType::Uniform1i, 0, location, value); }
+    void Uniform1f(int location, float value) { PushData(CommandType::Uniform1f, location, 1, &value, 1); }
+    void Uniform3f(int location, float x, float y, float z)
+    {
+        const float values[3] = { x, y, z };
+        PushData(CommandType::Uniform3f, location, 1, values, 3);
+    }
+    void UniformMatrix4(int location, int count, const float* values) { PushData(CommandType::UniformMatrix4, location, count, values, 16 * count); }
+    void DrawElements(GLenum mode, int count, int firstIndex, int baseVertex) { Push(CommandType::DrawElements, mode, count, 0, firstIndex, baseVertex); }
+    void DrawArrays(GLenum mode, int first, int count) { Push(CommandType::DrawArrays, mode, first, count); }
+
+    const std::vector<Command>& Commands() const { return commands; }
+    const float* Data(int32_t offset) const { return payload.data() + offset; }
+    size_t Size() const { return commands.size(); }
+    size_t Bytes() const { return commands.size() * sizeof(Command) + payload.size() * sizeof(float); }
+
+private:
+    void Push(CommandType type, GLenum target, int32_t a, int32_t b = 0, int32_t c = 0, int32_t d = 0)
+    {
+        commands.push_back({ type, target, a, b, c, d });
+    }
+
+    void PushData(CommandType type, int32_t location, int32_t count, const float* values, int floats)
+    {
+        int32_t offset = static_cast<int32_t>(payload.size());
+        payload.insert(payload.end(), values, values + floats);
+        Push(type, 0, location, count, 0, offset);
+    }
+
+    std::vector<Command> commands;
+    std::vector<float> payload;
+};
+
+// the GL calls, one for one. It keeps no state, because other code changes GL
+// state between replays; redundant binds are left out when commands are recorded
+class GLCommandBackend
+{
+public:
+    void UseProgram(unsigned int program) { glUseProgram(program); }
+    void BindVertexArray(unsigned int vao) { glBindVertexArray(vao); }
+    void ActiveTexture(int unit) { glActiveTexture(GL_TEXTURE0 + unit); }
+    void BindTexture(GLenum target, unsigned int texture) { glBindTexture(target, texture); }
+    void Uniform1i(int location, int value) { glUniform1i(location, value); }
+    void Uniform1f(int location, float value) { glUniform1f(location, value); }
+    void Uniform3f(int location, float x, float y, float z) { glUniform3f(location, x, y, z); }
+    void UniformMatrix4(int location, int count, const float* values) { glUniformMatrix4fv(location, count, GL_FALSE, values); }
+    void DrawElements(GLenum mode, int count, int firstIndex, int baseVertex)
+    {
+        glDrawElementsBaseVertex(mode, count, GL_UNSIGNED_INT, (void*)(firstIndex * sizeof(unsigned int)), baseVertex);
+    }
+    void DrawArrays(GLenum mode, int first, int count) { glDrawArrays(mode, first, count); }
+};
+
+// no GL: the state each draw would see, hashed (FNV-1a) with every uniform upload.
+// Binds don't enter the hash, so two recordings with different redundant binds but
+// the same draws compare equal
+class NullCommandBackend
+{
+public:
+    static const int UNITS = 8;
+
+    void UseProgram(unsigned int p) { program = p; ++binds; }
+    void BindVertexArray(unsigned int v) { vao = v; ++binds; }
+    void ActiveTexture(int unit) { activeUnit = unit >= 0 && unit < UNITS ? unit : 0; }
+    void BindTexture(GLenum, unsigned int texture) { textures[activeUnit] = texture; ++binds; }
+    void Uniform1i(int location, int value) { Upload(location, &value, sizeof(value)); }
+    void Uniform1f(int location, float value) { Upload(location, &value, sizeof(value)); }
+    void Uniform3f(int location, float x, float y, float z)
+    {
+        const float values[3] = { x, y, z };
+        Upload(location, values, sizeof(values));
+    }
+    void UniformMatrix4(int location, int count, const float* values) { Upload(location, values, sizeof(float) * 16 * count); }
+    void DrawElements(GLenum mode, int count, int firstIndex, int baseVertex)
+    {
+        const int32_t draw[4] = { static_cast<int32_t>(mode), count, firstIndex, baseVertex };
+        Draw(draw);
+    }
+    void DrawArrays(GLenum mode, int first, int count)
+    {
+        const int32_t draw[4] = { static_cast<int32_t>(mode), count, first, -1 };
+        Draw(draw);
+    }
+
+    uint64_t Hash() const { return hash; }
+    int Draws() const { return draws; }
+    int Binds() const { return binds; }
+    int Uploads() const { return uploads; }
+
+private:
+    void Mix(const void* data, size_t bytes)
+    {
+        const unsigned char* p = static_cast<const unsigned char*>(data);
+        for (size_t i = 0; i < bytes; ++i)
+        {
+            hash ^= p[i];
+            hash *= 1099511628211ull;
+        }
+    }
+
+    void Upload(int location, const void* data, size_t bytes)
+    {
+        const uint32_t header[2] = { program, static_cast<uint32_t>(location) };
+        Mix(header, sizeof(header));
+        Mix(data, bytes);
+        ++uploads;
+    }
+
+    void Draw(const int32_t (&draw)[4])
+    {
+        const uint32_t state[2] = { program, vao };
+        Mix(state, sizeof(state));
+        Mix(textures, sizeof(textures));
+        Mix(draw, sizeof(draw));
+        ++draws;
+    }
+
+    uint32_t program = 0;
+    uint32_t vao = 0;
+    uint32_t textures[UNITS] = {};
+    int activeUnit = 0;
+    uint64_t hash = 14695981039346656037ull;
+    int draws = 0;
+    int binds = 0;
+    int uploads = 0;
+};
+
+template <typename Backend>
+void ReplayCommands(const CommandBuffer& buffer, Backend& backend)
+{
+    for (const Command& command : buffer.Commands())
+    {
+        switch (command.type)
+        {
+        case CommandType::UseProgram: backend.UseProgram(static_cast<unsigned int>(command.a)); break;
+        case CommandType::BindVertexArray: backend.BindVertexArray(static_cast<unsigned int>(command.a)); break;
+        case CommandType::ActiveTexture: backend.ActiveTexture(command.a); break;
+        case CommandType::BindTexture: backend.BindTexture(command.target, static_cast<unsigned int>(command.a)); break;
+        case CommandType::Uniform1i: backend.Uniform1i(command.a, command.b); break;
+        case CommandType::Uniform1f: backend.Uniform1f(command.a, *buffer.Data(command.d)); break;
+        case CommandType::Uniform3f:
+        {
+            const float* v = buffer.Data(command.d);
+            backend.Uniform3f(command.a, v[0], v[1], v[2]);
+            break;
+        }
+        case CommandType::UniformMatrix4: backend.UniformMatrix4(command.a, command.b, buffer.Data(command.d)); break;
+        case CommandType::DrawElements: backend.DrawElements(command.target, command.a, command.c, command.d); break;
+        case CommandType::DrawArrays: backend.DrawArrays(command.target, command.a, command.b); break;
+        }
+    }
+}
+
+class CommandRecorder
+{
+public:
+    // fills the buffer for one job; called on a worker or a waiting thread
+    typedef std::function<void(int job, CommandBuffer& buffer)> RecordJob;
+
+    explicit CommandRecorder(int threads = 0)
+    {
+        for (int i = 0; i < threads; ++i)
+            workers.emplace_back([this]() { Work(); });
+    }
+
+    CommandRecorder(const CommandRecorder&) = delete;
+    CommandRecorder& operator=(const CommandRecorder&) = delete;
+
+    ~CommandRecorder()
+    {
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            stopping = true;
+        }
+        wake.notify_all();
+        for (std::thread& worker : workers)
+            worker.join();
+    }
+
+    int Threads() const { return static_cast<int>(workers.size()); }
+
+    // buffers for up to jobCount jobs, each with room for the given commands and uniform floats
+    void Reserve(int jobCount, size_t commandCount, size_t floats)
+    {
+        WaitAll();
+        std::lock_guard<std::mutex> lock(mutex);
+        while (static_cast<int>(buffers.size()) < jobCount)
+            buffers.emplace_back(new CommandBuffer);
+        for (std::unique_ptr<CommandBuffer>& buffer : buffers)
+            buffer->Reserve(commandCount, floats);
+        finished.reserve(jobCount);
+    }
+
+    // start jobs 0..jobCount-1, each recording into Buffer(job) after clearing it.
+    // record must stay alive until every job has been waited for
+    void Dispatch(int jobCount, const RecordJob& record)
+    {
+        WaitAll();
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            while (static_cast<int>(buffers.size()) < jobCount)
+                buffers.emplace_back(new CommandBuffer);
+            finished.assign(jobCount, 0);
+            job = &record;
+            jobs = jobCount;
+            nextJob = 0;
+        }
+        wake.notify_all();
+    }
+
+    // until the job's buffer is complete; runs unclaimed jobs meanwhile
+    void Wait(int index)
+    {
+        std::unique_lock<std::mutex> lock(mutex);
+        while (index < jobs && !finished[index])
+        {
+            if (nextJob < jobs)
+                RunNext(lock);
+            else
+                done.wait(lock);
+        }
+    }
+
+    void WaitAll()
+    {
+        for (int i = 0; i < jobs; ++i)
+            Wait(i);
+    }
+
+    CommandBuffer& Buffer(int index) { return *buffers[index]; }
+
+private:
+    void Work()
+    {
+        std::unique_lock<std::mutex> lock(mutex);
+        for (;;)
+        {
+            wake.wait(lock, [this]() { return stopping || nextJob < jobs; });
+            if (stopping)
+                return;
+            RunNext(lock);
+        }
+    }
+
+    // claim the next job and record it with the lock released
+    void RunNext(std::unique_lock<std::mutex>& lock)
+    {
+        int index = nextJob++;
+        const RecordJob& record = *job;
+        CommandBuffer& buffer = *buffers[index];
+        lock.unlock();
+        buffer.Clear();
+        record(index, buffer);
+        lock.lock();
+        finished[index] = 1;
+        done.notify_all();
+    }
+
+    std::vector<std::thread> workers;
+    std::vector<std::unique_ptr<CommandBuffer>> buffers;
+    std::vector<char> finished;
+    const RecordJob* job = nullptr;
+    int jobs = 0;
+    int nextJob = 0;
+    bool stopping = false;
+    std::mutex mutex;
+    std::condition_variable wake;
+    std::condition_variable done;
+};
+
+#endif
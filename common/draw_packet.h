@@ -0,0 +1,152 @@
+#ifndef DRAW_PACKET_H
+#define DRAW_PACKET_H
+
+// Draw packets and their sort keys, without GL: what RenderQueue sorts and submits
+// (common/render_queue.h), and what the CPU tests check (tests/).
+//
+// key layout (most significant first):
+//   layer:4 | program:12 | texture0:16 | vao:16 | depth:16
+//
+// GL names are packed as they are; they are small sequential integers, and a name
+// too wide for its field trips an assert instead of sorting next to another one.
+//
+// DrawOrder::FrontToBack sorts by layer then depth instead, so opaque draws
+// nearest the camera fill the depth buffer first and hidden fragments are
+// rejected before shading.
+
+#include <glm/glm.hpp>
+
+#include <algorithm>
+#include <cassert>
+#include <cstdint>
+#include <numeric>
+#include <vector>
+
+const int MAX_PACKET_TEXTURES = 4;
+
+// GL_TEXTURE_2D and GL_TRIANGLES, the packet defaults, without including GL here
+const unsigned int DRAW_PACKET_TEXTURE_2D = 0x0DE1;
+const unsigned int DRAW_PACKET_TRIANGLES = 0x0004;
+
+struct DrawPacket
+{
+    uint64_t key = 0;
+
+    unsigned int program = 0;
+    unsigned int vao = 0;
+    unsigned int textures[MAX_PACKET_TEXTURES] = {};  // bound to units 0..textureCount-1
+    int textureCount = 0;
+    unsigned int textureTarget = DRAW_PACKET_TEXTURE_2D;   // of every unit's texture
+
+    int modelLocation = -1;
+    glm::mat4 model = glm::mat4(1.0f);
+
+    unsigned int mode = DRAW_PACKET_TRIANGLES;
+    int count = 0;
+    bool indexed = true;   // glDrawElements with unsigned int indices, else glDrawArrays
+    int first = 0;         // first vertex, or first index when indexed
+    int baseVertex = 0;    // added to every index (glDrawElementsBaseVertex), for shared buffers
+};
+
+struct RenderStateStats
+{
+    int programBinds = 0;
+    int vaoBinds = 0;
+    int textureBinds = 0;
+    int draws = 0;
+
+    int Total() const { return programBinds + vaoBinds + textureBinds; }
+};
+
+const uint32_t DRAW_KEY_MAX_LAYER = 0xF;
+const uint32_t DRAW_KEY_MAX_PROGRAM = 0xFFF;
+const uint32_t DRAW_KEY_MAX_NAME = 0xFFFF;   // texture and VAO
+
+// depth01 is the view distance normalised to [0, 1]; smaller sorts first (front to back)
+inline uint64_t PackDrawKey(uint32_t layer, uint32_t program, uint32_t texture, uint32_t vao, float depth01)
+{
+    assert(layer <= DRAW_KEY_MAX_LAYER && "draw key layer does not fit in 4 bits");
+    assert(program <= DRAW_KEY_MAX_PROGRAM && "program name does not fit in the draw key's 12 bits");
+    assert(texture <= DRAW_KEY_MAX_NAME && "texture name does not fit in the draw key's 16 bits");
+    assert(vao <= DRAW_KEY_MAX_NAME && "VAO name does not fit in the draw key's 16 bits");
+    uint64_t depth = static_cast<uint64_t>(std::clamp(depth01, 0.0f, 1.0f) * 65535.0f);
+    return (static_cast<uint64_t>(layer & DRAW_KEY_MAX_LAYER) << 60) |
+           (static_cast<uint64_t>(program & DRAW_KEY_MAX_PROGRAM) << 48) |
+           (static_cast<uint64_t>(texture & DRAW_KEY_MAX_NAME) << 32) |
+           (static_cast<uint64_t>(vao & DRAW_KEY_MAX_NAME) << 16) |
+           depth;
+}
+
+inline uint32_t DrawKeyLayer(uint64_t key) { return static_cast<uint32_t>(key >> 60); }
+inline uint32_t DrawKeyProgram(uint64_t key) { return static_cast<uint32_t>((key >> 48) & DRAW_KEY_MAX_PROGRAM); }
+inline uint32_t DrawKeyTexture(uint64_t key) { return static_cast<uint32_t>((key >> 32) & DRAW_KEY_MAX_NAME); }
+inline uint32_t DrawKeyVao(uint64_t key) { return static_cast<uint32_t>((key >> 16) & DRAW_KEY_MAX_NAME); }
+inline uint32_t DrawKeyDepth(uint64_t key) { return static_cast<uint32_t>(key & 0xFFFF); }
+
+inline uint64_t PackDrawKey(const DrawPacket& packet, uint32_t layer, float depth01)
+{
+    return PackDrawKey(layer, packet.program, packet.textureCount > 0 ? packet.textures[0] : 0, packet.vao, depth01);
+}
+
+enum class DrawOrder
+{
+    State,        // fewest binds: the key as packed
+    FrontToBack   // least overdraw: layer, then depth, then the rest of the key
+};
+
+// packet indices in draw order; equal keys keep submission order. Ties go to the
+// lower index rather than through std::stable_sort, which takes a heap buffer per call
+inline void SortDrawPackets(const std::vector<DrawPacket>& packets, std::vector<uint32_t>& order, DrawOrder drawOrder = DrawOrder::State)
+{
+    order.resize(packets.size());
+    std::iota(order.begin(), order.end(), 0u);
+    if (drawOrder == DrawOrder::FrontToBack)
+    {
+        std::sort(order.begin(), order.end(), [&](uint32_t a, uint32_t b) {
+            uint64_t keyA = packets[a].key, keyB = packets[b].key;
+            if (DrawKeyLayer(keyA) != DrawKeyLayer(keyB))
+                return DrawKeyLayer(keyA) < DrawKeyLayer(keyB);
+            if (DrawKeyDepth(keyA) != DrawKeyDepth(keyB))
+                return DrawKeyDepth(keyA) < DrawKeyDepth(keyB);
+            return keyA != keyB ? keyA < keyB : a < b;
+        });
+    }
+    else
+    {
+        std::sort(order.begin(), order.end(), [&](uint32_t a, uint32_t b) {
+            return packets[a].key != packets[b].key ? packets[a].key < packets[b].key : a < b;
+        });
+    }
+}
+
+// state changes needed to draw packets in the given order. Without elision every
+// packet binds its program, VAO and textures, which is what immediate-mode drawing does
+inline RenderStateStats CountStateChanges(const std::vector<DrawPacket>& packets, const std::vector<uint32_t>& order, bool elide)
+{
+    RenderStateStats stats;
+    unsigned int program = 0;
+    unsigned int vao = 0;
+    unsigned int textures[MAX_PACKET_TEXTURES] = {};
+    bool first = true;
+    for (uint32_t index : order)
+    {
+        const DrawPacket& p = packets[index];
+        if (!elide || first || p.program != program)
+            ++stats.programBinds;
+        if (!elide || first || p.vao != vao)
+            ++stats.vaoBinds;
+        for (int unit = 0; unit < p.textureCount; ++unit)
+        {
+            if (!elide || first || p.textures[unit] != textures[unit])
+                ++stats.textureBinds;
+            textures[unit] = p.textures[unit];
+        }
+        program = p.program;
+        vao = p.vao;
+        first = false;
+        ++stats.draws;
+    }
+    return stats;
+}
+
+#endif
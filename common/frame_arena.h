@@ -0,0 +1,156 @@
+#ifndef FRAME_ARENA_H
+#define FRAME_ARENA_H
+
+// Per-frame transient memory and a heap allocation counter.
+//
+// FrameArena hands out memory by bumping an offset into one block and forgets
+// all of it at Reset(), once per frame. Nothing is destructed, so it only holds
+// trivially destructible data: matrices, uniform payloads, command lists. A
+// frame that runs past the block takes extra blocks from the heap, and the next
+// Reset() regrows the main block to cover that frame, so the arena stops
+// allocating once it has seen the largest frame.
+//
+// The allocation counter replaces the global operator new and delete, which
+// must happen in exactly one translation unit: define
+// ALLOCATION_TRACKER_IMPLEMENTATION before including this header there (each
+// demo is one .cpp, so that is its main file). Without it HeapAllocationCount()
+// stays at zero and AllocationTrackingEnabled() is false. Every thread counts,
+// aligned (over-aligned type) allocations don't.
+
+#include <algorithm>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <cstdlib>
+#include <memory>
+#include <new>
+#include <type_traits>
+#include <vector>
+
+inline std::atomic<uint64_t>& HeapAllocationCounter()
+{
+    static std::atomic<uint64_t> counter{ 0 };
+    return counter;
+}
+
+inline uint64_t HeapAllocationCount() { return HeapAllocationCounter().load(std::memory_order_relaxed); }
+
+#ifdef ALLOCATION_TRACKER_IMPLEMENTATION
+inline bool AllocationTrackingEnabled() { return true; }
+
+void* operator new(std::size_t size)
+{
+    HeapAllocationCounter().fetch_add(1, std::memory_order_relaxed);
+    if (size == 0)
+        size = 1;
+    for (;;)
+    {
+        if (void* p = std::malloc(size))
+            return p;
+        std::new_handler handler = std::get_new_handler();
+        if (!handler)
+            throw std::bad_alloc();
+        handler();
+    }
+}
+void* operator new[](std::size_t size) { return ::operator new(size); }
+void operator delete(void* p) noexcept { std::free(p); }
+void operator delete[](void* p) noexcept { std::free(p); }
+void operator delete(void* p, std::size_t) noexcept { std::free(p); }
+void operator delete[](void* p, std::size_t) noexcept { std::free(p); }
+#else
+inline bool AllocationTrackingEnabled() { return false; }
+#endif
+
+// heap allocations between Begin() and End(), on any thread
+struct AllocationScope
+{
+    uint64_t start = 0;
+
+    void Begin() { start = HeapAllocationCount(); }
+    uint64_t End() const { return HeapAllocationCount() - start; }
+};
+
+class FrameArena
+{
+public:
+    explicit FrameArena(size_t capacity = 0) { Reserve(capacity); }
+
+    FrameArena(const FrameArena&) = delete;
+    FrameArena& operator=(const FrameArena&) = delete;
+
+    // replace the block with one of at least the given size; drops everything allocated
+    void Reserve(size_t bytes)
+    {
+        overflow.clear();
+        used = 0;
+        overflowBytes = 0;
+        if (bytes <= capacity)
+            return;
+        block.reset(new unsigned char[bytes]);
+        capacity = bytes;
+    }
+
+    void* Allocate(size_t bytes, size_t alignment = alignof(std::max_align_t))
+    {
+        uintptr_t base = reinterpret_cast<uintptr_t>(block.get());
+        size_t offset = static_cast<size_t>(AlignUp(base + used, alignment) - base);
+        if (block && offset + bytes <= capacity)
+        {
+            used = offset + bytes;
+            highWater = std::max(highWater, used);
+            return block.get() + offset;
+        }
+
+        // past the block: a heap block of its own until the next Reset()
+        overflowBytes += bytes + alignment;
+        overflow.emplace_back(new unsigned char[bytes + alignment]);
+        uintptr_t p = reinterpret_cast<uintptr_t>(overflow.back().get());
+        return reinterpret_cast<void*>(AlignUp(p, alignment));
+    }
+
+    // count default-constructed Ts
+    template <typename T>
+    T* Allocate(size_t count)
+    {
+        static_assert(std::is_trivially_destructible<T>::value, "FrameArena never runs destructors");
+        T* items = static_cast<T*>(Allocate(count * sizeof(T), alignof(T)));
+        for (size_t i = 0; i < count; ++i)
+            new (items + i) T();
+        return items;
+    }
+
+    // end of frame: everything handed out is gone. A frame that overflowed grows the block
+    void Reset()
+    {
+        if (!overflow.empty())
+        {
+            size_t needed = used + overflowBytes;
+            overflow.clear();
+            block.reset(new unsigned char[needed]);
+            capacity = needed;
+            highWater = std::max(highWater, needed);
+            ++growCount;
+        }
+        used = 0;
+        overflowBytes = 0;
+    }
+
+    size_t Used() const { return used + overflowBytes; }
+    size_t Capacity() const { return capacity; }
+    size_t HighWater() const { return highWater; }
+    int GrowCount() const { return growCount; }
+
+private:
+    static uintptr_t AlignUp(uintptr_t value, size_t alignment) { return (value + alignment - 1) & ~static_cast<uintptr_t>(alignment - 1); }
+
+    std::unique_ptr<unsigned char[]> block;
+    size_t capacity = 0;
+    size_t used = 0;
+    size_t highWater = 0;
+    int growCount = 0;
+    std::vector<std::unique_ptr<unsigned char[]>> overflow;
+    size_t overflowBytes = 0;
+};
+
+#endif
@@ -0,0 +1,211 @@
+#ifndef FRAME_PIPELINE_H
+#define FRAME_PIPELINE_H
+
+// Two-stage frame pipeline: the update of frame N+1 runs on a worker thread
+// while the render thread draws frame N.
+//
+// Everything a frame needs for drawing goes into a Snapshot. The pipeline holds
+// two of them. The render thread draws the front one, and the update stage
+// fills the back one. Each frame the render thread does
+//
+//     pipeline.BeginUpdate();          // worker fills the back snapshot, frame N+1
+//     pipeline.BeginRender();
+//     ... draw pipeline.Front() (frame N), glfwSwapBuffers ...
+//     pipeline.EndRender();
+//     pipeline.FinishUpdate();         // wait for the worker, swap front and back
+//
+// Nobody writes the front snapshot while it is being drawn. The buffer swap
+// stays on the render thread with the same swap interval, so frames tear no
+// more than before. The cost is one frame of latency: input handed to the
+// update stage before BeginUpdate appears on screen a frame later.
+//
+// The update stage must not call GL. Apart from its snapshot, it may only touch
+// state the render thread leaves alone between BeginUpdate and FinishUpdate.
+// Both calls go through the pipeline's lock, so anything written before
+// BeginUpdate is visible to the worker, and anything the worker writes is
+// visible after FinishUpdate.
+//
+// PipelineOverlap adds up update time, render time and how long the two ran at
+// the same time. PipelineStress runs the demos' --pipeline-stress mode: phases of
+// a fixed number of frames, alternately sequential and pipelined, each reporting
+// its frame rate and the pipelined ones their overlap.
+
+#include <algorithm>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <cstdio>
+#include <functional>
+#include <mutex>
+#include <thread>
+
+struct PipelineOverlap
+{
+    uint64_t frames = 0;
+    double updateSeconds = 0.0;
+    double renderSeconds = 0.0;
+    double overlapSeconds = 0.0;     // update and render both running
+
+    double UpdateOverlapPercent() const { return updateSeconds > 0.0 ? 100.0 * overlapSeconds / updateSeconds : 0.0; }
+    double RenderOverlapPercent() const { return renderSeconds > 0.0 ? 100.0 * overlapSeconds / renderSeconds : 0.0; }
+
+    void Print(const char* name) const
+    {
+        double n = frames > 0 ? static_cast<double>(frames) : 1.0;
+        std::printf("%-24s %8llu frames  update %7.3f ms  render %7.3f ms  overlap: %5.1f%% of update, %5.1f%% of render\n",
+            name, static_cast<unsigned long long>(frames),
+            1000.0 * updateSeconds / n, 1000.0 * renderSeconds / n,
+            UpdateOverlapPercent(), RenderOverlapPercent());
+    }
+};
+
+struct PipelineStress
+{
+    int phaseFrames = 600;
+    int frames = 0;
+    double phaseStart = 0.0;
+
+    void Begin(double now)
+    {
+        frames = 0;
+        phaseStart = now;
+    }
+
+    // counts a frame. When a phase ends it prints the phase and returns true; the caller
+    // then switches between sequential and pipelined
+    bool EndFrame(double now, bool pipelined, const PipelineOverlap& overlap)
+    {
+        if (++frames < phaseFrames)
+            return false;
+        double seconds = now - phaseStart;
+        std::printf("%-24s %8d frames  %8.1f fps\n", pipelined ? "pipeline/pipelined" : "pipeline/sequential",
+            frames, seconds > 0.0 ? frames / seconds : 0.0);
+        if (pipelined)
+            overlap.Print("pipeline/overlap");
+        Begin(now);
+        return true;
+    }
+};
+
+template <typename Snapshot>
+class FramePipeline
+{
+public:
+    // fills the snapshot of the next frame; called on the worker
+    typedef std::function<void(Snapshot& next)> UpdateStage;
+
+    FramePipeline() = default;
+    FramePipeline(const FramePipeline&) = delete;
+    FramePipeline& operator=(const FramePipeline&) = delete;
+
+    ~FramePipeline() { Stop(); }
+
+    // runs the first update on the calling thread, so Front() is ready to draw,
+    // then starts the worker. update must stay alive until Stop()
+    void Start(const UpdateStage& update)
+    {
+        Stop();
+        stage = &update;
+        front = 0;
+        update(snapshots[0]);
+        stopping = false;
+        worker = std::thread([this]() { Work(); });
+    }
+
+    void Stop()
+    {
+        if (!worker.joinable())
+            return;
+        FinishUpdate();
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            stopping = true;
+        }
+        wake.notify_one();
+        worker.join();
+    }
+
+    bool Running() const { return worker.joinable(); }
+
+    void BeginUpdate()
+    {
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            requested = true;
+            pending = true;
+        }
+        wake.notify_one();
+    }
+
+    void BeginRender() { renderStart = Clock::now(); }
+    void EndRender() { renderEnd = Clock::now(); }
+
+    // blocks until the update started by BeginUpdate is done; its snapshot becomes Front()
+    void FinishUpdate()
+    {
+        std::unique_lock<std::mutex> lock(mutex);
+        if (!pending)
+            return;
+        done.wait(lock, [this]() { return !requested; });
+        pending = false;
+        front ^= 1;
+
+        overlap.frames += 1;
+        overlap.updateSeconds += Seconds(updateStart, updateEnd);
+        overlap.renderSeconds += Seconds(renderStart, renderEnd);
+        Clock::time_point start = std::max(updateStart, renderStart);
+        Clock::time_point end = std::min(updateEnd, renderEnd);
+        if (start < end)
+            overlap.overlapSeconds += Seconds(start, end);
+    }
+
+    const Snapshot& Front() const { return snapshots[front]; }
+
+    const PipelineOverlap& Overlap() const { return overlap; }
+    void ResetOverlap() { overlap = PipelineOverlap(); }
+
+private:
+    typedef std::chrono::steady_clock Clock;
+
+    static double Seconds(Clock::time_point start, Clock::time_point end)
+    {
+        return end > start ? std::chrono::duration<double>(end - start).count() : 0.0;
+    }
+
+    void Work()
+    {
+        std::unique_lock<std::mutex> lock(mutex);
+        for (;;)
+        {
+            wake.wait(lock, [this]() { return stopping || requested; });
+            if (stopping)
+                return;
+            Snapshot& next = snapshots[front ^ 1];
+            lock.unlock();
+            Clock::time_point start = Clock::now();
+            (*stage)(next);
+            Clock::time_point end = Clock::now();
+            lock.lock();
+            updateStart = start;
+            updateEnd = end;
+            requested = false;
+            done.notify_one();
+        }
+    }
+
+    Snapshot snapshots[2];
+    int front = 0;
+    const UpdateStage* stage = nullptr;
+    std::thread worker;
+    bool requested = false;          // the worker has an update to run
+    bool pending = false;            // an update started that FinishUpdate hasn't taken
+    bool stopping = false;
+    std::mutex mutex;
+    std::condition_variable wake;
+    std::condition_variable done;
+    Clock::time_point updateStart, updateEnd;
+    Clock::time_point renderStart, renderEnd;
+    PipelineOverlap overlap;
+};
+
+#endif
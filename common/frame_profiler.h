@@ -0,0 +1,356 @@
+#ifndef FRAME_PROFILER_H
+#define FRAME_PROFILER_H
+
+// Per-frame instrumentation: named CPU scopes, GL_TIME_ELAPSED query rings per
+// render pass, GL_SAMPLES_PASSED fragment counts per pass, per-frame counters
+// (draws, state changes, ...), rolling
+// min/avg/p99 over the last frames and Chrome trace export (open the file in
+// chrome://tracing or ui.perfetto.dev).
+//
+// Scopes and passes are registered once by name and then referred to by index,
+// so a scope costs two clock reads and an array add. GPU queries are read back
+// QUERY_RING_SIZE frames later and never stall the pipeline.
+
+#include <glad/glad.h>
+
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <string>
+#include <vector>
+
+class FrameProfiler
+{
+public:
+    static const int HISTORY_SIZE = 256;   // frames kept for rolling statistics
+    static const int QUERY_RING_SIZE = 4;  // frames a GPU query is given before readback
+
+    struct Stats
+    {
+        double minMs = 0.0;
+        double avgMs = 0.0;
+        double p99Ms = 0.0;
+    };
+
+    FrameProfiler() : origin(Clock::now()) {}
+
+    // delete the query objects; call before the GL context goes away
+    void ReleaseGpu()
+    {
+        for (GpuPass& pass : gpuPasses)
+            glDeleteQueries(QUERY_RING_SIZE, pass.queries);
+        gpuPasses.clear();
+    }
+
+    // command line: --profile prints a summary every 300 frames, --trace <file> writes a Chrome trace on exit
+    void ParseOptions(int argc, char** argv)
+    {
+        for (int i = 1; i < argc; ++i)
+        {
+            if (std::strcmp(argv[i], "--profile") == 0)
+                printInterval = 300;
+            else if (std::strcmp(argv[i], "--trace") == 0 && i + 1 < argc)
+            {
+                tracePath = argv[++i];
+                traceEvents.reserve(MAX_TRACE_EVENTS);
+                traceCounters.reserve(MAX_TRACE_EVENTS);
+            }
+        }
+    }
+
+    int RegisterScope(const std::string& name)
+    {
+        cpuScopes.push_back(CpuScope());
+        cpuScopes.back().name = name;
+        return static_cast<int>(cpuScopes.size()) - 1;
+    }
+
+    // needs a current GL context
+    int RegisterGpuPass(const std::string& name)
+    {
+        gpuPasses.push_back(GpuPass());
+        GpuPass& pass = gpuPasses.back();
+        pass.name = name;
+        glGenQueries(QUERY_RING_SIZE, pass.queries);
+        return static_cast<int>(gpuPasses.size()) - 1;
+    }
+
+    // occlusion query counting the fragments that pass the depth test in a block
+    // (ProfileGpuPass); can be open at the same time as a timed pass
+    int RegisterFragmentCounter(const std::string& name)
+    {
+        int pass = RegisterGpuPass(name);
+        gpuPasses[pass].target = GL_SAMPLES_PASSED;
+        return pass;
+    }
+
+    int RegisterCounter(const std::string& name)
+    {
+        counters.push_back(Counter());
+        counters.back().name = name;
+        return static_cast<int>(counters.size()) - 1;
+    }
+
+    // value of a counter for the current frame; counters not set in a frame record 0
+    void SetCounter(int counter, double value) { counters[counter].value = value; }
+    void AddCounter(int counter, double value) { counters[counter].value += value; }
+
+    void BeginFrame()
+    {
+        frameStart = Now();
+        int slot = static_cast<int>(frameIndex % QUERY_RING_SIZE);
+        for (GpuPass& pass : gpuPasses)
+        {
+            // the query in this slot was issued QUERY_RING_SIZE frames ago
+            if (!pass.issued[slot])
+                continue;
+            GLint available = 0;
+            glGetQueryObjectiv(pass.queries[slot], GL_QUERY_RESULT_AVAILABLE, &available);
+            if (available)
+            {
+                GLuint64 result = 0;
+                glGetQueryObjectui64v(pass.queries[slot], GL_QUERY_RESULT, &result);
+                double value = pass.target == GL_TIME_ELAPSED ? result / 1.0e6 : static_cast<double>(result);
+                pass.history.Push(value);
+                if (Tracing() && traceCounters.size() < MAX_TRACE_EVENTS)
+                    traceCounters.push_back({ true, static_cast<int>(&pass - gpuPasses.data()), frameStart, value });
+            }
+            pass.issued[slot] = false;
+        }
+    }
+
+    void EndFrame()
+    {
+        int64_t frameEnd = Now();
+        frameHistory.Push((frameEnd - frameStart) / 1.0e6);
+        for (CpuScope& scope : cpuScopes)
+        {
+            scope.history.Push(scope.frameNs / 1.0e6);
+            scope.frameNs = 0;
+        }
+        for (Counter& counter : counters)
+        {
+            counter.history.Push(counter.value);
+            if (Tracing() && traceCounters.size() < MAX_TRACE_EVENTS)
+                traceCounters.push_back({ false, static_cast<int>(&counter - counters.data()), frameStart, counter.value });
+            counter.value = 0.0;
+        }
+        ++frameIndex;
+        if (printInterval > 0 && frameIndex % printInterval == 0)
+            PrintSummary();
+    }
+
+    int64_t BeginScope() const { return Now(); }
+
+    void EndScope(int scope, int64_t start)
+    {
+        int64_t end = Now();
+        cpuScopes[scope].frameNs += end - start;
+        if (Tracing() && traceEvents.size() < MAX_TRACE_EVENTS)
+            traceEvents.push_back({ scope, start, end - start });
+    }
+
+    // only one pass per query target at a time; GL_TIME_ELAPSED queries don't nest
+    void BeginGpu(int pass)
+    {
+        int slot = static_cast<int>(frameIndex % QUERY_RING_SIZE);
+        glBeginQuery(gpuPasses[pass].target, gpuPasses[pass].queries[slot]);
+    }
+
+    void EndGpu(int pass)
+    {
+        int slot = static_cast<int>(frameIndex % QUERY_RING_SIZE);
+        glEndQuery(gpuPasses[pass].target);
+        gpuPasses[pass].issued[slot] = true;
+    }
+
+    Stats ScopeStats(int scope) const { return cpuScopes[scope].history.Compute(); }
+    Stats GpuStats(int pass) const { return gpuPasses[pass].history.Compute(); }
+    Stats CounterStats(int counter) const { return counters[counter].history.Compute(); }
+    Stats FrameStats() const { return frameHistory.Compute(); }
+
+    void PrintSummary() const
+    {
+        std::printf("---- frame %llu (last %d frames, ms) ----\n", static_cast<unsigned long long>(frameIndex), HISTORY_SIZE);
+        PrintRow("frame", FrameStats());
+        for (const CpuScope& scope : cpuScopes)
+            PrintRow(scope.name.c_str(), scope.history.Compute());
+        bool fragmentCounters = false;
+        for (const GpuPass& pass : gpuPasses)
+        {
+            if (pass.target == GL_TIME_ELAPSED)
+                PrintRow(("gpu " + pass.name).c_str(), pass.history.Compute());
+            else
+                fragmentCounters = true;
+        }
+        if (!counters.empty() || fragmentCounters)
+            std::printf("---- counters (per frame) ----\n");
+        for (const Counter& counter : counters)
+            PrintRow(counter.name.c_str(), counter.history.Compute());
+        for (const GpuPass& pass : gpuPasses)
+            if (pass.target != GL_TIME_ELAPSED)
+                PrintRow(pass.name.c_str(), pass.history.Compute());
+    }
+
+    bool Tracing() const { return !tracePath.empty(); }
+
+    // Chrome trace event format: complete events for CPU scopes, counter events for GPU passes and counters
+    bool WriteTrace() const
+    {
+        if (!Tracing())
+            return false;
+        std::ofstream file(tracePath);
+        if (!file)
+        {
+            std::cout << "Failed to write trace: " << tracePath << std::endl;
+            return false;
+        }
+        file << "{\"traceEvents\":[\n";
+        bool first = true;
+        for (const TraceEvent& e : traceEvents)
+        {
+            file << (first ? "" : ",\n") << "{\"name\":\"" << cpuScopes[e.scope].name << "\",\"ph\":\"X\",\"pid\":1,\"tid\":1,\"ts\":"
+                 << e.startNs / 1000.0 << ",\"dur\":" << e.durationNs / 1000.0 << "}";
+            first = false;
+        }
+        for (const TraceCounter& c : traceCounters)
+        {
+            bool timed = c.gpu && gpuPasses[c.index].target == GL_TIME_ELAPSED;
+            const std::string& name = timed ? "gpu " + gpuPasses[c.index].name : c.gpu ? gpuPasses[c.index].name : counters[c.index].name;
+            file << (first ? "" : ",\n") << "{\"name\":\"" << name << "\",\"ph\":\"C\",\"pid\":1,\"ts\":"
+                 << c.timeNs / 1000.0 << ",\"args\":{\"" << (timed ? "ms" : "value") << "\":" << c.value << "}}";
+            first = false;
+        }
+        file << "\n]}\n";
+        std::cout << "Wrote trace: " << tracePath << std::endl;
+        return true;
+    }
+
+private:
+    using Clock = std::chrono::steady_clock;
+    static const size_t MAX_TRACE_EVENTS = 1 << 20;   // of each kind; a long trace keeps its start
+
+    // fixed ring of per-frame samples
+    struct History
+    {
+        double samples[HISTORY_SIZE] = {};
+        int count = 0;
+        int next = 0;
+
+        void Push(double value)
+        {
+            samples[next] = value;
+            next = (next + 1) % HISTORY_SIZE;
+            count = std::min(count + 1, HISTORY_SIZE);
+        }
+
+        Stats Compute() const
+        {
+            Stats stats;
+            if (count == 0)
+                return stats;
+            std::vector<double> sorted(samples, samples + count);
+            std::sort(sorted.begin(), sorted.end());
+            double sum = 0.0;
+            for (double s : sorted)
+                sum += s;
+            stats.minMs = sorted.front();
+            stats.avgMs = sum / count;
+            stats.p99Ms = sorted[static_cast<size_t>(0.99 * (count - 1) + 0.5)];
+            return stats;
+        }
+    };
+
+    struct CpuScope
+    {
+        std::string name;
+        int64_t frameNs = 0;
+        History history;
+    };
+
+    struct GpuPass
+    {
+        std::string name;
+        GLenum target = GL_TIME_ELAPSED;
+        GLuint queries[QUERY_RING_SIZE] = {};
+        bool issued[QUERY_RING_SIZE] = {};
+        History history;
+    };
+
+    struct TraceEvent
+    {
+        int scope;
+        int64_t startNs;
+        int64_t durationNs;
+    };
+
+    struct Counter
+    {
+        std::string name;
+        double value = 0.0;
+        History history;
+    };
+
+    struct TraceCounter
+    {
+        bool gpu;
+        int index;
+        int64_t timeNs;
+        double value;
+    };
+
+    int64_t Now() const
+    {
+        return std::chrono::duration_cast<std::chrono::nanoseconds>(Clock::now() - origin).count();
+    }
+
+    static void PrintRow(const char* name, const Stats& stats)
+    {
+        std::printf("%-20s min %8.3f  avg %8.3f  p99 %8.3f\n", name, stats.minMs, stats.avgMs, stats.p99Ms);
+    }
+
+    Clock::time_point origin;
+    int64_t frameStart = 0;
+    uint64_t frameIndex = 0;
+    uint64_t printInterval = 0;
+    History frameHistory;
+
+    std::vector<CpuScope> cpuScopes;
+    std::vector<GpuPass> gpuPasses;
+    std::vector<Counter> counters;
+
+    std::string tracePath;
+    std::vector<TraceEvent> traceEvents;
+    std::vector<TraceCounter> traceCounters;
+};
+
+// times the enclosing block into a registered CPU scope
+class ProfileScope
+{
+public:
+    ProfileScope(FrameProfiler& profiler, int scope) : profiler(profiler), scope(scope), start(profiler.BeginScope()) {}
+    ~ProfileScope() { profiler.EndScope(scope, start); }
+
+private:
+    FrameProfiler& profiler;
+    int scope;
+    int64_t start;
+};
+
+// times the enclosing block into a registered GPU pass (or counts its fragments)
+class ProfileGpuPass
+{
+public:
+    ProfileGpuPass(FrameProfiler& profiler, int pass) : profiler(profiler), pass(pass) { profiler.BeginGpu(pass); }
+    ~ProfileGpuPass() { profiler.EndGpu(pass); }
+
+private:
+    FrameProfiler& profiler;
+    int pass;
+};
+
+#endif
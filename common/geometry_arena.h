@@ -0,0 +1,444 @@
+#ifndef GEOMETRY_ARENA_H
+#define GEOMETRY_ARENA_H
+
+// One vertex buffer and one index buffer per vertex format, shared by every
+// mesh of that format. Meshes are sub-allocated ranges drawn with
+// glDrawElementsBaseVertex, so drawing a whole scene binds one VAO instead of
+// one per mesh.
+//
+// OffsetAllocator hands out [offset, offset + size) ranges of a fixed
+// capacity: best fit from a free list, neighbours merged on free. Defragment
+// slides every live range down to the start and returns the moves, which
+// GeometryArena replays with glCopyBufferSubData into fresh buffers. Indices
+// are stored relative to their range's base vertex, so moving vertices never
+// rewrites indices. Callers keep arena handles, not offsets, because offsets
+// change on Defragment.
+
+#include <glad/glad.h>
+
+#include <cstdint>
+#include <iostream>
+#include <map>
+#include <random>
+#include <vector>
+
+class OffsetAllocator
+{
+public:
+    static const uint32_t INVALID = 0xFFFFFFFFu;
+
+    struct Move
+    {
+        uint32_t from;
+        uint32_t to;
+        uint32_t size;
+    };
+
+    explicit OffsetAllocator(uint32_t capacity = 0) { Reset(capacity); }
+
+    // forget every allocation; the whole capacity is one free block
+    void Reset(uint32_t newCapacity)
+    {
+        capacity = newCapacity;
+        used.clear();
+        freeByOffset.clear();
+        freeBySize.clear();
+        usedSize = 0;
+        if (capacity > 0)
+            AddFree(0, capacity);
+    }
+
+    // smallest free block that fits; INVALID when none does (or size is 0)
+    uint32_t Allocate(uint32_t size)
+    {
+        if (size == 0)
+            return INVALID;
+        auto fit = freeBySize.lower_bound(size);
+        if (fit == freeBySize.end())
+            return INVALID;
+        uint32_t blockSize = fit->first, offset = fit->second;
+        RemoveFree(offset, blockSize);
+        if (blockSize > size)
+            AddFree(offset + size, blockSize - size);
+        used[offset] = size;
+        usedSize += size;
+        return offset;
+    }
+
+    // offset must come from Allocate; the block merges with free neighbours
+    void Free(uint32_t offset)
+    {
+        auto found = used.find(offset);
+        if (found == used.end())
+            return;
+        uint32_t size = found->second;
+        used.erase(found);
+        usedSize -= size;
+
+        auto next = freeByOffset.find(offset + size);
+        if (next != freeByOffset.end())
+        {
+            uint32_t nextSize = next->second;
+            RemoveFree(next->first, nextSize);
+            size += nextSize;
+        }
+        auto previous = freeByOffset.lower_bound(offset);
+        if (previous != freeByOffset.begin())
+        {
+            --previous;
+            if (previous->first + previous->second == offset)
+            {
+                uint32_t previousOffset = previous->first;
+                size += previous->second;
+                RemoveFree(previousOffset, previous->second);
+                offset = previousOffset;
+            }
+        }
+        AddFree(offset, size);
+    }
+
+    // pack live blocks from offset 0 in their current order; every live block is
+    // listed (to == from for those that stay) so the caller can rebuild storage
+    std::vector<Move> Defragment()
+    {
+        std::vector<Move> moves;
+        moves.reserve(used.size());
+        std::map<uint32_t, uint32_t> packed;
+        uint32_t next = 0;
+        for (const auto& block : used)
+        {
+            moves.push_back({ block.first, next, block.second });
+            packed[next] = block.second;
+            next += block.second;
+        }
+        used.swap(packed);
+        freeByOffset.clear();
+        freeBySize.clear();
+        if (next < capacity)
+            AddFree(next, capacity - next);
+        return moves;
+    }
+
+    uint32_t Capacity() const { return capacity; }
+    uint32_t UsedSize() const { return usedSize; }
+    uint32_t FreeSize() const { return capacity - usedSize; }
+    uint32_t LargestFreeBlock() const { return freeBySize.empty() ? 0 : freeBySize.rbegin()->first; }
+    int AllocationCount() const { return static_cast<int>(used.size()); }
+    int FreeBlockCount() const { return static_cast<int>(freeByOffset.size()); }
+
+    // size of the block at offset, 0 when it isn't allocated
+    uint32_t SizeOf(uint32_t offset) const
+    {
+        auto found = used.find(offset);
+        return found == used.end() ? 0 : found->second;
+    }
+
+    const std::map<uint32_t, uint32_t>& Allocations() const { return used; }
+
+private:
+    void AddFree(uint32_t offset, uint32_t size)
+    {
+        freeByOffset[offset] = size;
+        freeBySize.emplace(size, offset);
+    }
+
+    void RemoveFree(uint32_t offset, uint32_t size)
+    {
+        freeByOffset.erase(offset);
+        auto range = freeBySize.equal_range(size);
+        for (auto it = range.first; it != range.second; ++it)
+            if (it->second == offset)
+            {
+                freeBySize.erase(it);
+                break;
+            }
+    }
+
+    uint32_t capacity = 0;
+    uint32_t usedSize = 0;
+    std::map<uint32_t, uint32_t> used;               // offset -> size
+    std::map<uint32_t, uint32_t> freeByOffset;       // offset -> size
+    std::multimap<uint32_t, uint32_t> freeBySize;    // size -> offset
+};
+
+// random allocate/free/defragment against a byte-per-unit owner map. Checks that blocks
+// stay in bounds and never overlap, that sizes add up, that freeing everything leaves
+// one free block, and that defragmenting keeps every block's contents and leaves at
+// most one free block. Returns the number of failures, printing each
+struct OffsetAllocatorStats
+{
+    int allocations = 0;
+    int failedAllocations = 0;
+    int defragments = 0;
+    int largestFreeBlocks = 0;   // most free blocks seen between defragments
+};
+
+inline int CheckOffsetAllocator(int operations, uint32_t capacity, unsigned seed, OffsetAllocatorStats& stats)
+{
+    int failures = 0;
+    auto fail = [&](int step, const char* what) {
+        if (failures < 10)
+            std::cout << "offset allocator step " << step << ": " << what << std::endl;
+        ++failures;
+    };
+
+    OffsetAllocator allocator(capacity);
+    std::vector<int> owner(capacity, -1);    // which live block owns each unit
+    std::map<int, uint32_t> live;            // block id -> offset
+    std::mt19937 random(seed);
+    int nextId = 0;
+    for (int step = 0; step < operations; ++step)
+    {
+        uint32_t roll = random() % 100;
+        if (roll < 55 || live.empty())
+        {
+            uint32_t size = 1 + random() % (capacity / 16);
+            uint32_t offset = allocator.Allocate(size);
+            if (offset == OffsetAllocator::INVALID)
+            {
+                ++stats.failedAllocations;
+                if (allocator.LargestFreeBlock() >= size)
+                    fail(step, "allocation failed with a large enough free block");
+                continue;
+            }
+            ++stats.allocations;
+            if (offset + size > capacity)
+            {
+                fail(step, "block out of bounds");
+                continue;
+            }
+            for (uint32_t i = offset; i < offset + size; ++i)
+            {
+                if (owner[i] != -1)
+                {
+                    fail(step, "blocks overlap");
+                    break;
+                }
+                owner[i] = nextId;
+            }
+            live[nextId++] = offset;
+        }
+        else if (roll < 97)
+        {
+            auto victim = live.begin();
+            std::advance(victim, random() % live.size());
+            uint32_t size = allocator.SizeOf(victim->second);
+            for (uint32_t i = victim->second; i < victim->second + size; ++i)
+                owner[i] = -1;
+            allocator.Free(victim->second);
+            live.erase(victim);
+        }
+        else
+        {
+            ++stats.defragments;
+            std::vector<int> packed(capacity, -1);
+            for (const OffsetAllocator::Move& move : allocator.Defragment())
+                for (uint32_t i = 0; i < move.size; ++i)
+                    packed[move.to + i] = owner[move.from + i];
+            owner.swap(packed);
+            for (auto& block : live)
+            {
+                uint32_t offset = capacity;
+                for (uint32_t i = 0; i < capacity && offset == capacity; ++i)
+                    if (owner[i] == block.first)
+                        offset = i;
+                if (offset == capacity || allocator.SizeOf(offset) == 0)
+                    fail(step, "block lost by defragment");
+                block.second = offset;
+            }
+            if (allocator.FreeBlockCount() > 1)
+                fail(step, "free space not contiguous after defragment");
+        }
+
+        stats.largestFreeBlocks = std::max(stats.largestFreeBlocks, allocator.FreeBlockCount());
+        uint32_t owned = 0;
+        for (int unit : owner)
+            owned += unit != -1;
+        if (owned != allocator.UsedSize() || allocator.AllocationCount() != static_cast<int>(live.size()))
+            fail(step, "used size disagrees with live blocks");
+    }
+
+    for (const auto& block : live)
+        allocator.Free(block.second);
+    if (allocator.FreeBlockCount() != 1 || allocator.LargestFreeBlock() != capacity)
+        fail(operations, "free space not merged back into one block");
+    return failures;
+}
+
+template <typename VertexType>
+class GeometryArena
+{
+public:
+    // a mesh's place in the arena, for glDrawElementsBaseVertex
+    struct Range
+    {
+        uint32_t firstIndex = 0;
+        uint32_t indexCount = 0;
+        uint32_t baseVertex = 0;
+        uint32_t vertexCount = 0;
+        bool live = false;
+    };
+
+    // setupAttributes describes VertexType with glVertexAttribPointer while the arena's
+    // VAO and vertex buffer are bound
+    bool Init(uint32_t vertexCapacity, uint32_t indexCapacity, void (*setupAttributes)())
+    {
+        setup = setupAttributes;
+        vertexSpace.Reset(vertexCapacity);
+        indexSpace.Reset(indexCapacity);
+        glGenVertexArrays(1, &vao);
+        vbo = CreateBuffer(static_cast<size_t>(vertexCapacity) * sizeof(VertexType));
+        ebo = CreateBuffer(static_cast<size_t>(indexCapacity) * sizeof(unsigned int));
+        AttachBuffers();
+        return vao != 0;
+    }
+
+    // copies the mesh in; -1 when either buffer has no block large enough
+    int Add(const VertexType* vertices, uint32_t vertexCount, const unsigned int* indices, uint32_t indexCount)
+    {
+        uint32_t baseVertex = vertexSpace.Allocate(vertexCount);
+        if (baseVertex == OffsetAllocator::INVALID)
+            return -1;
+        uint32_t firstIndex = indexSpace.Allocate(indexCount);
+        if (firstIndex == OffsetAllocator::INVALID)
+        {
+            vertexSpace.Free(baseVertex);
+            return -1;
+        }
+
+        glBindBuffer(GL_ARRAY_BUFFER, vbo);
+        glBufferSubData(GL_ARRAY_BUFFER, static_cast<GLintptr>(baseVertex) * sizeof(VertexType), vertexCount * sizeof(VertexType), vertices);
+        glBindBuffer(GL_ARRAY_BUFFER, 0);
+        glBindBuffer(GL_COPY_WRITE_BUFFER, ebo);
+        glBufferSubData(GL_COPY_WRITE_BUFFER, static_cast<GLintptr>(firstIndex) * sizeof(unsigned int), indexCount * sizeof(unsigned int), indices);
+        glBindBuffer(GL_COPY_WRITE_BUFFER, 0);
+
+        Range range;
+        range.firstIndex = firstIndex;
+        range.indexCount = indexCount;
+        range.baseVertex = baseVertex;
+        range.vertexCount = vertexCount;
+        range.live = true;
+        int handle;
+        if (!freeHandles.empty())
+        {
+            handle = freeHandles.back();
+            freeHandles.pop_back();
+            ranges[handle] = range;
+        }
+        else
+        {
+            handle = static_cast<int>(ranges.size());
+            ranges.push_back(range);
+        }
+        return handle;
+    }
+
+    void Remove(int handle)
+    {
+        if (handle < 0 || handle >= static_cast<int>(ranges.size()) || !ranges[handle].live)
+            return;
+        vertexSpace.Free(ranges[handle].baseVertex);
+        indexSpace.Free(ranges[handle].firstIndex);
+        ranges[handle] = Range();
+        freeHandles.push_back(handle);
+    }
+
+    // compact both buffers so all free space is one block at the end
+    void Defragment()
+    {
+        std::vector<OffsetAllocator::Move> vertexMoves = vertexSpace.Defragment();
+        std::vector<OffsetAllocator::Move> indexMoves = indexSpace.Defragment();
+        Relocate(vbo, vertexSpace.Capacity(), sizeof(VertexType), vertexMoves);
+        Relocate(ebo, indexSpace.Capacity(), sizeof(unsigned int), indexMoves);
+        AttachBuffers();
+
+        std::map<uint32_t, uint32_t> vertexTo, indexTo;
+        for (const OffsetAllocator::Move& move : vertexMoves)
+            vertexTo[move.from] = move.to;
+        for (const OffsetAllocator::Move& move : indexMoves)
+            indexTo[move.from] = move.to;
+        for (Range& range : ranges)
+            if (range.live)
+            {
+                range.baseVertex = vertexTo[range.baseVertex];
+                range.firstIndex = indexTo[range.firstIndex];
+            }
+    }
+
+    const Range& Get(int handle) const { return ranges[handle]; }
+    unsigned int Vao() const { return vao; }
+    unsigned int VertexBuffer() const { return vbo; }
+    unsigned int IndexBuffer() const { return ebo; }
+
+    const OffsetAllocator& Vertices() const { return vertexSpace; }
+    const OffsetAllocator& Indices() const { return indexSpace; }
+
+    size_t Bytes() const
+    {
+        return static_cast<size_t>(vertexSpace.Capacity()) * sizeof(VertexType) + static_cast<size_t>(indexSpace.Capacity()) * sizeof(unsigned int);
+    }
+
+    void Release()
+    {
+        if (vao)
+            glDeleteVertexArrays(1, &vao);
+        if (vbo)
+            glDeleteBuffers(1, &vbo);
+        if (ebo)
+            glDeleteBuffers(1, &ebo);
+        vao = vbo = ebo = 0;
+        ranges.clear();
+        freeHandles.clear();
+        vertexSpace.Reset(0);
+        indexSpace.Reset(0);
+    }
+
+private:
+    // storage only; glBufferData through the copy target so no VAO's element binding changes
+    static unsigned int CreateBuffer(size_t bytes)
+    {
+        unsigned int buffer;
+        glGenBuffers(1, &buffer);
+        glBindBuffer(GL_COPY_WRITE_BUFFER, buffer);
+        glBufferData(GL_COPY_WRITE_BUFFER, bytes, NULL, GL_STATIC_DRAW);
+        glBindBuffer(GL_COPY_WRITE_BUFFER, 0);
+        return buffer;
+    }
+
+    void AttachBuffers()
+    {
+        glBindVertexArray(vao);
+        glBindBuffer(GL_ARRAY_BUFFER, vbo);
+        setup();
+        glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, ebo);
+        glBindVertexArray(0);
+        glBindBuffer(GL_ARRAY_BUFFER, 0);
+    }
+
+    // copy live blocks into a new buffer at their packed offsets (ranges may overlap
+    // their old place, which glCopyBufferSubData forbids within one buffer)
+    static void Relocate(unsigned int& buffer, uint32_t capacity, size_t stride, const std::vector<OffsetAllocator::Move>& moves)
+    {
+        unsigned int packed = CreateBuffer(static_cast<size_t>(capacity) * stride);
+        glBindBuffer(GL_COPY_READ_BUFFER, buffer);
+        glBindBuffer(GL_COPY_WRITE_BUFFER, packed);
+        for (const OffsetAllocator::Move& move : moves)
+            glCopyBufferSubData(GL_COPY_READ_BUFFER, GL_COPY_WRITE_BUFFER, move.from * stride, move.to * stride, move.size * stride);
+        glBindBuffer(GL_COPY_READ_BUFFER, 0);
+        glBindBuffer(GL_COPY_WRITE_BUFFER, 0);
+        glDeleteBuffers(1, &buffer);
+        buffer = packed;
+    }
+
+    unsigned int vao = 0;
+    unsigned int vbo = 0;
+    unsigned int ebo = 0;
+    void (*setup)() = nullptr;
+    OffsetAllocator vertexSpace;
+    OffsetAllocator indexSpace;
+    std::vector<Range> ranges;
+    std::vector<int> freeHandles;
+};
+
+#endif
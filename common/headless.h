@@ -0,0 +1,335 @@
+#ifndef HEADLESS_H
+#define HEADLESS_H
+
+// Shared helpers for running a demo's update logic without a window:
+// command line options, recorded input playback, frame timing statistics and an
+// offscreen context for demos that need GL to load their assets. That context
+// needs a build with HEADLESS_EGL defined (and libEGL linked).
+
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <string>
+#include <vector>
+
+#include <glad/glad.h>
+#include <GLFW/glfw3.h>
+
+#ifdef HEADLESS_EGL
+#include <EGL/egl.h>
+#include <EGL/eglext.h>
+#endif
+
+// keys the demos react to, packed into InputFrame::keys
+enum InputKeyBits : uint32_t
+{
+    INPUT_KEY_W     = 1 << 0,
+    INPUT_KEY_S     = 1 << 1,
+    INPUT_KEY_A     = 1 << 2,
+    INPUT_KEY_D     = 1 << 3,
+    INPUT_KEY_Z     = 1 << 4,
+    INPUT_KEY_X     = 1 << 5,
+    INPUT_KEY_SHIFT = 1 << 6
+};
+
+struct InputFrame
+{
+    uint32_t keys = 0;
+    float mouseDx = 0.0f;
+    float mouseDy = 0.0f;
+};
+
+// per-frame input stream. Only frames that differ from the previous one are stored;
+// keys carry over to following frames while mouse deltas apply to their frame only
+// ----------------------------------------------------------------------------------
+class InputRecording
+{
+public:
+    void Push(uint64_t frame, const InputFrame& input)
+    {
+        bool sameKeys = !events.empty() && events.back().input.keys == input.keys;
+        if (sameKeys && input.mouseDx == 0.0f && input.mouseDy == 0.0f)
+            return;
+        events.push_back({ frame, input });
+    }
+
+    // input for the given frame; frames must be queried in increasing order
+    InputFrame At(uint64_t frame)
+    {
+        InputFrame result;
+        while (cursor < events.size() && events[cursor].frame <= frame)
+        {
+            lastKeys = events[cursor].input.keys;
+            if (events[cursor].frame == frame)
+            {
+                result.mouseDx = events[cursor].input.mouseDx;
+                result.mouseDy = events[cursor].input.mouseDy;
+            }
+            ++cursor;
+        }
+        result.keys = lastKeys;
+        return result;
+    }
+
+    void Rewind()
+    {
+        cursor = 0;
+        lastKeys = 0;
+    }
+
+    // frames the recording covers: the last recorded event's frame index + 1
+    uint64_t Length() const { return events.empty() ? 0 : events.back().frame + 1; }
+
+    bool Save(const std::string& path) const
+    {
+        std::ofstream file(path);
+        if (!file)
+        {
+            std::cout << "Failed to write input recording: " << path << std::endl;
+            return false;
+        }
+        file << "# frame keys mouseDx mouseDy\n";
+        for (const Event& e : events)
+            file << e.frame << " " << e.input.keys << " " << e.input.mouseDx << " " << e.input.mouseDy << "\n";
+        return true;
+    }
+
+    bool Load(const std::string& path)
+    {
+        std::ifstream file(path);
+        if (!file)
+        {
+            std::cout << "Failed to read input recording: " << path << std::endl;
+            return false;
+        }
+        events.clear();
+        Rewind();
+        std::string line;
+        while (std::getline(file, line))
+        {
+            if (line.empty() || line[0] == '#')
+                continue;
+            unsigned long long frame = 0;
+            Event e;
+            if (std::sscanf(line.c_str(), "%llu %u %f %f", &frame, &e.input.keys, &e.input.mouseDx, &e.input.mouseDy) >= 2)
+            {
+                e.frame = frame;
+                events.push_back(e);
+            }
+        }
+        return true;
+    }
+
+private:
+    struct Event
+    {
+        uint64_t frame = 0;
+        InputFrame input;
+    };
+
+    std::vector<Event> events;
+    size_t cursor = 0;
+    uint32_t lastKeys = 0;
+};
+
+// command line: --headless [--input <file>] [--frames <n>] [--dt <seconds>], --record-input <file>
+// ------------------------------------------------------------------------------------------------
+struct HeadlessOptions
+{
+    bool enabled = false;
+    std::string inputPath;
+    std::string recordPath;
+    uint64_t frames = 600;
+    float dt = 1.0f / 60.0f;
+};
+
+inline HeadlessOptions ParseHeadlessOptions(int argc, char** argv)
+{
+    HeadlessOptions options;
+    for (int i = 1; i < argc; ++i)
+    {
+        if (std::strcmp(argv[i], "--headless") == 0)
+            options.enabled = true;
+        else if (std::strcmp(argv[i], "--input") == 0 && i + 1 < argc)
+            options.inputPath = argv[++i];
+        else if (std::strcmp(argv[i], "--record-input") == 0 && i + 1 < argc)
+            options.recordPath = argv[++i];
+        else if (std::strcmp(argv[i], "--frames") == 0 && i + 1 < argc)
+            options.frames = std::strtoull(argv[++i], nullptr, 10);
+        else if (std::strcmp(argv[i], "--dt") == 0 && i + 1 < argc)
+            options.dt = static_cast<float>(std::atof(argv[++i]));
+    }
+    return options;
+}
+
+// collects per-frame durations and prints min/avg/p50/p99/max
+// ------------------------------------------------------------
+class TimingStats
+{
+public:
+    using Clock = std::chrono::steady_clock;
+
+    explicit TimingStats(const std::string& name) : name(name) {}
+
+    void Reserve(size_t count) { samples.reserve(count); }
+    void Add(double nanoseconds) { samples.push_back(nanoseconds); }
+    size_t Count() const { return samples.size(); }
+
+    double Percentile(double p) const
+    {
+        if (samples.empty())
+            return 0.0;
+        std::vector<double> sorted = samples;
+        std::sort(sorted.begin(), sorted.end());
+        size_t index = static_cast<size_t>(p * (sorted.size() - 1) + 0.5);
+        return sorted[std::min(index, sorted.size() - 1)];
+    }
+
+    double Average() const
+    {
+        if (samples.empty())
+            return 0.0;
+        double sum = 0.0;
+        for (double s : samples)
+            sum += s;
+        return sum / samples.size();
+    }
+
+    void Print() const
+    {
+        std::printf("%-24s frames %6zu  min %10.0f ns  avg %10.0f ns  p50 %10.0f ns  p99 %10.0f ns  max %10.0f ns\n",
+            name.c_str(), samples.size(), Percentile(0.0), Average(), Percentile(0.5), Percentile(0.99), Percentile(1.0));
+    }
+
+private:
+    std::string name;
+    std::vector<double> samples;
+};
+
+// times one scope into a TimingStats
+class ScopedTimer
+{
+public:
+    explicit ScopedTimer(TimingStats& stats) : stats(stats), start(TimingStats::Clock::now()) {}
+    ~ScopedTimer()
+    {
+        stats.Add(std::chrono::duration<double, std::nano>(TimingStats::Clock::now() - start).count());
+    }
+
+private:
+    TimingStats& stats;
+    TimingStats::Clock::time_point start;
+};
+
+// offscreen GL 3.3 core context for headless runs that still need GL (mesh upload,
+// texture creation), on Mesa's surfaceless EGL platform, which works on llvmpipe
+// without a GPU or display. Without HEADLESS_EGL creating one fails: a hidden window
+// would still need a display and isn't headless
+// -----------------------------------------------------------------------------------
+struct OffscreenContext
+{
+#ifdef HEADLESS_EGL
+    EGLDisplay display = EGL_NO_DISPLAY;
+    EGLContext context = EGL_NO_CONTEXT;
+#endif
+};
+
+inline bool CreateOffscreenContext(OffscreenContext& out)
+{
+#ifdef HEADLESS_EGL
+    auto getPlatformDisplay = (PFNEGLGETPLATFORMDISPLAYEXTPROC)eglGetProcAddress("eglGetPlatformDisplayEXT");
+    if (getPlatformDisplay)
+        out.display = getPlatformDisplay(EGL_PLATFORM_SURFACELESS_MESA, EGL_DEFAULT_DISPLAY, NULL);
+    if (out.display == EGL_NO_DISPLAY)
+        out.display = eglGetDisplay(EGL_DEFAULT_DISPLAY);
+    if (out.display == EGL_NO_DISPLAY || !eglInitialize(out.display, NULL, NULL))
+    {
+        std::cout << "Failed to initialize EGL display" << std::endl;
+        return false;
+    }
+
+    const EGLint configAttribs[] = {
+        EGL_SURFACE_TYPE, EGL_PBUFFER_BIT,
+        EGL_RENDERABLE_TYPE, EGL_OPENGL_BIT,
+        EGL_NONE
+    };
+    EGLConfig config;
+    EGLint configCount = 0;
+    if (!eglChooseConfig(out.display, configAttribs, &config, 1, &configCount) || configCount == 0)
+    {
+        std::cout << "Failed to choose EGL config" << std::endl;
+        return false;
+    }
+
+    eglBindAPI(EGL_OPENGL_API);
+    const EGLint contextAttribs[] = {
+        EGL_CONTEXT_MAJOR_VERSION, 3,
+        EGL_CONTEXT_MINOR_VERSION, 3,
+        EGL_CONTEXT_OPENGL_PROFILE_MASK, EGL_CONTEXT_OPENGL_CORE_PROFILE_BIT,
+        EGL_NONE
+    };
+    out.context = eglCreateContext(out.display, config, EGL_NO_CONTEXT, contextAttribs);
+    if (out.context == EGL_NO_CONTEXT || !eglMakeCurrent(out.display, EGL_NO_SURFACE, EGL_NO_SURFACE, out.context))
+    {
+        std::cout << "Failed to create surfaceless EGL context" << std::endl;
+        return false;
+    }
+    GLADloadproc loader = (GLADloadproc)eglGetProcAddress;
+
+    if (!gladLoadGLLoader(loader))
+    {
+        std::cout << "Failed to initialize GLAD" << std::endl;
+        return false;
+    }
+    return true;
+#else
+    (void)out;
+    std::cout << "No offscreen GL context: build with HEADLESS_EGL defined and link libEGL" << std::endl;
+    return false;
+#endif
+}
+
+inline void DestroyOffscreenContext(OffscreenContext& ctx)
+{
+#ifdef HEADLESS_EGL
+    if (ctx.display == EGL_NO_DISPLAY)
+        return;
+    eglMakeCurrent(ctx.display, EGL_NO_SURFACE, EGL_NO_SURFACE, EGL_NO_CONTEXT);
+    if (ctx.context != EGL_NO_CONTEXT)
+        eglDestroyContext(ctx.display, ctx.context);
+    eglTerminate(ctx.display);
+#endif
+    ctx = OffscreenContext();
+}
+
+// deletes what loading a Model uploaded: each mesh's VAO and buffers, and the textures.
+// Mesh keeps its buffer names private, so they are read back from the VAO. For models
+// that are loaded and thrown away, like the model_load benchmarks. Pass false for a model
+// a TextureManager has adopted; its textures are the manager's to release
+template <typename ModelType>
+void ReleaseModel(ModelType& model, bool releaseTextures = true)
+{
+    for (auto& mesh : model.meshes)
+    {
+        GLint vertexBuffer = 0, indexBuffer = 0;
+        glBindVertexArray(mesh.VAO);
+        glGetVertexAttribiv(0, GL_VERTEX_ATTRIB_ARRAY_BUFFER_BINDING, &vertexBuffer);
+        glGetIntegerv(GL_ELEMENT_ARRAY_BUFFER_BINDING, &indexBuffer);
+        glBindVertexArray(0);
+        GLuint buffers[] = { static_cast<GLuint>(vertexBuffer), static_cast<GLuint>(indexBuffer) };
+        glDeleteBuffers(2, buffers);  // 0 is ignored
+        glDeleteVertexArrays(1, &mesh.VAO);
+        mesh.VAO = 0;
+    }
+    if (releaseTextures)
+        for (auto& texture : model.textures_loaded)
+            glDeleteTextures(1, &texture.id);
+    model.textures_loaded.clear();
+}
+
+#endif
@@ -0,0 +1,205 @@
+#ifndef MODEL_BATCH_H
+#define MODEL_BATCH_H
+
+// A whole LearnOpenGL Model as one draw. Model::Draw issues one draw per mesh
+// and binds each mesh's textures by name in between; here every mesh's
+// vertices and indices are appended to one buffer pair, and each vertex
+// carries the array texture layer of its mesh's diffuse texture.
+//
+// The demos target GL 3.3, which has neither glMultiDrawElementsIndirect
+// (gl_DrawID) nor bindless textures, so the material index is a vertex
+// attribute and the merged index buffer is drawn with one glDrawElements.
+// Meshes of a LearnOpenGL Model share the model's space (node transforms are
+// not applied at load), so merging them doesn't move anything.
+//
+// Vertex layout: 0 position, 1 normal, 2 texcoords, MATERIAL_ATTRIBUTE layer.
+// Mesh VAOs leave MATERIAL_ATTRIBUTE disabled, so the same vertex shader
+// reads layer 0 there.
+//
+// With a GeometryArena<BatchVertex> a batched model is one range of the shared
+// buffers instead of owning a VAO; AddModelToArena puts a model's meshes there
+// unmerged, one range each, for per-mesh draws that still share one VAO.
+
+#include <glad/glad.h>
+#include <glm/glm.hpp>
+#include <stb_image.h>
+
+#include "texture_manager.h"
+#include "geometry_arena.h"
+
+#include <algorithm>
+#include <cstddef>
+#include <iostream>
+#include <map>
+#include <string>
+#include <vector>
+
+const int MATERIAL_ATTRIBUTE = 7;  // clear of the Mesh attributes (0-6)
+
+struct BatchVertex
+{
+    glm::vec3 position;
+    glm::vec3 normal;
+    glm::vec2 texCoords;
+    float material;      // array texture layer
+};
+
+// position, normal, texcoords and layer of BatchVertex, for the bound VAO and vertex buffer
+inline void SetupBatchVertexAttributes()
+{
+    glEnableVertexAttribArray(0);
+    glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, sizeof(BatchVertex), (void*)offsetof(BatchVertex, position));
+    glEnableVertexAttribArray(1);
+    glVertexAttribPointer(1, 3, GL_FLOAT, GL_FALSE, sizeof(BatchVertex), (void*)offsetof(BatchVertex, normal));
+    glEnableVertexAttribArray(2);
+    glVertexAttribPointer(2, 2, GL_FLOAT, GL_FALSE, sizeof(BatchVertex), (void*)offsetof(BatchVertex, texCoords));
+    glEnableVertexAttribArray(MATERIAL_ATTRIBUTE);
+    glVertexAttribPointer(MATERIAL_ATTRIBUTE, 1, GL_FLOAT, GL_FALSE, sizeof(BatchVertex), (void*)offsetof(BatchVertex, material));
+}
+
+typedef GeometryArena<BatchVertex> BatchArena;
+
+struct BatchedModel
+{
+    unsigned int vao = 0;            // the arena's VAO when arena is set
+    unsigned int vbo = 0;
+    unsigned int ebo = 0;
+    BatchArena* arena = nullptr;
+    int arenaHandle = -1;
+    unsigned int materials = 0;      // GL_TEXTURE_2D_ARRAY, one layer per distinct diffuse texture
+    int indexCount = 0;
+    int meshCount = 0;               // draws Model::Draw would issue
+    int textureBindsPerDraw = 0;     // textures Model::Draw binds across all meshes
+    int layerCount = 0;
+};
+
+// one vertex and index list for all meshes; layerPaths gets each layer's image path in
+// layer order, "" for meshes without a diffuse texture
+template <typename ModelType>
+void MergeModelMeshes(const ModelType& model, std::vector<BatchVertex>& vertices, std::vector<unsigned int>& indices, std::vector<std::string>& layerPaths)
+{
+    vertices.clear();
+    indices.clear();
+    layerPaths.clear();
+    std::map<std::string, int> layers;
+    for (const auto& mesh : model.meshes)
+    {
+        std::string path;
+        for (const auto& texture : mesh.textures)
+            if (texture.type == "texture_diffuse")
+            {
+                path = model.directory + "/" + texture.path;
+                break;
+            }
+        auto found = layers.find(path);
+        if (found == layers.end())
+        {
+            found = layers.emplace(path, static_cast<int>(layerPaths.size())).first;
+            layerPaths.push_back(path);
+        }
+
+        unsigned int base = static_cast<unsigned int>(vertices.size());
+        for (const auto& v : mesh.vertices)
+            vertices.push_back({ v.Position, v.Normal, v.TexCoords, static_cast<float>(found->second) });
+        for (unsigned int index : mesh.indices)
+            indices.push_back(base + index);
+    }
+}
+
+// layer size: the largest side among the images, capped
+inline int MaterialLayerSize(const std::vector<std::string>& layerPaths, int maxSize)
+{
+    int size = 1;
+    for (const std::string& path : layerPaths)
+    {
+        int width, height, components;
+        if (!path.empty() && stbi_info(path.c_str(), &width, &height, &components))
+            size = std::max(size, std::max(width, height));
+    }
+    return std::min(size, maxSize);
+}
+
+template <typename ModelType>
+BatchedModel BuildBatchedModel(const ModelType& model, TextureManager& textures, const TextureOptions& options = TextureOptions(),
+                               BatchArena* arena = nullptr, int maxLayerSize = 2048)
+{
+    BatchedModel batch;
+    std::vector<BatchVertex> vertices;
+    std::vector<unsigned int> indices;
+    std::vector<std::string> layerPaths;
+    MergeModelMeshes(model, vertices, indices, layerPaths);
+
+    batch.meshCount = static_cast<int>(model.meshes.size());
+    for (const auto& mesh : model.meshes)
+        batch.textureBindsPerDraw += std::max(1, static_cast<int>(mesh.textures.size()));
+    batch.indexCount = static_cast<int>(indices.size());
+    batch.layerCount = static_cast<int>(layerPaths.size());
+    batch.materials = textures.LoadArray(layerPaths, MaterialLayerSize(layerPaths, maxLayerSize), options);
+
+    if (arena)
+    {
+        batch.arenaHandle = arena->Add(vertices.data(), static_cast<uint32_t>(vertices.size()), indices.data(), static_cast<uint32_t>(indices.size()));
+        if (batch.arenaHandle >= 0)
+        {
+            batch.arena = arena;
+            batch.vao = arena->Vao();
+            return batch;
+        }
+        std::cout << "Geometry arena full, batched model gets its own buffers" << std::endl;
+    }
+
+    glGenVertexArrays(1, &batch.vao);
+    glGenBuffers(1, &batch.vbo);
+    glGenBuffers(1, &batch.ebo);
+    glBindVertexArray(batch.vao);
+    glBindBuffer(GL_ARRAY_BUFFER, batch.vbo);
+    glBufferData(GL_ARRAY_BUFFER, vertices.size() * sizeof(BatchVertex), vertices.data(), GL_STATIC_DRAW);
+    glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, batch.ebo);
+    glBufferData(GL_ELEMENT_ARRAY_BUFFER, indices.size() * sizeof(unsigned int), indices.data(), GL_STATIC_DRAW);
+    SetupBatchVertexAttributes();
+    glBindVertexArray(0);
+    return batch;
+}
+
+// one arena range per mesh, in mesh order (-1 for a mesh that didn't fit), layer 0 throughout
+template <typename ModelType>
+std::vector<int> AddModelToArena(const ModelType& model, BatchArena& arena)
+{
+    std::vector<int> handles;
+    std::vector<BatchVertex> vertices;
+    for (const auto& mesh : model.meshes)
+    {
+        vertices.clear();
+        for (const auto& v : mesh.vertices)
+            vertices.push_back({ v.Position, v.Normal, v.TexCoords, 0.0f });
+        handles.push_back(arena.Add(vertices.data(), static_cast<uint32_t>(vertices.size()), mesh.indices.data(), static_cast<uint32_t>(mesh.indices.size())));
+    }
+    return handles;
+}
+
+// vertices and indices a model needs in an arena, merged or per mesh alike
+template <typename ModelType>
+void CountModelGeometry(const ModelType& model, uint32_t& vertexCount, uint32_t& indexCount)
+{
+    for (const auto& mesh : model.meshes)
+    {
+        vertexCount += static_cast<uint32_t>(mesh.vertices.size());
+        indexCount += static_cast<uint32_t>(mesh.indices.size());
+    }
+}
+
+inline void ReleaseBatchedModel(BatchedModel& batch, TextureManager& textures)
+{
+    if (batch.arena)
+        batch.arena->Remove(batch.arenaHandle);
+    else
+    {
+        glDeleteVertexArrays(1, &batch.vao);
+        glDeleteBuffers(1, &batch.vbo);
+        glDeleteBuffers(1, &batch.ebo);
+    }
+    textures.Release(batch.materials);
+    batch = BatchedModel();
+}
+
+#endif
@@ -0,0 +1,365 @@
+#ifndef OCCLUSION_CULLING_H
+#define OCCLUSION_CULLING_H
+
+// Occlusion culling for large objects (islands) behind each other.
+//
+// OcclusionQueries is the GPU side. Each frame the objects that were visible
+// last frame are drawn as usual. Then every object's world box is drawn
+// (no colour or depth writes) inside a GL_ANY_SAMPLES_PASSED query against the
+// depth that scene left behind. Objects that were hidden last frame are drawn
+// under conditional rendering on that query, so one that comes into view
+// appears the same frame without a CPU stall. Results are read back a frame
+// late and decide next frame's visible set.
+//
+// DepthRaster and HiZPyramid are the same test in software: triangles are
+// rasterized to a small depth buffer, reduced into a max-depth pyramid, and a
+// box is occluded when its nearest depth is behind the farthest depth of the
+// few pyramid texels that cover it. BoxOccludedExact is the per-pixel test
+// they are checked against.
+
+#include <glad/glad.h>
+#include <glm/glm.hpp>
+#include <glm/gtc/matrix_transform.hpp>
+#include <glm/gtc/type_ptr.hpp>
+
+#include <algorithm>
+#include <cmath>
+#include <vector>
+
+// screen rectangle and nearest depth of a box's projection
+struct ProjectedBox
+{
+    bool crossesNearPlane = false;   // some corner behind the camera: treat as visible
+    glm::vec2 min = glm::vec2(0.0f); // normalized device coordinates
+    glm::vec2 max = glm::vec2(0.0f);
+    float nearestDepth = 1.0f;       // window depth, [0, 1]
+};
+
+inline ProjectedBox ProjectBox(const glm::vec3& boxMin, const glm::vec3& boxMax, const glm::mat4& viewProjection)
+{
+    ProjectedBox out;
+    out.min = glm::vec2(1.0e30f);
+    out.max = glm::vec2(-1.0e30f);
+    for (int i = 0; i < 8; ++i)
+    {
+        glm::vec3 corner((i & 1) ? boxMax.x : boxMin.x, (i & 2) ? boxMax.y : boxMin.y, (i & 4) ? boxMax.z : boxMin.z);
+        glm::vec4 clip = viewProjection * glm::vec4(corner, 1.0f);
+        if (clip.w <= 1.0e-5f)
+        {
+            out.crossesNearPlane = true;
+            return out;
+        }
+        glm::vec3 ndc = glm::vec3(clip) / clip.w;
+        out.min = glm::min(out.min, glm::vec2(ndc.x, ndc.y));
+        out.max = glm::max(out.max, glm::vec2(ndc.x, ndc.y));
+        out.nearestDepth = std::min(out.nearestDepth, ndc.z * 0.5f + 0.5f);
+    }
+    return out;
+}
+
+// CPU depth buffer; depth is window depth in [0, 1], cleared to the far plane
+// ---------------------------------------------------------------------------
+class DepthRaster
+{
+public:
+    DepthRaster(int width, int height) : width(width), height(height), depth(static_cast<size_t>(width) * height, 1.0f) {}
+
+    void Clear() { std::fill(depth.begin(), depth.end(), 1.0f); }
+
+    // triangles reaching behind the camera are skipped: a missing occluder only
+    // makes culling less aggressive, never wrong
+    void RasterizeTriangle(const glm::vec4& c0, const glm::vec4& c1, const glm::vec4& c2)
+    {
+        if (c0.w <= 1.0e-5f || c1.w <= 1.0e-5f || c2.w <= 1.0e-5f)
+            return;
+        glm::vec3 p[3] = { ToWindow(c0), ToWindow(c1), ToWindow(c2) };
+        float area = Edge(p[0], p[1], p[2]);
+        if (std::fabs(area) < 1.0e-12f)
+            return;
+
+        int x0 = std::max(0, static_cast<int>(std::floor(std::min({ p[0].x, p[1].x, p[2].x }))));
+        int x1 = std::min(width - 1, static_cast<int>(std::ceil(std::max({ p[0].x, p[1].x, p[2].x }))));
+        int y0 = std::max(0, static_cast<int>(std::floor(std::min({ p[0].y, p[1].y, p[2].y }))));
+        int y1 = std::min(height - 1, static_cast<int>(std::ceil(std::max({ p[0].y, p[1].y, p[2].y }))));
+        for (int y = y0; y <= y1; ++y)
+            for (int x = x0; x <= x1; ++x)
+            {
+                // pixel centre; both windings are filled
+                glm::vec3 s(x + 0.5f, y + 0.5f, 0.0f);
+                float w0 = Edge(p[1], p[2], s) / area;
+                float w1 = Edge(p[2], p[0], s) / area;
+                float w2 = Edge(p[0], p[1], s) / area;
+                if (w0 < 0.0f || w1 < 0.0f || w2 < 0.0f)
+                    continue;
+                float z = w0 * p[0].z + w1 * p[1].z + w2 * p[2].z;
+                float& stored = depth[static_cast<size_t>(y) * width + x];
+                if (z >= 0.0f && z < stored)
+                    stored = z;
+            }
+    }
+
+    // indexed triangles through model * viewProjection
+    void RasterizeMesh(const std::vector<glm::vec3>& positions, const std::vector<unsigned int>& indices, const glm::mat4& transform)
+    {
+        for (size_t i = 0; i + 2 < indices.size(); i += 3)
+            RasterizeTriangle(transform * glm::vec4(positions[indices[i]], 1.0f),
+                              transform * glm::vec4(positions[indices[i + 1]], 1.0f),
+                              transform * glm::vec4(positions[indices[i + 2]], 1.0f));
+    }
+
+    int Width() const { return width; }
+    int Height() const { return height; }
+    float At(int x, int y) const { return depth[static_cast<size_t>(y) * width + x]; }
+
+private:
+    glm::vec3 ToWindow(const glm::vec4& clip) const
+    {
+        glm::vec3 ndc = glm::vec3(clip) / clip.w;
+        return glm::vec3((ndc.x * 0.5f + 0.5f) * width, (ndc.y * 0.5f + 0.5f) * height, ndc.z * 0.5f + 0.5f);
+    }
+
+    static float Edge(const glm::vec3& a, const glm::vec3& b, const glm::vec3& c)
+    {
+        return (b.x - a.x) * (c.y - a.y) - (b.y - a.y) * (c.x - a.x);
+    }
+
+    int width;
+    int height;
+    std::vector<float> depth;
+};
+
+// pixel rectangle covered by a projected box, clamped to the screen; false when off screen
+inline bool BoxPixelRect(const ProjectedBox& box, int width, int height, int& x0, int& y0, int& x1, int& y1)
+{
+    x0 = std::max(0, static_cast<int>(std::floor((box.min.x * 0.5f + 0.5f) * width)));
+    y0 = std::max(0, static_cast<int>(std::floor((box.min.y * 0.5f + 0.5f) * height)));
+    x1 = std::min(width - 1, static_cast<int>(std::floor((box.max.x * 0.5f + 0.5f) * width)));
+    y1 = std::min(height - 1, static_cast<int>(std::floor((box.max.y * 0.5f + 0.5f) * height)));
+    return x0 <= x1 && y0 <= y1 && box.nearestDepth <= 1.0f;
+}
+
+// per-pixel reference: occluded when every covered pixel is nearer than the box
+inline bool BoxOccludedExact(const DepthRaster& raster, const glm::vec3& boxMin, const glm::vec3& boxMax, const glm::mat4& viewProjection)
+{
+    ProjectedBox box = ProjectBox(boxMin, boxMax, viewProjection);
+    if (box.crossesNearPlane)
+        return false;
+    int x0, y0, x1, y1;
+    if (!BoxPixelRect(box, raster.Width(), raster.Height(), x0, y0, x1, y1))
+        return true;
+    for (int y = y0; y <= y1; ++y)
+        for (int x = x0; x <= x1; ++x)
+            if (raster.At(x, y) >= box.nearestDepth)
+                return false;
+    return true;
+}
+
+// max-depth mip chain over a DepthRaster; level 0 is the raster itself
+// ----------------------------------------------------------------------
+class HiZPyramid
+{
+public:
+    void Build(const DepthRaster& raster)
+    {
+        levels.clear();
+        Level base;
+        base.width = raster.Width();
+        base.height = raster.Height();
+        base.depth.resize(static_cast<size_t>(base.width) * base.height);
+        for (int y = 0; y < base.height; ++y)
+            for (int x = 0; x < base.width; ++x)
+                base.depth[static_cast<size_t>(y) * base.width + x] = raster.At(x, y);
+        levels.push_back(std::move(base));
+
+        // odd sizes round up, so the last row or column folds in with a clamped neighbour
+        while (levels.back().width > 1 || levels.back().height > 1)
+        {
+            const Level& fine = levels.back();
+            Level coarse;
+            coarse.width = std::max(1, (fine.width + 1) / 2);
+            coarse.height = std::max(1, (fine.height + 1) / 2);
+            coarse.depth.resize(static_cast<size_t>(coarse.width) * coarse.height);
+            for (int y = 0; y < coarse.height; ++y)
+                for (int x = 0; x < coarse.width; ++x)
+                {
+                    int fx = std::min(2 * x + 1, fine.width - 1), fy = std::min(2 * y + 1, fine.height - 1);
+                    coarse.depth[static_cast<size_t>(y) * coarse.width + x] =
+                        std::max(std::max(fine.At(2 * x, 2 * y), fine.At(fx, 2 * y)), std::max(fine.At(2 * x, fy), fine.At(fx, fy)));
+                }
+            levels.push_back(std::move(coarse));
+        }
+    }
+
+    // conservative: reads the finest level where the box spans at most four texels per axis
+    bool BoxOccluded(const glm::vec3& boxMin, const glm::vec3& boxMax, const glm::mat4& viewProjection) const
+    {
+        ProjectedBox box = ProjectBox(boxMin, boxMax, viewProjection);
+        if (box.crossesNearPlane || levels.empty())
+            return false;
+        int x0, y0, x1, y1;
+        if (!BoxPixelRect(box, levels[0].width, levels[0].height, x0, y0, x1, y1))
+            return true;
+        int level = 0;
+        while (level + 1 < static_cast<int>(levels.size()) && ((x1 >> level) - (x0 >> level) > 3 || (y1 >> level) - (y0 >> level) > 3))
+            ++level;
+
+        const Level& l = levels[level];
+        float farthest = 0.0f;
+        for (int y = y0 >> level; y <= (y1 >> level); ++y)
+            for (int x = x0 >> level; x <= (x1 >> level); ++x)
+                farthest = std::max(farthest, l.At(x, y));
+        return farthest < box.nearestDepth;
+    }
+
+    int LevelCount() const { return static_cast<int>(levels.size()); }
+
+private:
+    struct Level
+    {
+        int width = 0;
+        int height = 0;
+        std::vector<float> depth;
+
+        float At(int x, int y) const { return depth[static_cast<size_t>(y) * width + x]; }
+    };
+
+    std::vector<Level> levels;
+};
+
+// GPU occlusion queries with conditional rendering, one query per object
+// ----------------------------------------------------------------------
+class OcclusionQueries
+{
+public:
+    bool Init(int objectCount)
+    {
+        objects.assign(objectCount, Object());
+        for (Object& object : objects)
+            glGenQueries(1, &object.query);
+
+        // unit cube, corners 0..1
+        float corners[8 * 3];
+        for (int i = 0; i < 8; ++i)
+        {
+            corners[i * 3 + 0] = (i & 1) ? 1.0f : 0.0f;
+            corners[i * 3 + 1] = (i & 2) ? 1.0f : 0.0f;
+            corners[i * 3 + 2] = (i & 4) ? 1.0f : 0.0f;
+        }
+        unsigned int faces[36] = {
+            0, 2, 1, 1, 2, 3,   4, 5, 6, 5, 7, 6,   // -z, +z
+            0, 1, 4, 1, 5, 4,   2, 6, 3, 3, 6, 7,   // -y, +y
+            0, 4, 2, 2, 4, 6,   1, 3, 5, 3, 7, 5    // -x, +x
+        };
+        glGenVertexArrays(1, &cubeVAO);
+        glGenBuffers(1, &cubeVBO);
+        glGenBuffers(1, &cubeEBO);
+        glBindVertexArray(cubeVAO);
+        glBindBuffer(GL_ARRAY_BUFFER, cubeVBO);
+        glBufferData(GL_ARRAY_BUFFER, sizeof(corners), corners, GL_STATIC_DRAW);
+        glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, cubeEBO);
+        glBufferData(GL_ELEMENT_ARRAY_BUFFER, sizeof(faces), faces, GL_STATIC_DRAW);
+        glEnableVertexAttribArray(0);
+        glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, 3 * sizeof(float), (void*)0);
+        glBindVertexArray(0);
+        return true;
+    }
+
+    // last frame's results; a query the GPU hasn't finished keeps the object visible
+    void CollectResults()
+    {
+        for (Object& object : objects)
+        {
+            if (!object.issued)
+                continue;
+            GLint available = 0;
+            glGetQueryObjectiv(object.query, GL_QUERY_RESULT_AVAILABLE, &available);
+            if (available)
+            {
+                GLuint anySamples = 0;
+                glGetQueryObjectuiv(object.query, GL_QUERY_RESULT, &anySamples);
+                object.visible = anySamples != 0;
+            }
+            object.issued = false;
+        }
+    }
+
+    bool Visible(int object) const { return objects[object].visible; }
+
+    // box tests go between these: colour and depth writes off, the program
+    // (position at location 0, model/view/projection) already in use
+    void BeginTests()
+    {
+        glColorMask(GL_FALSE, GL_FALSE, GL_FALSE, GL_FALSE);
+        glDepthMask(GL_FALSE);
+        glBindVertexArray(cubeVAO);
+    }
+
+    // a camera inside the box sees it without a test
+    void TestBox(int object, const glm::vec3& boxMin, const glm::vec3& boxMax, const glm::vec3& cameraPosition, int modelLocation)
+    {
+        Object& o = objects[object];
+        const glm::vec3& p = cameraPosition;
+        if (p.x >= boxMin.x && p.y >= boxMin.y && p.z >= boxMin.z && p.x <= boxMax.x && p.y <= boxMax.y && p.z <= boxMax.z)
+        {
+            o.visible = true;
+            o.issued = false;
+            return;
+        }
+        glm::mat4 model = glm::translate(glm::mat4(1.0f), boxMin);
+        model = glm::scale(model, boxMax - boxMin);
+        glUniformMatrix4fv(modelLocation, 1, GL_FALSE, glm::value_ptr(model));
+        glBeginQuery(GL_ANY_SAMPLES_PASSED, o.query);
+        glDrawElements(GL_TRIANGLES, 36, GL_UNSIGNED_INT, 0);
+        glEndQuery(GL_ANY_SAMPLES_PASSED);
+        o.issued = true;
+    }
+
+    void EndTests()
+    {
+        glBindVertexArray(0);
+        glDepthMask(GL_TRUE);
+        glColorMask(GL_TRUE, GL_TRUE, GL_TRUE, GL_TRUE);
+    }
+
+    // draws until EndConditional are skipped by the GPU when this frame's box test saw nothing
+    void BeginConditional(int object) const
+    {
+        if (objects[object].issued)
+            glBeginConditionalRender(objects[object].query, GL_QUERY_WAIT);
+    }
+
+    void EndConditional(int object) const
+    {
+        if (objects[object].issued)
+            glEndConditionalRender();
+    }
+
+    void Release()
+    {
+        for (Object& object : objects)
+            glDeleteQueries(1, &object.query);
+        objects.clear();
+        if (cubeVAO)
+        {
+            glDeleteVertexArrays(1, &cubeVAO);
+            glDeleteBuffers(1, &cubeVBO);
+            glDeleteBuffers(1, &cubeEBO);
+        }
+        cubeVAO = cubeVBO = cubeEBO = 0;
+    }
+
+private:
+    struct Object
+    {
+        unsigned int query = 0;
+        bool issued = false;
+        bool visible = true;
+    };
+
+    std::vector<Object> objects;
+    unsigned int cubeVAO = 0;
+    unsigned int cubeVBO = 0;
+    unsigned int cubeEBO = 0;
+};
+
+#endif
@@ -0,0 +1,161 @@
+#ifndef RENDER_QUEUE_H
+#define RENDER_QUEUE_H
+
+// Render queue: draws are collected as packets, sorted by a packed 64-bit state
+// key and submitted with redundant program, VAO and texture binds skipped.
+// Packets, keys and sorting are in common/draw_packet.h.
+//
+// Record writes the same binds and draws into a CommandBuffer instead of GL,
+// for queues built and sorted off the GL thread (common/command_buffer.h).
+
+#include <glad/glad.h>
+#include <glm/glm.hpp>
+#include <glm/gtc/type_ptr.hpp>
+
+#include "command_buffer.h"
+#include "draw_packet.h"
+
+#include <numeric>
+#include <vector>
+
+class RenderQueue
+{
+public:
+    void Clear() { packets.clear(); }
+
+    // room for this many packets, so pushing and sorting up to it never allocates
+    void Reserve(size_t count)
+    {
+        packets.reserve(count);
+        insertion.reserve(count);
+        order.reserve(count);
+    }
+
+    void Push(const DrawPacket& packet) { packets.push_back(packet); }
+
+    void SetDrawOrder(DrawOrder order) { drawOrder = order; }
+
+    const std::vector<DrawPacket>& Packets() const { return packets; }
+
+    // state changes of the last Submit or SubmitWithProgram, and what the same packets would have cost unsorted and unelided
+    const RenderStateStats& SubmittedStats() const { return submitted; }
+    const RenderStateStats& NaiveStats() const { return naive; }
+
+    // sort by key and draw, skipping binds that match the current state.
+    // Per-frame uniforms (view, projection, samplers) must already be set on each program
+    void Submit()
+    {
+        GLCommandBackend gl;
+        Emit(gl);
+    }
+
+    // what Submit would do, as commands appended to buffer; safe on any thread
+    void Record(CommandBuffer& buffer) { Emit(buffer); }
+
+    // the same draws in the same order with one program and no textures, for a
+    // depth prepass or overdraw view. The program must share the packets' vertex shader
+    void SubmitWithProgram(unsigned int program, int modelLocation)
+    {
+        // unelided, every packet would bind the program and its VAO
+        naive = RenderStateStats();
+        naive.programBinds = naive.vaoBinds = naive.draws = static_cast<int>(packets.size());
+
+        SortDrawPackets(packets, order, drawOrder);
+        submitted = RenderStateStats();
+        glUseProgram(program);
+        ++submitted.programBinds;
+        unsigned int vao = 0;
+        bool first = true;
+        for (uint32_t index : order)
+        {
+            const DrawPacket& p = packets[index];
+            if (first || p.vao != vao)
+            {
+                glBindVertexArray(p.vao);
+                vao = p.vao;
+                ++submitted.vaoBinds;
+            }
+            first = false;
+
+            if (modelLocation >= 0)
+                glUniformMatrix4fv(modelLocation, 1, GL_FALSE, glm::value_ptr(p.model));
+
+            if (p.indexed)
+                glDrawElementsBaseVertex(p.mode, p.count, GL_UNSIGNED_INT, (void*)(p.first * sizeof(unsigned int)), p.baseVertex);
+            else
+                glDrawArrays(p.mode, p.first, p.count);
+            ++submitted.draws;
+        }
+        glBindVertexArray(0);
+    }
+
+private:
+    // sorted draws into a GL backend or a command buffer
+    template <typename Backend>
+    void Emit(Backend& backend)
+    {
+        insertion.resize(packets.size());
+        std::iota(insertion.begin(), insertion.end(), 0u);
+        naive = CountStateChanges(packets, insertion, false);
+
+        SortDrawPackets(packets, order, drawOrder);
+        submitted = RenderStateStats();
+
+        unsigned int program = 0;
+        unsigned int vao = 0;
+        unsigned int textures[MAX_PACKET_TEXTURES] = {};
+        int activeUnit = -1;
+        bool first = true;
+        for (uint32_t index : order)
+        {
+            const DrawPacket& p = packets[index];
+            if (first || p.program != program)
+            {
+                backend.UseProgram(p.program);
+                program = p.program;
+                ++submitted.programBinds;
+            }
+            if (first || p.vao != vao)
+            {
+                backend.BindVertexArray(p.vao);
+                vao = p.vao;
+                ++submitted.vaoBinds;
+            }
+            for (int unit = 0; unit < p.textureCount; ++unit)
+            {
+                if (!first && p.textures[unit] == textures[unit])
+                    continue;
+                if (unit != activeUnit)
+                {
+                    backend.ActiveTexture(unit);
+                    activeUnit = unit;
+                }
+                backend.BindTexture(p.textureTarget, p.textures[unit]);
+                textures[unit] = p.textures[unit];
+                ++submitted.textureBinds;
+            }
+            first = false;
+
+            if (p.modelLocation >= 0)
+                backend.UniformMatrix4(p.modelLocation, 1, glm::value_ptr(p.model));
+
+            if (p.indexed)
+                backend.DrawElements(p.mode, p.count, p.first, p.baseVertex);
+            else
+                backend.DrawArrays(p.mode, p.first, p.count);
+            ++submitted.draws;
+        }
+
+        backend.BindVertexArray(0);
+        backend.ActiveTexture(0);
+    }
+
+    std::vector<DrawPacket> packets;
+    std::vector<uint32_t> insertion;
+    std::vector<uint32_t> order;
+    RenderStateStats submitted;
+    RenderStateStats naive;
+    DrawOrder drawOrder = DrawOrder::State;
+};
+
+#endif
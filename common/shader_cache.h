@@ -0,0 +1,647 @@
+#ifndef SHADER_CACHE_H
+#define SHADER_CACHE_H
+
+// Linked shader programs cached on disk, and hot reload.
+//
+// ShaderCache::Load(vertexPath, fragmentPath) returns a ShaderProgram, which has
+// the interface of LearnOpenGL's Shader (ID, use, set*). Its program binary is
+// stored under an FNV-1a hash of both sources and the driver (GL_VENDOR,
+// GL_RENDERER, GL_VERSION). A hit skips compiling and linking. A miss, or a
+// binary the driver no longer accepts, compiles from source and writes a new one.
+// Binaries need GL_ARB_get_program_binary (core in 4.1); the entry points are
+// looked up at runtime because the demos' glad is generated for 3.3. Without a
+// binary format the cache only compiles.
+//
+// With --hot-reload a watcher thread polls the source files' write times. A
+// changed program is compiled and linked on that thread, in a hidden context
+// shared with the window, and Poll() swaps it in on the render thread. Uniform
+// values carry over from the old program, so samplers and flags set once at
+// startup survive. A program that fails to compile keeps the old one running.
+//
+// Load can also take a block of #define lines, inserted after #version. That
+// is how shader_permutations.h builds variants of one source pair; the defines
+// are part of the hashed source, so each variant has its own binary.
+//
+// LearnOpenGL's Model::Draw only takes a Shader; DrawModel draws a Model with a
+// ShaderProgram and binds textures the way Mesh::Draw does.
+
+#include <glad/glad.h>
+#include <GLFW/glfw3.h>
+#include <glm/glm.hpp>
+
+#ifdef HEADLESS_EGL
+#include <EGL/egl.h>
+#endif
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <memory>
+#include <mutex>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <vector>
+
+#ifndef GL_PROGRAM_BINARY_RETRIEVABLE_HINT
+#define GL_PROGRAM_BINARY_RETRIEVABLE_HINT 0x8257
+#endif
+#ifndef GL_PROGRAM_BINARY_LENGTH
+#define GL_PROGRAM_BINARY_LENGTH 0x8741
+#endif
+#ifndef GL_NUM_PROGRAM_BINARY_FORMATS
+#define GL_NUM_PROGRAM_BINARY_FORMATS 0x87FE
+#endif
+
+class ShaderProgram
+{
+public:
+    unsigned int ID = 0;
+
+    void use() const { glUseProgram(ID); }
+    void setBool(const std::string& name, bool value) const { glUniform1i(glGetUniformLocation(ID, name.c_str()), (int)value); }
+    void setInt(const std::string& name, int value) const { glUniform1i(glGetUniformLocation(ID, name.c_str()), value); }
+    void setFloat(const std::string& name, float value) const { glUniform1f(glGetUniformLocation(ID, name.c_str()), value); }
+    void setVec2(const std::string& name, const glm::vec2& value) const { glUniform2fv(glGetUniformLocation(ID, name.c_str()), 1, &value[0]); }
+    void setVec2(const std::string& name, float x, float y) const { glUniform2f(glGetUniformLocation(ID, name.c_str()), x, y); }
+    void setVec3(const std::string& name, const glm::vec3& value) const { glUniform3fv(glGetUniformLocation(ID, name.c_str()), 1, &value[0]); }
+    void setVec3(const std::string& name, float x, float y, float z) const { glUniform3f(glGetUniformLocation(ID, name.c_str()), x, y, z); }
+    void setVec4(const std::string& name, const glm::vec4& value) const { glUniform4fv(glGetUniformLocation(ID, name.c_str()), 1, &value[0]); }
+    void setVec4(const std::string& name, float x, float y, float z, float w) const { glUniform4f(glGetUniformLocation(ID, name.c_str()), x, y, z, w); }
+    void setMat2(const std::string& name, const glm::mat2& mat) const { glUniformMatrix2fv(glGetUniformLocation(ID, name.c_str()), 1, GL_FALSE, &mat[0][0]); }
+    void setMat3(const std::string& name, const glm::mat3& mat) const { glUniformMatrix3fv(glGetUniformLocation(ID, name.c_str()), 1, GL_FALSE, &mat[0][0]); }
+    void setMat4(const std::string& name, const glm::mat4& mat) const { glUniformMatrix4fv(glGetUniformLocation(ID, name.c_str()), 1, GL_FALSE, &mat[0][0]); }
+};
+
+// sampler uniforms and texture units for one mesh, numbered like Mesh::Draw
+// (texture_diffuse1, texture_specular1, ...). Names are built on the stack
+template <typename ShaderType, typename TextureList>
+void BindMeshTextures(const ShaderType& shader, const TextureList& textures)
+{
+    unsigned int diffuseNr = 1, specularNr = 1, normalNr = 1, heightNr = 1;
+    for (unsigned int i = 0; i < textures.size(); i++)
+    {
+        glActiveTexture(GL_TEXTURE0 + i);
+        unsigned int number = 0;
+        const std::string& name = textures[i].type;
+        if (name == "texture_diffuse")
+            number = diffuseNr++;
+        else if (name == "texture_specular")
+            number = specularNr++;
+        else if (name == "texture_normal")
+            number = normalNr++;
+        else if (name == "texture_height")
+            number = heightNr++;
+        char uniform[64];
+        std::snprintf(uniform, sizeof(uniform), "%s%u", name.c_str(), number);
+        glUniform1i(glGetUniformLocation(shader.ID, uniform), i);
+        glBindTexture(GL_TEXTURE_2D, textures[i].id);
+    }
+}
+
+// Model::Draw for any program type
+template <typename ModelType, typename ShaderType>
+void DrawModel(const ModelType& model, const ShaderType& shader)
+{
+    for (const auto& mesh : model.meshes)
+    {
+        BindMeshTextures(shader, mesh.textures);
+        glBindVertexArray(mesh.VAO);
+        glDrawElements(GL_TRIANGLES, static_cast<GLsizei>(mesh.indices.size()), GL_UNSIGNED_INT, 0);
+    }
+    glBindVertexArray(0);
+    glActiveTexture(GL_TEXTURE0);
+}
+
+class ShaderCache
+{
+public:
+    ShaderCache() = default;
+    ShaderCache(const ShaderCache&) = delete;
+    ShaderCache& operator=(const ShaderCache&) = delete;
+    ~ShaderCache() { StopHotReload(); }
+
+    // command line: --shader-cache <dir> (default shader_cache), --no-shader-cache, --hot-reload
+    void ParseOptions(int argc, char** argv)
+    {
+        for (int i = 1; i < argc; ++i)
+        {
+            if (std::strcmp(argv[i], "--shader-cache") == 0 && i + 1 < argc)
+                directory = argv[++i];
+            else if (std::strcmp(argv[i], "--no-shader-cache") == 0)
+                directory.clear();
+            else if (std::strcmp(argv[i], "--hot-reload") == 0)
+                hotReload = true;
+        }
+    }
+
+    void SetDirectory(const std::string& path) { directory = path; }
+
+    // a linked program, from its cached binary when there is one. The reference stays
+    // valid until Release(); hot reload changes its ID in place. defines ("#define X\n"
+    // lines) go into both stages
+    ShaderProgram& Load(const char* vertexPath, const char* fragmentPath, const std::string& defines = std::string())
+    {
+        auto start = std::chrono::steady_clock::now();
+        if (!initialised)
+            InitDriver();
+
+        std::unique_ptr<Entry> entry(new Entry);
+        entry->vertexPath = vertexPath;
+        entry->fragmentPath = fragmentPath;
+        entry->defines = defines;
+        SourceTimes(*entry, entry->vertexTime, entry->fragmentTime);
+        std::string vertexSource, fragmentSource;
+        if (ReadSources(*entry, vertexSource, fragmentSource))
+        {
+            uint64_t key = Key(vertexSource, fragmentSource);
+            entry->program.ID = LoadBinary(key);
+            if (entry->program.ID)
+                ++binaryLoads;
+            else
+            {
+                entry->program.ID = Link(vertexSource, fragmentSource, *entry);
+                ++compiles;
+                if (entry->program.ID)
+                    SaveBinary(key, entry->program.ID);
+            }
+        }
+
+        loadSeconds += std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+        std::lock_guard<std::mutex> lock(mutex);
+        entries.push_back(std::move(entry));
+        return entries.back()->program;
+    }
+
+    // start watching the sources if --hot-reload was given. Needs the window whose
+    // context the programs are used in; call from the thread that created it
+    bool StartHotReload(GLFWwindow* window)
+    {
+        if (!hotReload || watcher.joinable())
+            return false;
+        glfwWindowHint(GLFW_VISIBLE, GLFW_FALSE);
+        reloadContext = glfwCreateWindow(1, 1, "shader reload", NULL, window);
+        glfwWindowHint(GLFW_VISIBLE, GLFW_TRUE);
+        if (!reloadContext)
+        {
+            std::cout << "Hot reload unavailable, could not create a shared context" << std::endl;
+            return false;
+        }
+        stopWatching = false;
+        watcher = std::thread([this]() { Watch(); });
+        std::cout << "Hot reload: watching " << entries.size() << " programs" << std::endl;
+        return true;
+    }
+
+    // on the render thread once per frame: swap in programs the watcher rebuilt.
+    // Returns how many changed
+    int Poll()
+    {
+        if (!watcher.joinable())
+            return 0;
+        std::lock_guard<std::mutex> lock(mutex);
+        int swapped = 0;
+        for (auto& entry : entries)
+        {
+            if (!entry->pending)
+                continue;
+            CopyUniforms(entry->program.ID, entry->pending);
+            glDeleteProgram(entry->program.ID);
+            entry->program.ID = entry->pending;
+            entry->pending = 0;
+            ++swapped;
+            std::cout << "Reloaded " << entry->vertexPath << " + " << entry->fragmentPath << std::endl;
+        }
+        if (swapped)
+        {
+            glUseProgram(0);
+            reloads += swapped;
+        }
+        return swapped;
+    }
+
+    void StopHotReload()
+    {
+        if (watcher.joinable())
+        {
+            {
+                std::lock_guard<std::mutex> lock(mutex);
+                stopWatching = true;
+            }
+            wake.notify_all();
+            watcher.join();
+        }
+        if (reloadContext)
+        {
+            glfwDestroyWindow(reloadContext);
+            reloadContext = nullptr;
+        }
+    }
+
+    int ProgramCount() const { return static_cast<int>(entries.size()); }
+    int BinaryLoads() const { return binaryLoads; }
+    int Compiles() const { return compiles; }
+    int Reloads() const { return reloads; }
+    bool BinariesSupported() const { return getProgramBinary && programBinary && binaryFormats > 0; }
+    double LoadMilliseconds() const { return loadSeconds * 1000.0; }
+
+    void PrintReport() const
+    {
+        std::printf("shader cache: %d programs in %.1f ms, %d from binaries, %d compiled%s, %d reloaded\n", ProgramCount(), LoadMilliseconds(),
+                    binaryLoads, compiles, directory.empty() ? " (cache off)" : BinariesSupported() ? "" : " (no program binary formats)", reloads);
+    }
+
+    // stop watching and delete every program; call before the GL context goes away
+    void Release()
+    {
+        StopHotReload();
+        for (auto& entry : entries)
+            glDeleteProgram(entry->program.ID);
+        entries.clear();
+    }
+
+private:
+    typedef void (APIENTRYP GetProgramBinaryProc)(GLuint program, GLsizei bufSize, GLsizei* length, GLenum* binaryFormat, void* binary);
+    typedef void (APIENTRYP ProgramBinaryProc)(GLuint program, GLenum binaryFormat, const void* binary, GLsizei length);
+    typedef void (APIENTRYP ProgramParameteriProc)(GLuint program, GLenum pname, GLint value);
+
+    struct Entry
+    {
+        std::string vertexPath;
+        std::string fragmentPath;
+        std::string defines;
+        std::filesystem::file_time_type vertexTime;    // written by Load, then only by the watcher
+        std::filesystem::file_time_type fragmentTime;
+        ShaderProgram program;
+        unsigned int pending = 0;                      // rebuilt program waiting for Poll
+    };
+
+    static const uint32_t BINARY_MAGIC = 0x31425053;  // "SPB1"
+
+    void InitDriver()
+    {
+        initialised = true;
+        const char* strings[] = { (const char*)glGetString(GL_VENDOR), (const char*)glGetString(GL_RENDERER), (const char*)glGetString(GL_VERSION) };
+        for (const char* s : strings)
+            driver += std::string(s ? s : "") + "\n";
+        getProgramBinary = (GetProgramBinaryProc)ProcAddress("glGetProgramBinary");
+        programBinary = (ProgramBinaryProc)ProcAddress("glProgramBinary");
+        programParameteri = (ProgramParameteriProc)ProcAddress("glProgramParameteri");
+        binaryFormats = 0;
+        if (getProgramBinary && programBinary)
+            glGetIntegerv(GL_NUM_PROGRAM_BINARY_FORMATS, &binaryFormats);
+        while (glGetError() != GL_NO_ERROR)
+            ;
+    }
+
+    static void* ProcAddress(const char* name)
+    {
+        if (glfwGetCurrentContext())
+            return (void*)glfwGetProcAddress(name);
+#ifdef HEADLESS_EGL
+        return (void*)eglGetProcAddress(name);
+#else
+        return nullptr;
+#endif
+    }
+
+    uint64_t Key(const std::string& vertexSource, const std::string& fragmentSource) const
+    {
+        uint64_t hash = 14695981039346656037ull;
+        const std::string* parts[] = { &driver, &vertexSource, &fragmentSource };
+        for (const std::string* part : parts)
+        {
+            for (unsigned char c : *part)
+            {
+                hash ^= c;
+                hash *= 1099511628211ull;
+            }
+            hash ^= 0xFF;  // separator, so moving text between the stages changes the key
+            hash *= 1099511628211ull;
+        }
+        return hash;
+    }
+
+    std::string BinaryPath(uint64_t key) const
+    {
+        char name[32];
+        std::snprintf(name, sizeof(name), "%016llx.bin", static_cast<unsigned long long>(key));
+        return directory + "/" + name;
+    }
+
+    unsigned int LoadBinary(uint64_t key) const
+    {
+        if (directory.empty() || !BinariesSupported())
+            return 0;
+        std::ifstream file(BinaryPath(key), std::ios::binary);
+        uint32_t header[3] = {};
+        if (!file.read(reinterpret_cast<char*>(header), sizeof(header)) || header[0] != BINARY_MAGIC)
+            return 0;
+        std::vector<char> binary(header[2]);
+        if (!file.read(binary.data(), binary.size()))
+            return 0;
+        unsigned int program = glCreateProgram();
+        programBinary(program, header[1], binary.data(), static_cast<GLsizei>(binary.size()));
+        GLint linked = 0;
+        glGetProgramiv(program, GL_LINK_STATUS, &linked);
+        if (!linked)
+        {
+            // another driver build; compiled again and overwritten by the caller
+            glDeleteProgram(program);
+            return 0;
+        }
+        return program;
+    }
+
+    void SaveBinary(uint64_t key, unsigned int program) const
+    {
+        if (directory.empty() || !BinariesSupported())
+            return;
+        GLint length = 0;
+        glGetProgramiv(program, GL_PROGRAM_BINARY_LENGTH, &length);
+        if (length <= 0)
+            return;
+        std::vector<char> binary(length);
+        GLenum format = 0;
+        getProgramBinary(program, length, &length, &format, binary.data());
+        std::error_code error;
+        std::filesystem::create_directories(directory, error);
+        std::ofstream file(BinaryPath(key), std::ios::binary);
+        uint32_t header[3] = { BINARY_MAGIC, format, static_cast<uint32_t>(length) };
+        file.write(reinterpret_cast<const char*>(header), sizeof(header));
+        file.write(binary.data(), length);
+        if (!file)
+            std::cout << "Failed to write shader binary " << BinaryPath(key) << std::endl;
+    }
+
+    static bool ReadSource(const std::string& path, std::string& out)
+    {
+        std::ifstream file(path);
+        if (!file)
+        {
+            std::cout << "ERROR::SHADER::FILE_NOT_SUCCESSFULLY_READ: " << path << std::endl;
+            return false;
+        }
+        std::stringstream stream;
+        stream << file.rdbuf();
+        out = stream.str();
+        return true;
+    }
+
+    // both stages with the entry's defines after the #version line. #line keeps compile
+    // errors pointing at the file's own line numbers
+    static bool ReadSources(const Entry& entry, std::string& vertexSource, std::string& fragmentSource)
+    {
+        if (!ReadSource(entry.vertexPath, vertexSource) || !ReadSource(entry.fragmentPath, fragmentSource))
+            return false;
+        if (!entry.defines.empty())
+        {
+            InsertDefines(vertexSource, entry.defines);
+            InsertDefines(fragmentSource, entry.defines);
+        }
+        return true;
+    }
+
+    static void InsertDefines(std::string& source, const std::string& defines)
+    {
+        size_t version = source.find("#version");
+        if (version == std::string::npos)
+        {
+            source = defines + "#line 1\n" + source;
+            return;
+        }
+        size_t lineEnd = source.find('\n', version);
+        if (lineEnd == std::string::npos)
+        {
+            source += "\n" + defines;
+            return;
+        }
+        int nextLine = 2 + static_cast<int>(std::count(source.begin(), source.begin() + version, '\n'));
+        source.insert(lineEnd + 1, defines + "#line " + std::to_string(nextLine) + "\n");
+    }
+
+    static void SourceTimes(const Entry& entry, std::filesystem::file_time_type& vertexTime, std::filesystem::file_time_type& fragmentTime)
+    {
+        std::error_code error;
+        vertexTime = std::filesystem::last_write_time(entry.vertexPath, error);
+        fragmentTime = std::filesystem::last_write_time(entry.fragmentPath, error);
+    }
+
+    static unsigned int CompileStage(GLenum type, const std::string& source, const std::string& path)
+    {
+        unsigned int shader = glCreateShader(type);
+        const char* code = source.c_str();
+        glShaderSource(shader, 1, &code, NULL);
+        glCompileShader(shader);
+        GLint success = 0;
+        glGetShaderiv(shader, GL_COMPILE_STATUS, &success);
+        if (!success)
+        {
+            char infoLog[1024];
+            glGetShaderInfoLog(shader, sizeof(infoLog), NULL, infoLog);
+            std::cout << "ERROR::SHADER_COMPILATION_ERROR in " << path << "\n" << infoLog << std::endl;
+            glDeleteShader(shader);
+            return 0;
+        }
+        return shader;
+    }
+
+    // compile and link; 0 (after printing the log) on failure
+    unsigned int Link(const std::string& vertexSource, const std::string& fragmentSource, const Entry& entry) const
+    {
+        unsigned int vertex = CompileStage(GL_VERTEX_SHADER, vertexSource, entry.vertexPath);
+        unsigned int fragment = CompileStage(GL_FRAGMENT_SHADER, fragmentSource, entry.fragmentPath);
+        if (!vertex || !fragment)
+        {
+            glDeleteShader(vertex);
+            glDeleteShader(fragment);
+            return 0;
+        }
+        unsigned int program = glCreateProgram();
+        glAttachShader(program, vertex);
+        glAttachShader(program, fragment);
+        if (programParameteri && BinariesSupported() && !directory.empty())
+            programParameteri(program, GL_PROGRAM_BINARY_RETRIEVABLE_HINT, GL_TRUE);
+        glLinkProgram(program);
+        glDeleteShader(vertex);
+        glDeleteShader(fragment);
+        GLint success = 0;
+        glGetProgramiv(program, GL_LINK_STATUS, &success);
+        if (!success)
+        {
+            char infoLog[1024];
+            glGetProgramInfoLog(program, sizeof(infoLog), NULL, infoLog);
+            std::cout << "ERROR::PROGRAM_LINKING_ERROR for " << entry.vertexPath << " + " << entry.fragmentPath << "\n" << infoLog << std::endl;
+            glDeleteProgram(program);
+            return 0;
+        }
+        return program;
+    }
+
+    // watcher thread: poll write times, rebuild changed programs in the shared context
+    void Watch()
+    {
+        glfwMakeContextCurrent(reloadContext);
+        std::unique_lock<std::mutex> lock(mutex);
+        while (!wake.wait_for(lock, std::chrono::milliseconds(250), [this]() { return stopWatching; }))
+        {
+            size_t count = entries.size();
+            for (size_t i = 0; i < count; ++i)
+            {
+                Entry& entry = *entries[i];
+                std::filesystem::file_time_type vertexTime, fragmentTime;
+                SourceTimes(entry, vertexTime, fragmentTime);
+                if (vertexTime == entry.vertexTime && fragmentTime == entry.fragmentTime)
+                    continue;
+                entry.vertexTime = vertexTime;
+                entry.fragmentTime = fragmentTime;
+
+                // the render thread only takes the lock in Poll, so compile without it
+                lock.unlock();
+                std::string vertexSource, fragmentSource;
+                unsigned int program = 0;
+                if (ReadSources(entry, vertexSource, fragmentSource))
+                    program = Link(vertexSource, fragmentSource, entry);
+                if (program)
+                {
+                    glFinish();  // complete before the render context uses it
+                    SaveBinary(Key(vertexSource, fragmentSource), program);
+                }
+                else
+                    std::cout << "Keeping the previous " << entry.vertexPath << " + " << entry.fragmentPath << std::endl;
+                lock.lock();
+                if (program)
+                {
+                    if (entry.pending)
+                        glDeleteProgram(entry.pending);
+                    entry.pending = program;
+                }
+            }
+        }
+        lock.unlock();
+        glfwMakeContextCurrent(NULL);
+    }
+
+    // every active uniform's current value from one program into another with the same names
+    static void CopyUniforms(unsigned int from, unsigned int to)
+    {
+        if (!from || !to)
+            return;
+        glUseProgram(to);
+        GLint count = 0;
+        glGetProgramiv(from, GL_ACTIVE_UNIFORMS, &count);
+        for (GLint i = 0; i < count; ++i)
+        {
+            char name[256];
+            GLsizei length = 0;
+            GLint size = 0;
+            GLenum type = 0;
+            glGetActiveUniform(from, i, sizeof(name), &length, &size, &type, name);
+            if (std::strncmp(name, "gl_", 3) == 0)
+                continue;
+            // arrays report "name[0]"; copy each element
+            std::string base(name);
+            if (size > 1 && base.size() > 3 && base.compare(base.size() - 3, 3, "[0]") == 0)
+                base.resize(base.size() - 3);
+            for (GLint element = 0; element < size; ++element)
+            {
+                std::string elementName = size > 1 ? base + "[" + std::to_string(element) + "]" : base;
+                GLint source = glGetUniformLocation(from, elementName.c_str());
+                GLint target = glGetUniformLocation(to, elementName.c_str());
+                if (source >= 0 && target >= 0)
+                    CopyUniform(from, source, target, type);
+            }
+        }
+    }
+
+    static void CopyUniform(unsigned int from, GLint source, GLint target, GLenum type)
+    {
+        GLfloat f[16];
+        GLint n[4];
+        GLuint u[4];
+        switch (type)
+        {
+        case GL_FLOAT: glGetUniformfv(from, source, f); glUniform1fv(target, 1, f); break;
+        case GL_FLOAT_VEC2: glGetUniformfv(from, source, f); glUniform2fv(target, 1, f); break;
+        case GL_FLOAT_VEC3: glGetUniformfv(from, source, f); glUniform3fv(target, 1, f); break;
+        case GL_FLOAT_VEC4: glGetUniformfv(from, source, f); glUniform4fv(target, 1, f); break;
+        case GL_FLOAT_MAT2: glGetUniformfv(from, source, f); glUniformMatrix2fv(target, 1, GL_FALSE, f); break;
+        case GL_FLOAT_MAT3: glGetUniformfv(from, source, f); glUniformMatrix3fv(target, 1, GL_FALSE, f); break;
+        case GL_FLOAT_MAT4: glGetUniformfv(from, source, f); glUniformMatrix4fv(target, 1, GL_FALSE, f); break;
+        case GL_INT_VEC2: case GL_BOOL_VEC2: glGetUniformiv(from, source, n); glUniform2iv(target, 1, n); break;
+        case GL_INT_VEC3: case GL_BOOL_VEC3: glGetUniformiv(from, source, n); glUniform3iv(target, 1, n); break;
+        case GL_INT_VEC4: case GL_BOOL_VEC4: glGetUniformiv(from, source, n); glUniform4iv(target, 1, n); break;
+        case GL_UNSIGNED_INT: glGetUniformuiv(from, source, u); glUniform1uiv(target, 1, u); break;
+        case GL_UNSIGNED_INT_VEC2: glGetUniformuiv(from, source, u); glUniform2uiv(target, 1, u); break;
+        case GL_UNSIGNED_INT_VEC3: glGetUniformuiv(from, source, u); glUniform3uiv(target, 1, u); break;
+        case GL_UNSIGNED_INT_VEC4: glGetUniformuiv(from, source, u); glUniform4uiv(target, 1, u); break;
+        default:
+            // ints, bools and every sampler type are one int
+            glGetUniformiv(from, source, n);
+            glUniform1iv(target, 1, n);
+            break;
+        }
+    }
+
+    std::string directory = "shader_cache";
+    bool hotReload = false;
+    bool initialised = false;
+    std::string driver;
+    GetProgramBinaryProc getProgramBinary = nullptr;
+    ProgramBinaryProc programBinary = nullptr;
+    ProgramParameteriProc programParameteri = nullptr;
+    GLint binaryFormats = 0;
+
+    std::vector<std::unique_ptr<Entry>> entries;
+    int binaryLoads = 0;
+    int compiles = 0;
+    int reloads = 0;
+    double loadSeconds = 0.0;
+
+    GLFWwindow* reloadContext = nullptr;
+    std::thread watcher;
+    std::mutex mutex;
+    std::condition_variable wake;
+    bool stopWatching = false;
+};
+
+// startup cost of loading the given programs with an empty cache directory and again
+// with the binaries that run wrote. Needs a current context; the directory is removed after
+struct ShaderStartupTimes
+{
+    int programs = 0;
+    double coldMs = 0.0;
+    double warmMs = 0.0;
+    int warmBinaryLoads = 0;
+    bool binariesSupported = false;
+};
+
+inline ShaderStartupTimes MeasureShaderStartup(const char* const programs[][2], int count, const std::string& directory)
+{
+    ShaderStartupTimes times;
+    std::error_code error;
+    std::filesystem::remove_all(directory, error);
+    for (int pass = 0; pass < 2; ++pass)
+    {
+        ShaderCache cache;
+        cache.SetDirectory(directory);
+        for (int i = 0; i < count; ++i)
+            cache.Load(programs[i][0], programs[i][1]);
+        (pass == 0 ? times.coldMs : times.warmMs) = cache.LoadMilliseconds();
+        times.programs = cache.ProgramCount();
+        times.warmBinaryLoads = cache.BinaryLoads();
+        times.binariesSupported = cache.BinariesSupported();
+        cache.Release();
+    }
+    std::filesystem::remove_all(directory, error);
+    return times;
+}
+
+#endif
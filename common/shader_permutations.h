@@ -0,0 +1,210 @@
+#ifndef SHADER_PERMUTATIONS_H
+#define SHADER_PERMUTATIONS_H
+
+// Shader variants built from #defines instead of uniform branches.
+//
+// A ShaderPermutation names the features a draw needs: the surface of the
+// sculpture shader (water or boat), how many bone influences a skinned vertex
+// reads (0 for none, else 1, 2 or 4), whether vertices are packed
+// (common/vertex_quantization.h) and whether materials are layers of one array
+// texture (common/model_batch.h). PermutationKey packs it into a small integer
+// and PermutationDefines turns it into the #define block that ShaderCache::Load
+// puts after #version, e.g.
+//
+//     #define SURFACE_BOAT
+//     #define BONE_INFLUENCES 2
+//     #define QUANTIZED_VERTICES
+//
+// ShaderPermutations holds the variants of one source pair. Get(permutation)
+// compiles a variant the first time its key is asked for (or loads its program
+// binary) and returns the same program afterwards, so draws can select by key.
+
+#include "shader_cache.h"
+
+#include <algorithm>
+#include <cstdint>
+#include <iostream>
+#include <map>
+#include <string>
+
+enum class SurfaceVariant : uint8_t
+{
+    None,
+    Water,
+    Boat,
+};
+
+struct ShaderPermutation
+{
+    SurfaceVariant surface = SurfaceVariant::None;
+    int boneInfluences = 0;      // 0, 1, 2 or 4
+    bool quantizedVertices = false;
+    bool materialArray = false;
+};
+
+const int PERMUTATION_SURFACE_BITS = 2;
+const int PERMUTATION_INFLUENCE_BITS = 2;
+const uint32_t PERMUTATION_QUANTIZED_BIT = 1u << (PERMUTATION_SURFACE_BITS + PERMUTATION_INFLUENCE_BITS);
+const uint32_t PERMUTATION_MATERIAL_ARRAY_BIT = PERMUTATION_QUANTIZED_BIT << 1;
+const uint32_t PERMUTATION_KEY_COUNT = PERMUTATION_MATERIAL_ARRAY_BIT << 1;
+
+inline bool IsValidPermutation(const ShaderPermutation& permutation)
+{
+    int influences = permutation.boneInfluences;
+    return permutation.surface <= SurfaceVariant::Boat && (influences == 0 || influences == 1 || influences == 2 || influences == 4);
+}
+
+// bits 0-1 surface, bits 2-3 influences as 0, 1, 2 or 3 for 0, 1, 2 or 4, bit 4 quantized
+// vertices, bit 5 material array
+inline uint32_t PermutationKey(const ShaderPermutation& permutation)
+{
+    uint32_t influences = permutation.boneInfluences == 4 ? 3u : static_cast<uint32_t>(permutation.boneInfluences);
+    return static_cast<uint32_t>(permutation.surface) | (influences << PERMUTATION_SURFACE_BITS) |
+           (permutation.quantizedVertices ? PERMUTATION_QUANTIZED_BIT : 0u) |
+           (permutation.materialArray ? PERMUTATION_MATERIAL_ARRAY_BIT : 0u);
+}
+
+// false for a key no valid permutation produces
+inline bool DecodePermutationKey(uint32_t key, ShaderPermutation& permutation)
+{
+    if (key >= PERMUTATION_KEY_COUNT)
+        return false;
+    uint32_t surface = key & ((1u << PERMUTATION_SURFACE_BITS) - 1);
+    uint32_t influences = (key >> PERMUTATION_SURFACE_BITS) & ((1u << PERMUTATION_INFLUENCE_BITS) - 1);
+    permutation.surface = static_cast<SurfaceVariant>(surface);
+    permutation.boneInfluences = influences == 3 ? 4 : static_cast<int>(influences);
+    permutation.quantizedVertices = (key & PERMUTATION_QUANTIZED_BIT) != 0;
+    permutation.materialArray = (key & PERMUTATION_MATERIAL_ARRAY_BIT) != 0;
+    return IsValidPermutation(permutation);
+}
+
+inline std::string PermutationDefines(const ShaderPermutation& permutation)
+{
+    std::string defines;
+    if (permutation.surface == SurfaceVariant::Water)
+        defines += "#define SURFACE_WATER\n";
+    else if (permutation.surface == SurfaceVariant::Boat)
+        defines += "#define SURFACE_BOAT\n";
+    if (permutation.boneInfluences > 0)
+        defines += "#define BONE_INFLUENCES " + std::to_string(permutation.boneInfluences) + "\n";
+    if (permutation.quantizedVertices)
+        defines += "#define QUANTIZED_VERTICES\n";
+    if (permutation.materialArray)
+        defines += "#define MATERIAL_ARRAY\n";
+    return defines;
+}
+
+// the smallest skinning variant covering vertices with up to maxInfluences bones
+inline int SkinningVariant(int maxInfluences)
+{
+    if (maxInfluences <= 1)
+        return 1;
+    return maxInfluences <= 2 ? 2 : 4;
+}
+
+// most bones any vertex of the model is weighted to. LearnOpenGL fills a vertex's
+// bone slots in order, so a vertex with n bones uses slots 0 to n-1
+template <typename ModelType>
+int MaxBoneInfluences(const ModelType& model)
+{
+    int most = 0;
+    for (const auto& mesh : model.meshes)
+        for (const auto& vertex : mesh.vertices)
+        {
+            int count = 0;
+            int slots = static_cast<int>(sizeof(vertex.m_Weights) / sizeof(vertex.m_Weights[0]));
+            for (int i = 0; i < slots; ++i)
+                if (vertex.m_BoneIDs[i] >= 0 && vertex.m_Weights[i] > 0.0f)
+                    count = i + 1;
+            most = std::max(most, count);
+        }
+    return most;
+}
+
+// every key round trips, distinct permutations get distinct keys and define blocks,
+// and invalid ones are refused. Returns the number of failures
+inline int CheckPermutationKeys(int& validKeys)
+{
+    int failures = 0;
+    auto fail = [&](uint32_t key, const char* what) {
+        if (failures < 10)
+            std::cout << "permutation key " << key << ": " << what << std::endl;
+        ++failures;
+    };
+
+    validKeys = 0;
+    std::map<std::string, uint32_t> defineBlocks;
+    for (uint32_t key = 0; key < PERMUTATION_KEY_COUNT + 4; ++key)
+    {
+        ShaderPermutation permutation;
+        if (!DecodePermutationKey(key, permutation))
+        {
+            if (key < PERMUTATION_KEY_COUNT && (key & 3u) != 3u)
+                fail(key, "refused though its fields are in range");
+            continue;
+        }
+        ++validKeys;
+        if (PermutationKey(permutation) != key)
+            fail(key, "does not round trip");
+        if (!defineBlocks.emplace(PermutationDefines(permutation), key).second)
+            fail(key, "shares its defines with another key");
+    }
+
+    const int influences[] = { 0, 1, 2, 4 };
+    for (int s = 0; s <= static_cast<int>(SurfaceVariant::Boat); ++s)
+        for (int n : influences)
+            for (int flags = 0; flags < 4; ++flags)
+            {
+                ShaderPermutation permutation;
+                permutation.surface = static_cast<SurfaceVariant>(s);
+                permutation.boneInfluences = n;
+                permutation.quantizedVertices = (flags & 1) != 0;
+                permutation.materialArray = (flags & 2) != 0;
+                ShaderPermutation decoded;
+                uint32_t key = PermutationKey(permutation);
+                if (!DecodePermutationKey(key, decoded) || decoded.surface != permutation.surface || decoded.boneInfluences != n ||
+                    decoded.quantizedVertices != permutation.quantizedVertices || decoded.materialArray != permutation.materialArray)
+                    fail(key, "decodes to another permutation");
+            }
+
+    ShaderPermutation three;
+    three.boneInfluences = 3;
+    if (IsValidPermutation(three))
+        fail(PermutationKey(three), "3 influences accepted");
+    for (int n = 0; n <= 8; ++n)
+    {
+        int variant = SkinningVariant(n);
+        if (variant < std::min(n, 4) || (variant != 1 && variant != 2 && variant != 4))
+            fail(static_cast<uint32_t>(n), "skinning variant does not cover its influences");
+    }
+    return failures;
+}
+
+class ShaderPermutations
+{
+public:
+    ShaderPermutations(ShaderCache& cache, const char* vertexPath, const char* fragmentPath)
+        : cache(cache), vertexPath(vertexPath), fragmentPath(fragmentPath) {}
+
+    // the program for this permutation, built on first use
+    ShaderProgram& Get(const ShaderPermutation& permutation)
+    {
+        uint32_t key = PermutationKey(permutation);
+        auto found = programs.find(key);
+        if (found != programs.end())
+            return *found->second;
+        ShaderProgram& program = cache.Load(vertexPath.c_str(), fragmentPath.c_str(), PermutationDefines(permutation));
+        programs.emplace(key, &program);
+        return program;
+    }
+
+    int Count() const { return static_cast<int>(programs.size()); }
+
+private:
+    ShaderCache& cache;
+    std::string vertexPath;
+    std::string fragmentPath;
+    std::map<uint32_t, ShaderProgram*> programs;
+};
+
+#endif
@@ -0,0 +1,551 @@
+#ifndef TEXTURE_MANAGER_H
+#define TEXTURE_MANAGER_H
+
+// One place to load textures: every demo's loadTexture and the textures a
+// LearnOpenGL Model loads go through here.
+//
+// - A texture is loaded once per path and options. Decoded pixels are hashed,
+//   so the same image under another path (island variants sharing a material)
+//   reuses the first texture. Adopt() does the same for a Model's textures.
+// - LoadArray() packs images into one GL_TEXTURE_2D_ARRAY, one layer each,
+//   resampled to a common size. Layers keep GL_REPEAT tiling, which an atlas
+//   would lose.
+// - Resident bytes are tracked against a budget. At EndFrame the least recently
+//   used textures lose their largest mip level (the texture is reallocated from
+//   level 1) until the total fits. Once there is room again, the most recently
+//   used evicted texture is reloaded from its file, one per frame.
+//
+// Loads set stb_image's vertical flip flag from TextureOptions.
+
+#include <glad/glad.h>
+#include <stb_image.h>
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <iostream>
+#include <map>
+#include <string>
+#include <vector>
+
+struct TextureOptions
+{
+    GLenum wrap = GL_REPEAT;
+    bool mipmaps = true;             // GL_LINEAR_MIPMAP_LINEAR, else GL_LINEAR
+    bool flipVertically = false;
+
+    std::string Key() const
+    {
+        return std::to_string(wrap) + (mipmaps ? "m" : "l") + (flipVertically ? "f" : "n");
+    }
+};
+
+// FNV-1a over the image size and pixels
+inline uint64_t HashPixels(const unsigned char* pixels, int width, int height, int components)
+{
+    uint64_t hash = 14695981039346656037ull;
+    auto mix = [&hash](unsigned char byte) {
+        hash ^= byte;
+        hash *= 1099511628211ull;
+    };
+    int header[3] = { width, height, components };
+    for (int value : header)
+        for (int b = 0; b < 4; ++b)
+            mix(static_cast<unsigned char>(value >> (b * 8)));
+    size_t size = static_cast<size_t>(width) * height * components;
+    for (size_t i = 0; i < size; ++i)
+        mix(pixels[i]);
+    return hash;
+}
+
+// bilinear resample to RGBA8 at size x size (texture array layers share one size)
+inline void ResampleToRgba(const unsigned char* pixels, int width, int height, int components, int size, std::vector<unsigned char>& out)
+{
+    out.resize(static_cast<size_t>(size) * size * 4);
+    auto texel = [&](int x, int y, int c) -> float {
+        x = std::clamp(x, 0, width - 1);
+        y = std::clamp(y, 0, height - 1);
+        const unsigned char* p = pixels + (static_cast<size_t>(y) * width + x) * components;
+        if (c == 3)
+            return components == 4 ? p[3] : 255.0f;
+        return components >= 3 ? p[c] : p[0];
+    };
+    for (int y = 0; y < size; ++y)
+        for (int x = 0; x < size; ++x)
+        {
+            float sx = (x + 0.5f) * width / size - 0.5f;
+            float sy = (y + 0.5f) * height / size - 0.5f;
+            int x0 = static_cast<int>(std::floor(sx)), y0 = static_cast<int>(std::floor(sy));
+            float fx = sx - x0, fy = sy - y0;
+            for (int c = 0; c < 4; ++c)
+            {
+                float top = texel(x0, y0, c) * (1.0f - fx) + texel(x0 + 1, y0, c) * fx;
+                float bottom = texel(x0, y0 + 1, c) * (1.0f - fx) + texel(x0 + 1, y0 + 1, c) * fx;
+                out[(static_cast<size_t>(y) * size + x) * 4 + c] = static_cast<unsigned char>(std::clamp(top * (1.0f - fy) + bottom * fy + 0.5f, 0.0f, 255.0f));
+            }
+        }
+}
+
+// bytes for a width x height image with its mip chain. RGB8 is counted as 4 bytes
+// per texel, which is how drivers store it
+inline size_t TextureBytes(int width, int height, int components, bool mipmaps, int layers = 1)
+{
+    size_t texel = components == 3 ? 4 : components;
+    size_t bytes = 0;
+    for (;;)
+    {
+        bytes += static_cast<size_t>(width) * height * texel * layers;
+        if (!mipmaps || (width == 1 && height == 1))
+            break;
+        width = std::max(1, width / 2);
+        height = std::max(1, height / 2);
+    }
+    return bytes;
+}
+
+class TextureManager
+{
+public:
+    static const int MIN_EVICTED_SIZE = 64;  // eviction stops at this width or height
+
+    // bytes of texture memory to stay under; 0 = no budget
+    void SetBudget(size_t bytes) { budget = bytes; }
+
+    // --texture-budget <MB>
+    void ParseOptions(int argc, char** argv)
+    {
+        for (int i = 1; i + 1 < argc; ++i)
+            if (std::string(argv[i]) == "--texture-budget")
+                budget = static_cast<size_t>(std::atof(argv[++i]) * 1024.0 * 1024.0);
+    }
+
+    // 0 when the file can't be read
+    unsigned int Load(const std::string& path, const TextureOptions& options = TextureOptions())
+    {
+        std::string key = path + "|" + options.Key();
+        auto cached = byPath.find(key);
+        if (cached != byPath.end())
+        {
+            ++entries[cached->second].references;
+            ++dedupedLoads;
+            return entries[cached->second].id;
+        }
+
+        int width, height, components;
+        stbi_set_flip_vertically_on_load(options.flipVertically);
+        unsigned char* data = stbi_load(path.c_str(), &width, &height, &components, 0);
+        if (!data)
+        {
+            std::cout << "Texture failed to load at path: " << path << std::endl;
+            return 0;
+        }
+        int entry = Insert(path, options, data, width, height, components);
+        stbi_image_free(data);
+        byPath[key] = entry;
+        return entries[entry].id;
+    }
+
+    // pixels already in memory (generated or fallback images); never evicted
+    unsigned int Create(const std::string& name, const unsigned char* pixels, int width, int height, int components, const TextureOptions& options = TextureOptions())
+    {
+        std::string key = "memory:" + name + "|" + options.Key();
+        auto cached = byPath.find(key);
+        if (cached != byPath.end())
+        {
+            ++entries[cached->second].references;
+            ++dedupedLoads;
+            return entries[cached->second].id;
+        }
+        int entry = Insert(std::string(), options, pixels, width, height, components);
+        byPath[key] = entry;
+        return entries[entry].id;
+    }
+
+    // every image resampled into one layer of a size x size RGBA8 array texture, in order.
+    // Missing files become white layers so layer indices stay stable; an empty path is a
+    // black layer, which is what an untextured mesh sampling texture 0 gets
+    unsigned int LoadArray(const std::vector<std::string>& paths, int size, const TextureOptions& options = TextureOptions())
+    {
+        std::string key = "array:" + std::to_string(size);
+        for (const std::string& path : paths)
+            key += "|" + path;
+        key += "|" + options.Key();
+        auto cached = byPath.find(key);
+        if (cached != byPath.end())
+        {
+            ++entries[cached->second].references;
+            ++dedupedLoads;
+            return entries[cached->second].id;
+        }
+
+        Entry entry;
+        entry.target = GL_TEXTURE_2D_ARRAY;
+        entry.options = options;
+        entry.width = entry.height = size;
+        entry.components = 4;
+        entry.layers = std::max(1, static_cast<int>(paths.size()));
+        glGenTextures(1, &entry.id);
+        glBindTexture(GL_TEXTURE_2D_ARRAY, entry.id);
+        glTexImage3D(GL_TEXTURE_2D_ARRAY, 0, GL_RGBA8, size, size, entry.layers, 0, GL_RGBA, GL_UNSIGNED_BYTE, NULL);
+        std::vector<unsigned char> layer;
+        for (size_t i = 0; i < paths.size(); ++i)
+        {
+            int width, height, components;
+            stbi_set_flip_vertically_on_load(options.flipVertically);
+            unsigned char* data = paths[i].empty() ? NULL : stbi_load(paths[i].c_str(), &width, &height, &components, 0);
+            if (paths[i].empty())
+            {
+                layer.assign(static_cast<size_t>(size) * size * 4, 0);
+                for (size_t texel = 3; texel < layer.size(); texel += 4)
+                    layer[texel] = 255;
+            }
+            else if (data)
+            {
+                ResampleToRgba(data, width, height, components, size, layer);
+                stbi_image_free(data);
+            }
+            else
+            {
+                std::cout << "Texture failed to load at path: " << paths[i] << std::endl;
+                layer.assign(static_cast<size_t>(size) * size * 4, 255);
+            }
+            glTexSubImage3D(GL_TEXTURE_2D_ARRAY, 0, 0, 0, static_cast<int>(i), size, size, 1, GL_RGBA, GL_UNSIGNED_BYTE, layer.data());
+        }
+        SetParameters(GL_TEXTURE_2D_ARRAY, options);
+        glBindTexture(GL_TEXTURE_2D_ARRAY, 0);
+        entry.bytes = TextureBytes(size, size, 4, options.mipmaps, entry.layers);
+        entries.push_back(entry);
+        byId[entry.id] = static_cast<int>(entries.size()) - 1;
+        byPath[key] = static_cast<int>(entries.size()) - 1;
+        return entry.id;
+    }
+
+    // take over the textures a LearnOpenGL Model loaded: ones already known here
+    // (same file or same pixels) replace the model's copy, which is deleted
+    template <typename ModelType>
+    void Adopt(ModelType& model, const TextureOptions& options = TextureOptions())
+    {
+        std::map<unsigned int, unsigned int> replaced;
+        for (auto& loaded : model.textures_loaded)
+        {
+            std::string path = model.directory + "/" + loaded.path;
+            std::string key = path + "|" + options.Key();
+            auto cached = byPath.find(key);
+            if (cached == byPath.end())
+            {
+                int width = 0, height = 0, components = 0;
+                stbi_set_flip_vertically_on_load(options.flipVertically);
+                unsigned char* data = stbi_load(path.c_str(), &width, &height, &components, 0);
+                if (data)
+                {
+                    uint64_t hash = HashPixels(data, width, height, components);
+                    stbi_image_free(data);
+                    auto same = byHash.find(hash);
+                    if (same != byHash.end())
+                        cached = byPath.emplace(key, same->second).first;
+                    else
+                    {
+                        // keep the model's texture and start tracking it
+                        Entry entry;
+                        entry.id = loaded.id;
+                        entry.path = path;
+                        entry.options = options;
+                        entry.width = width;
+                        entry.height = height;
+                        entry.components = components;
+                        entry.hash = hash;
+                        entry.bytes = TextureBytes(width, height, components, true);
+                        entries.push_back(entry);
+                        int index = static_cast<int>(entries.size()) - 1;
+                        byId[entry.id] = index;
+                        byHash[hash] = index;
+                        byPath[key] = index;
+                        continue;
+                    }
+                }
+                else
+                {
+                    continue;
+                }
+            }
+            Entry& existing = entries[cached->second];
+            ++existing.references;
+            ++dedupedLoads;
+            if (existing.id != loaded.id)
+            {
+                replaced[loaded.id] = existing.id;
+                glDeleteTextures(1, &loaded.id);
+                loaded.id = existing.id;
+            }
+        }
+        for (auto& mesh : model.meshes)
+            for (auto& texture : mesh.textures)
+            {
+                auto swap = replaced.find(texture.id);
+                if (swap != replaced.end())
+                    texture.id = swap->second;
+            }
+    }
+
+    // marks a texture as used this frame (LRU order for eviction and restore)
+    void Use(unsigned int texture)
+    {
+        auto found = byId.find(texture);
+        if (found != byId.end())
+            entries[found->second].lastUsed = frame;
+    }
+
+    template <typename ModelType>
+    void UseModel(const ModelType& model)
+    {
+        for (const auto& loaded : model.textures_loaded)
+            Use(loaded.id);
+    }
+
+    // evict mips of the least recently used textures until under budget, or
+    // restore one evicted texture when there is room for it
+    void EndFrame()
+    {
+        ++frame;
+        if (budget == 0)
+            return;
+        while (ResidentBytes() > budget)
+        {
+            int victim = -1;
+            for (size_t i = 0; i < entries.size(); ++i)
+            {
+                const Entry& e = entries[i];
+                if (!Evictable(e) || std::min(e.width, e.height) / 2 < MIN_EVICTED_SIZE)
+                    continue;
+                if (victim < 0 || e.lastUsed < entries[victim].lastUsed)
+                    victim = static_cast<int>(i);
+            }
+            if (victim < 0)
+                break;
+            DropTopLevel(entries[victim]);
+        }
+
+        int restore = -1;
+        for (size_t i = 0; i < entries.size(); ++i)
+            if (entries[i].droppedLevels > 0 && (restore < 0 || entries[i].lastUsed > entries[restore].lastUsed))
+                restore = static_cast<int>(i);
+        if (restore >= 0)
+        {
+            Entry& e = entries[restore];
+            size_t full = TextureBytes(e.width << e.droppedLevels, e.height << e.droppedLevels, e.components, e.options.mipmaps);
+            if (ResidentBytes() - e.bytes + full <= budget)
+                Reload(e);
+        }
+    }
+
+    size_t ResidentBytes() const
+    {
+        size_t total = 0;
+        for (const Entry& e : entries)
+            total += e.bytes;
+        return total;
+    }
+
+    size_t Budget() const { return budget; }
+    int TextureCount() const { return static_cast<int>(entries.size()); }
+    int DedupedLoads() const { return dedupedLoads; }
+
+    int EvictedTextureCount() const
+    {
+        int count = 0;
+        for (const Entry& e : entries)
+            count += e.droppedLevels > 0;
+        return count;
+    }
+
+    void PrintReport() const
+    {
+        std::printf("textures: %d resident, %.2f MB", TextureCount(), ResidentBytes() / (1024.0 * 1024.0));
+        if (budget > 0)
+            std::printf(" of %.2f MB budget", budget / (1024.0 * 1024.0));
+        std::printf(", %d loads deduplicated, %d with evicted mips\n", dedupedLoads, EvictedTextureCount());
+    }
+
+    // drop one reference; the texture is deleted with its last one
+    void Release(unsigned int texture)
+    {
+        auto found = byId.find(texture);
+        if (found == byId.end())
+            return;
+        Entry& e = entries[found->second];
+        if (--e.references > 0)
+            return;
+        glDeleteTextures(1, &e.id);
+        e = Entry();
+        Reindex();
+    }
+
+    void ReleaseAll()
+    {
+        for (Entry& e : entries)
+            glDeleteTextures(1, &e.id);
+        entries.clear();
+        Reindex();
+    }
+
+private:
+    struct Entry
+    {
+        unsigned int id = 0;
+        GLenum target = GL_TEXTURE_2D;
+        std::string path;              // empty: created from memory, can't be reloaded
+        TextureOptions options;
+        int width = 0;                 // resident level 0
+        int height = 0;
+        int components = 0;
+        int layers = 1;
+        int droppedLevels = 0;
+        uint64_t hash = 0;
+        size_t bytes = 0;
+        int references = 1;
+        uint64_t lastUsed = 0;
+    };
+
+    static GLenum Format(int components)
+    {
+        return components == 1 ? GL_RED : components == 3 ? GL_RGB : components == 2 ? GL_RG : GL_RGBA;
+    }
+
+    static void SetParameters(GLenum target, const TextureOptions& options)
+    {
+        if (options.mipmaps)
+            glGenerateMipmap(target);
+        glTexParameteri(target, GL_TEXTURE_WRAP_S, options.wrap);
+        glTexParameteri(target, GL_TEXTURE_WRAP_T, options.wrap);
+        glTexParameteri(target, GL_TEXTURE_MIN_FILTER, options.mipmaps ? GL_LINEAR_MIPMAP_LINEAR : GL_LINEAR);
+        glTexParameteri(target, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+    }
+
+    static void Upload(unsigned int id, const unsigned char* pixels, int width, int height, int components, const TextureOptions& options)
+    {
+        GLenum format = Format(components);
+        glBindTexture(GL_TEXTURE_2D, id);
+        glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+        glTexImage2D(GL_TEXTURE_2D, 0, format, width, height, 0, format, GL_UNSIGNED_BYTE, pixels);
+        glPixelStorei(GL_UNPACK_ALIGNMENT, 4);
+        SetParameters(GL_TEXTURE_2D, options);
+        glBindTexture(GL_TEXTURE_2D, 0);
+    }
+
+    bool Evictable(const Entry& e) const
+    {
+        return e.id != 0 && !e.path.empty() && e.target == GL_TEXTURE_2D && e.options.mipmaps;
+    }
+
+    // a decoded image: reuse a texture with the same pixels, else upload a new one
+    int Insert(const std::string& path, const TextureOptions& options, const unsigned char* pixels, int width, int height, int components)
+    {
+        uint64_t hash = HashPixels(pixels, width, height, components);
+        auto same = byHash.find(hash);
+        if (same != byHash.end() && entries[same->second].options.Key() == options.Key())
+        {
+            ++entries[same->second].references;
+            ++dedupedLoads;
+            return same->second;
+        }
+
+        Entry entry;
+        glGenTextures(1, &entry.id);
+        Upload(entry.id, pixels, width, height, components, options);
+        entry.path = path;
+        entry.options = options;
+        entry.width = width;
+        entry.height = height;
+        entry.components = components;
+        entry.hash = hash;
+        entry.bytes = TextureBytes(width, height, components, options.mipmaps);
+        entry.lastUsed = frame;
+        entries.push_back(entry);
+        int index = static_cast<int>(entries.size()) - 1;
+        byId[entry.id] = index;
+        byHash[hash] = index;
+        return index;
+    }
+
+    // reallocate with level 1 as the new level 0; the old top level's memory is freed
+    void DropTopLevel(Entry& e)
+    {
+        int width = std::max(1, e.width / 2), height = std::max(1, e.height / 2);
+        GLenum format = Format(e.components);
+        std::vector<unsigned char> pixels(static_cast<size_t>(width) * height * e.components);
+        glBindTexture(GL_TEXTURE_2D, e.id);
+        glPixelStorei(GL_PACK_ALIGNMENT, 1);
+        glGetTexImage(GL_TEXTURE_2D, 1, format, GL_UNSIGNED_BYTE, pixels.data());
+        glPixelStorei(GL_PACK_ALIGNMENT, 4);
+        Upload(e.id, pixels.data(), width, height, e.components, e.options);
+        e.width = width;
+        e.height = height;
+        ++e.droppedLevels;
+        e.bytes = TextureBytes(width, height, e.components, true);
+    }
+
+    void Reload(Entry& e)
+    {
+        int width, height, components;
+        stbi_set_flip_vertically_on_load(e.options.flipVertically);
+        unsigned char* data = stbi_load(e.path.c_str(), &width, &height, &components, 0);
+        if (!data)
+            return;
+        Upload(e.id, data, width, height, components, e.options);
+        stbi_image_free(data);
+        e.width = width;
+        e.height = height;
+        e.components = components;
+        e.droppedLevels = 0;
+        e.bytes = TextureBytes(width, height, components, e.options.mipmaps);
+    }
+
+    // drop released entries and rebuild the lookups
+    void Reindex()
+    {
+        std::vector<int> remap(entries.size(), -1);
+        std::vector<Entry> kept;
+        for (size_t i = 0; i < entries.size(); ++i)
+            if (entries[i].id != 0)
+            {
+                remap[i] = static_cast<int>(kept.size());
+                kept.push_back(entries[i]);
+            }
+        entries.swap(kept);
+        byId.clear();
+        for (size_t i = 0; i < entries.size(); ++i)
+            byId[entries[i].id] = static_cast<int>(i);
+        for (auto it = byPath.begin(); it != byPath.end();)
+        {
+            if (remap[it->second] < 0)
+                it = byPath.erase(it);
+            else
+            {
+                it->second = remap[it->second];
+                ++it;
+            }
+        }
+        for (auto it = byHash.begin(); it != byHash.end();)
+        {
+            if (remap[it->second] < 0)
+                it = byHash.erase(it);
+            else
+            {
+                it->second = remap[it->second];
+                ++it;
+            }
+        }
+    }
+
+    std::vector<Entry> entries;
+    std::map<std::string, int> byPath;
+    std::map<uint64_t, int> byHash;
+    std::map<unsigned int, int> byId;
+    size_t budget = 0;
+    uint64_t frame = 0;
+    int dedupedLoads = 0;
+};
+
+#endif
@@ -0,0 +1,380 @@
+#ifndef VERTEX_QUANTIZATION_H
+#define VERTEX_QUANTIZATION_H
+
+// Packed vertices for LearnOpenGL meshes: 28 bytes instead of the 88 of the
+// full-float Vertex.
+//
+//   position   3 x unorm16 (+ pad) relative to the mesh box   attribute 0
+//   normal     2 x snorm16, octahedral                        attribute 1
+//   texcoords  2 x half float                                 attribute 2
+//   tangent    2 x snorm16, octahedral                        attribute 3
+//   bone ids   4 x uint8 (255 = none, 254 = rest pose)        attribute 5
+//   weights    4 x unorm8, summing to 255                     attribute 6
+//
+// The bitangent is not stored: no shader reads it, and cross(normal, tangent)
+// gives it back up to handedness.
+//
+// Vertex shaders built with QUANTIZED_VERTICES (common/shader_permutations.h) decode with
+//   uniform vec3 positionScale;    // mesh box extent
+//   uniform vec3 positionOffset;   // mesh box min
+// and OctDecode for normals. Where a packet's model matrix is already set per
+// draw, MeshMatrix() folds the box into it instead.
+
+#include <glad/glad.h>
+#include <glm/glm.hpp>
+#include <glm/gtc/matrix_transform.hpp>
+
+#include "shader_cache.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <iostream>
+#include <string>
+#include <vector>
+
+struct PackedVertex
+{
+    uint16_t position[4];   // w unused, keeps normal 4-byte aligned
+    int16_t normal[2];
+    uint16_t texCoords[2];
+    int16_t tangent[2];
+    uint8_t boneIds[4];
+    uint8_t weights[4];
+};
+
+const uint8_t PACKED_BONE_NONE = 255;
+const uint8_t PACKED_BONE_REST = 254;   // any id the shader treats as "leave unskinned"
+
+// IEEE half, round to nearest even; out of range saturates to infinity
+inline uint16_t FloatToHalf(float value)
+{
+    uint32_t bits;
+    std::memcpy(&bits, &value, sizeof(bits));
+    uint32_t sign = (bits >> 16) & 0x8000u;
+    int32_t exponent = static_cast<int32_t>((bits >> 23) & 0xFF) - 127 + 15;
+    uint32_t mantissa = bits & 0x7FFFFFu;
+    if (((bits >> 23) & 0xFF) == 0xFF)
+        return static_cast<uint16_t>(sign | 0x7C00u | (mantissa ? 0x200u : 0u));
+    if (exponent >= 31)
+        return static_cast<uint16_t>(sign | 0x7C00u);
+    if (exponent <= 0)
+    {
+        if (exponent < -10)
+            return static_cast<uint16_t>(sign);
+        mantissa |= 0x800000u;
+        uint32_t shift = static_cast<uint32_t>(14 - exponent);
+        uint32_t half = mantissa >> shift;
+        uint32_t rest = mantissa & ((1u << shift) - 1u), halfway = 1u << (shift - 1);
+        if (rest > halfway || (rest == halfway && (half & 1u)))
+            ++half;
+        return static_cast<uint16_t>(sign | half);
+    }
+    uint32_t half = sign | (static_cast<uint32_t>(exponent) << 10) | (mantissa >> 13);
+    uint32_t rest = mantissa & 0x1FFFu;
+    if (rest > 0x1000u || (rest == 0x1000u && (half & 1u)))
+        ++half;   // carries into the exponent correctly
+    return static_cast<uint16_t>(half);
+}
+
+inline float HalfToFloat(uint16_t half)
+{
+    uint32_t sign = (half & 0x8000u) << 16;
+    uint32_t exponent = (half >> 10) & 0x1F;
+    uint32_t mantissa = half & 0x3FFu;
+    uint32_t bits;
+    if (exponent == 0)
+    {
+        float value = std::ldexp(static_cast<float>(mantissa), -24);
+        return sign ? -value : value;
+    }
+    if (exponent == 31)
+        bits = sign | 0x7F800000u | (mantissa << 13);
+    else
+        bits = sign | ((exponent + 127 - 15) << 23) | (mantissa << 13);
+    float value;
+    std::memcpy(&value, &bits, sizeof(value));
+    return value;
+}
+
+inline int16_t PackSnorm16(float value)
+{
+    return static_cast<int16_t>(std::lround(std::clamp(value, -1.0f, 1.0f) * 32767.0f));
+}
+
+inline float UnpackSnorm16(int16_t value)
+{
+    return std::max(static_cast<float>(value) / 32767.0f, -1.0f);
+}
+
+// unit vector onto the octahedron, lower half folded over the diagonals; zero vectors give +z
+inline void OctEncode(const glm::vec3& v, int16_t out[2])
+{
+    float sum = std::fabs(v.x) + std::fabs(v.y) + std::fabs(v.z);
+    if (sum <= 0.0f)
+    {
+        out[0] = out[1] = 0;
+        return;
+    }
+    float x = v.x / sum, y = v.y / sum;
+    if (v.z < 0.0f)
+    {
+        float foldedX = (1.0f - std::fabs(y)) * (x >= 0.0f ? 1.0f : -1.0f);
+        float foldedY = (1.0f - std::fabs(x)) * (y >= 0.0f ? 1.0f : -1.0f);
+        x = foldedX;
+        y = foldedY;
+    }
+    out[0] = PackSnorm16(x);
+    out[1] = PackSnorm16(y);
+}
+
+// the same as the GLSL OctDecode in the vertex shaders
+inline glm::vec3 OctDecode(const int16_t in[2])
+{
+    glm::vec3 n(UnpackSnorm16(in[0]), UnpackSnorm16(in[1]), 0.0f);
+    n.z = 1.0f - std::fabs(n.x) - std::fabs(n.y);
+    float t = std::max(-n.z, 0.0f);
+    n.x += n.x >= 0.0f ? -t : t;
+    n.y += n.y >= 0.0f ? -t : t;
+    return glm::normalize(n);
+}
+
+// worst error over everything packed, in the units of the source data
+struct QuantizationError
+{
+    size_t vertices = 0;
+    float position = 0.0f;          // model units
+    float normalDegrees = 0.0f;
+    float tangentDegrees = 0.0f;
+    float texCoord = 0.0f;
+    float weight = 0.0f;
+    int clampedBoneIds = 0;         // ids >= PACKED_BONE_REST, drawn in the rest pose
+
+    void Merge(const QuantizationError& other)
+    {
+        vertices += other.vertices;
+        position = std::max(position, other.position);
+        normalDegrees = std::max(normalDegrees, other.normalDegrees);
+        tangentDegrees = std::max(tangentDegrees, other.tangentDegrees);
+        texCoord = std::max(texCoord, other.texCoord);
+        weight = std::max(weight, other.weight);
+        clampedBoneIds += other.clampedBoneIds;
+    }
+};
+
+inline float AngleDegrees(const glm::vec3& a, const glm::vec3& b)
+{
+    float lengths = glm::length(a) * glm::length(b);
+    if (lengths <= 0.0f)
+        return 0.0f;
+    return glm::degrees(std::acos(std::clamp(glm::dot(a, b) / lengths, -1.0f, 1.0f)));
+}
+
+// pack one mesh; boundsMin/boundsExtent are what positions decode against
+template <typename MeshType>
+void PackMeshVertices(const MeshType& mesh, std::vector<PackedVertex>& out, glm::vec3& boundsMin, glm::vec3& boundsExtent, QuantizationError& error)
+{
+    out.resize(mesh.vertices.size());
+    glm::vec3 low(0.0f), high(0.0f);
+    if (!mesh.vertices.empty())
+        low = high = mesh.vertices[0].Position;
+    for (const auto& v : mesh.vertices)
+    {
+        low = glm::vec3(std::min(low.x, v.Position.x), std::min(low.y, v.Position.y), std::min(low.z, v.Position.z));
+        high = glm::vec3(std::max(high.x, v.Position.x), std::max(high.y, v.Position.y), std::max(high.z, v.Position.z));
+    }
+    boundsMin = low;
+    boundsExtent = high - low;
+
+    for (size_t i = 0; i < mesh.vertices.size(); ++i)
+    {
+        const auto& v = mesh.vertices[i];
+        PackedVertex& p = out[i];
+
+        glm::vec3 decoded;
+        for (int axis = 0; axis < 3; ++axis)
+        {
+            float t = boundsExtent[axis] > 0.0f ? (v.Position[axis] - low[axis]) / boundsExtent[axis] : 0.0f;
+            p.position[axis] = static_cast<uint16_t>(std::lround(std::clamp(t, 0.0f, 1.0f) * 65535.0f));
+            decoded[axis] = p.position[axis] / 65535.0f * boundsExtent[axis] + low[axis];
+        }
+        p.position[3] = 0;
+        error.position = std::max(error.position, glm::length(decoded - v.Position));
+
+        OctEncode(v.Normal, p.normal);
+        OctEncode(v.Tangent, p.tangent);
+        error.normalDegrees = std::max(error.normalDegrees, AngleDegrees(OctDecode(p.normal), v.Normal));
+        error.tangentDegrees = std::max(error.tangentDegrees, AngleDegrees(OctDecode(p.tangent), v.Tangent));
+
+        for (int c = 0; c < 2; ++c)
+        {
+            p.texCoords[c] = FloatToHalf(v.TexCoords[c]);
+            error.texCoord = std::max(error.texCoord, std::fabs(HalfToFloat(p.texCoords[c]) - v.TexCoords[c]));
+        }
+
+        // weights rounded to 1/255, then the largest absorbs the rounding so they still sum to one
+        int largest = 0, sum = 0;
+        float sourceSum = 0.0f;
+        for (int k = 0; k < 4; ++k)
+        {
+            int id = v.m_BoneIDs[k];
+            if (id < 0)
+                p.boneIds[k] = PACKED_BONE_NONE;
+            else if (id >= PACKED_BONE_REST)
+            {
+                p.boneIds[k] = PACKED_BONE_REST;
+                ++error.clampedBoneIds;
+            }
+            else
+                p.boneIds[k] = static_cast<uint8_t>(id);
+            p.weights[k] = static_cast<uint8_t>(std::lround(std::clamp(v.m_Weights[k], 0.0f, 1.0f) * 255.0f));
+            sum += p.weights[k];
+            sourceSum += v.m_Weights[k];
+            if (p.weights[k] > p.weights[largest])
+                largest = k;
+        }
+        if (sum > 0 && std::fabs(sourceSum - 1.0f) < 1.0e-3f)
+            p.weights[largest] = static_cast<uint8_t>(std::clamp(p.weights[largest] + 255 - sum, 0, 255));
+        for (int k = 0; k < 4; ++k)
+            error.weight = std::max(error.weight, std::fabs(p.weights[k] / 255.0f - v.m_Weights[k]));
+    }
+    error.vertices += mesh.vertices.size();
+}
+
+inline void PrintQuantizationReport(const std::string& name, const QuantizationError& error, size_t sourceVertexBytes)
+{
+    std::cout << "quantized " << name << ": " << error.vertices << " vertices, " << sourceVertexBytes << " -> " << sizeof(PackedVertex)
+              << " bytes each (" << static_cast<double>(sourceVertexBytes) / sizeof(PackedVertex) << "x); max error position " << error.position
+              << ", normal " << error.normalDegrees << " deg, tangent " << error.tangentDegrees << " deg, texcoord " << error.texCoord
+              << ", weight " << error.weight << ", " << error.clampedBoneIds << " bone ids clamped" << std::endl;
+}
+
+// a packed VAO per mesh of a LearnOpenGL Model, drawn like Mesh::Draw
+template <typename ModelType>
+class QuantizedModel
+{
+public:
+    // releaseSource drops the storage of the model's own vertex and index buffers; its
+    // mesh VAOs must not be drawn after that (CPU-side vertices are kept)
+    void Init(ModelType& source, bool releaseSource)
+    {
+        model = &source;
+        error = QuantizationError();
+        std::vector<PackedVertex> packed;
+        for (auto& mesh : source.meshes)
+        {
+            PackedMesh out;
+            QuantizationError meshError;
+            PackMeshVertices(mesh, packed, out.boundsMin, out.boundsExtent, meshError);
+            error.Merge(meshError);
+            out.indexCount = static_cast<int>(mesh.indices.size());
+
+            glGenVertexArrays(1, &out.vao);
+            glGenBuffers(1, &out.vbo);
+            glGenBuffers(1, &out.ebo);
+            glBindVertexArray(out.vao);
+            glBindBuffer(GL_ARRAY_BUFFER, out.vbo);
+            glBufferData(GL_ARRAY_BUFFER, packed.size() * sizeof(PackedVertex), packed.data(), GL_STATIC_DRAW);
+            glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, out.ebo);
+            glBufferData(GL_ELEMENT_ARRAY_BUFFER, mesh.indices.size() * sizeof(unsigned int), mesh.indices.data(), GL_STATIC_DRAW);
+            const GLsizei stride = sizeof(PackedVertex);
+            glEnableVertexAttribArray(0);
+            glVertexAttribPointer(0, 3, GL_UNSIGNED_SHORT, GL_TRUE, stride, (void*)offsetof(PackedVertex, position));
+            glEnableVertexAttribArray(1);
+            glVertexAttribPointer(1, 2, GL_SHORT, GL_TRUE, stride, (void*)offsetof(PackedVertex, normal));
+            glEnableVertexAttribArray(2);
+            glVertexAttribPointer(2, 2, GL_HALF_FLOAT, GL_FALSE, stride, (void*)offsetof(PackedVertex, texCoords));
+            glEnableVertexAttribArray(3);
+            glVertexAttribPointer(3, 2, GL_SHORT, GL_TRUE, stride, (void*)offsetof(PackedVertex, tangent));
+            glEnableVertexAttribArray(5);
+            glVertexAttribIPointer(5, 4, GL_UNSIGNED_BYTE, stride, (void*)offsetof(PackedVertex, boneIds));
+            glEnableVertexAttribArray(6);
+            glVertexAttribPointer(6, 4, GL_UNSIGNED_BYTE, GL_TRUE, stride, (void*)offsetof(PackedVertex, weights));
+            glBindVertexArray(0);
+
+            if (releaseSource)
+                ReleaseSourceBuffers(mesh.VAO);
+            meshes.push_back(out);
+        }
+        glBindBuffer(GL_ARRAY_BUFFER, 0);
+    }
+
+    // every mesh with its textures bound as Mesh::Draw binds them and its box in the decode uniforms
+    template <typename ShaderType>
+    void Draw(const ShaderType& shader) const
+    {
+        for (size_t m = 0; m < meshes.size(); ++m)
+        {
+            BindMeshTextures(shader, model->meshes[m].textures);
+            glUniform3fv(glGetUniformLocation(shader.ID, "positionScale"), 1, &meshes[m].boundsExtent[0]);
+            glUniform3fv(glGetUniformLocation(shader.ID, "positionOffset"), 1, &meshes[m].boundsMin[0]);
+            glBindVertexArray(meshes[m].vao);
+            glDrawElements(GL_TRIANGLES, meshes[m].indexCount, GL_UNSIGNED_INT, 0);
+        }
+        glBindVertexArray(0);
+        glActiveTexture(GL_TEXTURE0);
+    }
+
+    int MeshCount() const { return static_cast<int>(meshes.size()); }
+    unsigned int Vao(int mesh) const { return meshes[mesh].vao; }
+
+    // mesh box to model space, for packets that only carry a model matrix
+    glm::mat4 MeshMatrix(int mesh) const
+    {
+        glm::mat4 box = glm::translate(glm::mat4(1.0f), meshes[mesh].boundsMin);
+        return glm::scale(box, meshes[mesh].boundsExtent);
+    }
+
+    const QuantizationError& Error() const { return error; }
+
+    size_t Bytes() const { return error.vertices * sizeof(PackedVertex); }
+
+    void Release()
+    {
+        for (PackedMesh& mesh : meshes)
+        {
+            glDeleteVertexArrays(1, &mesh.vao);
+            glDeleteBuffers(1, &mesh.vbo);
+            glDeleteBuffers(1, &mesh.ebo);
+        }
+        meshes.clear();
+    }
+
+private:
+    struct PackedMesh
+    {
+        unsigned int vao = 0;
+        unsigned int vbo = 0;
+        unsigned int ebo = 0;
+        int indexCount = 0;
+        glm::vec3 boundsMin = glm::vec3(0.0f);
+        glm::vec3 boundsExtent = glm::vec3(0.0f);
+    };
+
+    // Mesh keeps its buffer names private; find them through its VAO and shrink them to nothing
+    static void ReleaseSourceBuffers(unsigned int sourceVao)
+    {
+        GLint vertexBuffer = 0, indexBuffer = 0;
+        glBindVertexArray(sourceVao);
+        glGetVertexAttribiv(0, GL_VERTEX_ATTRIB_ARRAY_BUFFER_BINDING, &vertexBuffer);
+        glGetIntegerv(GL_ELEMENT_ARRAY_BUFFER_BINDING, &indexBuffer);
+        glBindVertexArray(0);
+        GLint buffers[] = { vertexBuffer, indexBuffer };
+        for (GLint buffer : buffers)
+        {
+            if (buffer == 0)
+                continue;
+            glBindBuffer(GL_COPY_WRITE_BUFFER, buffer);
+            glBufferData(GL_COPY_WRITE_BUFFER, 0, NULL, GL_STATIC_DRAW);
+        }
+        glBindBuffer(GL_COPY_WRITE_BUFFER, 0);
+    }
+
+    ModelType* model = nullptr;
+    std::vector<PackedMesh> meshes;
+    QuantizationError error;
+};
+
+#endif
@@ -0,0 +1,62 @@
+// cascade splits and fitting (common/cascaded_shadows.h)
+
+#undef NDEBUG
+#include <cassert>
+
+#include "../common/cascaded_shadows.h"
+
+#include <glm/gtc/matrix_transform.hpp>
+
+#include <cmath>
+
+static void CheckView(const glm::mat4& view, float shadowDistance, int cascadeCount, float casterReach)
+{
+    const float fovY = glm::radians(45.0f);
+    const float aspect = 800.0f / 600.0f;
+    const glm::vec3 sun = glm::normalize(glm::vec3(-0.4f, -1.0f, -0.3f));
+    ShadowCascade cascades[MAX_SHADOW_CASCADES];
+    int count = FitCascades(view, fovY, aspect, 0.1f, shadowDistance, sun, cascadeCount, 2048, casterReach, cascades);
+    assert(count == cascadeCount);
+    assert(CheckCascadeFit(view, fovY, aspect, 0.1f, shadowDistance, cascades, count, 2048) == 0);
+}
+
+void TestCascadedShadows()
+{
+    // splits grow, end at the far distance and sit between uniform and logarithmic
+    float splits[MAX_SHADOW_CASCADES];
+    ComputeCascadeSplits(0.1f, 400.0f, 4, 0.75f, splits);
+    assert(splits[3] == 400.0f);
+    for (int i = 1; i < 4; ++i)
+        assert(splits[i] > splits[i - 1]);
+    assert(splits[0] > 0.1f * std::pow(4000.0f, 0.25f) && splits[0] < 100.0f);
+
+    // the character demo's orbit camera over its pitch and zoom range, 3 cascades over 25 units
+    for (float distance = 3.0f; distance <= 12.0f; distance += 1.5f)
+        for (float pitch = -30.0f; pitch <= 75.0f; pitch += 5.0f)
+        {
+            float p = glm::radians(pitch);
+            glm::vec3 target(0.0f, 1.0f, 0.0f);
+            glm::vec3 eye = target + distance * glm::vec3(0.0f, std::sin(p), std::cos(p));
+            CheckView(glm::lookAt(eye, target, glm::vec3(0.0f, 1.0f, 0.0f)), 25.0f, 3, 20.0f);
+        }
+
+    // the plane game's chase camera over a banking climb, 4 cascades over 400 units; the
+    // camera moves by fractions of a texel, so the snap is checked away from round numbers
+    for (int frame = 0; frame < 600; ++frame)
+    {
+        float heading = frame * 0.013f;
+        float bank = std::sin(frame * 0.021f) * 0.8f;
+        glm::vec3 forward(std::sin(heading), 0.2f, -std::cos(heading));
+        glm::vec3 position = glm::vec3(frame * 0.37f, 50.0f + frame * 0.11f, frame * -0.53f);
+        glm::vec3 up(std::sin(bank) * std::cos(heading), std::cos(bank), std::sin(bank) * std::sin(heading));
+        glm::vec3 eye = position - 12.0f * glm::normalize(forward) + glm::vec3(0.0f, 3.0f, 0.0f);
+        CheckView(glm::lookAt(eye, position, up), 400.0f, 4, 600.0f);
+    }
+
+    // a caster inside the last cascade's box counts, one far behind the camera does not
+    glm::mat4 view = glm::lookAt(glm::vec3(0.0f, 2.0f, 6.0f), glm::vec3(0.0f, 1.0f, 0.0f), glm::vec3(0.0f, 1.0f, 0.0f));
+    ShadowCascade cascades[MAX_SHADOW_CASCADES];
+    FitCascades(view, glm::radians(45.0f), 800.0f / 600.0f, 0.1f, 25.0f, glm::normalize(glm::vec3(-0.4f, -1.0f, -0.3f)), 3, 2048, 20.0f, cascades);
+    assert(SphereInCascade(cascades[2], glm::vec3(0.0f, 1.0f, 0.0f), 1.0f));
+    assert(!SphereInCascade(cascades[2], glm::vec3(0.0f, 1.0f, 500.0f), 1.0f));
+}
@@ -0,0 +1,114 @@
+// draw keys, packet sorting and state-change counting (common/draw_packet.h)
+
+#undef NDEBUG
+#include <cassert>
+
+#include "../common/draw_packet.h"
+
+#include <vector>
+
+static DrawPacket MakePacket(unsigned int program, unsigned int texture, unsigned int vao, uint32_t layer, float depth01)
+{
+    DrawPacket packet;
+    packet.program = program;
+    packet.vao = vao;
+    packet.textures[0] = texture;
+    packet.textureCount = 1;
+    packet.key = PackDrawKey(packet, layer, depth01);
+    return packet;
+}
+
+static std::vector<uint32_t> Sorted(const std::vector<DrawPacket>& packets, DrawOrder drawOrder)
+{
+    std::vector<uint32_t> order;
+    SortDrawPackets(packets, order, drawOrder);
+    return order;
+}
+
+void TestDrawPackets()
+{
+    // every field comes back out of the key, at the widest value it holds
+    uint64_t key = PackDrawKey(DRAW_KEY_MAX_LAYER, DRAW_KEY_MAX_PROGRAM, 0x1234, DRAW_KEY_MAX_NAME, 1.0f);
+    assert(DrawKeyLayer(key) == DRAW_KEY_MAX_LAYER);
+    assert(DrawKeyProgram(key) == DRAW_KEY_MAX_PROGRAM);
+    assert(DrawKeyTexture(key) == 0x1234);
+    assert(DrawKeyVao(key) == DRAW_KEY_MAX_NAME);
+    assert(DrawKeyDepth(key) == 0xFFFF);
+    key = PackDrawKey(3, 7, 0, 9, 0.5f);
+    assert(DrawKeyLayer(key) == 3 && DrawKeyProgram(key) == 7 && DrawKeyTexture(key) == 0 && DrawKeyVao(key) == 9);
+    assert(DrawKeyDepth(key) == static_cast<uint32_t>(0.5f * 65535.0f));
+    assert(DrawKeyDepth(PackDrawKey(0, 0, 0, 0, -1.0f)) == 0);
+    assert(DrawKeyDepth(PackDrawKey(0, 0, 0, 0, 2.0f)) == 0xFFFF);
+
+    // state order: layer, then program, then texture, then VAO, then depth
+    {
+        std::vector<DrawPacket> packets = {
+            MakePacket(1, 1, 1, 1, 0.0f),   // 0: later layer outranks everything below it
+            MakePacket(2, 1, 1, 0, 0.0f),   // 1
+            MakePacket(1, 2, 1, 0, 0.0f),   // 2
+            MakePacket(1, 1, 2, 0, 0.0f),   // 3
+            MakePacket(1, 1, 1, 0, 0.9f),   // 4
+            MakePacket(1, 1, 1, 0, 0.1f),   // 5
+        };
+        std::vector<uint32_t> expected = { 5, 4, 3, 2, 1, 0 };
+        assert(Sorted(packets, DrawOrder::State) == expected);
+    }
+
+    // equal keys keep the order they were pushed in
+    {
+        std::vector<DrawPacket> packets;
+        for (int i = 0; i < 64; ++i)
+            packets.push_back(MakePacket(1 + i % 2, 1, 1, 0, 0.25f));
+        std::vector<uint32_t> order = Sorted(packets, DrawOrder::State);
+        for (size_t i = 1; i < order.size(); ++i)
+        {
+            assert(packets[order[i - 1]].key <= packets[order[i]].key);
+            if (packets[order[i - 1]].key == packets[order[i]].key)
+                assert(order[i - 1] < order[i]);
+        }
+        order = Sorted(packets, DrawOrder::FrontToBack);
+        for (size_t i = 1; i < order.size(); ++i)
+            if (packets[order[i - 1]].key == packets[order[i]].key)
+                assert(order[i - 1] < order[i]);
+    }
+
+    // front to back: layer first, then nearest first whatever the state
+    {
+        std::vector<DrawPacket> packets = {
+            MakePacket(1, 1, 1, 0, 0.8f),   // 0
+            MakePacket(9, 9, 9, 0, 0.2f),   // 1
+            MakePacket(5, 5, 5, 1, 0.0f),   // 2: later layer, drawn last though nearest
+            MakePacket(1, 1, 1, 0, 0.5f),   // 3
+        };
+        std::vector<uint32_t> expected = { 1, 3, 0, 2 };
+        assert(Sorted(packets, DrawOrder::FrontToBack) == expected);
+    }
+
+    // two programs drawing two meshes (texture and VAO each), interleaved: unsorted and
+    // unelided every packet binds all three; sorted and elided only the changes are counted
+    {
+        std::vector<DrawPacket> packets;
+        for (int i = 0; i < 8; ++i)
+        {
+            unsigned int mesh = 1 + (i / 2) % 2;
+            packets.push_back(MakePacket(1 + i % 2, mesh, mesh, 0, 0.0f));
+        }
+        std::vector<uint32_t> insertion(packets.size());
+        for (size_t i = 0; i < insertion.size(); ++i)
+            insertion[i] = static_cast<uint32_t>(i);
+
+        RenderStateStats naive = CountStateChanges(packets, insertion, false);
+        assert(naive.programBinds == 8 && naive.vaoBinds == 8 && naive.textureBinds == 8 && naive.draws == 8);
+        assert(naive.Total() == 24);
+
+        RenderStateStats unsortedElided = CountStateChanges(packets, insertion, true);
+        assert(unsortedElided.programBinds == 8);   // the program alternates every packet
+        assert(unsortedElided.textureBinds == 4 && unsortedElided.vaoBinds == 4);
+
+        RenderStateStats sorted = CountStateChanges(packets, Sorted(packets, DrawOrder::State), true);
+        assert(sorted.programBinds == 2);
+        assert(sorted.textureBinds == 4 && sorted.vaoBinds == 4);   // each mesh once per program
+        assert(sorted.draws == 8);
+        assert(sorted.Total() < unsortedElided.Total() && sorted.Total() < naive.Total());
+    }
+}
@@ -0,0 +1,44 @@
+// the arena's offset allocator (common/geometry_arena.h)
+
+#undef NDEBUG
+#include <cassert>
+
+#include "../common/geometry_arena.h"
+
+void TestGeometryArena()
+{
+    // best fit picks the smallest free block that holds the request
+    OffsetAllocator allocator(100);
+    uint32_t a = allocator.Allocate(10), b = allocator.Allocate(30), c = allocator.Allocate(20), d = allocator.Allocate(5);
+    assert(a == 0 && b == 10 && c == 40 && d == 60);
+    allocator.Free(b);
+    assert(allocator.Allocate(25) == 10);    // 30 at 10 beats 35 at 65
+    allocator.Free(10);
+    assert(allocator.Allocate(0) == OffsetAllocator::INVALID && allocator.Allocate(101) == OffsetAllocator::INVALID);
+
+    // freeing merges with both neighbours
+    allocator.Free(a);
+    allocator.Free(c);
+    assert(allocator.FreeBlockCount() == 2 && allocator.LargestFreeBlock() == 60);
+    allocator.Free(d);
+    assert(allocator.FreeBlockCount() == 1 && allocator.UsedSize() == 0 && allocator.LargestFreeBlock() == 100);
+
+    // defragment lists every live block in order and leaves one free block at the end
+    a = allocator.Allocate(10);
+    b = allocator.Allocate(10);
+    c = allocator.Allocate(10);
+    allocator.Free(a);
+    std::vector<OffsetAllocator::Move> moves = allocator.Defragment();
+    assert(moves.size() == 2);
+    assert(moves[0].from == b && moves[0].to == 0 && moves[0].size == 10);
+    assert(moves[1].from == c && moves[1].to == 10 && moves[1].size == 10);
+    assert(allocator.FreeBlockCount() == 1 && allocator.LargestFreeBlock() == 80 && allocator.SizeOf(10) == 10);
+
+    // random allocate, free and defragment against an owner map, over a few seeds
+    for (unsigned seed = 1; seed <= 8; ++seed)
+    {
+        OffsetAllocatorStats stats;
+        assert(CheckOffsetAllocator(20000, 4096, seed, stats) == 0);
+        assert(stats.allocations > 0 && stats.failedAllocations > 0 && stats.defragments > 0);
+    }
+}
@@ -0,0 +1,31 @@
+// CPU tests for the header-only helpers in common/. They need the glm, glad and
+// stb headers but no GL library, window or assets. From the repository root:
+//
+//   g++ -std=c++17 -pthread -I/path/to/LearnOpenGL/includes tests/*.cpp -o cpu_tests && ./cpu_tests
+//
+// Each check is a plain assert, so the first failure stops the run with its line.
+
+#include <iostream>
+
+void TestDrawPackets();
+void TestCascadedShadows();
+void TestOcclusionCulling();
+void TestTextureManager();
+void TestModelBatch();
+void TestGeometryArena();
+void TestVertexQuantization();
+void TestShaderPermutations();
+
+int main()
+{
+    TestDrawPackets();
+    TestCascadedShadows();
+    TestOcclusionCulling();
+    TestTextureManager();
+    TestModelBatch();
+    TestGeometryArena();
+    TestVertexQuantization();
+    TestShaderPermutations();
+    std::cout << "cpu tests passed" << std::endl;
+    return 0;
+}
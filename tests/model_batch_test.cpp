@@ -0,0 +1,69 @@
+// merging a model's meshes into one draw (common/model_batch.h)
+
+#undef NDEBUG
+#include <cassert>
+
+#include "../common/model_batch.h"
+#include "test_model.h"
+
+#include <string>
+#include <vector>
+
+void TestModelBatch()
+{
+    // four meshes: two share a diffuse texture, one has its own and one has none
+    TestModel model;
+    model.directory = "island";
+    const char* diffuse[] = { "rock.png", "sand.png", "rock.png", nullptr };
+    for (int m = 0; m < 4; ++m)
+    {
+        TestMesh mesh = MakeGridMesh(m + 1, 10.0f, glm::vec3(20.0f * m, 0.0f, 0.0f));
+        TestTexture normalMap;
+        normalMap.type = "texture_normal";
+        normalMap.path = "normal.png";
+        mesh.textures.push_back(normalMap);
+        if (diffuse[m])
+        {
+            TestTexture texture;
+            texture.type = "texture_diffuse";
+            texture.path = diffuse[m];
+            mesh.textures.push_back(texture);
+        }
+        model.meshes.push_back(mesh);
+    }
+
+    std::vector<BatchVertex> vertices;
+    std::vector<unsigned int> indices;
+    std::vector<std::string> layerPaths;
+    MergeModelMeshes(model, vertices, indices, layerPaths);
+
+    // one layer per distinct diffuse path, in first-use order, "" for no texture
+    assert(layerPaths.size() == 3);
+    assert(layerPaths[0] == "island/rock.png" && layerPaths[1] == "island/sand.png" && layerPaths[2].empty());
+    const float expectedLayer[] = { 0.0f, 1.0f, 0.0f, 2.0f };
+
+    // every vertex and index comes across, indices rebased onto their mesh's vertices
+    size_t vertexBase = 0, indexBase = 0;
+    for (size_t m = 0; m < model.meshes.size(); ++m)
+    {
+        const TestMesh& mesh = model.meshes[m];
+        for (size_t v = 0; v < mesh.vertices.size(); ++v)
+        {
+            const BatchVertex& merged = vertices[vertexBase + v];
+            assert(merged.position.x == mesh.vertices[v].Position.x && merged.position.z == mesh.vertices[v].Position.z);
+            assert(merged.texCoords.x == mesh.vertices[v].TexCoords.x && merged.texCoords.y == mesh.vertices[v].TexCoords.y);
+            assert(merged.material == expectedLayer[m]);
+        }
+        for (size_t i = 0; i < mesh.indices.size(); ++i)
+            assert(indices[indexBase + i] == vertexBase + mesh.indices[i]);
+        vertexBase += mesh.vertices.size();
+        indexBase += mesh.indices.size();
+    }
+    assert(vertices.size() == vertexBase && indices.size() == indexBase);
+    for (unsigned int index : indices)
+        assert(index < vertices.size());
+
+    // merging again starts over
+    MergeModelMeshes(model, vertices, indices, layerPaths);
+    assert(vertices.size() == vertexBase && layerPaths.size() == 3);
+}
@@ -0,0 +1,60 @@
+// software Hi-Z against the per-pixel occlusion test (common/occlusion_culling.h)
+
+#undef NDEBUG
+#include <cassert>
+
+#include "../common/occlusion_culling.h"
+
+#include <cmath>
+#include <vector>
+
+void TestOcclusionCulling()
+{
+    // a low circuit around a large hill with three smaller ones (square pyramids standing
+    // in for islands), each hill's box tested against the depth of the other three. Hi-Z
+    // may keep a box the per-pixel test would cull but must never cull one it would keep
+    const glm::vec3 hills[] = { glm::vec3(0.0f), glm::vec3(450.0f, 0.0f, 100.0f), glm::vec3(-400.0f, 0.0f, -300.0f), glm::vec3(150.0f, 0.0f, -500.0f) };
+    const float hillScales[] = { 2.5f, 1.0f, 1.0f, 1.0f };
+    const float hillHalfWidth = 120.0f, hillHeight = 90.0f;
+    std::vector<glm::vec3> hillVertices = {
+        glm::vec3(-hillHalfWidth, 0.0f, -hillHalfWidth), glm::vec3(hillHalfWidth, 0.0f, -hillHalfWidth),
+        glm::vec3(hillHalfWidth, 0.0f, hillHalfWidth), glm::vec3(-hillHalfWidth, 0.0f, hillHalfWidth),
+        glm::vec3(0.0f, hillHeight, 0.0f)
+    };
+    std::vector<unsigned int> hillIndices = { 0, 1, 4, 1, 2, 4, 2, 3, 4, 3, 0, 4, 0, 2, 1, 0, 3, 2 };
+    DepthRaster raster(256, 144);
+    HiZPyramid hiZ;
+    glm::mat4 projection = glm::perspective(glm::radians(45.0f), 800.0f / 600.0f, 0.1f, 1000.0f);
+    int hiZCulled = 0, exactCulled = 0;
+    for (int frame = 0; frame < 360; ++frame)
+    {
+        float angle = glm::radians(static_cast<float>(frame));
+        glm::vec3 eye(std::cos(angle) * 700.0f, 20.0f, std::sin(angle) * 700.0f);
+        glm::mat4 viewProjection = projection * glm::lookAt(eye, glm::vec3(0.0f, 20.0f, 0.0f), glm::vec3(0.0f, 1.0f, 0.0f));
+        for (int tested = 0; tested < 4; ++tested)
+        {
+            raster.Clear();
+            for (int hill = 0; hill < 4; ++hill)
+                if (hill != tested)
+                    raster.RasterizeMesh(hillVertices, hillIndices, viewProjection * glm::scale(glm::translate(glm::mat4(1.0f), hills[hill]), glm::vec3(hillScales[hill])));
+            hiZ.Build(raster);
+            glm::vec3 boxMin = hills[tested] + glm::vec3(-hillHalfWidth, 0.0f, -hillHalfWidth) * hillScales[tested];
+            glm::vec3 boxMax = hills[tested] + glm::vec3(hillHalfWidth, hillHeight, hillHalfWidth) * hillScales[tested];
+            bool culled = hiZ.BoxOccluded(boxMin, boxMax, viewProjection);
+            bool exact = BoxOccludedExact(raster, boxMin, boxMax, viewProjection);
+            assert(!culled || exact);
+            hiZCulled += culled;
+            exactCulled += exact;
+        }
+    }
+    // the big hill hides the small ones for part of the circuit, and Hi-Z finds some of it
+    assert(exactCulled > 0);
+    assert(hiZCulled > 0 && hiZCulled <= exactCulled);
+
+    // a box behind the camera crosses the near plane and is never culled
+    raster.Clear();
+    glm::mat4 viewProjection = projection * glm::lookAt(glm::vec3(0.0f, 20.0f, 700.0f), glm::vec3(0.0f, 20.0f, 0.0f), glm::vec3(0.0f, 1.0f, 0.0f));
+    hiZ.Build(raster);
+    assert(ProjectBox(glm::vec3(-10.0f, 0.0f, 690.0f), glm::vec3(10.0f, 40.0f, 710.0f), viewProjection).crossesNearPlane);
+    assert(!hiZ.BoxOccluded(glm::vec3(-10.0f, 0.0f, 690.0f), glm::vec3(10.0f, 40.0f, 710.0f), viewProjection));
+}
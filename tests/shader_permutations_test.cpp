@@ -0,0 +1,43 @@
+// permutation keys and defines (common/shader_permutations.h)
+
+#undef NDEBUG
+#include <cassert>
+
+#include "../common/shader_permutations.h"
+#include "test_model.h"
+
+void TestShaderPermutations()
+{
+    // every key round trips and gets its own define block: three surfaces by four influence
+    // counts, with and without packed vertices and array materials
+    int validKeys = 0;
+    assert(CheckPermutationKeys(validKeys) == 0);
+    assert(validKeys == 48);
+
+    ShaderPermutation boat;
+    boat.surface = SurfaceVariant::Boat;
+    boat.boneInfluences = 2;
+    assert(PermutationDefines(boat) == "#define SURFACE_BOAT\n#define BONE_INFLUENCES 2\n");
+    ShaderPermutation packed;
+    packed.boneInfluences = 4;
+    packed.quantizedVertices = true;
+    assert(PermutationDefines(packed) == "#define BONE_INFLUENCES 4\n#define QUANTIZED_VERTICES\n");
+    ShaderPermutation batched;
+    batched.materialArray = true;
+    assert(PermutationDefines(batched) == "#define MATERIAL_ARRAY\n");
+    assert(PermutationKey(batched) != PermutationKey(ShaderPermutation()));
+    assert(PermutationDefines(ShaderPermutation()).empty());
+
+    // the influence count comes from the last used bone slot of any vertex
+    TestModel model;
+    model.meshes.push_back(MakeGridMesh(2, 1.0f, glm::vec3(0.0f)));
+    assert(MaxBoneInfluences(model) == 0);
+    TestVertex& v = model.meshes[0].vertices[4];
+    v.m_BoneIDs[0] = 3;
+    v.m_Weights[0] = 0.5f;
+    v.m_BoneIDs[2] = 7;
+    v.m_Weights[2] = 0.5f;
+    assert(MaxBoneInfluences(model) == 3 && SkinningVariant(3) == 4);
+    v.m_Weights[2] = 0.0f;
+    assert(MaxBoneInfluences(model) == 1 && SkinningVariant(1) == 1);
+}
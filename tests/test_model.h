@@ -0,0 +1,69 @@
+#ifndef TEST_MODEL_H
+#define TEST_MODEL_H
+
+// Stand-ins for LearnOpenGL's Vertex, Texture, Mesh and Model with the members the
+// templates in common/ read, so model code runs on made-up geometry without GL.
+
+#include <glm/glm.hpp>
+
+#include <string>
+#include <vector>
+
+const int TEST_MAX_BONE_INFLUENCE = 4;
+
+struct TestVertex
+{
+    glm::vec3 Position = glm::vec3(0.0f);
+    glm::vec3 Normal = glm::vec3(0.0f, 1.0f, 0.0f);
+    glm::vec2 TexCoords = glm::vec2(0.0f);
+    glm::vec3 Tangent = glm::vec3(1.0f, 0.0f, 0.0f);
+    glm::vec3 Bitangent = glm::vec3(0.0f, 0.0f, 1.0f);
+    int m_BoneIDs[TEST_MAX_BONE_INFLUENCE] = { -1, -1, -1, -1 };
+    float m_Weights[TEST_MAX_BONE_INFLUENCE] = {};
+};
+
+struct TestTexture
+{
+    unsigned int id = 0;
+    std::string type;
+    std::string path;
+};
+
+struct TestMesh
+{
+    std::vector<TestVertex> vertices;
+    std::vector<unsigned int> indices;
+    std::vector<TestTexture> textures;
+    unsigned int VAO = 0;
+};
+
+struct TestModel
+{
+    std::vector<TestTexture> textures_loaded;
+    std::vector<TestMesh> meshes;
+    std::string directory;
+};
+
+// a grid of quads in the xz plane: (cells + 1)^2 vertices, two triangles per cell
+inline TestMesh MakeGridMesh(int cells, float size, const glm::vec3& offset)
+{
+    TestMesh mesh;
+    for (int z = 0; z <= cells; ++z)
+        for (int x = 0; x <= cells; ++x)
+        {
+            TestVertex v;
+            v.Position = offset + glm::vec3(size * x / cells, 0.0f, size * z / cells);
+            v.TexCoords = glm::vec2(static_cast<float>(x) / cells, static_cast<float>(z) / cells);
+            mesh.vertices.push_back(v);
+        }
+    for (int z = 0; z < cells; ++z)
+        for (int x = 0; x < cells; ++x)
+        {
+            unsigned int corner = static_cast<unsigned int>(z * (cells + 1) + x);
+            unsigned int quad[6] = { corner, corner + cells + 1, corner + 1, corner + 1, corner + cells + 1, corner + cells + 2 };
+            mesh.indices.insert(mesh.indices.end(), quad, quad + 6);
+        }
+    return mesh;
+}
+
+#endif
@@ -0,0 +1,46 @@
+// pixel hashing, resampling and texture sizes (common/texture_manager.h)
+
+#undef NDEBUG
+#include <cassert>
+
+#include "../common/texture_manager.h"
+
+#include <vector>
+
+void TestTextureManager()
+{
+    // identical pixels hash alike wherever they came from; one changed byte, or the same
+    // bytes read as another size or component count, hash differently
+    std::vector<unsigned char> image(16 * 8 * 3);
+    for (size_t i = 0; i < image.size(); ++i)
+        image[i] = static_cast<unsigned char>(i * 7);
+    std::vector<unsigned char> copy = image;
+    assert(HashPixels(image.data(), 16, 8, 3) == HashPixels(copy.data(), 16, 8, 3));
+    copy[100] ^= 1;
+    assert(HashPixels(image.data(), 16, 8, 3) != HashPixels(copy.data(), 16, 8, 3));
+    assert(HashPixels(image.data(), 16, 8, 3) != HashPixels(image.data(), 8, 16, 3));
+    assert(HashPixels(image.data(), 16, 8, 3) != HashPixels(image.data(), 16, 6, 4));
+
+    // resampling keeps a flat colour, fills alpha for RGB and spreads grey to RGB
+    std::vector<unsigned char> flat(5 * 3 * 3), out;
+    for (size_t i = 0; i < flat.size(); i += 3)
+    {
+        flat[i] = 10;
+        flat[i + 1] = 200;
+        flat[i + 2] = 90;
+    }
+    ResampleToRgba(flat.data(), 5, 3, 3, 8, out);
+    assert(out.size() == 8 * 8 * 4);
+    for (size_t i = 0; i < out.size(); i += 4)
+        assert(out[i] == 10 && out[i + 1] == 200 && out[i + 2] == 90 && out[i + 3] == 255);
+    const unsigned char grey[4] = { 128, 128, 128, 128 };
+    ResampleToRgba(grey, 2, 2, 1, 4, out);
+    for (size_t i = 0; i < out.size(); i += 4)
+        assert(out[i] == 128 && out[i + 1] == 128 && out[i + 2] == 128 && out[i + 3] == 255);
+
+    // a mip chain adds a third; RGB is stored as four bytes per texel
+    assert(TextureBytes(4, 4, 4, false) == 64);
+    assert(TextureBytes(4, 4, 4, true) == 64 + 16 + 4);
+    assert(TextureBytes(4, 4, 3, false) == 64);
+    assert(TextureBytes(8, 2, 1, true, 3) == 3 * (16 + 4 + 2 + 1));
+}
@@ -0,0 +1,60 @@
+// packed vertex encoding (common/vertex_quantization.h)
+
+#undef NDEBUG
+#include <cassert>
+
+#include "../common/vertex_quantization.h"
+#include "test_model.h"
+
+#include <cmath>
+#include <vector>
+
+void TestVertexQuantization()
+{
+    // halves: exact where the value fits, round to nearest even, saturate past the range
+    const float exact[] = { 0.0f, 1.0f, -2.0f, 0.5f, 0.333251953125f, 65504.0f };
+    for (float value : exact)
+        assert(HalfToFloat(FloatToHalf(value)) == value);
+    assert(HalfToFloat(FloatToHalf(1.0f + 1.0f / 4096.0f)) == 1.0f);
+    assert(std::isinf(HalfToFloat(FloatToHalf(1.0e6f))));
+
+    // octahedral normals within a twentieth of a degree over the sphere, poles included
+    for (int i = 0; i <= 64; ++i)
+        for (int j = 0; j < 64; ++j)
+        {
+            float theta = 3.14159265f * i / 64.0f, phi = 6.2831853f * j / 64.0f;
+            glm::vec3 n(std::sin(theta) * std::cos(phi), std::cos(theta), std::sin(theta) * std::sin(phi));
+            int16_t packed[2];
+            OctEncode(n, packed);
+            assert(AngleDegrees(OctDecode(packed), n) < 0.05f);
+        }
+
+    // a mesh far from the origin: positions within one 16-bit step of the box, weights
+    // summing to 255, missing bones as 255 and ids past the range clamped to the rest pose
+    TestMesh mesh = MakeGridMesh(16, 300.0f, glm::vec3(1000.0f, 50.0f, -2000.0f));
+    for (size_t i = 0; i < mesh.vertices.size(); ++i)
+    {
+        TestVertex& v = mesh.vertices[i];
+        v.Position.y += std::sin(static_cast<float>(i)) * 20.0f;
+        v.m_BoneIDs[0] = static_cast<int>(i % 40);
+        v.m_BoneIDs[1] = i % 7 == 0 ? 300 : static_cast<int>(i % 13);
+        v.m_Weights[0] = 0.7f;
+        v.m_Weights[1] = 0.3f;
+    }
+    std::vector<PackedVertex> packed;
+    glm::vec3 boundsMin, boundsExtent;
+    QuantizationError error;
+    PackMeshVertices(mesh, packed, boundsMin, boundsExtent, error);
+    assert(packed.size() == mesh.vertices.size() && error.vertices == mesh.vertices.size());
+    assert(error.position <= glm::length(boundsExtent) / 65535.0f + 1.0e-6f);
+    assert(error.texCoord < 1.0e-3f && error.weight <= 0.5f / 255.0f + 1.0e-6f);
+    int clamped = 0;
+    for (size_t i = 0; i < packed.size(); ++i)
+    {
+        const PackedVertex& p = packed[i];
+        assert(p.weights[0] + p.weights[1] + p.weights[2] + p.weights[3] == 255);
+        assert(p.boneIds[0] == i % 40 && p.boneIds[2] == PACKED_BONE_NONE && p.boneIds[3] == PACKED_BONE_NONE);
+        clamped += p.boneIds[1] == PACKED_BONE_REST;
+    }
+    assert(clamped == error.clampedBoneIds && clamped > 0);
+}